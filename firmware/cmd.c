@@ -0,0 +1,171 @@
+#include "cmd.h"
+#include "cmd_usb.h"
+
+#include <string.h>
+
+#define MAGIC_LO ((uint8_t)(PKT_MAGIC & 0xFF))
+#define MAGIC_HI ((uint8_t)(PKT_MAGIC >> 8))
+
+// ---------------- assembly buffer ----------------
+
+static void consume(cmd_t* c, uint16_t n)
+{
+    c->have -= n;
+    memmove(c->buf, c->buf + n, c->have);
+}
+
+// Drops buf[0] and everything up to the next byte that could start a
+// magic. The bytes after it stay, so a frame hidden behind a false
+// header is parsed from what was already read.
+static void resync(cmd_t* c)
+{
+    uint16_t i = 1;
+    while (i < c->have &&
+           !(c->buf[i] == MAGIC_LO &&
+             (i + 1 == c->have || c->buf[i + 1] == MAGIC_HI)))
+        i++;
+
+    c->stats.resync_bytes += i;
+    consume(c, i);
+}
+
+// ---------------- dispatch ----------------
+
+static void dispatch(cmd_t* c, const pkt_view_t* v)
+{
+    const cmd_handlers_t* h = &c->h;
+    c->stats.frames++;
+
+    switch (v->type)
+    {
+    case PKT_TYPE_HEARTBEAT:
+    {
+        uint64_t host_tx;
+        if (!pkt_decode_heartbeat(v, &host_tx))
+            break;      // untimed (older host): echoed
+
+        c->stats.heartbeats++;
+        if (h->heartbeat)
+            h->heartbeat(h->ctx, v->seq, host_tx, c->rx_us);
+        return;
+    }
+
+    case PKT_TYPE_FORCES:
+    {
+        pkt_force_t forces[PKT_FORCES_MAX];
+        uint8_t n;
+        if (!pkt_decode_forces(v, forces, PKT_FORCES_MAX, &n))
+        {
+            c->stats.malformed++;
+            return;
+        }
+
+        c->stats.forces++;
+        if (h->forces)
+            h->forces(h->ctx, v->seq, forces, n, c->rx_us);
+        return;
+    }
+
+    default:
+        break;
+    }
+
+    c->stats.other++;
+    if (h->other)
+        h->other(h->ctx, v, c->buf, c->rx_us);
+}
+
+// ---------------- parser ----------------
+
+// Reads until buf starts with a whole, valid frame and dispatches it.
+// Returns false once the FIFO has run dry.
+static bool next_frame(cmd_t* c)
+{
+    for (;;)
+    {
+        // the header first, then exactly the rest of the frame, so a read
+        // never goes past this frame (the shortest frame is longer than
+        // a header)
+        uint16_t need = PKT_HEADER_SIZE;
+
+        if (c->have >= 2 && pkt_get_u16(c->buf) != PKT_MAGIC)
+        {
+            resync(c);
+            continue;
+        }
+
+        if (c->have >= PKT_HEADER_SIZE)
+        {
+            uint16_t size = pkt_get_u16(c->buf + 2);
+            if (size > CMD_FRAME_MAX - PKT_OVERHEAD)
+            {
+                c->stats.oversize++;
+                resync(c);
+                continue;
+            }
+            need = (uint16_t)(PKT_OVERHEAD + size);
+        }
+
+        if (c->have < need)
+        {
+            uint32_t n = cmd_usb_read(c->buf + c->have,
+                                      (uint32_t)(need - c->have));
+            if (!n)
+                return false;
+
+            if (!c->have)
+                c->rx_us = cmd_usb_time_us();
+            c->have += (uint16_t)n;
+            c->stats.bytes += n;
+
+            if (c->have < need)
+                return false;
+            continue;       // header done: now the frame length is known
+        }
+
+        // magic and size are checked, so only the CRC can fail here
+        pkt_view_t v;
+        if (pkt_decode(c->buf, need, &v) != PKT_OK)
+        {
+            c->stats.bad_crc++;
+            resync(c);
+            continue;
+        }
+
+        dispatch(c, &v);
+        consume(c, need);
+        return true;
+    }
+}
+
+void cmd_init(cmd_t* c, const cmd_handlers_t* h, uint32_t budget_us)
+{
+    memset(c, 0, sizeof(*c));
+    c->h = *h;
+    c->budget_us = budget_us;
+}
+
+uint32_t cmd_task(cmd_t* c)
+{
+    uint64_t t0 = cmd_usb_time_us();
+    uint64_t t = t0;
+    uint32_t n = 0;
+
+    while (next_frame(c))
+    {
+        n++;
+
+        t = cmd_usb_time_us();
+        if (t - t0 >= c->budget_us)
+        {
+            if (c->have || cmd_usb_available())
+                c->stats.budget_stops++;
+            break;
+        }
+    }
+
+    if (t - t0 > c->stats.max_task_us)
+        c->stats.max_task_us = (uint32_t)(t - t0);
+
+    return n;
+}
@@ -0,0 +1,102 @@
+//
+// Host command parser.
+//
+// The device-side counterpart of the middleware's parse_from_ring: takes
+// the byte stream the host writes to the vendor OUT endpoint, finds
+// PacketHeader frames in it (shared/packet_codec.h) whatever the 64-byte
+// USB packet boundaries, checks their CRC and dispatches them by type.
+//
+// Bytes are read from the tinyusb FIFO straight to their place in the
+// frame being assembled (header first, then exactly the rest of the
+// frame), so there is no bounce buffer and handlers get pointers into
+// that one copy. Junk before a frame, a header claiming more than
+// CMD_FRAME_MAX bytes or a bad CRC costs a resync: the parser drops to
+// the next magic in the bytes it already holds, so a false header never
+// swallows the real frame behind it.
+//
+// cmd_task runs in the main loop and stops once a call has taken
+// budget_us, leaving the rest in the FIFO (tinyusb NAKs the host until
+// there is room again), so a burst of commands can't delay the finger
+// stream by more than the budget plus one handler.
+//
+// No Pico SDK or tinyusb dependency: reads go through the shim in
+// cmd_usb.h, so the parser also builds on the host (see the
+// middleware's --fw-cmd-bench).
+//
+
+#ifndef CMD_H
+#define CMD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "packet_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------- config ----------------
+
+#define CMD_FRAME_MAX         64      // CFG_TUD_VENDOR_RX_BUFSIZE
+
+// ---------------- handlers ----------------
+
+// Called from cmd_task. rx_us is when the frame's first bytes were read.
+typedef struct {
+    // type 2 with a host timestamp
+    void (*heartbeat)(void* ctx, uint16_t seq, uint64_t host_tx_us,
+                      uint64_t rx_us);
+
+    // type 5, already decoded
+    void (*forces)(void* ctx, uint16_t seq, const pkt_force_t* forces,
+                   uint8_t count, uint64_t rx_us);
+
+    // probes, untimed heartbeats and unknown types: the whole frame
+    void (*other)(void* ctx, const pkt_view_t* v, const uint8_t* frame,
+                  uint64_t rx_us);
+
+    void* ctx;
+} cmd_handlers_t;
+
+// ---------------- state ----------------
+
+typedef struct {
+    uint64_t bytes;            // read from the FIFO
+    uint64_t frames;           // dispatched
+    uint64_t heartbeats;
+    uint64_t forces;
+    uint64_t other;
+    uint64_t bad_crc;
+    uint64_t oversize;         // header claimed more than CMD_FRAME_MAX
+    uint64_t malformed;        // known type, payload too short
+    uint64_t resyncs;
+    uint64_t resync_bytes;     // dropped looking for a magic
+    uint64_t budget_stops;     // cmd_task returned with bytes left
+    uint32_t max_task_us;      // longest cmd_task call
+} cmd_stats_t;
+
+typedef struct {
+    cmd_handlers_t h;
+    uint32_t budget_us;
+
+    // frame being assembled: buf[0..have)
+    uint8_t  buf[CMD_FRAME_MAX];
+    uint16_t have;
+    uint64_t rx_us;
+
+    cmd_stats_t stats;
+} cmd_t;
+
+void cmd_init(cmd_t* c, const cmd_handlers_t* h, uint32_t budget_us);
+
+// Main loop context: read and dispatch frames until the FIFO runs dry
+// or budget_us has passed (at least one frame per call). Returns the
+// number of frames dispatched.
+uint32_t cmd_task(cmd_t* c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
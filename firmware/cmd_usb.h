@@ -0,0 +1,27 @@
+//
+// Minimal USB shim for the command parser.
+//
+// The parser only needs to read the vendor OUT FIFO and a microsecond
+// clock. The firmware maps these onto tinyusb and the Pico SDK
+// (firmware.c); the middleware bench provides a host model of the
+// 64-byte FIFO.
+//
+
+#ifndef CMD_USB_H
+#define CMD_USB_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t cmd_usb_available(void);               // tud_vendor_available
+uint32_t cmd_usb_read(void* buf, uint32_t n);   // tud_vendor_read
+uint64_t cmd_usb_time_us(void);                 // time_us_64
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,11 +1,133 @@
+#include <string.h>
+
 #include "pico/stdlib.h"
 #include "tusb.h"
+#include "cmd.h"
+#include "cmd_usb.h"
+#include "stream.h"
+#include "stream_usb.h"
 
 #define LED_PIN PICO_DEFAULT_LED_PIN
 
 static bool led_state = false;
 
-static uint8_t rx_buf[64];
+// Finger stream at 1 kHz. A 180-byte frame needs 2.81 packets, so holding
+// tails back saves at most ~6% of transactions, and without a short packet
+// the host's IN transfer only completes when full (ms of latency, see
+// --fw-stream-bench). Flush every frame's tail; raise flush_us and
+// bank_samples for rates where the bus is the limit.
+static const stream_config_t stream_cfg = {
+    .period_us    = 1000,
+    .bank_samples = 1,
+    .flush_us     = 0,
+};
+
+static stream_t stream;
+static repeating_timer_t sample_timer;
+
+// Host commands, at most 50 us of them per main loop pass: well under
+// the 1 ms sample period, so the finger stream keeps its pace under a
+// burst of commands.
+#define CMD_BUDGET_US 50
+
+static cmd_t cmd;
+
+// latest forces from the host, until actuators are wired up
+static pkt_force_t forces[PKT_FORCES_MAX];
+static uint8_t force_count;
+
+// ---------------- stream USB shim ----------------
+
+uint32_t stream_usb_write_available(void)
+{
+    return tud_vendor_write_available();
+}
+
+uint32_t stream_usb_write(const void* data, uint32_t n)
+{
+    return tud_vendor_write(data, n);
+}
+
+void stream_usb_flush(void)
+{
+    tud_vendor_flush();
+}
+
+// ---------------- command USB shim ----------------
+
+uint32_t cmd_usb_available(void)
+{
+    return tud_vendor_available();
+}
+
+uint32_t cmd_usb_read(void* buf, uint32_t n)
+{
+    return tud_vendor_read(buf, n);
+}
+
+uint64_t cmd_usb_time_us(void)
+{
+    return time_us_64();
+}
+
+// ---------------- commands ----------------
+
+// timed heartbeat: answer with our clock for the host's sync
+static void on_heartbeat(void* ctx, uint16_t seq, uint64_t host_tx,
+                         uint64_t rx_us)
+{
+    (void) ctx;
+
+    uint8_t reply[PKT_TIME_REPLY_FRAME];
+    size_t len = pkt_encode_time_reply(reply, sizeof(reply), seq,
+                                       host_tx, rx_us, time_us_64());
+    stream_write_raw(&stream, reply, (uint16_t)len, rx_us);
+}
+
+static void on_forces(void* ctx, uint16_t seq, const pkt_force_t* f,
+                      uint8_t count, uint64_t rx_us)
+{
+    (void) ctx;
+    (void) seq;
+    (void) rx_us;
+
+    memcpy(forces, f, count * sizeof(pkt_force_t));
+    force_count = count;
+}
+
+// anything else: echo back, in order with the finger stream
+static void on_other(void* ctx, const pkt_view_t* v, const uint8_t* frame,
+                     uint64_t rx_us)
+{
+    (void) ctx;
+
+    stream_write_raw(&stream, frame, (uint16_t)v->frame_len, rx_us);
+}
+
+static const cmd_handlers_t cmd_handlers = {
+    .heartbeat = on_heartbeat,
+    .forces    = on_forces,
+    .other     = on_other,
+};
+
+// ---------------- sampling ----------------
+
+// Timer ISR. No sensors are wired up yet, so fingers report rest pose.
+static bool sample_cb(repeating_timer_t* t)
+{
+    (void) t;
+
+    stream_sample_t smp;
+    memset(&smp, 0, sizeof(smp));
+
+    smp.timestamp_us = time_us_64();
+    smp.count = STREAM_MAX_FINGERS;
+    for (uint8_t i = 0; i < smp.count; ++i)
+        smp.fingers[i].state_array = i;
+
+    stream_push_sample(&stream, &smp);
+    return true;
+}
 
 void tud_mount_cb(void) {}
 void tud_unmount_cb(void) {}
@@ -16,23 +138,17 @@ void tud_suspend_cb(bool remote_wakeup_en) {
 
 void tud_resume_cb(void) {}
 
-// Called when data received
+// Called when data received. The bytes stay in the OUT FIFO for
+// cmd_task in the main loop, which frames them.
 void tud_vendor_rx_cb(uint8_t itf, uint8_t const* buffer, uint16_t bufsize)
 {
     (void) itf;
+    (void) buffer;
 
     if (bufsize)
     {
         led_state = !led_state;
         gpio_put(LED_PIN, led_state);
-
-        // drain the OUT FIFO
-        uint8_t tmp[64];
-        tud_vendor_read(tmp, bufsize);
-
-        // echo back
-        tud_vendor_write(tmp, bufsize);
-        tud_vendor_flush();
     }
 }
 
@@ -45,7 +161,14 @@ int main(void) {
 
   tusb_init();
 
+  stream_init(&stream, &stream_cfg);
+  cmd_init(&cmd, &cmd_handlers, CMD_BUDGET_US);
+  add_repeating_timer_us(-(int64_t)stream_cfg.period_us, sample_cb, NULL,
+                         &sample_timer);
+
   while (true) {
     tud_task();
+    cmd_task(&cmd);
+    stream_task(&stream, time_us_64());
   }
 }
\ No newline at end of file
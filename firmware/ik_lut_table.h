@@ -0,0 +1,405 @@
+//
+// Generated by the middleware: --ik-check 1,1.25 --ik-gen (make ik-table).
+// Do not edit. max_err 1.1433 deg over 5760 checked samples, 82 reachable
+// entries of 361.
+//
+
+#ifndef IK_LUT_TABLE_H
+#define IK_LUT_TABLE_H
+
+#include "ik_lut.h"
+
+#if IK_LUT_MAX_ENTRIES < 361
+#error "IK_LUT_MAX_ENTRIES too small for ik_lut_table.h"
+#endif
+
+static const ik_lut_t IK_LUT_TABLE = {
+    .min_deg         = -180.0f,
+    .step_deg        = 1.0f,
+    .inv_step        = 1.0f,
+    .count           = 361,
+    .reachable_count = 82,
+    .max_err_deg     = 1.14334774f,
+    .edge_cells      = 2,
+    .uncovered       = 4,
+    .spurious        = 0,
+    .joints = {
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -18.2921658f, 23.2921982f, 89.9999695f },
+        { 0.0f, -15.9977903f, 21.9978237f, 89.9999695f },
+        { 0.0f, -13.7172985f, 20.7173424f, 89.9999542f },
+        { 0.0f, -11.4507475f, 19.4507484f, 90.0f },
+        { 0.0f, -9.19661903f, 18.1966419f, 89.9999771f },
+        { 0.0f, -6.95512104f, 16.9551563f, 89.9999619f },
+        { 0.0f, -4.72529936f, 15.725399f, 89.9999008f },
+        { 0.0f, -2.50683355f, 14.5068359f, 90.0f },
+        { 0.0f, -0.299403578f, 13.2995052f, 89.9999008f },
+        { 0.0f, 1.89761257f, 12.1024227f, 89.9999619f },
+        { 0.0f, 4.08436203f, 10.9157505f, 89.9998856f },
+        { 0.0f, 6.26126289f, 9.73882866f, 89.9999084f },
+        { 0.0f, 8.42843533f, 8.57164955f, 89.9999161f },
+        { 0.0f, 10.5860062f, 7.41405725f, 89.999939f },
+        { 0.0f, 12.7339926f, 6.26605844f, 89.9999466f },
+        { 0.0f, 14.8723383f, 5.12771654f, 89.9999466f },
+        { 0.0f, 17.0009022f, 3.99916959f, 89.9999237f },
+        { 0.0f, 19.1194515f, 2.88059831f, 89.9999466f },
+        { 0.0f, 21.2274895f, 1.77251065f, 90.0f },
+        { 0.0f, 23.3238487f, 0.676157773f, 89.9999924f },
+        { 0.0f, 25.2307606f, 0.0540898293f, 89.7151489f },
+        { 0.0f, 26.8952084f, 0.054254584f, 89.0505371f },
+        { 0.0f, 28.5541515f, 0.0544042587f, 88.3914413f },
+        { 0.0f, 30.2074699f, 0.054537382f, 87.7379913f },
+        { 0.0f, 31.8550453f, 0.0546573177f, 87.0902939f },
+        { 0.0f, 33.4967499f, 0.0547662228f, 86.4484863f },
+        { 0.0f, 35.1324615f, 0.0548620149f, 85.8126755f },
+        { 0.0f, 36.7620468f, 0.0549507439f, 85.1829987f },
+        { 0.0f, 38.385376f, 0.0550342724f, 84.5595932f },
+        { 0.0f, 40.0023117f, 0.05510718f, 83.9425812f },
+        { 0.0f, 41.6127205f, 0.0551783964f, 83.3320999f },
+        { 0.0f, 43.2164574f, 0.0552402772f, 82.728302f },
+        { 0.0f, 44.813385f, 0.0552994944f, 82.1313171f },
+        { 0.0f, 46.4033508f, 0.0553522855f, 81.5412979f },
+        { 0.0f, 47.9862137f, 0.0554029532f, 80.9583817f },
+        { 0.0f, 49.5618134f, 0.055448398f, 80.3827362f },
+        { 0.0f, 51.1300049f, 0.0554904155f, 79.8145065f },
+        { 0.0f, 52.6906319f, 0.0555294715f, 79.2538376f },
+        { 0.0f, 54.2435303f, 0.0555677377f, 78.7009048f },
+        { 0.0f, 55.7885437f, 0.0556028821f, 78.1558533f },
+        { 0.0f, 57.3255043f, 0.0556341708f, 77.6188583f },
+        { 0.0f, 58.8542519f, 0.0556623749f, 77.0900879f },
+        { 0.0f, 60.3746147f, 0.0556897074f, 76.5696945f },
+        { 0.0f, 61.8864288f, 0.055716686f, 76.0578537f },
+        { 0.0f, 63.3895149f, 0.0557390302f, 75.5547485f },
+        { 0.0f, 64.8837051f, 0.0557582155f, 75.0605316f },
+        { 0.0f, 66.3688354f, 0.0557583869f, 74.5754089f },
+        { 0.0f, 67.8447189f, 0.0557586774f, 74.0995255f },
+        { 0.0f, 69.3111725f, 0.0557589941f, 73.6330719f },
+        { 0.0f, 70.7680283f, 0.0557600707f, 73.1762161f },
+        { 0.0f, 72.2150955f, 0.0557603464f, 72.7291412f },
+        { 0.0f, 73.6522064f, 0.0557588935f, 72.292038f },
+        { 0.0f, 75.0791702f, 0.0557582527f, 71.8650742f },
+        { 0.0f, 76.4958191f, 0.0557583421f, 71.4484253f },
+        { 0.0f, 77.9019623f, 0.0557593405f, 71.0422821f },
+        { 0.0f, 79.2974167f, 0.0557585843f, 70.6468201f },
+        { 0.0f, 80.6820221f, 0.0557593442f, 70.2622223f },
+        { 0.0f, 82.0555801f, 0.0557588339f, 69.8886566f },
+        { 0.0f, 83.4179306f, 0.0557599105f, 69.5263138f },
+        { 0.0f, 84.7688828f, 0.0557591356f, 69.175354f },
+        { 0.0f, 86.1082764f, 0.0557584167f, 68.8359604f },
+        { 0.0f, 87.435936f, 0.0557589494f, 68.5083008f },
+        { 0.0f, 88.7516937f, 0.055758208f, 68.192543f },
+        { 0.0f, 90.0f, 0.197489113f, 67.8025131f },
+        { 0.0f, 90.0f, 3.56716275f, 65.4328384f },
+        { 0.0f, 90.0f, 6.95887947f, 63.0411186f },
+        { 0.0f, 90.0f, 10.3775415f, 60.6224594f },
+        { 0.0f, 90.0f, 13.828764f, 58.1712341f },
+        { 0.0f, 90.0f, 17.3190136f, 55.6809883f },
+        { 0.0f, 90.0f, 20.8558922f, 53.1441078f },
+        { 0.0f, 90.0f, 24.4484844f, 50.5515175f },
+        { 0.0f, 90.0f, 28.1078835f, 47.8921165f },
+        { 0.0f, 90.0f, 31.8479023f, 45.1520958f },
+        { 0.0f, 90.0f, 35.6862068f, 42.3137932f },
+        { 0.0f, 90.0f, 39.6460953f, 39.3539047f },
+        { 0.0f, 90.0f, 43.7593956f, 36.2406044f },
+        { 0.0f, 90.0f, 48.0717354f, 32.9282646f },
+        { 0.0f, 90.0f, 52.6526451f, 29.3473549f },
+        { 0.0f, 90.0f, 57.6179886f, 25.3820095f },
+        { 0.0f, 90.0f, 63.1891785f, 20.8108215f },
+        { 0.0f, 90.0f, 69.9105453f, 15.0894527f },
+        { 0.0f, 90.0f, 80.7136307f, 5.28636694f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+        { 0.0f, -10.0f, 10.0f, 10.0f },
+    },
+    .reachable = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 0, 0, 0, 0,
+    },
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "stream.h"
+#include "stream_usb.h"
+
+#include <string.h>
+
+// ---------------- framing ----------------
+
+uint16_t stream_frame_sample(uint8_t* out, uint16_t seq,
+                             const stream_sample_t* sample)
+{
+    uint8_t count = sample->count;
+    if (count > STREAM_MAX_FINGERS)
+        count = STREAM_MAX_FINGERS;
+
+    return (uint16_t)pkt_encode_fingers(out, STREAM_FRAME_MAX, seq,
+                                        sample->timestamp_us,
+                                        sample->fingers, count);
+}
+
+// ---------------- TX stage ----------------
+
+static void stage_append(stream_t* s, const uint8_t* data, uint16_t len,
+                         uint64_t now_us)
+{
+    memcpy(s->tx + s->tx_len, data, len);
+    s->tx_len += len;
+
+    if (s->mark_n && (s->mark_us[s->mark_n - 1] == now_us ||
+                      s->mark_n == STREAM_TX_MARKS))
+    {
+        // same instant, or out of marks: extend the newest run
+        s->mark_end[s->mark_n - 1] = s->tx_len;
+        return;
+    }
+
+    s->mark_end[s->mark_n] = s->tx_len;
+    s->mark_us[s->mark_n]  = now_us;
+    s->mark_n++;
+}
+
+static void stage_consume(stream_t* s, uint16_t n)
+{
+    s->tx_len -= n;
+    memmove(s->tx, s->tx + n, s->tx_len);
+
+    uint8_t keep = 0;
+    for (uint8_t i = 0; i < s->mark_n; ++i)
+    {
+        if (s->mark_end[i] <= n)
+            continue;
+        s->mark_end[keep] = (uint16_t)(s->mark_end[i] - n);
+        s->mark_us[keep]  = s->mark_us[i];
+        keep++;
+    }
+    s->mark_n = keep;
+}
+
+static void pump(stream_t* s, uint64_t now_us)
+{
+    // whole packets first
+    while (s->tx_len >= STREAM_USB_PACKET &&
+           stream_usb_write_available() >= STREAM_USB_PACKET)
+    {
+        stream_usb_write(s->tx, STREAM_USB_PACKET);
+        stream_usb_flush();
+        stage_consume(s, STREAM_USB_PACKET);
+
+        s->stats.packets_full++;
+        s->stats.bytes += STREAM_USB_PACKET;
+    }
+
+    // then the tail, once its oldest byte has waited long enough; the
+    // short packet also completes the host's pending IN transfer
+    if (s->tx_len && s->tx_len < STREAM_USB_PACKET &&
+        now_us - s->mark_us[0] >= s->cfg.flush_us &&
+        stream_usb_write_available() >= s->tx_len)
+    {
+        uint16_t n = s->tx_len;
+
+        stream_usb_write(s->tx, n);
+        stream_usb_flush();
+        stage_consume(s, n);
+
+        s->stats.packets_short++;
+        s->stats.bytes += n;
+    }
+}
+
+// ---------------- API ----------------
+
+void stream_init(stream_t* s, const stream_config_t* cfg)
+{
+    memset(s, 0, sizeof(*s));
+    s->cfg = *cfg;
+
+    if (s->cfg.bank_samples < 1)
+        s->cfg.bank_samples = 1;
+    if (s->cfg.bank_samples > STREAM_BANK_MAX)
+        s->cfg.bank_samples = STREAM_BANK_MAX;
+}
+
+bool stream_push_sample(stream_t* s, const stream_sample_t* sample)
+{
+    uint8_t b = s->fill_bank;
+
+    // the bank being filled is still queued: the main loop has fallen
+    // two banks behind
+    if (__atomic_load_n(&s->ready[b], __ATOMIC_ACQUIRE))
+    {
+        s->stats.sample_overruns++;
+        return false;
+    }
+
+    s->bank[b][s->fill_count++] = *sample;
+    s->stats.samples++;
+
+    if (s->fill_count == s->cfg.bank_samples)
+    {
+        __atomic_store_n(&s->ready[b], 1, __ATOMIC_RELEASE);
+        s->fill_bank = b ^ 1;
+        s->fill_count = 0;
+    }
+
+    return true;
+}
+
+void stream_task(stream_t* s, uint64_t now_us)
+{
+    uint8_t frame[STREAM_FRAME_MAX];
+
+    while (__atomic_load_n(&s->ready[s->drain_bank], __ATOMIC_ACQUIRE))
+    {
+        const stream_sample_t* bank = s->bank[s->drain_bank];
+
+        while (s->drain_pos < s->cfg.bank_samples)
+        {
+            uint16_t n = stream_frame_sample(frame, s->seq,
+                                             &bank[s->drain_pos]);
+
+            // no room: make some and try again on the next call
+            if (s->tx_len + n > STREAM_TX_STAGE)
+            {
+                pump(s, now_us);
+                if (s->tx_len + n > STREAM_TX_STAGE)
+                    return;
+            }
+
+            stage_append(s, frame, n, now_us);
+            s->seq++;
+            s->drain_pos++;
+            s->stats.frames++;
+        }
+
+        s->drain_pos = 0;
+        __atomic_store_n(&s->ready[s->drain_bank], 0, __ATOMIC_RELEASE);
+        s->drain_bank ^= 1;
+    }
+
+    pump(s, now_us);
+}
+
+bool stream_write_raw(stream_t* s, const uint8_t* data, uint16_t len,
+                      uint64_t now_us)
+{
+    if (s->tx_len + len > STREAM_TX_STAGE)
+    {
+        pump(s, now_us);
+        if (s->tx_len + len > STREAM_TX_STAGE)
+            return false;
+    }
+
+    stage_append(s, data, len, now_us);
+    pump(s, now_us);
+    return true;
+}
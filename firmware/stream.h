@@ -0,0 +1,109 @@
+//
+// Finger sample streaming engine.
+//
+// A timer ISR samples at a fixed period into one of two banks
+// (stream_push_sample); when a bank is full it is handed to the main loop,
+// which frames every sample as a type 1 packet (shared/packet_codec.h)
+// and writes the byte stream to the vendor IN endpoint in whole 64-byte
+// packets (stream_task). A trailing partial packet is held back until
+// more data arrives or flush_us has passed, so a steady stream costs one
+// USB transaction per 64 bytes instead of one or more per frame.
+//
+// No Pico SDK or tinyusb dependency: USB access goes through the shim in
+// stream_usb.h, so the engine also builds on the host (see the
+// middleware's --fw-stream-bench).
+//
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "packet_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------- config ----------------
+
+#define STREAM_USB_PACKET     64      // CFG_TUD_VENDOR_TX_BUFSIZE
+#define STREAM_MAX_FINGERS    5
+#define STREAM_BANK_MAX       16      // samples per bank
+#define STREAM_TX_STAGE       1024    // framed bytes waiting for USB
+#define STREAM_TX_MARKS       32
+
+typedef struct {
+    uint32_t period_us;      // sampling period
+    uint16_t bank_samples;   // samples per bank, 1..STREAM_BANK_MAX
+    uint32_t flush_us;       // max age of a held partial packet, 0 = never hold
+} stream_config_t;
+
+// ---------------- wire types ----------------
+
+#define STREAM_FRAME_MAX      PKT_FINGERS_FRAME(STREAM_MAX_FINGERS)
+
+typedef struct {
+    uint64_t        timestamp_us;
+    uint8_t         count;
+    pkt_finger_t    fingers[STREAM_MAX_FINGERS];
+} stream_sample_t;
+
+// ---------------- state ----------------
+
+typedef struct {
+    uint64_t samples;          // accepted by stream_push_sample
+    uint64_t sample_overruns;  // dropped: both banks full
+    uint64_t frames;           // framed into the TX stage
+    uint64_t packets_full;     // 64-byte USB packets written
+    uint64_t packets_short;    // flushed partial packets
+    uint64_t bytes;
+} stream_stats_t;
+
+typedef struct {
+    stream_config_t cfg;
+
+    // double buffer, written by the ISR and drained by the main loop
+    stream_sample_t bank[2][STREAM_BANK_MAX];
+    uint16_t        fill_count;     // ISR only
+    uint8_t         fill_bank;      // ISR only
+    volatile uint8_t ready[2];      // set by ISR, cleared by main loop
+
+    uint8_t  drain_bank;            // main loop only
+    uint16_t drain_pos;             // main loop only
+
+    // framed bytes not yet handed to USB, with the time each run of
+    // bytes was staged so flush_us bounds the age of the oldest byte
+    uint8_t  tx[STREAM_TX_STAGE];
+    uint16_t tx_len;
+    uint16_t mark_end[STREAM_TX_MARKS];
+    uint64_t mark_us[STREAM_TX_MARKS];
+    uint8_t  mark_n;
+
+    uint16_t seq;
+    stream_stats_t stats;
+} stream_t;
+
+void stream_init(stream_t* s, const stream_config_t* cfg);
+
+// ISR context. Returns false if the sample was dropped.
+bool stream_push_sample(stream_t* s, const stream_sample_t* sample);
+
+// Main loop context: frame ready banks and move whole packets to USB.
+void stream_task(stream_t* s, uint64_t now_us);
+
+// Main loop context: queue raw bytes (e.g. an echo reply) behind the
+// frames already staged. Returns false if the stage is full.
+bool stream_write_raw(stream_t* s, const uint8_t* data, uint16_t len,
+                      uint64_t now_us);
+
+// Frames one sample into 'out' (STREAM_FRAME_MAX bytes); returns length.
+uint16_t stream_frame_sample(uint8_t* out, uint16_t seq,
+                             const stream_sample_t* sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
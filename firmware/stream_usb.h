@@ -0,0 +1,26 @@
+//
+// Minimal USB shim for the streaming engine.
+//
+// The engine only needs these three calls on the vendor IN FIFO. The
+// firmware maps them onto tinyusb (firmware.c); the middleware bench
+// provides a host model of the 64-byte FIFO.
+//
+
+#ifndef STREAM_USB_H
+#define STREAM_USB_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t stream_usb_write_available(void);               // tud_vendor_write_available
+uint32_t stream_usb_write(const void* data, uint32_t n); // tud_vendor_write
+void     stream_usb_flush(void);                         // tud_vendor_flush
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+"""
+Frames/s into Python: parsing the middleware's printf output versus the
+soupy extension's block callbacks.
+
+    make sim && make py
+    PYTHONPATH=build python3 python/bench_ingest.py [--secs 5]
+
+Both runs use the sim transport unpaced, so they measure how fast Python
+can take frames in, not the sim rate. The printf path only carries seq,
+timestamp and count per frame; the extension hands over every finger
+field.
+"""
+
+import argparse
+import re
+import subprocess
+import time
+
+import numpy as np
+
+import soupy
+
+FINGERS_RE = re.compile(rb"\[FINGERS\] seq=(\d+) ts=(\d+) count=(\d+)")
+
+
+def bench_printf(secs, binary):
+    proc = subprocess.Popen([binary, "--run-secs", str(secs)],
+                            stdout=subprocess.PIPE)
+    seqs, stamps, counts = [], [], []
+
+    t0 = time.perf_counter()
+    for line in proc.stdout:
+        m = FINGERS_RE.match(line)
+        if m:
+            seqs.append(int(m.group(1)))
+            stamps.append(int(m.group(2)))
+            counts.append(int(m.group(3)))
+    elapsed = time.perf_counter() - t0
+    proc.wait()
+
+    # what a numpy user would do with it afterwards
+    ts = np.array(stamps, dtype=np.uint64)
+    return len(ts), elapsed
+
+
+def bench_extension(secs, block):
+    p = soupy.Pipeline(history=block * 64, fingers=5, block=block, sim_hz=0)
+    frames = 0
+    acc = 0.0
+
+    def on_block(first, b):
+        nonlocal frames, acc
+        x = np.asarray(b["x"])
+        acc += float(x[:, 0].sum())
+        frames += x.shape[0]
+
+    p.on_block(on_block)
+
+    with p:
+        t0 = time.perf_counter()
+        while time.perf_counter() - t0 < secs:
+            p.pump(0.01)
+        elapsed = time.perf_counter() - t0
+
+    return frames, elapsed, p.overruns
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--secs", type=float, default=5.0)
+    ap.add_argument("--block", type=int, default=256)
+    ap.add_argument("--binary", default="./build/middleware")
+    args = ap.parse_args()
+
+    n, dt = bench_printf(int(args.secs), args.binary)
+    print(f"[PY-BENCH] printf parse: {n} frames in {dt:.2f} s "
+          f"= {n / dt:,.0f} frames/s (seq/ts/count only)")
+
+    n, dt, over = bench_extension(args.secs, args.block)
+    print(f"[PY-BENCH] extension:    {n} frames in {dt:.2f} s "
+          f"= {n / dt:,.0f} frames/s = {5 * n / dt:,.0f} finger samples/s "
+          f"(block {args.block}, overruns {over})")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,612 @@
+// --------------------------------------------------
+// soupy: Python extension running the middleware pipeline in process
+// --------------------------------------------------
+//
+//   import soupy, numpy as np
+//
+//   p = soupy.Pipeline(history=4096, fingers=5, block=64)
+//   p.on_block(lambda first, b: print(first, np.asarray(b["x"]).mean()))
+//   p.start()
+//   p.pump(1.0)                       # deliver completed blocks
+//   x = np.asarray(p.x)               # (history, fingers) float64, no copy
+//   p.stop()
+//
+// A pipeline thread polls the transport, parses and appends every finger
+// frame to a FingerHistory (src/finger_history.hpp); it never touches
+// Python. The history columns are exported through the buffer protocol,
+// so np.asarray() / memoryview() see the middleware's own arrays. Views
+// are live: rows are overwritten once the history wraps, and p.head
+// tells where the newest frame is.
+//
+// on_block() callbacks run in the thread calling pump(), one per
+// completed block of 'block' frames, with a dict of views onto just that
+// block. A block stays intact until the writer laps it, about
+// history - block frames later; a pump() that falls further behind skips
+// ahead and counts the frames it missed in p.overruns. So does a block
+// the writer reached while its own callback was still running.
+//
+// Built by 'make py' (sim transport), 'make py-fake' or 'make py-hw'.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "transport.hpp"
+#include "protocol.hpp"
+#include "ring_buffer.hpp"
+#include "finger_history.hpp"
+#include "host_clock.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+// --------------------------------------------------
+// Pipeline state (no Python objects)
+// --------------------------------------------------
+
+struct HistoryHandler : PacketHandler
+{
+    explicit HistoryHandler(FingerHistory& h) : hist(h) {}
+
+    FingerHistory& hist;
+
+    void on_finger_packet(uint16_t seq, uint64_t timestamp,
+                          const FingerArrayView& fingers) override
+    {
+        hist.append(seq, timestamp, fingers);
+    }
+
+    void on_unknown(uint8_t, uint16_t, const uint8_t*, uint16_t) override {}
+};
+
+struct PipelineState
+{
+    PipelineState(size_t frames, size_t width, const TransportConfig& cfg)
+        : hist(frames, width), handler(hist), tcfg(cfg) {}
+
+    FingerHistory hist;
+    HistoryHandler handler;
+    TransportConfig tcfg;
+
+    std::unique_ptr<ITransport> transport;
+    std::thread worker;
+    std::atomic<bool> running{false};
+
+    void loop()
+    {
+        ByteRing ring(16384);
+        uint8_t buf[1024];
+        uint16_t hb_seq = 0;
+        auto next_hb = std::chrono::steady_clock::now();
+
+        while (running.load())
+        {
+            transport->poll(1000);
+
+            int n;
+            while ((n = transport->read(buf, sizeof(buf))) > 0)
+            {
+                ring.push(buf, (size_t)n);
+                parse_from_ring(ring, handler);
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_hb)
+            {
+                uint8_t pkt[PKT_HEARTBEAT_FRAME];
+                size_t len = pkt_encode_heartbeat(pkt, sizeof(pkt), hb_seq++,
+                                                  host_now_us());
+                transport->write(pkt, (int)len);
+
+                next_hb += std::chrono::milliseconds(10);
+                if (next_hb < now)
+                    next_hb = now + std::chrono::milliseconds(10);
+            }
+        }
+    }
+};
+
+// --------------------------------------------------
+// soupy.Column: one history column as a buffer
+// --------------------------------------------------
+
+struct ColumnObject
+{
+    PyObject_HEAD
+    PyObject*  owner;       // keeps the Pipeline (and its arrays) alive
+    void*      data;
+    const char* format;
+    Py_ssize_t itemsize;
+    int        ndim;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+};
+
+static PyTypeObject ColumnType;
+
+static int column_getbuffer(PyObject* self, Py_buffer* view, int flags)
+{
+    ColumnObject* c = (ColumnObject*)self;
+
+    if (flags & PyBUF_WRITABLE)
+    {
+        PyErr_SetString(PyExc_BufferError, "history columns are read-only");
+        return -1;
+    }
+
+    view->obj = self;
+    Py_INCREF(self);
+    view->buf = c->data;
+    view->len = c->itemsize * c->shape[0] * (c->ndim == 2 ? c->shape[1] : 1);
+    view->readonly = 1;
+    view->itemsize = c->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)c->format : nullptr;
+    view->ndim = c->ndim;
+    view->shape = (flags & PyBUF_ND) ? c->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) ? c->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+static PyBufferProcs column_as_buffer = { column_getbuffer, nullptr };
+
+static void column_dealloc(PyObject* self)
+{
+    Py_XDECREF(((ColumnObject*)self)->owner);
+    Py_TYPE(self)->tp_free(self);
+}
+
+// rows [row, row + rows) of an array with 'width' items per row
+// (width 0: one-dimensional)
+template <class T>
+static PyObject* make_column(PyObject* owner, const T* base, size_t row,
+                             size_t rows, size_t width, const char* format)
+{
+    ColumnObject* c = PyObject_New(ColumnObject, &ColumnType);
+    if (!c)
+        return nullptr;
+
+    Py_INCREF(owner);
+    c->owner = owner;
+    c->format = format;
+    c->itemsize = sizeof(T);
+
+    size_t w = width ? width : 1;
+    c->data = (void*)(base + row * w);
+    c->ndim = width ? 2 : 1;
+    c->shape[0] = (Py_ssize_t)rows;
+    c->shape[1] = (Py_ssize_t)w;
+    c->strides[0] = (Py_ssize_t)(w * sizeof(T));
+    c->strides[1] = (Py_ssize_t)sizeof(T);
+
+    return (PyObject*)c;
+}
+
+// --------------------------------------------------
+// soupy.Pipeline
+// --------------------------------------------------
+
+struct PipelineObject
+{
+    PyObject_HEAD
+    PipelineState* st;
+    PyObject* callback;
+    size_t    block;
+    uint64_t  delivered;    // frames handed to callbacks or skipped
+    uint64_t  overruns;
+};
+
+static PyTypeObject PipelineType;
+
+static int pipeline_init(PyObject* self, PyObject* args, PyObject* kw)
+{
+    PipelineObject* p = (PipelineObject*)self;
+
+    static const char* kwlist[] = {
+        "history", "fingers", "block", "sim_hz", nullptr };
+
+    Py_ssize_t history = 4096, fingers = 5, block = 64;
+    unsigned sim_hz = 1000;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "|nnnI", (char**)kwlist,
+                                     &history, &fingers, &block, &sim_hz))
+        return -1;
+
+    if (history < 2 || fingers < 1 || fingers > 255 || block < 1)
+    {
+        PyErr_SetString(PyExc_ValueError,
+            "need history >= 2, 1 <= fingers <= 255, block >= 1");
+        return -1;
+    }
+
+    if (p->st)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Pipeline already initialised");
+        return -1;
+    }
+
+    // whole blocks only, and at least two so one can be read while the
+    // next one fills
+    if (block * 2 > history)
+        history = block * 2;
+    history = (history + block - 1) / block * block;
+
+    TransportConfig tcfg;
+    tcfg.sim_rate_hz = sim_hz;
+    tcfg.print_stats = false;
+
+    p->st = new PipelineState((size_t)history, (size_t)fingers, tcfg);
+    p->block = (size_t)block;
+    p->delivered = 0;
+    p->overruns = 0;
+    return 0;
+}
+
+static PyObject* pipeline_stop(PyObject* self, PyObject*);
+
+static void pipeline_dealloc(PyObject* self)
+{
+    PipelineObject* p = (PipelineObject*)self;
+
+    if (p->st)
+    {
+        PyObject* r = pipeline_stop(self, nullptr);
+        Py_XDECREF(r);
+        delete p->st;
+    }
+
+    Py_XDECREF(p->callback);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static PipelineState* state_of(PyObject* self)
+{
+    PipelineState* st = ((PipelineObject*)self)->st;
+    if (!st)
+        PyErr_SetString(PyExc_RuntimeError, "Pipeline not initialised");
+    return st;
+}
+
+static PyObject* pipeline_start(PyObject* self, PyObject*)
+{
+    PipelineState* st = state_of(self);
+    if (!st)
+        return nullptr;
+
+    if (st->running.load())
+        Py_RETURN_NONE;
+
+#if defined(USE_SIM)
+    st->transport = std::make_unique<SimTransport>(st->tcfg);
+#elif defined(USE_USB)
+    st->transport = std::make_unique<USBTransport>(st->tcfg);
+#endif
+
+    st->transport->set_polled(true);
+
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = st->transport->open();
+    Py_END_ALLOW_THREADS
+
+    if (!ok)
+    {
+        st->transport.reset();
+        PyErr_SetString(PyExc_OSError, "transport open failed");
+        return nullptr;
+    }
+
+    // blocks start at the next block boundary, so none wraps the history
+    PipelineObject* p = (PipelineObject*)self;
+    p->delivered = (st->hist.head() + p->block - 1) / p->block * p->block;
+
+    st->running.store(true);
+    st->worker = std::thread([st]{ st->loop(); });
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* pipeline_stop(PyObject* self, PyObject*)
+{
+    PipelineState* st = state_of(self);
+    if (!st)
+        return nullptr;
+
+    if (!st->running.exchange(false))
+        Py_RETURN_NONE;
+
+    Py_BEGIN_ALLOW_THREADS
+    st->worker.join();
+    st->transport->close();
+    Py_END_ALLOW_THREADS
+
+    st->transport.reset();
+    Py_RETURN_NONE;
+}
+
+static PyObject* pipeline_on_block(PyObject* self, PyObject* fn)
+{
+    PipelineObject* p = (PipelineObject*)self;
+
+    if (fn != Py_None && !PyCallable_Check(fn))
+    {
+        PyErr_SetString(PyExc_TypeError, "on_block() needs a callable or None");
+        return nullptr;
+    }
+
+    Py_XDECREF(p->callback);
+    p->callback = fn == Py_None ? nullptr : fn;
+    Py_XINCREF(p->callback);
+
+    Py_RETURN_NONE;
+}
+
+// dict of views onto rows [row, row + n)
+static PyObject* block_views(PyObject* self, size_t row, size_t n)
+{
+    const FingerHistory& h = ((PipelineObject*)self)->st->hist;
+    size_t w = h.width;
+
+    struct { const char* key; PyObject* v; } cols[] = {
+        { "timestamp", make_column(self, h.timestamp.data(), row, n, 0, "Q") },
+        { "seq",       make_column(self, h.seq.data(),       row, n, 0, "H") },
+        { "count",     make_column(self, h.count.data(),     row, n, 0, "B") },
+        { "x",         make_column(self, h.x.data(),         row, n, w, "d") },
+        { "y",         make_column(self, h.y.data(),         row, n, w, "d") },
+        { "z",         make_column(self, h.z.data(),         row, n, w, "d") },
+        { "state",     make_column(self, h.state.data(),     row, n, w, "I") },
+        { "temp",      make_column(self, h.temp.data(),      row, n, w, "f") },
+    };
+
+    PyObject* d = PyDict_New();
+    bool ok = d != nullptr;
+
+    for (auto& c : cols)
+    {
+        ok = ok && c.v && PyDict_SetItemString(d, c.key, c.v) == 0;
+        Py_XDECREF(c.v);
+    }
+
+    if (!ok)
+    {
+        Py_XDECREF(d);
+        return nullptr;
+    }
+    return d;
+}
+
+// Lapped: skip to the oldest block the writer is not filling. After a
+// restart 'delivered' is the next block boundary, which the writer may
+// not have reached yet.
+static void skip_lapped(PipelineObject* p, uint64_t h, size_t cap, size_t B)
+{
+    if (h > p->delivered && h - p->delivered > cap - B)
+    {
+        uint64_t d = (h - (cap - B) + B - 1) / B * B;
+        p->overruns += d - p->delivered;
+        p->delivered = d;
+    }
+}
+
+static PyObject* pipeline_pump(PyObject* self, PyObject* args)
+{
+    PipelineObject* p = (PipelineObject*)self;
+    PipelineState* st = state_of(self);
+    if (!st)
+        return nullptr;
+
+    double timeout = 0.0;
+    if (!PyArg_ParseTuple(args, "|d", &timeout))
+        return nullptr;
+
+    const size_t cap = st->hist.frames;
+    const size_t B = p->block;
+
+    auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::microseconds((int64_t)(timeout * 1e6));
+
+    long blocks = 0;
+
+    for (;;)
+    {
+        // blocks complete by now; later ones wait for the next pump(),
+        // so a writer faster than the callbacks cannot keep us here
+        const uint64_t end = st->hist.head();
+        skip_lapped(p, end, cap, B);
+
+        while (p->delivered + B <= end)
+        {
+            // the writer keeps going while callbacks run, so look again
+            // before every block
+            skip_lapped(p, st->hist.head(), cap, B);
+            if (p->delivered + B > end)
+                break;
+
+            uint64_t first = p->delivered;
+            p->delivered += B;
+            blocks++;
+
+            if (!p->callback)
+                continue;
+
+            PyObject* views = block_views(self, (size_t)(first % cap), B);
+            if (!views)
+                return nullptr;
+
+            PyObject* r = PyObject_CallFunction(p->callback, "KO",
+                (unsigned long long)first, views);
+            Py_DECREF(views);
+
+            if (!r)
+                return nullptr;
+            Py_DECREF(r);
+
+            // overwritten while the callback had it: it saw a torn block
+            if (st->hist.head() > first + cap)
+                p->overruns += B;
+        }
+
+        if (blocks || !st->running.load() ||
+            std::chrono::steady_clock::now() >= deadline)
+            break;
+
+        Py_BEGIN_ALLOW_THREADS
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        Py_END_ALLOW_THREADS
+
+        if (PyErr_CheckSignals())
+            return nullptr;
+    }
+
+    return PyLong_FromLong(blocks);
+}
+
+static PyObject* pipeline_enter(PyObject* self, PyObject*)
+{
+    PyObject* r = pipeline_start(self, nullptr);
+    if (!r)
+        return nullptr;
+    Py_DECREF(r);
+
+    Py_INCREF(self);
+    return self;
+}
+
+static PyObject* pipeline_exit(PyObject* self, PyObject*)
+{
+    PyObject* r = pipeline_stop(self, nullptr);
+    if (!r)
+        return nullptr;
+    Py_DECREF(r);
+
+    Py_RETURN_FALSE;
+}
+
+// ---------------- attributes ----------------
+
+#define COLUMN_GETTER(name, width_expr, fmt)                                 \
+    static PyObject* get_##name(PyObject* self, void*)                      \
+    {                                                                        \
+        PipelineState* st = state_of(self);                                  \
+        if (!st) return nullptr;                                             \
+        const FingerHistory& h = st->hist;                                   \
+        return make_column(self, h.name.data(), 0, h.frames, width_expr, fmt); \
+    }
+
+COLUMN_GETTER(timestamp, 0, "Q")
+COLUMN_GETTER(seq, 0, "H")
+COLUMN_GETTER(count, 0, "B")
+COLUMN_GETTER(x, h.width, "d")
+COLUMN_GETTER(y, h.width, "d")
+COLUMN_GETTER(z, h.width, "d")
+COLUMN_GETTER(state, h.width, "I")
+COLUMN_GETTER(temp, h.width, "f")
+
+#undef COLUMN_GETTER
+
+static PyObject* get_head(PyObject* self, void*)
+{
+    PipelineState* st = state_of(self);
+    return st ? PyLong_FromUnsignedLongLong(st->hist.head()) : nullptr;
+}
+
+static PyObject* get_history(PyObject* self, void*)
+{
+    PipelineState* st = state_of(self);
+    return st ? PyLong_FromSize_t(st->hist.frames) : nullptr;
+}
+
+static PyObject* get_fingers(PyObject* self, void*)
+{
+    PipelineState* st = state_of(self);
+    return st ? PyLong_FromSize_t(st->hist.width) : nullptr;
+}
+
+static PyObject* get_block(PyObject* self, void*)
+{
+    return PyLong_FromSize_t(((PipelineObject*)self)->block);
+}
+
+static PyObject* get_overruns(PyObject* self, void*)
+{
+    return PyLong_FromUnsignedLongLong(((PipelineObject*)self)->overruns);
+}
+
+static PyGetSetDef pipeline_getset[] = {
+    { "timestamp", get_timestamp, nullptr, "device timestamps (us), uint64[history]", nullptr },
+    { "seq",       get_seq,       nullptr, "frame sequence numbers, uint16[history]", nullptr },
+    { "count",     get_count,     nullptr, "fingers in each frame, uint8[history]", nullptr },
+    { "x",         get_x,         nullptr, "float64[history, fingers]", nullptr },
+    { "y",         get_y,         nullptr, "float64[history, fingers]", nullptr },
+    { "z",         get_z,         nullptr, "float64[history, fingers]", nullptr },
+    { "state",     get_state,     nullptr, "state_array, uint32[history, fingers]", nullptr },
+    { "temp",      get_temp,      nullptr, "float32[history, fingers]", nullptr },
+    { "head",      get_head,      nullptr, "frames received; newest is row (head - 1) % history", nullptr },
+    { "history",   get_history,   nullptr, "rows in the history", nullptr },
+    { "fingers",   get_fingers,   nullptr, "columns of the per-finger arrays", nullptr },
+    { "block",     get_block,     nullptr, "frames per on_block() callback", nullptr },
+    { "overruns",  get_overruns,  nullptr, "frames pump() skipped or delivered torn after being lapped", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr },
+};
+
+static PyMethodDef pipeline_methods[] = {
+    { "start",    pipeline_start,    METH_NOARGS,  "open the transport and start the pipeline thread" },
+    { "stop",     pipeline_stop,     METH_NOARGS,  "stop the pipeline thread and close the transport" },
+    { "on_block", pipeline_on_block, METH_O,       "set fn(first_frame, views) called by pump() per block" },
+    { "pump",     pipeline_pump,     METH_VARARGS, "pump(timeout=0.0): run callbacks for completed blocks, "
+                                                   "waiting up to timeout s for one; returns blocks delivered" },
+    { "__enter__", pipeline_enter,   METH_NOARGS,  nullptr },
+    { "__exit__",  pipeline_exit,    METH_VARARGS, nullptr },
+    { nullptr, nullptr, 0, nullptr },
+};
+
+// --------------------------------------------------
+// Module
+// --------------------------------------------------
+
+static PyModuleDef soupy_module = {
+    PyModuleDef_HEAD_INIT,
+    "soupy",
+    "SoupyHaptics middleware pipeline with numpy-friendly finger history",
+    -1,
+    nullptr, nullptr, nullptr, nullptr, nullptr,
+};
+
+PyMODINIT_FUNC PyInit_soupy(void)
+{
+    ColumnType.tp_name = "soupy.Column";
+    ColumnType.tp_doc = "Read-only buffer over one history column";
+    ColumnType.tp_basicsize = sizeof(ColumnObject);
+    ColumnType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ColumnType.tp_dealloc = column_dealloc;
+    ColumnType.tp_as_buffer = &column_as_buffer;
+
+    PipelineType.tp_name = "soupy.Pipeline";
+    PipelineType.tp_doc = "Pipeline(history=4096, fingers=5, block=64, sim_hz=1000)";
+    PipelineType.tp_basicsize = sizeof(PipelineObject);
+    PipelineType.tp_flags = Py_TPFLAGS_DEFAULT;
+    PipelineType.tp_new = PyType_GenericNew;
+    PipelineType.tp_init = pipeline_init;
+    PipelineType.tp_dealloc = pipeline_dealloc;
+    PipelineType.tp_methods = pipeline_methods;
+    PipelineType.tp_getset = pipeline_getset;
+
+    if (PyType_Ready(&ColumnType) < 0 || PyType_Ready(&PipelineType) < 0)
+        return nullptr;
+
+    PyObject* m = PyModule_Create(&soupy_module);
+    if (!m)
+        return nullptr;
+
+    Py_INCREF(&PipelineType);
+    if (PyModule_AddObject(m, "Pipeline", (PyObject*)&PipelineType) < 0)
+    {
+        Py_DECREF(&PipelineType);
+        Py_DECREF(m);
+        return nullptr;
+    }
+
+    return m;
+}
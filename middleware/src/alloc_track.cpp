@@ -0,0 +1,198 @@
+#include "alloc_track.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <new>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+// --------------------------------------------------
+// Per-thread counts
+// --------------------------------------------------
+//
+// Everything here runs inside malloc, so it must not allocate: fixed
+// slots, constant-initialised atomics and plain thread_locals. A thread
+// claims a slot the first time it allocates after alloc_track_arm().
+
+namespace {
+
+constexpr size_t MAX_THREADS = 64;
+
+struct Slot
+{
+    std::atomic<uint64_t> allocs{0};
+    std::atomic<uint64_t> bytes{0};
+    char name[16];
+};
+
+Slot slots[MAX_THREADS];
+std::atomic<size_t> n_slots{0};
+std::atomic<bool> armed{false};
+std::atomic<unsigned> generation{0};
+
+thread_local unsigned tls_generation = 0;
+thread_local Slot* tls_slot = nullptr;
+
+Slot* claim_slot()
+{
+    size_t i = n_slots.fetch_add(1, std::memory_order_relaxed);
+    if (i >= MAX_THREADS)
+        return &slots[MAX_THREADS - 1];     // shared by the overflow
+
+    Slot* s = &slots[i];
+#ifdef __linux__
+    if (prctl(PR_GET_NAME, s->name, 0, 0, 0) != 0)
+#endif
+        std::strcpy(s->name, "?");
+    return s;
+}
+
+inline void count(size_t n)
+{
+    if (!armed.load(std::memory_order_relaxed))
+        return;
+
+    unsigned gen = generation.load(std::memory_order_acquire);
+    if (tls_generation != gen)
+    {
+        tls_slot = claim_slot();
+        tls_generation = gen;
+    }
+
+    tls_slot->allocs.fetch_add(1, std::memory_order_relaxed);
+    tls_slot->bytes.fetch_add(n, std::memory_order_relaxed);
+}
+
+} // namespace
+
+// --------------------------------------------------
+// Hooks
+// --------------------------------------------------
+
+#if defined(__GLIBC__)
+
+extern "C" {
+
+void* __libc_malloc(size_t n);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t n);
+void* __libc_memalign(size_t align, size_t n);
+
+void* malloc(size_t n) noexcept
+{
+    count(n);
+    return __libc_malloc(n);
+}
+
+void* calloc(size_t n, size_t size) noexcept
+{
+    count(n * size);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t n) noexcept
+{
+    count(n);
+    return __libc_realloc(p, n);
+}
+
+void* memalign(size_t align, size_t n) noexcept
+{
+    count(n);
+    return __libc_memalign(align, n);
+}
+
+void* aligned_alloc(size_t align, size_t n) noexcept
+{
+    count(n);
+    return __libc_memalign(align, n);
+}
+
+int posix_memalign(void** out, size_t align, size_t n) noexcept
+{
+    if (align < sizeof(void*) || (align & (align - 1)))
+        return EINVAL;
+
+    count(n);
+    void* p = __libc_memalign(align, n);
+    if (!p)
+        return ENOMEM;
+
+    *out = p;
+    return 0;
+}
+
+} // extern "C"
+
+#else
+
+// no portable way to wrap malloc: count operator new only
+
+void* operator new(size_t n)
+{
+    count(n);
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t n)
+{
+    return ::operator new(n);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+#endif
+
+// --------------------------------------------------
+// Control
+// --------------------------------------------------
+
+void alloc_track_arm()
+{
+    armed.store(false);
+
+    for (Slot& s : slots)
+    {
+        s.allocs.store(0, std::memory_order_relaxed);
+        s.bytes.store(0, std::memory_order_relaxed);
+    }
+    n_slots.store(0, std::memory_order_relaxed);
+
+    // threads re-claim a slot on their next allocation
+    generation.fetch_add(1, std::memory_order_release);
+    armed.store(true);
+}
+
+void alloc_track_disarm()
+{
+    armed.store(false);
+}
+
+size_t alloc_track_report(AllocThreadStats* out, size_t max)
+{
+    size_t n = n_slots.load();
+    if (n > MAX_THREADS) n = MAX_THREADS;
+
+    size_t k = 0;
+    for (size_t i = 0; i < n && k < max; ++i)
+    {
+        uint64_t a = slots[i].allocs.load(std::memory_order_relaxed);
+        if (!a)
+            continue;
+
+        std::memcpy(out[k].name, slots[i].name, sizeof(out[k].name));
+        out[k].allocs = a;
+        out[k].bytes = slots[i].bytes.load(std::memory_order_relaxed);
+        k++;
+    }
+    return k;
+}
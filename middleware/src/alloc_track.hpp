@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// --------------------------------------------------
+// Heap allocation tracking
+// --------------------------------------------------
+//
+// The binaries replace malloc / calloc / realloc / memalign (glibc;
+// operator new, strdup, stdio buffers all end up there) or, elsewhere,
+// the global operator new. While armed, every allocation is counted
+// against the calling thread; disarmed, the hook is one relaxed load.
+//
+// --alloc-check uses this to assert that the pipeline allocates nothing
+// once warmed up.
+
+struct AllocThreadStats
+{
+    char name[16];          // thread name when it first allocated
+    uint64_t allocs;
+    uint64_t bytes;
+};
+
+// zero all counts and start counting
+void alloc_track_arm();
+void alloc_track_disarm();
+
+// threads that allocated while armed, up to 'max'; returns how many
+size_t alloc_track_report(AllocThreadStats* out, size_t max);
@@ -0,0 +1,511 @@
+#include "binlog.hpp"
+#include "realtime.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+std::atomic<bool> g_log_deferred{false};
+
+Counter* g_log_dropped = &metrics().counter(
+    "soupy_log_dropped_total", "Log records dropped on a full ring");
+
+static Counter& log_records = metrics().counter(
+    "soupy_log_records_total", "Log records written by the log thread");
+static Counter& log_suppressed = metrics().counter(
+    "soupy_log_suppressed_total", "Log records over their site's rate limit");
+
+// --------------------------------------------------
+// Registries
+// --------------------------------------------------
+//
+// Fixed arrays published with a release store of the count, so the log
+// thread reads them without the lock.
+
+static constexpr uint32_t MAX_SITES = 4096;
+static constexpr uint32_t MAX_RINGS = 256;
+
+static std::mutex g_reg_mutex;
+
+static LogSite* g_sites[MAX_SITES];
+static std::atomic<uint32_t> g_site_count{0};
+
+static LogRing* g_rings[MAX_RINGS];
+static std::atomic<uint32_t> g_ring_count{0};
+
+LogSite::LogSite(const char* fmt, const char* file, int line,
+                 unsigned per_sec, const char* sig)
+    : fmt(fmt), file(file), line(line), sig(sig), per_sec(per_sec)
+{
+    std::lock_guard<std::mutex> lk(g_reg_mutex);
+
+    uint32_t n = g_site_count.load(std::memory_order_relaxed);
+    id = n;
+
+    // past the table the site still formats synchronously, but the log
+    // thread can't resolve it and skips its records
+    if (n < MAX_SITES)
+    {
+        g_sites[n] = this;
+        g_site_count.store(n + 1, std::memory_order_release);
+    }
+}
+
+LogRing* log_attach_thread()
+{
+    std::lock_guard<std::mutex> lk(g_reg_mutex);
+
+    uint32_t n = g_ring_count.load(std::memory_order_relaxed);
+
+    // a ring left by an exited thread, once the log thread emptied it
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        LogRing* r = g_rings[i];
+        if (!r->owned.load(std::memory_order_acquire) && r->empty())
+        {
+            r->owned.store(true, std::memory_order_relaxed);
+            return r;
+        }
+    }
+
+    if (n == MAX_RINGS)
+    {
+        std::fprintf(stderr, "[LOG] more than %u logging threads\n", MAX_RINGS);
+        std::abort();
+    }
+
+    LogRing* r = new LogRing();
+    g_rings[n] = r;
+    g_ring_count.store(n + 1, std::memory_order_release);
+    return r;
+}
+
+// --------------------------------------------------
+// Formatting
+// --------------------------------------------------
+
+namespace {
+
+struct Arg
+{
+    bool ok = false;
+    bool str = false;
+    long long i = 0;
+    unsigned long long u = 0;
+    double d = 0.0;
+    char s[LOG_MAX_STR + 1] = {};
+};
+
+template <class T>
+T read_as(const uint8_t*& a)
+{
+    T v;
+    std::memcpy(&v, a, sizeof(v));
+    a += sizeof(v);
+    return v;
+}
+
+Arg next_arg(const char*& sig, const uint8_t*& a, const uint8_t* end)
+{
+    Arg r;
+    char t = *sig;
+    if (!t)
+        return r;
+    sig++;
+
+    size_t need = (t == 'i' || t == 'u') ? 4 : (t == 's' ? 1 : 8);
+    if ((size_t)(end - a) < need)
+        return r;
+
+    r.ok = true;
+
+    switch (t)
+    {
+    case 'i': r.i = read_as<int32_t>(a);  r.u = (unsigned long long)r.i; r.d = (double)r.i; break;
+    case 'u': r.u = read_as<uint32_t>(a); r.i = (long long)r.u; r.d = (double)r.u; break;
+    case 'I': r.i = read_as<int64_t>(a);  r.u = (unsigned long long)r.i; r.d = (double)r.i; break;
+    case 'U': r.u = read_as<uint64_t>(a); r.i = (long long)r.u; r.d = (double)r.u; break;
+    case 'd': r.d = read_as<double>(a);   r.i = (long long)r.d; r.u = (unsigned long long)r.i; break;
+    case 's':
+    {
+        size_t n = *a++;
+        if ((size_t)(end - a) < n)
+        {
+            r.ok = false;
+            break;
+        }
+        std::memcpy(r.s, a, n);
+        r.s[n] = '\0';
+        r.str = true;
+        a += n;
+        break;
+    }
+    default:
+        r.ok = false;
+    }
+
+    return r;
+}
+
+// printf 'fmt' with arguments decoded per 'sig'; the conversion's length
+// modifier is replaced by the one the stored type needs
+size_t format_record(const char* fmt, const char* sig,
+                     const uint8_t* a, size_t len, char* out, size_t cap)
+{
+    const uint8_t* end = a + len;
+    size_t n = 0;
+
+    auto room = [&]() { return n + 1 < cap ? cap - n : 0; };
+    auto added = [&](int k) {
+        if (k > 0) n = std::min(n + (size_t)k, cap - 1);
+    };
+
+    const char* p = fmt;
+    while (*p && room())
+    {
+        if (*p != '%')
+        {
+            out[n++] = *p++;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            out[n++] = '%';
+            p += 2;
+            continue;
+        }
+
+        char spec[40];
+        size_t k = 0;
+        spec[k++] = *p++;
+
+        while (*p && std::strchr("-+ #0", *p) && k < 16) spec[k++] = *p++;
+        while (*p && (std::isdigit((unsigned char)*p) || *p == '.') && k < 32)
+            spec[k++] = *p++;
+        while (*p && std::strchr("hlLqjzt", *p)) p++;
+
+        char conv = *p;
+        if (!conv)
+            break;
+        p++;
+
+        Arg v = next_arg(sig, a, end);
+        if (!v.ok)
+        {
+            added(std::snprintf(out + n, room(), "<?>"));
+            continue;
+        }
+
+        if (conv == 's' || v.str)
+        {
+            spec[k++] = 's';
+            spec[k] = '\0';
+            added(std::snprintf(out + n, room(), spec, v.str ? v.s : ""));
+        }
+        else if (conv == 'd' || conv == 'i')
+        {
+            std::memcpy(spec + k, "lld", 4);
+            added(std::snprintf(out + n, room(), spec, v.i));
+        }
+        else if (conv == 'u' || conv == 'x' || conv == 'X' || conv == 'o')
+        {
+            spec[k++] = 'l';
+            spec[k++] = 'l';
+            spec[k++] = conv;
+            spec[k] = '\0';
+            added(std::snprintf(out + n, room(), spec, v.u));
+        }
+        else if (conv == 'c')
+        {
+            std::memcpy(spec + k, "c", 2);
+            added(std::snprintf(out + n, room(), spec, (int)v.i));
+        }
+        else if (conv == 'p')
+            added(std::snprintf(out + n, room(), "0x%llx", v.u));
+        else
+        {
+            spec[k++] = conv;       // f F e E g G a A
+            spec[k] = '\0';
+            added(std::snprintf(out + n, room(), spec, v.d));
+        }
+    }
+
+    out[n] = '\0';
+    return n;
+}
+
+} // namespace
+
+void log_format_now(const LogSite& site, const uint8_t* args, size_t len)
+{
+    char line[1024];
+    size_t n = format_record(site.fmt, site.sig, args, len, line, sizeof(line));
+    std::fwrite(line, 1, n, stdout);
+}
+
+// --------------------------------------------------
+// Log thread
+// --------------------------------------------------
+//
+// Raw files are a stream of host-endian entries after a 4-byte magic:
+//   'S' id:u32 line:u32 fmt\0 file\0 sig\0      site, before its records
+//   'R' id:u32 ts_ns:u64 len:u32 args[len]      record
+
+static const char RAW_MAGIC[4] = {'S', 'L', 'G', '1'};
+
+static std::thread g_thread;
+static std::atomic<bool> g_running{false};
+static LogMode g_mode = LogMode::text;
+static FILE* g_raw = nullptr;
+static std::vector<bool> g_site_written;
+
+template <class T>
+static void raw_put(const T& v)
+{
+    std::fwrite(&v, sizeof(v), 1, g_raw);
+}
+
+static void emit(const LogRecord& r)
+{
+    if (r.site >= g_site_count.load(std::memory_order_acquire))
+        return;
+
+    const LogSite& s = *g_sites[r.site];
+    const uint8_t* args = reinterpret_cast<const uint8_t*>(&r + 1);
+    size_t len = r.size - sizeof(LogRecord);
+
+    log_records.inc();
+
+    if (g_mode == LogMode::text)
+    {
+        log_format_now(s, args, len);
+        return;
+    }
+
+    if (g_site_written.size() <= r.site)
+        g_site_written.resize(r.site + 1);
+
+    if (!g_site_written[r.site])
+    {
+        raw_put('S');
+        raw_put(r.site);
+        raw_put((uint32_t)s.line);
+        std::fwrite(s.fmt, 1, std::strlen(s.fmt) + 1, g_raw);
+        std::fwrite(s.file, 1, std::strlen(s.file) + 1, g_raw);
+        std::fwrite(s.sig, 1, std::strlen(s.sig) + 1, g_raw);
+        g_site_written[r.site] = true;
+    }
+
+    raw_put('R');
+    raw_put(r.site);
+    raw_put(r.ts_ns);
+    raw_put((uint32_t)len);
+    std::fwrite(args, 1, len, g_raw);
+}
+
+static size_t drain_all()
+{
+    size_t n = 0;
+    uint32_t rings = g_ring_count.load(std::memory_order_acquire);
+
+    for (uint32_t i = 0; i < rings; ++i)
+        n += g_rings[i]->drain(emit);
+
+    return n;
+}
+
+static void report_suppressed()
+{
+    uint32_t sites = g_site_count.load(std::memory_order_acquire);
+
+    for (uint32_t i = 0; i < sites; ++i)
+    {
+        LogSite& s = *g_sites[i];
+        uint64_t total = s.suppressed.load(std::memory_order_relaxed);
+        if (total == s.reported)
+            continue;
+
+        log_suppressed.inc(total - s.reported);
+        std::printf("[LOG] %s:%d: %llu messages over %u/s suppressed\n",
+            s.file, s.line,
+            (unsigned long long)(total - s.reported), s.per_sec);
+        s.reported = total;
+    }
+}
+
+static void log_thread_fn()
+{
+    rt_setup_current_thread("soupy-log", ThreadRtConfig{});
+
+    auto last_report = std::chrono::steady_clock::now();
+
+    while (g_running.load(std::memory_order_relaxed))
+    {
+        if (!drain_all())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(1))
+        {
+            report_suppressed();
+            last_report = now;
+        }
+    }
+}
+
+bool log_start(LogMode mode, const char* path)
+{
+    if (g_running.load())
+        return false;
+
+    g_mode = mode;
+
+    if (mode == LogMode::raw)
+    {
+        g_raw = path ? std::fopen(path, "wb") : nullptr;
+        if (!g_raw)
+        {
+            std::printf("[LOG] cannot open %s\n", path ? path : "(null)");
+            return false;
+        }
+        std::fwrite(RAW_MAGIC, 1, sizeof(RAW_MAGIC), g_raw);
+    }
+
+    g_running.store(true);
+    g_log_deferred.store(true);
+    g_thread = std::thread(log_thread_fn);
+    return true;
+}
+
+void log_stop()
+{
+    if (!g_running.exchange(false))
+        return;
+
+    g_thread.join();
+    g_log_deferred.store(false);
+
+    // whatever was logged while the thread wound down
+    drain_all();
+    report_suppressed();
+
+    if (g_raw)
+    {
+        std::fclose(g_raw);
+        g_raw = nullptr;
+    }
+
+    std::printf("[LOG] records=%llu dropped=%llu suppressed=%llu\n",
+        (unsigned long long)log_records.value(),
+        (unsigned long long)g_log_dropped->value(),
+        (unsigned long long)log_suppressed.value());
+    std::fflush(stdout);
+}
+
+// --------------------------------------------------
+// Offline decoder
+// --------------------------------------------------
+
+int log_decode(const char* path)
+{
+    FILE* f = std::fopen(path, "rb");
+    if (!f)
+    {
+        std::printf("[LOG] cannot open %s\n", path);
+        return 1;
+    }
+
+    std::vector<char> data;
+    char chunk[65536];
+    size_t got;
+    while ((got = std::fread(chunk, 1, sizeof(chunk), f)) > 0)
+        data.insert(data.end(), chunk, chunk + got);
+    std::fclose(f);
+
+    if (data.size() < sizeof(RAW_MAGIC) ||
+        std::memcmp(data.data(), RAW_MAGIC, sizeof(RAW_MAGIC)) != 0)
+    {
+        std::printf("[LOG] %s is not a raw log\n", path);
+        return 1;
+    }
+
+    struct Site { std::string fmt, file, sig; uint32_t line; };
+    std::unordered_map<uint32_t, Site> sites;
+
+    const char* p = data.data() + sizeof(RAW_MAGIC);
+    const char* end = data.data() + data.size();
+    uint64_t t0 = 0;
+    uint64_t records = 0;
+
+    auto take_str = [&](std::string& out) {
+        const char* z = (const char*)std::memchr(p, '\0', (size_t)(end - p));
+        if (!z) return false;
+        out.assign(p, z);
+        p = z + 1;
+        return true;
+    };
+
+    char line[1024];
+
+    while (p < end)
+    {
+        char tag = *p++;
+        uint32_t id;
+
+        if ((size_t)(end - p) < sizeof(id))
+            break;
+        std::memcpy(&id, p, sizeof(id));
+        p += sizeof(id);
+
+        if (tag == 'S')
+        {
+            Site s;
+            if ((size_t)(end - p) < sizeof(s.line))
+                break;
+            std::memcpy(&s.line, p, sizeof(s.line));
+            p += sizeof(s.line);
+
+            if (!take_str(s.fmt) || !take_str(s.file) || !take_str(s.sig))
+                break;
+            sites[id] = std::move(s);
+        }
+        else if (tag == 'R')
+        {
+            uint64_t ts;
+            uint32_t len;
+            if ((size_t)(end - p) < sizeof(ts) + sizeof(len))
+                break;
+            std::memcpy(&ts, p, sizeof(ts));
+            std::memcpy(&len, p + sizeof(ts), sizeof(len));
+            p += sizeof(ts) + sizeof(len);
+
+            if ((size_t)(end - p) < len)
+                break;
+
+            auto it = sites.find(id);
+            if (it != sites.end())
+            {
+                if (!records++) t0 = ts;
+
+                format_record(it->second.fmt.c_str(), it->second.sig.c_str(),
+                              (const uint8_t*)p, len, line, sizeof(line));
+                std::printf("%12.6f %s", (double)(ts - t0) / 1e9, line);
+            }
+            p += len;
+        }
+        else
+            break;
+    }
+
+    if (p < end)
+        std::printf("[LOG] %s: truncated or corrupt at byte %zu\n",
+            path, (size_t)(p - data.data()));
+
+    return 0;
+}
@@ -0,0 +1,342 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include "metrics.hpp"
+
+// --------------------------------------------------
+// Deferred-format binary log
+// --------------------------------------------------
+//
+//   SOUPY_LOG("[UNKNOWN] type=%u seq=%u len=%u\n", type, seq, len);
+//   SOUPY_LOG_RATE(10, "[USB] transfer error: status=%d\n", status);
+//
+// A log call does not format. It copies a site id, a timestamp and the
+// raw arguments into a per-thread single-producer ring and returns; a
+// background thread formats the records to stdout, or writes them raw
+// to a file that --log-decode turns into text later. Formats are
+// checked at compile time like printf's.
+//
+// Arguments are integers, floating point and C strings (copied, at most
+// 255 bytes). Each site can be limited to 'per_sec' records per second;
+// the rest are counted and reported as suppressed. A full ring drops
+// the record (soupy_log_dropped_total) rather than block.
+//
+// Until log_start() (benches, tools), calls format synchronously.
+
+struct LogSite
+{
+    LogSite(const char* fmt, const char* file, int line,
+            unsigned per_sec, const char* sig);
+
+    const char* fmt;
+    const char* file;
+    int line;
+    const char* sig;        // one code per argument, see log_arg_code()
+    unsigned per_sec;       // 0 = unlimited
+    uint32_t id;
+
+    std::atomic<uint64_t> window{0};        // second 'in_window' counts
+    std::atomic<uint32_t> in_window{0};
+    std::atomic<uint64_t> suppressed{0};
+    uint64_t reported = 0;                  // log thread only
+
+    bool admit(uint64_t ts_ns)
+    {
+        uint64_t sec = ts_ns / 1000000000ull;
+        if (window.load(std::memory_order_relaxed) != sec)
+        {
+            window.store(sec, std::memory_order_relaxed);
+            in_window.store(0, std::memory_order_relaxed);
+        }
+
+        if (in_window.fetch_add(1, std::memory_order_relaxed) < per_sec)
+            return true;
+
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+};
+
+// --------------------------------------------------
+// Per-thread ring
+// --------------------------------------------------
+//
+// Records are 16-byte aligned and never wrap: one that doesn't fit
+// before the end of the buffer is preceded by a padding record.
+
+struct LogRecord
+{
+    static constexpr uint32_t PAD = 0xFFFFFFFFu;
+
+    uint32_t site;
+    uint32_t size;          // whole record, header included
+    uint64_t ts_ns;
+};
+
+class LogRing
+{
+public:
+    static constexpr size_t CAPACITY = 64 * 1024;
+
+    // room for 'payload' argument bytes, or nullptr if the ring is full
+    uint8_t* reserve(size_t payload)
+    {
+        size_t total = record_size(payload);
+        uint64_t pos = head.load(std::memory_order_relaxed);
+        size_t off = (size_t)(pos & (CAPACITY - 1));
+        size_t to_end = CAPACITY - off;
+        size_t need = to_end < total ? to_end + total : total;
+
+        if (pos + need - tail.load(std::memory_order_acquire) > CAPACITY)
+            return nullptr;
+
+        if (to_end < total)
+        {
+            LogRecord* pad = reinterpret_cast<LogRecord*>(buf + off);
+            pad->site = LogRecord::PAD;
+            pad->size = (uint32_t)to_end;
+            pending = to_end;
+            off = 0;
+        }
+        else
+            pending = 0;
+
+        return buf + off + sizeof(LogRecord);
+    }
+
+    void commit(uint8_t* payload, size_t len, uint32_t site, uint64_t ts_ns)
+    {
+        LogRecord* r = reinterpret_cast<LogRecord*>(payload - sizeof(LogRecord));
+        r->site = site;
+        r->size = (uint32_t)record_size(len);
+        r->ts_ns = ts_ns;
+
+        head.store(head.load(std::memory_order_relaxed) + pending + r->size,
+                   std::memory_order_release);
+    }
+
+    // consumer side: calls fn(record) for everything published
+    template <class Fn>
+    size_t drain(Fn&& fn)
+    {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        size_t n = 0;
+
+        while (t < h)
+        {
+            const LogRecord* r = reinterpret_cast<const LogRecord*>(
+                buf + (t & (CAPACITY - 1)));
+            if (r->site != LogRecord::PAD)
+            {
+                fn(*r);
+                n++;
+            }
+            t += r->size;
+        }
+
+        tail.store(t, std::memory_order_release);
+        return n;
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_relaxed);
+    }
+
+    // false once the owning thread has exited; the ring is then reused
+    std::atomic<bool> owned{true};
+
+private:
+    static size_t record_size(size_t payload)
+    {
+        return (sizeof(LogRecord) + payload + 15) & ~(size_t)15;
+    }
+
+    alignas(64) std::atomic<uint64_t> head{0};
+    size_t pending = 0;     // padding in front of the reserved record
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(16) uint8_t buf[CAPACITY];
+};
+
+// --------------------------------------------------
+// Argument encoding
+// --------------------------------------------------
+//
+// i/u: 32-bit signed/unsigned, I/U: 64-bit, d: double,
+// s: length byte + bytes
+
+template <class T>
+constexpr char log_arg_code()
+{
+    using U = std::decay_t<T>;
+
+    if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>)
+        return 's';
+    else if constexpr (std::is_enum_v<U>)
+        return log_arg_code<std::underlying_type_t<U>>();
+    else if constexpr (std::is_floating_point_v<U>)
+        return 'd';
+    else
+    {
+        static_assert(std::is_integral_v<U>,
+                      "log arguments are numbers or C strings");
+        if constexpr (sizeof(U) <= 4)
+            return std::is_signed_v<U> ? 'i' : 'u';
+        else
+            return std::is_signed_v<U> ? 'I' : 'U';
+    }
+}
+
+template <class... A>
+struct LogSig
+{
+    static constexpr char value[] = {log_arg_code<A>()..., '\0'};
+};
+
+// only named in decltype(), to get the signature of a call's arguments
+template <class... A>
+LogSig<A...> log_sig_of(const A&...);
+
+constexpr size_t LOG_MAX_STR = 255;
+
+template <class T>
+inline size_t log_arg_size(const T& v)
+{
+    constexpr char c = log_arg_code<T>();
+
+    if constexpr (c == 's')
+        return 1 + (v ? strnlen(v, LOG_MAX_STR) : 6);
+    else if constexpr (c == 'i' || c == 'u')
+        return 4;
+    else
+        return 8;
+}
+
+template <class T>
+inline uint8_t* log_put(uint8_t* w, const T& v)
+{
+    constexpr char c = log_arg_code<T>();
+
+    if constexpr (c == 's')
+    {
+        const char* s = v ? v : "(null)";
+        size_t n = v ? strnlen(s, LOG_MAX_STR) : 6;
+        *w++ = (uint8_t)n;
+        std::memcpy(w, s, n);
+        return w + n;
+    }
+    else
+    {
+        using V = std::conditional_t<c == 'i', int32_t,
+                  std::conditional_t<c == 'u', uint32_t,
+                  std::conditional_t<c == 'I', int64_t,
+                  std::conditional_t<c == 'U', uint64_t, double>>>>;
+        V x = (V)v;
+        std::memcpy(w, &x, sizeof(x));
+        return w + sizeof(x);
+    }
+}
+
+// --------------------------------------------------
+// Front end
+// --------------------------------------------------
+
+extern std::atomic<bool> g_log_deferred;
+extern Counter* g_log_dropped;
+
+LogRing* log_attach_thread();
+void log_format_now(const LogSite& site, const uint8_t* args, size_t len);
+
+inline LogRing& log_ring()
+{
+    thread_local struct Tls
+    {
+        LogRing* r = nullptr;
+        ~Tls() { if (r) r->owned.store(false, std::memory_order_release); }
+    } tls;
+
+    if (!tls.r)
+        tls.r = log_attach_thread();
+    return *tls.r;
+}
+
+inline uint64_t log_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <class... A>
+inline void log_write(LogSite& site, const A&... a)
+{
+    uint64_t ts = log_now_ns();
+
+    if (site.per_sec && !site.admit(ts))
+        return;
+
+    size_t len = (size_t(0) + ... + log_arg_size(a));
+
+    if (!g_log_deferred.load(std::memory_order_relaxed))
+    {
+        uint8_t local[16 + sizeof...(A) * (1 + LOG_MAX_STR)];
+        uint8_t* w = local;
+        ((w = log_put(w, a)), ...);
+        (void)w;
+        log_format_now(site, local, len);
+        return;
+    }
+
+    LogRing& ring = log_ring();
+    uint8_t* p = ring.reserve(len);
+    if (!p)
+    {
+        g_log_dropped->inc();
+        return;
+    }
+
+    uint8_t* w = p;
+    ((w = log_put(w, a)), ...);
+    (void)w;
+    ring.commit(p, len, site.id, ts);
+}
+
+// never called; lets the compiler check formats against arguments
+inline void log_check_format(const char*, ...)
+    __attribute__((format(printf, 1, 2)));
+inline void log_check_format(const char*, ...) {}
+
+#define SOUPY_LOG_RATE(per_sec, fmt, ...)                                   \
+    do {                                                                    \
+        if (false) log_check_format(fmt, ##__VA_ARGS__);                    \
+        static LogSite soupy_log_site_(fmt, __FILE__, __LINE__, (per_sec),  \
+            decltype(log_sig_of(__VA_ARGS__))::value);                      \
+        log_write(soupy_log_site_, ##__VA_ARGS__);                          \
+    } while (0)
+
+#define SOUPY_LOG(fmt, ...) SOUPY_LOG_RATE(0, fmt, ##__VA_ARGS__)
+
+// --------------------------------------------------
+// Back end
+// --------------------------------------------------
+
+enum class LogMode
+{
+    text,       // format to stdout
+    raw,        // records to a file, see log_decode()
+};
+
+// start the log thread; raw mode needs 'path'
+bool log_start(LogMode mode, const char* path = nullptr);
+
+// drain everything, report suppressed sites and stop
+void log_stop();
+
+// raw log file -> text on stdout
+int log_decode(const char* path);
@@ -0,0 +1,325 @@
+#include "calib_bench.hpp"
+#include "calibration.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static const unsigned FINGERS = 5;
+static const size_t BATCH = 64;
+
+// small rotations, scales near 1 and a few drift points per finger. The
+// drift points sit inside table cells (0.3125 C wide over 0 .. 80 C), not
+// on their edges, so the table's chord error shows up
+static DeviceCalib make_device()
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> small(-0.05, 0.05);
+    std::uniform_real_distribution<double> inside(0.05, 0.26);
+
+    DeviceCalib d;
+    d.name = "bench";
+
+    for (unsigned w = 0; w < FINGERS; ++w)
+    {
+        FingerCalib& f = d.fingers[w];
+
+        double th = small(rng);
+        double s = 1.0 + small(rng);
+        double a[9] = {s * std::cos(th), -s * std::sin(th), 0.0,
+                       s * std::sin(th),  s * std::cos(th), 0.0,
+                       0.0,               0.0,              s};
+        for (int k = 0; k < 9; ++k)
+            f.a[k] = a[k];
+        for (int k = 0; k < 3; ++k)
+            f.b[k] = small(rng);
+
+        for (double t = 10.0; t <= 60.0; t += 12.5)
+            f.drift.push_back({t + inside(rng),
+                               {small(rng), small(rng), small(rng)}});
+    }
+    return d;
+}
+
+static std::vector<FingerData> make_frames(unsigned frames)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> pos(-1.0, 1.0);
+    std::uniform_real_distribution<float> temp(15.f, 55.f);
+
+    std::vector<FingerData> out((size_t)frames * FINGERS);
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        out[i].x = pos(rng);
+        out[i].y = pos(rng);
+        out[i].z = pos(rng);
+        out[i].state_array = (uint32_t)(i % FINGERS);
+        out[i].temp = temp(rng);
+    }
+    return out;
+}
+
+static FingerArrayView view_of(const std::vector<FingerData>& v, size_t frame)
+{
+    return FingerArrayView(
+        reinterpret_cast<const uint8_t*>(&v[frame * FINGERS]), FINGERS);
+}
+
+// p = A * (p_raw - d(t)) + b, straight from the file's description
+static void reference(const FingerCalib& f, const FingerData& in, double out[3])
+{
+    double d[3] = {0.0, 0.0, 0.0};
+    const auto& pts = f.drift;
+    double t = in.temp;
+
+    if (t <= pts.front().t)
+        for (int k = 0; k < 3; ++k) d[k] = pts.front().d[k];
+    else if (t >= pts.back().t)
+        for (int k = 0; k < 3; ++k) d[k] = pts.back().d[k];
+    else
+    {
+        size_t hi = 1;
+        while (pts[hi].t < t) hi++;
+        double u = (t - pts[hi - 1].t) / (pts[hi].t - pts[hi - 1].t);
+        for (int k = 0; k < 3; ++k)
+            d[k] = pts[hi - 1].d[k] + u * (pts[hi].d[k] - pts[hi - 1].d[k]);
+    }
+
+    double p[3] = {in.x - d[0], in.y - d[1], in.z - d[2]};
+    for (int r = 0; r < 3; ++r)
+        out[r] = f.a[r * 3] * p[0] + f.a[r * 3 + 1] * p[1] +
+                 f.a[r * 3 + 2] * p[2] + f.b[r];
+}
+
+// Worst case of the table against the formula, per calibration.hpp: each
+// drift point bends c(t) = b - A * d(t) by A * (slope change), and the
+// chord across its cell misses the bend by that times (k - a)(b - k) / h.
+// Ends count too, since d is flat outside the points. Bends sharing a
+// cell add up.
+static double table_bound(const DeviceCalib& dev, unsigned fingers)
+{
+    double h = (dev.temp_max - dev.temp_min) / Calibration::TABLE_SIZE;
+    std::vector<double> cell(Calibration::TABLE_SIZE);
+    double worst = 0.0;
+
+    for (unsigned w = 0; w < fingers; ++w)
+    {
+        const FingerCalib& f = dev.fingers[w];
+        const auto& pts = f.drift;
+
+        for (int r = 0; r < 3; ++r)
+        {
+            std::fill(cell.begin(), cell.end(), 0.0);
+
+            for (size_t i = 0; i < pts.size(); ++i)
+            {
+                double bend = 0.0;
+                for (int k = 0; k < 3; ++k)
+                {
+                    double in = i ? (pts[i].d[k] - pts[i - 1].d[k]) /
+                                    (pts[i].t - pts[i - 1].t) : 0.0;
+                    double out = i + 1 < pts.size()
+                        ? (pts[i + 1].d[k] - pts[i].d[k]) /
+                          (pts[i + 1].t - pts[i].t) : 0.0;
+                    bend += f.a[r * 3 + k] * (out - in);
+                }
+
+                double u = (pts[i].t - dev.temp_min) / h;
+                if (u <= 0.0 || u >= (double)Calibration::TABLE_SIZE)
+                    continue;
+                size_t c = (size_t)u;
+                double x = (u - (double)c) * h;
+
+                cell[c] += std::fabs(bend) * x * (h - x) / h;
+            }
+
+            for (double e : cell)
+                worst = std::fmax(worst, e);
+        }
+    }
+    return worst;
+}
+
+static void fill(CalibBatch& b, const std::vector<FingerData>& v, size_t first)
+{
+    b.clear();
+    for (size_t i = 0; i < BATCH; ++i)
+        b.add((uint16_t)i, i, view_of(v, first + i));
+}
+
+// counts what reaches the application
+struct SinkHandler : PacketHandler
+{
+    uint64_t frames = 0;
+    double sum = 0.0;
+
+    void on_finger_packet(uint16_t, uint64_t, const FingerArrayView& f) override
+    {
+        frames++;
+        sum += f[0].x();
+    }
+    void on_unknown(uint8_t, uint16_t, const uint8_t*, uint16_t) override {}
+};
+
+static void report(const char* what, double secs, uint64_t frames)
+{
+    std::printf("[CALIB-BENCH] %-24s %8.2f M frames/s %7.1f ns/frame\n",
+        what, frames / secs / 1e6, secs * 1e9 / frames);
+}
+
+int run_calib_bench(unsigned frames)
+{
+    if (frames < BATCH)
+        frames = BATCH;
+    frames -= frames % BATCH;
+
+    DeviceCalib dev = make_device();
+    Calibration cal(dev);
+    std::vector<FingerData> data = make_frames(frames);
+
+    std::printf("[CALIB-BENCH] %u frames x %u fingers, batches of %zu, "
+                "best kernel %s\n",
+        frames, FINGERS, BATCH,
+        Calibration::kernel_name(Calibration::best_kernel()));
+
+    // ---- accuracy: kernels vs the direct formula ----
+
+    CalibBatch b(BATCH, FINGERS);
+    std::vector<Calibration::Kernel> kernels = {Calibration::Kernel::scalar};
+#if defined(__x86_64__) || defined(__i386__)
+    kernels.push_back(Calibration::Kernel::sse2);
+    if (Calibration::best_kernel() == Calibration::Kernel::avx2)
+        kernels.push_back(Calibration::Kernel::avx2);
+#endif
+
+    for (Calibration::Kernel k : kernels)
+    {
+        double max_err = 0.0;
+
+        for (size_t first = 0; first < frames; first += BATCH)
+        {
+            fill(b, data, first);
+            cal.apply(b, k);
+
+            for (size_t i = 0; i < BATCH; ++i)
+            {
+                pkt_finger_t out[FINGERS];
+                b.get(i, out);
+
+                for (unsigned w = 0; w < FINGERS; ++w)
+                {
+                    double ref[3];
+                    reference(dev.fingers[w], data[(first + i) * FINGERS + w], ref);
+                    max_err = std::fmax(max_err, std::fabs(out[w].x - ref[0]));
+                    max_err = std::fmax(max_err, std::fabs(out[w].y - ref[1]));
+                    max_err = std::fmax(max_err, std::fabs(out[w].z - ref[2]));
+                }
+            }
+        }
+
+        std::printf("[CALIB-BENCH] %-6s max error vs formula %.4g\n",
+            Calibration::kernel_name(k), max_err);
+    }
+
+    // ---- table error: a fine temperature sweep over the whole range ----
+
+    double bound = table_bound(dev, FINGERS);
+    double table_err = 0.0;
+    size_t sweep = Calibration::TABLE_SIZE * 64;
+    {
+        std::vector<FingerData> pts(BATCH * FINGERS);
+        double span = dev.temp_max - dev.temp_min;
+
+        for (size_t first = 0; first < sweep; first += BATCH)
+        {
+            for (size_t i = 0; i < BATCH; ++i)
+                for (unsigned w = 0; w < FINGERS; ++w)
+                {
+                    FingerData& p = pts[i * FINGERS + w];
+                    p.x = 0.3;
+                    p.y = -0.2;
+                    p.z = 0.1;
+                    p.state_array = w;
+                    p.temp = (float)(dev.temp_min +
+                                     span * (double)(first + i) / (double)sweep);
+                }
+
+            b.clear();
+            for (size_t i = 0; i < BATCH; ++i)
+                b.add((uint16_t)i, i, view_of(pts, i));
+            cal.apply(b, Calibration::Kernel::scalar);
+
+            for (size_t i = 0; i < BATCH; ++i)
+            {
+                pkt_finger_t out[FINGERS];
+                b.get(i, out);
+
+                for (unsigned w = 0; w < FINGERS; ++w)
+                {
+                    double ref[3];
+                    reference(dev.fingers[w], pts[i * FINGERS + w], ref);
+                    table_err = std::fmax(table_err, std::fabs(out[w].x - ref[0]));
+                    table_err = std::fmax(table_err, std::fabs(out[w].y - ref[1]));
+                    table_err = std::fmax(table_err, std::fabs(out[w].z - ref[2]));
+                }
+            }
+        }
+    }
+
+    bool table_ok = table_err <= bound * (1.0 + 1e-6) + 1e-12;
+    std::printf("[CALIB-BENCH] table error %.4g over %zu temps %.0f .. %.0f C "
+                "(bound %.4g)%s\n",
+        table_err, sweep, dev.temp_min, dev.temp_max, bound,
+        table_ok ? "" : " OVER BOUND");
+
+    // ---- kernels alone, in place on one resident batch ----
+
+    for (Calibration::Kernel k : kernels)
+    {
+        fill(b, data, 0);
+
+        auto t0 = bench_clock::now();
+        for (size_t done = 0; done < frames; done += BATCH)
+            cal.apply(b, k);
+        auto t1 = bench_clock::now();
+
+        char what[32];
+        std::snprintf(what, sizeof(what), "kernel %s",
+                      Calibration::kernel_name(k));
+        report(what, std::chrono::duration<double>(t1 - t0).count(), frames);
+    }
+
+    // ---- whole stage: wire views in, calibrated views out ----
+
+    SinkHandler sink;
+
+    auto t0 = bench_clock::now();
+    for (size_t i = 0; i < frames; ++i)
+        sink.on_finger_packet((uint16_t)i, i, view_of(data, i));
+    auto t1 = bench_clock::now();
+    report("handler only", std::chrono::duration<double>(t1 - t0).count(), frames);
+
+    // one parse run per 16 frames, about a 4 KiB chunk
+    CalibratingHandler stage(cal, sink, BATCH);
+    sink.frames = 0;
+
+    t0 = bench_clock::now();
+    for (size_t i = 0; i < frames; ++i)
+    {
+        stage.on_finger_packet((uint16_t)i, i, view_of(data, i));
+        if (i % 16 == 15)
+            stage.on_parse_end();
+    }
+    stage.flush();
+    t1 = bench_clock::now();
+    report("stage + handler", std::chrono::duration<double>(t1 - t0).count(), frames);
+
+    std::printf("[CALIB-BENCH] delivered=%llu (checksum %.3f)\n",
+        (unsigned long long)sink.frames, sink.sum);
+    return table_ok ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// --------------------------------------------------
+// Calibration bench
+// --------------------------------------------------
+//
+// Calibrated frames/s of each kernel on batched 5-finger frames, the
+// whole stage (wire view -> batch -> kernel -> handler), and the error
+// of the kernels and of the temperature table against the direct
+// formula. Returns nonzero if the table error is over its bound (see
+// calibration.hpp).
+
+int run_calib_bench(unsigned frames);
@@ -0,0 +1,572 @@
+#include "calibration.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CALIB_X86 1
+#endif
+
+// --------------------------------------------------
+// File
+// --------------------------------------------------
+
+bool CalibrationFile::load(const std::string& path)
+{
+    FILE* f = std::fopen(path.c_str(), "r");
+    if (!f)
+    {
+        std::printf("[CALIB] cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    devices.clear();
+    DeviceCalib* dev = nullptr;
+
+    char line[512];
+    int lineno = 0;
+    bool ok = true;
+
+    while (ok && std::fgets(line, sizeof(line), f))
+    {
+        lineno++;
+
+        char kind[16];
+        int used = 0;
+        if (std::sscanf(line, " %15s %n", kind, &used) != 1 || kind[0] == '#')
+            continue;
+
+        const char* rest = line + used;
+
+        if (!std::strcmp(kind, "device"))
+        {
+            char name[64];
+            if (std::sscanf(rest, "%63s", name) != 1)
+            {
+                ok = false;
+                break;
+            }
+            devices.emplace_back();
+            dev = &devices.back();
+            dev->name = name;
+            continue;
+        }
+
+        if (!dev)
+        {
+            devices.emplace_back();
+            dev = &devices.back();
+            dev->name = "default";
+        }
+
+        if (!std::strcmp(kind, "range"))
+        {
+            ok = std::sscanf(rest, "%lf %lf", &dev->temp_min, &dev->temp_max) == 2 &&
+                 dev->temp_max > dev->temp_min;
+            continue;
+        }
+
+        unsigned finger = 0;
+        int skip = 0;
+        double v[12];
+        int n = 0;
+
+        if (std::sscanf(rest, "%u %n", &finger, &skip) == 1 &&
+            finger < DeviceCalib::MAX_FINGERS)
+        {
+            n = std::sscanf(rest + skip,
+                            "%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",
+                            &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+                            &v[6], &v[7], &v[8], &v[9], &v[10], &v[11]);
+        }
+        else
+            kind[0] = '\0';     // falls through to "bad line"
+
+        FingerCalib& fc = dev->fingers[finger];
+
+        if (!std::strcmp(kind, "affine") && n == 12)
+        {
+            for (int r = 0; r < 3; ++r)
+            {
+                fc.a[r * 3 + 0] = v[r * 4 + 0];
+                fc.a[r * 3 + 1] = v[r * 4 + 1];
+                fc.a[r * 3 + 2] = v[r * 4 + 2];
+                fc.b[r]         = v[r * 4 + 3];
+            }
+        }
+        else if (!std::strcmp(kind, "scale") && (n == 3 || n == 6))
+        {
+            std::fill(fc.a, fc.a + 9, 0.0);
+            fc.a[0] = v[0];
+            fc.a[4] = v[1];
+            fc.a[8] = v[2];
+            for (int k = 0; k < 3; ++k)
+                fc.b[k] = n == 6 ? v[3 + k] : 0.0;
+        }
+        else if (!std::strcmp(kind, "temp") && n == 4)
+            fc.drift.push_back({v[0], {v[1], v[2], v[3]}});
+        else
+            ok = false;
+    }
+    std::fclose(f);
+
+    if (!ok)
+    {
+        std::printf("[CALIB] %s:%d: bad line\n", path.c_str(), lineno);
+        return false;
+    }
+
+    for (DeviceCalib& d : devices)
+        for (FingerCalib& fc : d.fingers)
+            std::sort(fc.drift.begin(), fc.drift.end(),
+                [](const FingerCalib::Point& a, const FingerCalib::Point& b) {
+                    return a.t < b.t;
+                });
+
+    return true;
+}
+
+const DeviceCalib* CalibrationFile::find(const std::string& name) const
+{
+    for (const DeviceCalib& d : devices)
+        if (d.name == name)
+            return &d;
+    return nullptr;
+}
+
+// --------------------------------------------------
+// Batch
+// --------------------------------------------------
+
+CalibBatch::CalibBatch(size_t frames, size_t width)
+    : frames(frames ? frames : 1),
+      width(std::min(width ? width : 1, DeviceCalib::MAX_FINGERS)),
+      seq(this->frames),
+      timestamp(this->frames),
+      count(this->frames),
+      x(this->frames * this->width),
+      y(this->frames * this->width),
+      z(this->frames * this->width),
+      temp(this->frames * this->width),
+      state(this->frames * this->width)
+{}
+
+bool CalibBatch::add(uint16_t s, uint64_t ts, const FingerArrayView& fingers)
+{
+    if (full())
+        return false;
+
+    size_t i = n++;
+    uint8_t c = fingers.size();
+
+    seq[i] = s;
+    timestamp[i] = ts;
+    count[i] = c;
+
+    // absent fingers are zero so the kernels never see garbage; only the
+    // columns in use are touched, and a wider frame clears its new
+    // columns for the frames before it
+    size_t w = std::min((size_t)c, width);
+    for (size_t k = used; k < w; ++k)
+        for (size_t j = 0; j < i; ++j)
+            clear_at(k * frames + j);
+    used = std::max(used, w);
+
+    for (size_t k = 0; k < used; ++k)
+    {
+        size_t at = k * frames + i;
+
+        if (k < w)
+        {
+            FingerView f = fingers[k];
+            x[at]     = f.x();
+            y[at]     = f.y();
+            z[at]     = f.z();
+            temp[at]  = f.temp();
+            state[at] = f.state_array();
+        }
+        else
+            clear_at(at);
+    }
+    return true;
+}
+
+uint8_t CalibBatch::get(size_t i, pkt_finger_t* out) const
+{
+    uint8_t c = count[i] < width ? count[i] : (uint8_t)width;
+
+    for (size_t k = 0; k < c; ++k)
+    {
+        size_t at = k * frames + i;
+        out[k].x = x[at];
+        out[k].y = y[at];
+        out[k].z = z[at];
+        out[k].state_array = state[at];
+        out[k].temp = (float)temp[at];
+    }
+    return c;
+}
+
+// --------------------------------------------------
+// Tables
+// --------------------------------------------------
+
+static void drift_at(const FingerCalib& fc, double t, double d[3])
+{
+    const auto& pts = fc.drift;
+
+    if (pts.empty())
+    {
+        d[0] = d[1] = d[2] = 0.0;
+        return;
+    }
+
+    // flat past the ends of the curve
+    if (t <= pts.front().t || pts.size() == 1)
+    {
+        std::memcpy(d, pts.front().d, sizeof(pts.front().d));
+        return;
+    }
+    if (t >= pts.back().t)
+    {
+        std::memcpy(d, pts.back().d, sizeof(pts.back().d));
+        return;
+    }
+
+    size_t hi = 1;
+    while (pts[hi].t < t)
+        hi++;
+
+    const FingerCalib::Point& a = pts[hi - 1];
+    const FingerCalib::Point& b = pts[hi];
+    double u = (t - a.t) / (b.t - a.t);
+
+    for (int k = 0; k < 3; ++k)
+        d[k] = a.d[k] + u * (b.d[k] - a.d[k]);
+}
+
+// b - A * d(t): everything added after the matrix product
+static void offset_at(const FingerCalib& fc, double t, double c[3])
+{
+    double d[3];
+    drift_at(fc, t, d);
+
+    for (int r = 0; r < 3; ++r)
+        c[r] = fc.b[r] - (fc.a[r * 3 + 0] * d[0] +
+                          fc.a[r * 3 + 1] * d[1] +
+                          fc.a[r * 3 + 2] * d[2]);
+}
+
+Calibration::Calibration(const DeviceCalib& dev)
+    : name(dev.name),
+      temp_min(dev.temp_min),
+      inv_step(TABLE_SIZE / (dev.temp_max - dev.temp_min))
+{
+    double step = 1.0 / inv_step;
+
+    for (size_t w = 0; w < DeviceCalib::MAX_FINGERS; ++w)
+    {
+        const FingerCalib& fc = dev.fingers[w];
+        Finger& f = fingers[w];
+
+        std::memcpy(f.a, fc.a, sizeof(f.a));
+
+        for (int k = 0; k < 3; ++k)
+        {
+            f.c0[k].resize(TABLE_SIZE);
+            f.c1[k].resize(TABLE_SIZE);
+        }
+
+        // each cell: the line through c() at its two ends
+        double lo[3], hi[3];
+        offset_at(fc, temp_min, lo);
+
+        for (size_t i = 0; i < TABLE_SIZE; ++i)
+        {
+            double t0 = temp_min + i * step;
+            offset_at(fc, t0 + step, hi);
+
+            for (int k = 0; k < 3; ++k)
+            {
+                double slope = (hi[k] - lo[k]) / step;
+                f.c1[k][i] = slope;
+                f.c0[k][i] = lo[k] - slope * t0;
+                lo[k] = hi[k];
+            }
+        }
+    }
+}
+
+// --------------------------------------------------
+// Kernels
+// --------------------------------------------------
+//
+// One finger column at a time: the matrix and table pointers stay put
+// while the loop runs over that finger's frames. Temperatures outside
+// the table range use the edge cells' lines.
+
+void Calibration::apply_scalar(CalibBatch& b, size_t w, size_t from) const
+{
+    const Finger& f = fingers[w];
+    const double* a = f.a;
+    const double top = (double)(TABLE_SIZE - 1);
+
+    double* X = &b.x[w * b.frames];
+    double* Y = &b.y[w * b.frames];
+    double* Z = &b.z[w * b.frames];
+    const double* T = &b.temp[w * b.frames];
+
+    for (size_t i = from; i < b.n; ++i)
+    {
+        double t = T[i];
+        double u = (t - temp_min) * inv_step;
+        // a NaN temperature takes cell 0, like max_pd in the SIMD kernels
+        if (!(u > 0.0))
+            u = 0.0;
+        else if (u > top)
+            u = top;
+        size_t c = (size_t)u;
+
+        double px = X[i], py = Y[i], pz = Z[i];
+
+        X[i] = a[0] * px + a[1] * py + a[2] * pz + f.c0[0][c] + f.c1[0][c] * t;
+        Y[i] = a[3] * px + a[4] * py + a[5] * pz + f.c0[1][c] + f.c1[1][c] * t;
+        Z[i] = a[6] * px + a[7] * py + a[8] * pz + f.c0[2][c] + f.c1[2][c] * t;
+    }
+}
+
+#ifdef CALIB_X86
+
+// SSE2 is part of x86-64, so this needs no dispatch there; two frames
+// per step, table entries loaded one lane at a time
+void Calibration::apply_sse2(CalibBatch& b, size_t w) const
+{
+    const Finger& f = fingers[w];
+
+    double* X = &b.x[w * b.frames];
+    double* Y = &b.y[w * b.frames];
+    double* Z = &b.z[w * b.frames];
+    const double* T = &b.temp[w * b.frames];
+
+    __m128d a[9];
+    for (int k = 0; k < 9; ++k)
+        a[k] = _mm_set1_pd(f.a[k]);
+
+    const __m128d tmin = _mm_set1_pd(temp_min);
+    const __m128d inv  = _mm_set1_pd(inv_step);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d top  = _mm_set1_pd((double)(TABLE_SIZE - 1));
+
+    size_t i = 0;
+    for (; i + 2 <= b.n; i += 2)
+    {
+        __m128d t = _mm_loadu_pd(T + i);
+        __m128d u = _mm_mul_pd(_mm_sub_pd(t, tmin), inv);
+        u = _mm_min_pd(_mm_max_pd(u, zero), top);
+
+        __m128i idx = _mm_cvttpd_epi32(u);
+        int c0 = _mm_cvtsi128_si32(idx);
+        int c1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(idx, 1));
+
+        __m128d px = _mm_loadu_pd(X + i);
+        __m128d py = _mm_loadu_pd(Y + i);
+        __m128d pz = _mm_loadu_pd(Z + i);
+
+        __m128d out[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            __m128d off = _mm_add_pd(
+                _mm_set_pd(f.c0[r][c1], f.c0[r][c0]),
+                _mm_mul_pd(_mm_set_pd(f.c1[r][c1], f.c1[r][c0]), t));
+
+            out[r] = _mm_add_pd(
+                _mm_add_pd(_mm_mul_pd(a[r * 3 + 0], px),
+                           _mm_mul_pd(a[r * 3 + 1], py)),
+                _mm_add_pd(_mm_mul_pd(a[r * 3 + 2], pz), off));
+        }
+
+        _mm_storeu_pd(X + i, out[0]);
+        _mm_storeu_pd(Y + i, out[1]);
+        _mm_storeu_pd(Z + i, out[2]);
+    }
+
+    apply_scalar(b, w, i);
+}
+
+// four frames per step with fused multiply-adds and gathered table
+// entries; compiled for AVX2 regardless of the build flags and only
+// called after best_kernel() checked the CPU
+__attribute__((target("avx2,fma")))
+void Calibration::apply_avx2(CalibBatch& b, size_t w) const
+{
+    const Finger& f = fingers[w];
+
+    double* X = &b.x[w * b.frames];
+    double* Y = &b.y[w * b.frames];
+    double* Z = &b.z[w * b.frames];
+    const double* T = &b.temp[w * b.frames];
+
+    __m256d a[9];
+    for (int k = 0; k < 9; ++k)
+        a[k] = _mm256_set1_pd(f.a[k]);
+
+    const __m256d tmin = _mm256_set1_pd(temp_min);
+    const __m256d inv  = _mm256_set1_pd(inv_step);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d top  = _mm256_set1_pd((double)(TABLE_SIZE - 1));
+    // the masked gather with every lane on: the unmasked intrinsic
+    // starts from an undefined register GCC 12 warns about
+    const __m256d all  = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+    size_t i = 0;
+    for (; i + 4 <= b.n; i += 4)
+    {
+        __m256d t = _mm256_loadu_pd(T + i);
+        __m256d u = _mm256_mul_pd(_mm256_sub_pd(t, tmin), inv);
+        u = _mm256_min_pd(_mm256_max_pd(u, zero), top);
+        __m128i idx = _mm256_cvttpd_epi32(u);
+
+        __m256d px = _mm256_loadu_pd(X + i);
+        __m256d py = _mm256_loadu_pd(Y + i);
+        __m256d pz = _mm256_loadu_pd(Z + i);
+
+        __m256d out[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            __m256d c0 = _mm256_mask_i32gather_pd(zero, f.c0[r].data(),
+                                                  idx, all, 8);
+            __m256d c1 = _mm256_mask_i32gather_pd(zero, f.c1[r].data(),
+                                                  idx, all, 8);
+
+            __m256d acc = _mm256_fmadd_pd(c1, t, c0);
+            acc = _mm256_fmadd_pd(a[r * 3 + 0], px, acc);
+            acc = _mm256_fmadd_pd(a[r * 3 + 1], py, acc);
+            out[r] = _mm256_fmadd_pd(a[r * 3 + 2], pz, acc);
+        }
+
+        _mm256_storeu_pd(X + i, out[0]);
+        _mm256_storeu_pd(Y + i, out[1]);
+        _mm256_storeu_pd(Z + i, out[2]);
+    }
+
+    apply_scalar(b, w, i);
+}
+
+#endif
+
+Calibration::Kernel Calibration::best_kernel()
+{
+#ifdef CALIB_X86
+    static const Kernel k =
+        __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+            ? Kernel::avx2 : Kernel::sse2;
+    return k;
+#else
+    return Kernel::scalar;
+#endif
+}
+
+const char* Calibration::kernel_name(Kernel k)
+{
+    switch (k)
+    {
+    case Kernel::scalar: return "scalar";
+    case Kernel::sse2:   return "sse2";
+    case Kernel::avx2:   return "avx2";
+    }
+    return "?";
+}
+
+void Calibration::apply(CalibBatch& b, Kernel k) const
+{
+    for (size_t w = 0; w < b.used; ++w)
+    {
+        switch (k)
+        {
+#ifdef CALIB_X86
+        case Kernel::avx2: apply_avx2(b, w); break;
+        case Kernel::sse2: apply_sse2(b, w); break;
+#endif
+        default:           apply_scalar(b, w, 0); break;
+        }
+    }
+}
+
+// --------------------------------------------------
+// Pipeline stage
+// --------------------------------------------------
+
+CalibratingHandler::CalibratingHandler(const Calibration& cal,
+                                       PacketHandler& next,
+                                       size_t batch_frames)
+    : cal(cal), next(next),
+      batch(batch_frames, DeviceCalib::MAX_FINGERS)
+{}
+
+void CalibratingHandler::on_finger_packet(
+    uint16_t seq,
+    uint64_t timestamp,
+    const FingerArrayView& fingers)
+{
+    batch.add(seq, timestamp, fingers);
+
+    if (batch.full())
+        flush();
+}
+
+void CalibratingHandler::flush()
+{
+    if (!batch.n)
+        return;
+
+    cal.apply(batch);
+    frames.inc(batch.n);
+    batches.inc();
+
+    // host and wire finger layouts are the same (see schema.hpp)
+    pkt_finger_t out[DeviceCalib::MAX_FINGERS];
+
+    for (size_t i = 0; i < batch.n; ++i)
+    {
+        uint8_t c = batch.get(i, out);
+        next.on_finger_packet(batch.seq[i], batch.timestamp[i],
+            FingerArrayView(reinterpret_cast<const uint8_t*>(out), c));
+    }
+
+    batch.clear();
+}
+
+void CalibratingHandler::on_unknown(
+    uint8_t type,
+    uint16_t seq,
+    const uint8_t* payload,
+    uint16_t len)
+{
+    flush();
+    next.on_unknown(type, seq, payload, len);
+}
+
+void CalibratingHandler::on_time_reply(
+    uint16_t seq,
+    uint64_t host_tx_us,
+    uint64_t dev_rx_us,
+    uint64_t dev_tx_us)
+{
+    flush();
+    next.on_time_reply(seq, host_tx_us, dev_rx_us, dev_tx_us);
+}
+
+void CalibratingHandler::on_probe_echo(uint16_t seq, uint64_t host_tx_us,
+                                       uint16_t len)
+{
+    flush();
+    next.on_probe_echo(seq, host_tx_us, len);
+}
+
+void CalibratingHandler::on_bad_crc(uint8_t type, uint16_t seq)
+{
+    flush();
+    next.on_bad_crc(type, seq);
+}
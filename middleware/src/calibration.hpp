@@ -0,0 +1,205 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "protocol.hpp"
+#include "metrics.hpp"
+
+// --------------------------------------------------
+// Finger calibration
+// --------------------------------------------------
+//
+// Per device and finger, raw positions are corrected for temperature
+// drift d(t) and then mapped through an affine transform:
+//
+//   p = A * (p_raw - d(temp)) + b
+//
+// A is 3x3 (scale and axis mixing), d a piecewise-linear curve through
+// the file's points. Building a Calibration folds b - A * d(t) into a
+// table of TABLE_SIZE cells over [temp_min, temp_max], each holding the
+// line c0 + c1 * t through the cell's ends, so applying it is nine
+// multiply-adds and one table lookup per finger.
+//
+// The table is exact in cells where d is a straight line. In a cell
+// holding a drift point at k, the chord cuts the corner: it is off by up
+// to |A * (slope change of d at k)| * (k - a)(b - k) / h, where a, b are
+// the cell's ends and h = (tmax - tmin) / TABLE_SIZE. That is at most a
+// quarter of slope change * h, with h 0.3125 C by default. Drift points
+// on cell edges cost nothing. --calib-bench reports the error and this
+// bound.
+//
+// Text file, one directive per line, '#' comments:
+//   device <name>                      following lines are for <name>
+//   range  <tmin> <tmax>               table span, default 0 .. 80 C
+//   affine <finger> a00 a01 a02 b0  a10 a11 a12 b1  a20 a21 a22 b2
+//   scale  <finger> sx sy sz [bx by bz]       diagonal A
+//   temp   <finger> <t> dx dy dz       one drift curve point
+// Lines before the first 'device' belong to "default". Fingers without
+// lines are left as they are.
+
+struct FingerCalib
+{
+    double a[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    double b[3] = {0, 0, 0};
+
+    struct Point { double t, d[3]; };
+    std::vector<Point> drift;       // sorted by t on load
+};
+
+struct DeviceCalib
+{
+    static constexpr size_t MAX_FINGERS = 16;
+
+    std::string name;
+    double temp_min = 0.0;
+    double temp_max = 80.0;
+    FingerCalib fingers[MAX_FINGERS];
+};
+
+class CalibrationFile
+{
+public:
+    bool load(const std::string& path);
+
+    // nullptr if there is no such device
+    const DeviceCalib* find(const std::string& name) const;
+
+    std::vector<DeviceCalib> devices;
+};
+
+// --------------------------------------------------
+// Frame batch (structure of arrays)
+// --------------------------------------------------
+//
+// Up to 'frames' frames of up to 'width' fingers. Per-finger columns are
+// finger-major (column[finger * frames + frame]), so a kernel walks one
+// finger's frames with that finger's coefficients held in registers.
+
+struct CalibBatch
+{
+    CalibBatch(size_t frames, size_t width);
+
+    const size_t frames;
+    const size_t width;
+    size_t n = 0;                   // frames held
+    size_t used = 0;                // finger columns any of them fills
+
+    std::vector<uint16_t> seq;
+    std::vector<uint64_t> timestamp;
+    std::vector<uint8_t>  count;
+
+    std::vector<double>   x, y, z, temp;
+    std::vector<uint32_t> state;
+
+    bool full() const { return n == frames; }
+    void clear() { n = used = 0; }
+
+    // false if the batch is full; fingers past 'width' are dropped
+    bool add(uint16_t s, uint64_t ts, const FingerArrayView& fingers);
+
+    // frame i back to wire-layout fingers; returns the finger count
+    uint8_t get(size_t i, pkt_finger_t* out) const;
+
+private:
+    void clear_at(size_t at)
+    {
+        x[at] = y[at] = z[at] = temp[at] = 0.0;
+        state[at] = 0;
+    }
+};
+
+// --------------------------------------------------
+// Precomputed device calibration
+// --------------------------------------------------
+
+class Calibration
+{
+public:
+    static constexpr size_t TABLE_SIZE = 256;
+
+    enum class Kernel { scalar, sse2, avx2 };
+
+    explicit Calibration(const DeviceCalib& dev);
+
+    // widest kernel this CPU runs
+    static Kernel best_kernel();
+    static const char* kernel_name(Kernel k);
+
+    Kernel kernel = best_kernel();
+
+    // calibrate x/y/z of every frame in place
+    void apply(CalibBatch& b) const { apply(b, kernel); }
+    void apply(CalibBatch& b, Kernel k) const;
+
+    const std::string& device() const { return name; }
+
+private:
+    struct Finger
+    {
+        double a[9];
+        // c(t) = c0 + c1 * t per axis, TABLE_SIZE cells each
+        std::vector<double> c0[3], c1[3];
+    };
+
+    void apply_scalar(CalibBatch& b, size_t w, size_t from) const;
+#if defined(__x86_64__) || defined(__i386__)
+    void apply_sse2(CalibBatch& b, size_t w) const;
+    void apply_avx2(CalibBatch& b, size_t w) const;
+#endif
+
+    std::string name;
+    double temp_min;
+    double inv_step;                // cells per degree
+    Finger fingers[DeviceCalib::MAX_FINGERS];
+};
+
+// --------------------------------------------------
+// Pipeline stage
+// --------------------------------------------------
+//
+// Sits between the parser and the application handler: finger frames are
+// batched and calibrated together when the parser runs out of input (or
+// the batch fills), then dispatched in order. Other packets flush the
+// batch first, so the order the handler sees is unchanged.
+
+class CalibratingHandler : public PacketHandler
+{
+public:
+    CalibratingHandler(const Calibration& cal, PacketHandler& next,
+                       size_t batch_frames = 64);
+
+    void on_finger_packet(
+        uint16_t seq,
+        uint64_t timestamp,
+        const FingerArrayView& fingers) override;
+
+    void on_unknown(
+        uint8_t type,
+        uint16_t seq,
+        const uint8_t* payload,
+        uint16_t len) override;
+
+    void on_time_reply(
+        uint16_t seq,
+        uint64_t host_tx_us,
+        uint64_t dev_rx_us,
+        uint64_t dev_tx_us) override;
+
+    void on_probe_echo(uint16_t seq, uint64_t host_tx_us, uint16_t len) override;
+    void on_bad_crc(uint8_t type, uint16_t seq) override;
+    void on_parse_end() override { flush(); }
+
+    void flush();
+
+private:
+    const Calibration& cal;
+    PacketHandler& next;
+    CalibBatch batch;
+
+    Counter& frames = metrics().counter(
+        "soupy_calib_frames_total", "Finger frames calibrated");
+    Counter& batches = metrics().counter(
+        "soupy_calib_batches_total", "Calibration batches applied");
+};
@@ -0,0 +1,106 @@
+#include "clock_sync.hpp"
+
+#include <cstdio>
+
+// samples slower than min + max(FLOOR, min * FRAC) are treated as queued
+static constexpr double DELAY_FLOOR_US = 50.0;
+static constexpr double DELAY_FRAC     = 0.5;
+
+// need this much host time under the samples before trusting a slope
+static constexpr int64_t MIN_SPAN_US = 200000;
+
+void ClockSync::add(uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3)
+{
+    // reject exchanges that make no sense (reordered or wrapped clocks)
+    if (t3 < t0 || t2 < t1)
+        return;
+
+    // differences first: the raw clocks may be far apart
+    double fwd = (double)(int64_t)(t1 - t0);
+    double back = (double)(int64_t)(t2 - t3);
+
+    Sample& s = ring[head];
+    s.host_mid = (int64_t)(t0 + (t3 - t0) / 2);
+    s.offset = (fwd + back) / 2.0;
+    s.delay = (double)(t3 - t0) - (double)(t2 - t1);
+
+    head = (head + 1) % WINDOW;
+    if (count < WINDOW) count++;
+
+    n_samples.fetch_add(1, std::memory_order_relaxed);
+    refit();
+}
+
+void ClockSync::refit()
+{
+    double min_delay = 1e300;
+    for (size_t i = 0; i < count; ++i)
+        if (ring[i].delay < min_delay)
+            min_delay = ring[i].delay;
+
+    double slack = min_delay * DELAY_FRAC;
+    if (slack < DELAY_FLOOR_US) slack = DELAY_FLOOR_US;
+    double limit = min_delay + slack;
+
+    // newest sample is the reference point, keeping the numbers small
+    int64_t r = ring[(head + WINDOW - 1) % WINDOW].host_mid;
+
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int64_t lo = INT64_MAX, hi = INT64_MIN;
+    size_t n = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Sample& s = ring[i];
+        if (s.delay > limit)
+            continue;
+
+        double x = (double)(s.host_mid - r);
+        sx += x;
+        sy += s.offset;
+        sxx += x * x;
+        sxy += x * s.offset;
+        n++;
+
+        if (s.host_mid < lo) lo = s.host_mid;
+        if (s.host_mid > hi) hi = s.host_mid;
+    }
+
+    if (!n)
+        return;
+
+    double slope = b;
+    double den = n * sxx - sx * sx;
+
+    if (n >= 4 && hi - lo >= MIN_SPAN_US && den > 0.0)
+        slope = (n * sxy - sx * sy) / den;
+
+    // intercept at the reference with the current (or previous) slope
+    a = (sy - slope * sx) / n;
+    b = slope;
+    ref = r;
+    used = n;
+    fitted = true;
+
+    pub_offset.store(a, std::memory_order_relaxed);
+    pub_skew.store(b * 1e6, std::memory_order_relaxed);
+    pub_delay.store(min_delay, std::memory_order_relaxed);
+}
+
+uint64_t ClockSync::to_host(uint64_t dev_us) const
+{
+    // dev = h + a + b * (h - ref)  =>  h = (dev - a + b * ref) / (1 + b),
+    // done relative to ref to keep precision
+    double dev_rel = (double)(int64_t)(dev_us - (uint64_t)ref);
+    double h_rel = (dev_rel - a) / (1.0 + b);
+
+    return (uint64_t)(ref + (int64_t)(h_rel >= 0 ? h_rel + 0.5 : h_rel - 0.5));
+}
+
+void ClockSync::print() const
+{
+    std::printf("[CLOCK] samples=%llu used=%zu offset=%.1f us "
+                "skew=%.3f ppm min_rtt=%.0f us\n",
+        (unsigned long long)samples(), used,
+        offset_us(), skew_ppm(), min_delay_us());
+}
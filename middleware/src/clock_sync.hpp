@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// --------------------------------------------------
+// Device -> host clock estimator
+// --------------------------------------------------
+//
+// NTP-style: each heartbeat carries the host send time t0, the device
+// answers with its receive and send times t1, t2, and the host notes the
+// arrival t3. Per exchange
+//
+//   offset = ((t1 - t0) + (t2 - t3)) / 2      device minus host
+//   delay  = (t3 - t0) - (t2 - t1)            round trip on the wire
+//
+// Queueing only ever adds delay, so the estimator keeps the samples
+// whose delay is close to the window minimum and fits offset against
+// host time with least squares. The slope is the skew (device ticks
+// faster by 'skew' per tick); drift shows up as the slope moving as the
+// window slides.
+//
+// Single writer (whoever parses packets); stats may be read anywhere.
+
+class ClockSync
+{
+public:
+    static constexpr size_t WINDOW = 128;   // ~1.3 s of 100 Hz heartbeats
+
+    // one completed exchange, all in microseconds
+    void add(uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3);
+
+    bool valid() const { return fitted; }
+
+    // device timestamp -> host steady_clock microseconds
+    uint64_t to_host(uint64_t dev_us) const;
+
+    double offset_us() const { return pub_offset.load(std::memory_order_relaxed); }
+    double skew_ppm() const { return pub_skew.load(std::memory_order_relaxed); }
+    double min_delay_us() const { return pub_delay.load(std::memory_order_relaxed); }
+    uint64_t samples() const { return n_samples.load(std::memory_order_relaxed); }
+
+    void print() const;
+
+private:
+    struct Sample
+    {
+        int64_t host_mid;   // (t0 + t3) / 2
+        double  offset;
+        double  delay;
+    };
+
+    void refit();
+
+    Sample ring[WINDOW];
+    size_t head = 0;
+    size_t count = 0;
+
+    // offset(h) = a + b * (h - ref)
+    bool    fitted = false;
+    int64_t ref = 0;
+    double  a = 0.0;
+    double  b = 0.0;
+    size_t  used = 0;
+
+    std::atomic<double>   pub_offset{0.0};
+    std::atomic<double>   pub_skew{0.0};
+    std::atomic<double>   pub_delay{0.0};
+    std::atomic<uint64_t> n_samples{0};
+};
@@ -0,0 +1,231 @@
+#include "codec_bench.hpp"
+#include "protocol.hpp"
+#include "schema.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ns_per(bench_clock::time_point t0, bench_clock::time_point t1,
+                     unsigned iters)
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        t1 - t0).count() / iters;
+}
+
+static void report(const char* what, double ns, size_t bytes)
+{
+    std::printf("[CODEC] %-22s %7.1f ns/frame %8.1f MB/s\n",
+        what, ns, ns > 0 ? bytes / ns * 1000.0 : 0.0);
+}
+
+// --------------------------------------------------
+// Previous implementation, kept here for comparison
+// --------------------------------------------------
+
+static uint32_t crc32_bitwise(const uint8_t* data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; ++j)
+            crc = (crc >> 1) ^ (0xEDB88320u & (uint32_t)-(int)(crc & 1u));
+    }
+
+    return ~crc;
+}
+
+static std::vector<uint8_t> legacy_encode_fingers(
+    uint16_t seq, uint64_t ts, const FingerData* src, uint8_t count)
+{
+    std::vector<FingerData> fingers(src, src + count);
+
+    std::vector<uint8_t> payload(9 + count * sizeof(FingerData));
+    std::memcpy(payload.data(), &ts, 8);
+    payload[8] = count;
+    std::memcpy(payload.data() + 9, fingers.data(),
+                count * sizeof(FingerData));
+
+    PacketHeader hdr{};
+    hdr.magic = MAGIC;
+    hdr.size  = (uint16_t)payload.size();
+    hdr.seq   = seq;
+    hdr.type  = 1;
+
+    std::vector<uint8_t> pkt(sizeof(hdr) + payload.size() + 4);
+    size_t off = 0;
+    std::memcpy(pkt.data() + off, &hdr, sizeof(hdr));       off += sizeof(hdr);
+    std::memcpy(pkt.data() + off, payload.data(), payload.size());
+    off += payload.size();
+
+    uint32_t crc = crc32_bitwise(pkt.data(), off);
+    std::memcpy(pkt.data() + off, &crc, 4);
+    return pkt;
+}
+
+// field decoding as parse_from_ring did it: header and payload cast to
+// packed host structs
+static double legacy_decode_fingers(const uint8_t* frame, uint32_t& states)
+{
+    const PacketHeader* hdr = reinterpret_cast<const PacketHeader*>(frame);
+    const uint8_t* payload = frame + sizeof(PacketHeader);
+
+    if (hdr->magic != MAGIC || hdr->type != 1 || hdr->size < 9)
+        return 0.0;
+
+    uint64_t ts = *reinterpret_cast<const uint64_t*>(payload);
+    uint8_t count = payload[8];
+    if (hdr->size < 9 + count * sizeof(FingerData))
+        return 0.0;
+
+    const FingerData* f = reinterpret_cast<const FingerData*>(payload + 9);
+
+    double acc = (double)(ts & 1);
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        acc += f[i].x + f[i].y + f[i].z + f[i].temp;
+        states ^= f[i].state_array;
+    }
+    return acc;
+}
+
+static double schema_decode_fingers(const uint8_t* frame, uint32_t& states)
+{
+    using namespace wire;
+
+    const uint8_t* payload = frame + Header::SIZE;
+    uint16_t size = Header::size::load(frame);
+
+    FingersPacket p;
+    if (Header::magic::load(frame) != MAGIC ||
+        Header::type::load(frame) != PKT_TYPE_FINGERS ||
+        !decode_fingers(payload, size, p))
+        return 0.0;
+
+    double acc = (double)(p.timestamp & 1);
+    for (uint8_t i = 0; i < p.fingers.size(); ++i)
+    {
+        FingerView f = p.fingers[i];
+        acc += f.x() + f.y() + f.z() + f.temp();
+        states ^= f.state_array();
+    }
+    return acc;
+}
+
+// --------------------------------------------------
+// Bench
+// --------------------------------------------------
+
+int run_codec_bench(unsigned iters)
+{
+    const uint8_t count = 5;
+    FingerData fingers[count];
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        fingers[i].x = 0.1 * i;
+        fingers[i].y = 0.2 * i;
+        fingers[i].z = 0.3 * i;
+        fingers[i].state_array = i;
+        fingers[i].temp = 30.0f;
+    }
+
+    const size_t frame_len = PKT_FINGERS_FRAME(count);
+
+    // a batch of back-to-back frames, decoded as a stream
+    const unsigned batch = 256;
+    std::vector<uint8_t> stream(batch * frame_len);
+    volatile size_t sink = 0;
+
+    auto t0 = bench_clock::now();
+    for (unsigned i = 0; i < iters; ++i)
+    {
+        uint8_t* out = stream.data() + (i % batch) * frame_len;
+        sink = sink + pkt_encode_fingers(out, frame_len, (uint16_t)i,
+                                         i, fingers, count);
+    }
+    auto t1 = bench_clock::now();
+    report("encode fingers", ns_per(t0, t1, iters), frame_len);
+
+    uint64_t decoded = 0;
+    auto t2 = bench_clock::now();
+    for (unsigned done = 0; done < iters;)
+    {
+        const uint8_t* p = stream.data();
+        size_t left = stream.size();
+
+        while (left && done < iters)
+        {
+            pkt_view_t v;
+            if (pkt_decode(p, left, &v) != PKT_OK)
+                break;
+
+            uint64_t ts;
+            const pkt_finger_t* f;
+            uint8_t n;
+            if (pkt_decode_fingers(&v, &ts, &f, &n))
+                decoded += n;
+
+            p += v.frame_len;
+            left -= v.frame_len;
+            done++;
+        }
+    }
+    auto t3 = bench_clock::now();
+    report("decode fingers", ns_per(t2, t3, iters), frame_len);
+
+    // field access only (CRC already checked): frames sit at odd offsets,
+    // so most timestamps and fingers are unaligned
+    double (*decoders[])(const uint8_t*, uint32_t&) = {
+        legacy_decode_fingers, schema_decode_fingers };
+    const char* decoder_names[] = {
+        "fields via casts (old)", "fields via schema" };
+    double sums[2] = {};
+
+    for (int d = 0; d < 2; ++d)
+    {
+        uint32_t states = 0;
+        double acc = 0.0;
+
+        auto a = bench_clock::now();
+        for (unsigned i = 0; i < iters; ++i)
+            acc += decoders[d](stream.data() + (i % batch) * frame_len, states);
+        auto b = bench_clock::now();
+
+        sums[d] = acc + states;
+        report(decoder_names[d], ns_per(a, b, iters), frame_len);
+    }
+
+    uint8_t hb[PKT_HEARTBEAT_FRAME];
+    auto t4 = bench_clock::now();
+    for (unsigned i = 0; i < iters; ++i)
+        sink = sink + pkt_encode_heartbeat(hb, sizeof(hb), (uint16_t)i, i);
+    auto t5 = bench_clock::now();
+    report("encode heartbeat", ns_per(t4, t5, iters), sizeof(hb));
+
+    auto t6 = bench_clock::now();
+    for (unsigned i = 0; i < iters; ++i)
+        sink = sink + legacy_encode_fingers((uint16_t)i, i, fingers,
+                                            count).size();
+    auto t7 = bench_clock::now();
+    report("encode fingers (old)", ns_per(t6, t7, iters), frame_len);
+
+    // the old encoder must produce the same bytes
+    std::vector<uint8_t> ref = legacy_encode_fingers(7, 42, fingers, count);
+    uint8_t mine[PKT_FINGERS_FRAME(5)];
+    pkt_encode_fingers(mine, sizeof(mine), 7, 42, fingers, count);
+    bool same = ref.size() == sizeof(mine) &&
+                std::memcmp(ref.data(), mine, sizeof(mine)) == 0;
+
+    bool agree = sums[0] == sums[1];
+
+    std::printf("[CODEC] frames=%u fingers decoded=%llu wire-compatible=%s "
+                "schema-matches-casts=%s\n",
+        iters, (unsigned long long)decoded, same ? "yes" : "NO",
+        agree ? "yes" : "NO");
+
+    return same && agree ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// --------------------------------------------------
+// Packet codec bench
+// --------------------------------------------------
+//
+// Encode/decode throughput of shared/packet_codec.h for finger and
+// heartbeat frames, next to the vector-building encoder and bitwise
+// CRC it replaced.
+
+int run_codec_bench(unsigned iters);
@@ -0,0 +1,433 @@
+#include "libusb.h"
+#include "../protocol.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const uint16_t FAKE_VID = 0x1d50;
+static const uint16_t FAKE_PID = 0xdead;
+
+static const int MAX_PACKET = 64;   // full-speed bulk
+
+// --------------------------------------------------
+// Model state
+// --------------------------------------------------
+
+struct FakeTransfer
+{
+    libusb_transfer t{};            // must stay first
+    Clock::time_point deadline;
+    bool has_deadline = false;
+};
+
+struct libusb_device_handle
+{
+    libusb_context* ctx;
+};
+
+struct libusb_context
+{
+    std::mutex m;
+    std::condition_variable dev_cv;     // wakes the device thread
+    std::condition_variable done_cv;    // wakes handle_events
+
+    // short lists, kept as vectors so the model stops allocating once
+    // they reach their working size (--alloc-check)
+    std::vector<FakeTransfer*> in_pending;
+    std::vector<libusb_transfer*> completed;
+
+    // device TX FIFO (byte stream, like tud_vendor_write)
+    ByteRing fifo{4096};
+
+    unsigned rate_hz  = 1000;
+    unsigned pkt_us   = 53;
+    size_t   fifo_cap = 4096;
+
+    Clock::time_point bus_free;
+    uint16_t seq = 0;
+    uint64_t overruns = 0;
+
+    libusb_device_handle handle{this};
+    bool opened = false;
+    bool stop = false;
+    std::thread dev;
+
+    std::mt19937 rng{12345};
+
+    void device_loop();
+    void produce_fingers();
+    void complete(libusb_transfer* t, libusb_transfer_status st);
+};
+
+static unsigned env_uint(const char* name, unsigned def)
+{
+    const char* v = std::getenv(name);
+    return v ? (unsigned)std::strtoul(v, nullptr, 10) : def;
+}
+
+// --------------------------------------------------
+// Device side
+// --------------------------------------------------
+
+void libusb_context::complete(libusb_transfer* t, libusb_transfer_status st)
+{
+    t->status = st;
+    completed.push_back(t);
+    done_cv.notify_all();
+}
+
+void libusb_context::produce_fingers()
+{
+    std::uniform_real_distribution<double> pos(-1.0, 1.0);
+
+    uint64_t ts = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now().time_since_epoch()).count();
+
+    const uint8_t count = 5;
+    FingerData fingers[count];
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        fingers[i].x = pos(rng);
+        fingers[i].y = pos(rng);
+        fingers[i].z = pos(rng);
+        fingers[i].state_array = i;
+        fingers[i].temp = 30.0f;
+    }
+
+    uint8_t pkt[PKT_FINGERS_FRAME(count)];
+    size_t len = pkt_encode_fingers(pkt, sizeof(pkt), seq++, ts,
+                                    fingers, count);
+
+    // the firmware can only queue what fits in its TX buffer
+    if (fifo.size() + len > fifo_cap)
+    {
+        overruns++;
+        return;
+    }
+
+    fifo.push(pkt, len);
+}
+
+void libusb_context::device_loop()
+{
+    std::unique_lock<std::mutex> lk(m);
+
+    auto period = std::chrono::nanoseconds(
+        rate_hz ? 1'000'000'000ull / rate_hz : 0);
+    auto next_gen = Clock::now();
+    bus_free = Clock::now();
+
+    while (!stop)
+    {
+        auto now = Clock::now();
+
+        while (rate_hz && now >= next_gen)
+        {
+            produce_fingers();
+            next_gen += period;
+        }
+
+        // IN transfer timeouts
+        for (auto it = in_pending.begin(); it != in_pending.end();)
+        {
+            if ((*it)->has_deadline && now >= (*it)->deadline)
+            {
+                complete(&(*it)->t, LIBUSB_TRANSFER_TIMED_OUT);
+                it = in_pending.erase(it);
+            }
+            else
+                ++it;
+        }
+
+        // one bus packet per pkt_us into the oldest pending IN transfer
+        if (now >= bus_free && !in_pending.empty() && !fifo.empty())
+        {
+            libusb_transfer* t = &in_pending.front()->t;
+
+            int room = t->length - t->actual_length;
+            int n = (int)fifo.size();
+            if (n > MAX_PACKET) n = MAX_PACKET;
+            if (n > room) n = room;
+
+            fifo.read(t->buffer + t->actual_length, (size_t)n);
+
+            t->actual_length += n;
+
+            // the bus runs on its own clock; a late wakeup may catch up
+            // on at most one 1 ms frame worth of packets
+            auto floor = now - std::chrono::milliseconds(1);
+            if (bus_free < floor) bus_free = floor;
+            bus_free += std::chrono::microseconds(pkt_us);
+
+            // a short packet or a full buffer ends the transfer; a
+            // max-size packet that drains the FIFO does not (no ZLP)
+            if (n < MAX_PACKET || t->actual_length == t->length)
+            {
+                in_pending.erase(in_pending.begin());
+                complete(t, LIBUSB_TRANSFER_COMPLETED);
+            }
+            continue;
+        }
+
+        // sleep until the next thing can happen
+        auto wake = now + std::chrono::milliseconds(50);
+        if (rate_hz && next_gen < wake)
+            wake = next_gen;
+        if (!in_pending.empty() && !fifo.empty() && bus_free < wake)
+            wake = bus_free;
+        for (auto* ft : in_pending)
+            if (ft->has_deadline && ft->deadline < wake)
+                wake = ft->deadline;
+
+        dev_cv.wait_until(lk, wake);
+    }
+}
+
+// --------------------------------------------------
+// Context / device
+// --------------------------------------------------
+
+int libusb_init(libusb_context** ctx)
+{
+    auto* c = new libusb_context();
+
+    c->rate_hz  = env_uint("FAKE_USB_RATE_HZ", 1000);
+    c->pkt_us   = env_uint("FAKE_USB_PKT_US", 53);
+    c->fifo_cap = env_uint("FAKE_USB_FIFO", 4096);
+    c->fifo = ByteRing(c->fifo_cap);
+
+    // more than the transport ever keeps in flight
+    c->in_pending.reserve(64);
+    c->completed.reserve(64);
+
+    *ctx = c;
+    return LIBUSB_SUCCESS;
+}
+
+void libusb_exit(libusb_context* ctx)
+{
+    if (!ctx) return;
+
+    if (ctx->overruns)
+        std::printf("[FAKE-USB] device TX overruns: %llu\n",
+            (unsigned long long)ctx->overruns);
+
+    delete ctx;
+}
+
+libusb_device_handle* libusb_open_device_with_vid_pid(
+    libusb_context* ctx, uint16_t vendor_id, uint16_t product_id)
+{
+    if (vendor_id != FAKE_VID || product_id != FAKE_PID || ctx->opened)
+        return nullptr;
+
+    ctx->opened = true;
+    ctx->stop = false;
+    ctx->dev = std::thread([ctx]{ ctx->device_loop(); });
+
+    std::printf("[FAKE-USB] device up: %u Hz, %u us/packet, %zu B FIFO\n",
+        ctx->rate_hz, ctx->pkt_us, ctx->fifo_cap);
+
+    return &ctx->handle;
+}
+
+void libusb_close(libusb_device_handle* handle)
+{
+    libusb_context* ctx = handle->ctx;
+
+    {
+        std::lock_guard<std::mutex> lk(ctx->m);
+        ctx->stop = true;
+    }
+    ctx->dev_cv.notify_all();
+
+    if (ctx->dev.joinable())
+        ctx->dev.join();
+
+    ctx->opened = false;
+}
+
+int libusb_set_auto_detach_kernel_driver(libusb_device_handle*, int)
+{
+    return LIBUSB_SUCCESS;
+}
+
+int libusb_claim_interface(libusb_device_handle*, int)
+{
+    return LIBUSB_SUCCESS;
+}
+
+int libusb_release_interface(libusb_device_handle*, int)
+{
+    return LIBUSB_SUCCESS;
+}
+
+// --------------------------------------------------
+// Transfers
+// --------------------------------------------------
+
+libusb_transfer* libusb_alloc_transfer(int)
+{
+    return &(new FakeTransfer())->t;
+}
+
+void libusb_free_transfer(libusb_transfer* t)
+{
+    delete reinterpret_cast<FakeTransfer*>(t);
+}
+
+int libusb_submit_transfer(libusb_transfer* t)
+{
+    if (!t->dev_handle)
+        return LIBUSB_ERROR_INVALID_PARAM;
+
+    // only the async IN path is used by the transport
+    if (!(t->endpoint & 0x80))
+        return LIBUSB_ERROR_IO;
+
+    libusb_context* ctx = t->dev_handle->ctx;
+    auto* ft = reinterpret_cast<FakeTransfer*>(t);
+
+    {
+        std::lock_guard<std::mutex> lk(ctx->m);
+
+        if (ctx->stop)
+            return LIBUSB_ERROR_NO_DEVICE;
+
+        t->actual_length = 0;
+        ft->has_deadline = t->timeout != 0;
+        if (ft->has_deadline)
+            ft->deadline = Clock::now() + std::chrono::milliseconds(t->timeout);
+
+        ctx->in_pending.push_back(ft);
+    }
+    ctx->dev_cv.notify_all();
+    return LIBUSB_SUCCESS;
+}
+
+int libusb_cancel_transfer(libusb_transfer* t)
+{
+    libusb_context* ctx = t->dev_handle->ctx;
+    std::lock_guard<std::mutex> lk(ctx->m);
+
+    for (auto it = ctx->in_pending.begin(); it != ctx->in_pending.end(); ++it)
+    {
+        if (&(*it)->t == t)
+        {
+            ctx->in_pending.erase(it);
+            ctx->complete(t, LIBUSB_TRANSFER_CANCELLED);
+            return LIBUSB_SUCCESS;
+        }
+    }
+    return LIBUSB_ERROR_NOT_FOUND;
+}
+
+// --------------------------------------------------
+// Event handling
+// --------------------------------------------------
+
+int libusb_handle_events_timeout_completed(
+    libusb_context* ctx, timeval* tv, int* completed)
+{
+    auto limit = Clock::now() +
+        std::chrono::seconds(tv ? tv->tv_sec : 0) +
+        std::chrono::microseconds(tv ? tv->tv_usec : 0);
+
+    // per calling thread: close() pumps events on the main thread while
+    // the event thread may still be in here. Swapping with 'completed'
+    // trades buffers, so both keep their capacity and neither allocates
+    // once warm
+    thread_local std::vector<libusb_transfer*> done;
+    if (!done.capacity())
+        done.reserve(64);
+
+    {
+        std::unique_lock<std::mutex> lk(ctx->m);
+        ctx->done_cv.wait_until(lk, limit, [&]{
+            return !ctx->completed.empty() || (completed && *completed);
+        });
+        done.swap(ctx->completed);
+    }
+
+    // callbacks run on the caller's thread, outside the model lock
+    for (auto* t : done)
+        if (t->callback)
+            t->callback(t);
+    done.clear();
+
+    return LIBUSB_SUCCESS;
+}
+
+int libusb_handle_events_timeout(libusb_context* ctx, timeval* tv)
+{
+    return libusb_handle_events_timeout_completed(ctx, tv, nullptr);
+}
+
+// Synchronous OUT: occupies the bus for its packets, then the device
+// answers into its TX FIFO like tud_vendor_rx_cb does.
+int libusb_bulk_transfer(
+    libusb_device_handle* handle, unsigned char endpoint,
+    unsigned char* data, int length, int* actual_length,
+    unsigned int)
+{
+    if (endpoint & 0x80)
+        return LIBUSB_ERROR_INVALID_PARAM;
+
+    libusb_context* ctx = handle->ctx;
+    Clock::time_point done_at;
+
+    {
+        std::lock_guard<std::mutex> lk(ctx->m);
+
+        int packets = (length + MAX_PACKET - 1) / MAX_PACKET;
+        if (!packets) packets = 1;
+
+        auto now = Clock::now();
+        if (ctx->bus_free < now) ctx->bus_free = now;
+        ctx->bus_free += std::chrono::microseconds(ctx->pkt_us * packets);
+        done_at = ctx->bus_free;
+
+        // timed heartbeats get a time reply (device clock = host clock),
+        // forces are consumed, anything else is echoed
+        uint8_t reply[PKT_TIME_REPLY_FRAME];
+        const uint8_t* out = data;
+        size_t out_len = (size_t)length;
+
+        pkt_view_t v;
+        uint64_t host_tx;
+        bool framed = pkt_decode(data, (size_t)length, &v) == PKT_OK;
+
+        if (framed && pkt_decode_heartbeat(&v, &host_tx))
+        {
+            uint64_t t = std::chrono::duration_cast<std::chrono::microseconds>(
+                done_at.time_since_epoch()).count();
+
+            out = reply;
+            out_len = pkt_encode_time_reply(reply, sizeof(reply), v.seq,
+                                            host_tx, t, t);
+        }
+        else if (framed && v.type == PKT_TYPE_FORCES)
+            out_len = 0;
+
+        if (ctx->fifo.size() + out_len <= ctx->fifo_cap)
+            ctx->fifo.push(out, out_len);
+        else
+            ctx->overruns++;
+    }
+    ctx->dev_cv.notify_all();
+
+    std::this_thread::sleep_until(done_at);
+
+    if (actual_length)
+        *actual_length = length;
+    return LIBUSB_SUCCESS;
+}
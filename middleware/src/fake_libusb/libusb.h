@@ -0,0 +1,113 @@
+#pragma once
+
+// --------------------------------------------------
+// Fake libusb
+// --------------------------------------------------
+//
+// Drop-in subset of the libusb-1.0 API used by usb_transport.cpp, backed
+// by an in-process model of the glove: a full-speed bulk pipe (64-byte
+// packets, fixed per-packet bus time) with a device that streams finger
+// packets at a fixed rate, answers timed heartbeats with a time reply and
+// echoes other bulk OUT data back on IN, like firmware.c does. Lets
+// USBTransportImpl be load-tested without hardware.
+//
+// Device model knobs (environment, read at libusb_init):
+//   FAKE_USB_RATE_HZ   finger packets per second        (default 1000)
+//   FAKE_USB_PKT_US    bus time per 64-byte packet, us  (default 53,
+//                      ~19 packets per 1 ms full-speed frame)
+//   FAKE_USB_FIFO      device TX buffer in bytes; data produced while
+//                      it is full is lost                (default 4096)
+//
+// Finger timestamps are host steady_clock microseconds, so end-to-end
+// latency can be measured exactly as with the sim transport.
+
+#include <cstdint>
+#include <sys/time.h>
+
+#define LIBUSB_CALL
+
+struct libusb_context;
+struct libusb_device_handle;
+struct libusb_transfer;
+
+typedef void (LIBUSB_CALL *libusb_transfer_cb_fn)(libusb_transfer* transfer);
+
+enum libusb_error {
+    LIBUSB_SUCCESS             = 0,
+    LIBUSB_ERROR_IO            = -1,
+    LIBUSB_ERROR_INVALID_PARAM = -2,
+    LIBUSB_ERROR_NO_DEVICE     = -4,
+    LIBUSB_ERROR_NOT_FOUND     = -5,
+    LIBUSB_ERROR_BUSY          = -6,
+    LIBUSB_ERROR_TIMEOUT       = -7,
+    LIBUSB_ERROR_NO_MEM        = -11,
+};
+
+enum libusb_transfer_status {
+    LIBUSB_TRANSFER_COMPLETED,
+    LIBUSB_TRANSFER_ERROR,
+    LIBUSB_TRANSFER_TIMED_OUT,
+    LIBUSB_TRANSFER_CANCELLED,
+    LIBUSB_TRANSFER_STALL,
+    LIBUSB_TRANSFER_NO_DEVICE,
+    LIBUSB_TRANSFER_OVERFLOW,
+};
+
+enum libusb_transfer_type {
+    LIBUSB_TRANSFER_TYPE_BULK = 2,
+};
+
+struct libusb_transfer {
+    libusb_device_handle* dev_handle;
+    uint8_t flags;
+    unsigned char endpoint;
+    unsigned char type;
+    unsigned int timeout;
+    libusb_transfer_status status;
+    int length;
+    int actual_length;
+    libusb_transfer_cb_fn callback;
+    void* user_data;
+    unsigned char* buffer;
+    int num_iso_packets;
+};
+
+int  libusb_init(libusb_context** ctx);
+void libusb_exit(libusb_context* ctx);
+
+libusb_device_handle* libusb_open_device_with_vid_pid(
+    libusb_context* ctx, uint16_t vendor_id, uint16_t product_id);
+void libusb_close(libusb_device_handle* handle);
+
+int libusb_set_auto_detach_kernel_driver(libusb_device_handle* handle, int enable);
+int libusb_claim_interface(libusb_device_handle* handle, int iface);
+int libusb_release_interface(libusb_device_handle* handle, int iface);
+
+libusb_transfer* libusb_alloc_transfer(int iso_packets);
+void libusb_free_transfer(libusb_transfer* transfer);
+int  libusb_submit_transfer(libusb_transfer* transfer);
+int  libusb_cancel_transfer(libusb_transfer* transfer);
+
+int libusb_handle_events_timeout(libusb_context* ctx, timeval* tv);
+int libusb_handle_events_timeout_completed(
+    libusb_context* ctx, timeval* tv, int* completed);
+
+int libusb_bulk_transfer(
+    libusb_device_handle* handle, unsigned char endpoint,
+    unsigned char* data, int length, int* actual_length,
+    unsigned int timeout);
+
+static inline void libusb_fill_bulk_transfer(
+    libusb_transfer* transfer, libusb_device_handle* dev_handle,
+    unsigned char endpoint, unsigned char* buffer, int length,
+    libusb_transfer_cb_fn callback, void* user_data, unsigned int timeout)
+{
+    transfer->dev_handle = dev_handle;
+    transfer->endpoint   = endpoint;
+    transfer->type       = LIBUSB_TRANSFER_TYPE_BULK;
+    transfer->timeout    = timeout;
+    transfer->buffer     = buffer;
+    transfer->length     = length;
+    transfer->user_data  = user_data;
+    transfer->callback   = callback;
+}
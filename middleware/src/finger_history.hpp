@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "protocol.hpp"
+
+// --------------------------------------------------
+// Finger history (column store)
+// --------------------------------------------------
+//
+// The last 'frames' finger frames, one preallocated array per field
+// (structure of arrays), so each column can be handed out as a dense
+// array (numpy, see python/soupy_module.cpp) without copying. Row r is
+// frame r % frames; per-finger columns are frames x width, row-major.
+// Fingers beyond 'width' are dropped, missing ones are zero.
+//
+// One writer. append() publishes a row with a release store of head(),
+// so a reader that loads head() sees every row below it complete, until
+// the writer laps it.
+
+class FingerHistory
+{
+public:
+    FingerHistory(size_t frames, size_t width)
+        : frames(frames ? frames : 1),
+          width(width ? width : 1),
+          timestamp(this->frames),
+          seq(this->frames),
+          count(this->frames),
+          x(this->frames * this->width),
+          y(this->frames * this->width),
+          z(this->frames * this->width),
+          state(this->frames * this->width),
+          temp(this->frames * this->width)
+    {}
+
+    void append(uint16_t s, uint64_t ts, const FingerArrayView& fingers)
+    {
+        const uint8_t n = fingers.size();
+        uint64_t h = head_.load(std::memory_order_relaxed);
+        size_t r = (size_t)(h % frames);
+        size_t base = r * width;
+
+        timestamp[r] = ts;
+        seq[r] = s;
+        count[r] = n;
+
+        size_t k = 0;
+        for (; k < n && k < width; ++k)
+        {
+            FingerView f = fingers[k];
+            x[base + k]     = f.x();
+            y[base + k]     = f.y();
+            z[base + k]     = f.z();
+            state[base + k] = f.state_array();
+            temp[base + k]  = f.temp();
+        }
+        for (; k < width; ++k)
+        {
+            x[base + k] = y[base + k] = z[base + k] = 0.0;
+            state[base + k] = 0;
+            temp[base + k] = 0.0f;
+        }
+
+        head_.store(h + 1, std::memory_order_release);
+    }
+
+    // frames appended so far; the newest is row (head() - 1) % frames
+    uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+    const size_t frames;
+    const size_t width;
+
+    std::vector<uint64_t> timestamp;
+    std::vector<uint16_t> seq;
+    std::vector<uint8_t>  count;
+    std::vector<double>   x, y, z;
+    std::vector<uint32_t> state;
+    std::vector<float>    temp;
+
+private:
+    std::atomic<uint64_t> head_{0};
+};
@@ -0,0 +1,633 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "ring_buffer.hpp"
+#include "protocol.hpp"
+#include "metrics.hpp"
+#include "pool.hpp"
+#include "trace.hpp"
+
+// --------------------------------------------------
+// Overload policy
+// --------------------------------------------------
+
+enum class OverloadPolicy
+{
+    Block,          // producer waits for space
+    DropNewest,     // incoming chunk is discarded
+    DropOldest,     // oldest queued chunk is discarded
+    Coalesce,       // queue is flushed, only the newest frame is kept
+};
+
+inline const char* overload_policy_name(OverloadPolicy p)
+{
+    switch (p)
+    {
+    case OverloadPolicy::Block:      return "block";
+    case OverloadPolicy::DropNewest: return "drop-newest";
+    case OverloadPolicy::DropOldest: return "drop-oldest";
+    case OverloadPolicy::Coalesce:   return "coalesce";
+    }
+    return "?";
+}
+
+inline bool parse_overload_policy(const char* s, OverloadPolicy& out)
+{
+    for (auto p : { OverloadPolicy::Block, OverloadPolicy::DropNewest,
+                    OverloadPolicy::DropOldest, OverloadPolicy::Coalesce })
+    {
+        if (!std::strcmp(s, overload_policy_name(p)))
+        {
+            out = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct QueueConfig
+{
+    size_t capacity = 256;      // chunks
+    OverloadPolicy policy = OverloadPolicy::DropOldest;
+};
+
+// --------------------------------------------------
+// Global memory budget shared by all pipeline queues
+// --------------------------------------------------
+
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget(size_t limit = 0) : limit(limit) {}
+
+    // 0 = unlimited
+    size_t limit;
+
+    bool try_charge(size_t n)
+    {
+        size_t cur = used_.load(std::memory_order_relaxed);
+        do {
+            if (limit && cur + n > limit)
+                return false;
+        } while (!used_.compare_exchange_weak(cur, cur + n));
+
+        size_t now = cur + n;
+        size_t pk = peak_.load(std::memory_order_relaxed);
+        while (now > pk && !peak_.compare_exchange_weak(pk, now)) {}
+        return true;
+    }
+
+    void release(size_t n) { used_.fetch_sub(n); }
+
+    size_t used() const { return used_.load(); }
+    size_t peak() const { return peak_.load(); }
+
+private:
+    std::atomic<size_t> used_{0};
+    std::atomic<size_t> peak_{0};
+};
+
+// --------------------------------------------------
+// Chunk of whole frames
+// --------------------------------------------------
+//
+// Chunks pushed into a FrameQueue always start and end on a packet
+// boundary, so dropping a chunk never splits a packet. The bytes live in
+// a pooled block (see pool.hpp) that goes back to the pool when the chunk
+// is destroyed, so the steady-state data path does not allocate.
+
+class Chunk
+{
+public:
+    Chunk() = default;
+    ~Chunk() { reset(); }
+
+    Chunk(Chunk&& o) noexcept
+        : seq(o.seq), queued_ns(o.queued_ns), buf(o.buf), len(o.len), cap(o.cap)
+    {
+        o.buf = nullptr;
+        o.len = o.cap = 0;
+    }
+
+    Chunk& operator=(Chunk&& o) noexcept
+    {
+        if (this != &o)
+        {
+            reset();
+            seq = o.seq;
+            queued_ns = o.queued_ns;
+            buf = o.buf;
+            len = o.len;
+            cap = o.cap;
+            o.buf = nullptr;
+            o.len = o.cap = 0;
+        }
+        return *this;
+    }
+
+    Chunk(const Chunk&) = delete;
+    Chunk& operator=(const Chunk&) = delete;
+
+    const uint8_t* data() const { return buf; }
+    uint8_t* data() { return buf; }
+    size_t size() const { return len; }
+    bool empty() const { return !len; }
+
+    // make room for 'n' bytes in total, keeping the current ones
+    void reserve(size_t n)
+    {
+        if (n <= cap)
+            return;
+
+        size_t ncap = 0;
+        uint8_t* nb = chunk_pools().get(n, ncap);
+        if (len)
+            std::memcpy(nb, buf, len);
+        if (buf)
+            chunk_pools().put(buf, cap);
+
+        buf = nb;
+        cap = ncap;
+    }
+
+    void append(const uint8_t* p, size_t n)
+    {
+        reserve(len + n);
+        std::memcpy(buf + len, p, n);
+        len += n;
+    }
+
+    // 'n' bytes for the caller to fill
+    uint8_t* resize(size_t n)
+    {
+        reserve(n);
+        len = n;
+        return buf;
+    }
+
+    // keep only the last frame (chunks hold whole frames); returns the
+    // bytes cut
+    size_t keep_last_frame()
+    {
+        using namespace wire;
+
+        size_t last = 0;
+        for (size_t off = 0; off + Header::SIZE <= len; )
+        {
+            last = off;
+            off += Header::SIZE + Header::size::load(buf + off) + Crc::end;
+        }
+        if (!last)
+            return 0;
+
+        std::memmove(buf, buf + last, len - last);
+        len -= last;
+        seq = Header::seq::load(buf);
+        return last;
+    }
+
+    // give the block back
+    void reset()
+    {
+        if (buf)
+            chunk_pools().put(buf, cap);
+        buf = nullptr;
+        len = cap = 0;
+        seq = -1;
+    }
+
+    // for tracing (trace.hpp): seq of the first frame, -1 if unknown,
+    // and when the chunk entered its queue
+    int32_t seq = -1;
+    uint64_t queued_ns = 0;
+
+private:
+    uint8_t* buf = nullptr;
+    size_t len = 0;
+    size_t cap = 0;
+};
+
+// --------------------------------------------------
+// Chunk FIFO
+// --------------------------------------------------
+//
+// Ring of chunk slots sized to the queue capacity; unlike a deque it
+// allocates nothing on push / pop. An unbounded queue (capacity 0) grows
+// by doubling.
+
+class ChunkFifo
+{
+public:
+    explicit ChunkFifo(size_t n = 0) { resize(n); }
+
+    bool empty() const { return !count; }
+    size_t size() const { return count; }
+
+    Chunk& front() { return slots[head]; }
+
+    void push_back(Chunk&& c)
+    {
+        if (count == slots.size())
+            resize(slots.size() * 2);
+
+        slots[(head + count) % slots.size()] = std::move(c);
+        count++;
+    }
+
+    void pop_front()
+    {
+        slots[head].reset();
+        head = (head + 1) % slots.size();
+        count--;
+    }
+
+    // at least 'n' slots, keeping the queued chunks in order
+    void resize(size_t n)
+    {
+        if (n < 16) n = 16;
+        if (n <= slots.size())
+            return;
+
+        std::vector<Chunk> next(n);
+        for (size_t i = 0; i < count; ++i)
+            next[i] = std::move(slots[(head + i) % slots.size()]);
+
+        slots.swap(next);
+        head = 0;
+    }
+
+    void prefault()
+    {
+        rt_prefault(slots.data(), slots.size() * sizeof(Chunk));
+    }
+
+private:
+    std::vector<Chunk> slots;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+// --------------------------------------------------
+// Bounded chunk queue
+// --------------------------------------------------
+
+class FrameQueue
+{
+public:
+    FrameQueue(const char* name, QueueConfig cfg = {},
+               MemoryBudget* budget = nullptr)
+        : name(name), cfg(cfg), budget(budget), q(cfg.capacity) {}
+
+    ~FrameQueue() { clear(); }
+
+    void configure(QueueConfig c, MemoryBudget* b)
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            cfg = c;
+            budget = b;
+            q.resize(c.capacity);
+        }
+        register_metrics();
+    }
+
+    // touch the slot storage (--mlock); blocks come from the chunk pools
+    void prefault()
+    {
+        std::lock_guard<std::mutex> lk(m);
+        q.prefault();
+    }
+
+    // Export depth / pushed / dropped, until the queue is destroyed.
+    void register_metrics()
+    {
+        std::string label = std::string("queue=\"") + name + "\"";
+        auto& reg = metrics();
+
+        depth_metric = reg.gauge_fn("soupy_queue_depth", "Chunks waiting in a pipeline queue",
+            label.c_str(), [this]{ return (double)depth(); });
+        pushed_metric = reg.counter_fn("soupy_queue_pushed_total", "Chunks accepted by a queue",
+            label.c_str(), [this]{ return (double)pushed(); });
+        dropped_metric = reg.counter_fn("soupy_queue_dropped_total", "Chunks dropped by overload policy",
+            label.c_str(), [this]{ return (double)dropped(); });
+    }
+
+    // Returns false if the chunk (or, for Block, the wait) was abandoned.
+    // 'running' lets a blocked producer bail out on shutdown. A chunk
+    // bigger than the whole budget can never fit and is dropped at once,
+    // whatever the policy.
+    bool push(Chunk&& c, const std::atomic<bool>* running = nullptr)
+    {
+        size_t n = c.size();
+        if (!n) return true;
+
+        TraceScope trace("queue push", c.seq, (uint32_t)n, name);
+        if (trace_on())
+            c.queued_ns = trace_now_ns();
+
+        std::unique_lock<std::mutex> lk(m);
+
+        if (budget && budget->limit && n > budget->limit)
+        {
+            count_drop(n);
+            return false;
+        }
+
+        while (!has_room(n))
+        {
+            switch (cfg.policy)
+            {
+            case OverloadPolicy::Block:
+                if (running && !running->load())
+                {
+                    count_drop(n);
+                    return false;
+                }
+                // budget space can be freed by other queues, so poll
+                not_full.wait_for(lk, std::chrono::milliseconds(1));
+                continue;
+
+            case OverloadPolicy::DropNewest:
+                count_drop(n);
+                return false;
+
+            case OverloadPolicy::DropOldest:
+                if (q.empty())
+                {
+                    count_drop(n);
+                    return false;
+                }
+                drop_front();
+                continue;
+
+            case OverloadPolicy::Coalesce:
+            {
+                // a transport chunk can carry several frames: the older
+                // ones go with the queue
+                bool flushed = !q.empty();
+                while (!q.empty())
+                    drop_front();
+
+                size_t cut = c.keep_last_frame();
+                dropped_bytes_ += cut;
+                n -= cut;
+
+                if (!flushed && !cut)
+                {
+                    count_drop(n);
+                    return false;
+                }
+                continue;
+            }
+            }
+        }
+
+        q.push_back(std::move(c));
+        pushed_.fetch_add(1, std::memory_order_relaxed);
+
+        if (q.size() > max_depth_) max_depth_ = q.size();
+        depth_.store(q.size(), std::memory_order_relaxed);
+
+        lk.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    bool try_pop(Chunk& out)
+    {
+        std::lock_guard<std::mutex> lk(m);
+        return pop_locked(out);
+    }
+
+    // Wait for a chunk; returns false once 'running' drops.
+    bool pop_wait(Chunk& out, const std::atomic<bool>& running)
+    {
+        std::unique_lock<std::mutex> lk(m);
+        not_empty.wait(lk, [&]{ return !q.empty() || !running.load(); });
+
+        if (!running.load())
+            return false;
+
+        return pop_locked(out);
+    }
+
+    void wake_all()
+    {
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lk(m);
+        while (!q.empty())
+        {
+            release(q.front().size());
+            q.pop_front();
+        }
+        depth_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t   depth() const   { return depth_.load(std::memory_order_relaxed); }
+    uint64_t pushed() const  { return pushed_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    void print_stats() const
+    {
+        std::printf(
+            "[QUEUE] %s cap=%zu policy=%s pushed=%llu dropped=%llu "
+            "(%llu bytes) max_depth=%zu\n",
+            name,
+            cfg.capacity,
+            overload_policy_name(cfg.policy),
+            (unsigned long long)pushed(),
+            (unsigned long long)dropped_.load(),
+            (unsigned long long)dropped_bytes_,
+            max_depth_);
+    }
+
+private:
+    bool has_room(size_t n)
+    {
+        if (cfg.capacity && q.size() >= cfg.capacity)
+            return false;
+        if (budget && !budget->try_charge(n))
+            return false;
+        return true;
+    }
+
+    bool pop_locked(Chunk& out)
+    {
+        if (q.empty())
+            return false;
+
+        out = std::move(q.front());
+        q.pop_front();
+
+        // arg: microseconds spent queued
+        if (trace_on() && out.queued_ns)
+            trace_instant("queue pop", name, out.seq,
+                          (uint32_t)((trace_now_ns() - out.queued_ns) / 1000));
+
+        release(out.size());
+        depth_.store(q.size(), std::memory_order_relaxed);
+
+        not_full.notify_one();
+        return true;
+    }
+
+    void drop_front()
+    {
+        size_t n = q.front().size();
+        q.pop_front();
+        release(n);
+        count_drop(n);
+    }
+
+    void release(size_t n)
+    {
+        if (budget) budget->release(n);
+    }
+
+    void count_drop(size_t n)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        dropped_bytes_ += n;
+    }
+
+    const char* name;
+    QueueConfig cfg;
+    MemoryBudget* budget;
+
+    std::mutex m;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    ChunkFifo q;
+
+    size_t max_depth_ = 0;
+    uint64_t dropped_bytes_ = 0;
+    std::atomic<size_t> depth_{0};
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    // last, so they unregister before what they read goes
+    MetricFn depth_metric;
+    MetricFn pushed_metric;
+    MetricFn dropped_metric;
+};
+
+// --------------------------------------------------
+// Byte-oriented reads from a FrameQueue
+// --------------------------------------------------
+//
+// Transports hand out bytes through ITransport::read(); a chunk that does
+// not fit in the caller's buffer is held here, outside the queue, so it
+// can no longer be dropped half-read.
+
+class ChunkReader
+{
+public:
+    int read(FrameQueue& q, uint8_t* out, int maxlen)
+    {
+        int total = 0;
+
+        while (total < maxlen)
+        {
+            if (off >= cur.size())
+            {
+                if (!q.try_pop(cur))
+                    break;
+                off = 0;
+            }
+
+            size_t n = cur.size() - off;
+            if (n > (size_t)(maxlen - total)) n = (size_t)(maxlen - total);
+
+            std::memcpy(out + total, cur.data() + off, n);
+            off   += n;
+            total += (int)n;
+        }
+
+        return total;
+    }
+
+private:
+    Chunk cur;
+    size_t off = 0;
+};
+
+// --------------------------------------------------
+// Byte stream → whole frames
+// --------------------------------------------------
+//
+// Cuts a raw transport byte stream at frame boundaries (wire::Header
+// magic + size, no CRC check - that stays with the parser) so producers
+// can queue whole frames. Garbage before a magic is skipped one byte at
+// a time, like parse_from_ring() does.
+
+class FrameSplitter
+{
+public:
+    explicit FrameSplitter(size_t capacity = 8192)
+        : ring(capacity), frame(capacity) {}
+
+    // Feed bytes; on_frame(const uint8_t*, size_t) is called once per
+    // complete frame.
+    template <class F>
+    void feed(const uint8_t* data, size_t len, F&& on_frame)
+    {
+        while (len)
+        {
+            size_t n = ring.free_space();
+            if (n > len) n = len;
+
+            ring.push(data, n);
+            data += n;
+            len  -= n;
+
+            extract(on_frame);
+        }
+    }
+
+    uint64_t resyncs() const { return resyncs_; }
+
+private:
+    template <class F>
+    void extract(F& on_frame)
+    {
+        using namespace wire;
+
+        uint8_t hdr[Header::SIZE];
+
+        while (ring.peek(hdr, Header::SIZE))
+        {
+            size_t total = Header::SIZE + Header::size::load(hdr) + Crc::end;
+
+            if (Header::magic::load(hdr) != MAGIC || total > ring.capacity())
+            {
+                ring.consume(1);
+                resyncs_++;
+                continue;
+            }
+
+            if (ring.size() < total)
+                return;
+
+            ring.read(frame.data(), total);
+            on_frame(frame.data(), total);
+        }
+    }
+
+    ByteRing ring;
+    std::vector<uint8_t> frame;
+    uint64_t resyncs_ = 0;
+};
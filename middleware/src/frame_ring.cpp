@@ -0,0 +1,145 @@
+#include "frame_ring.hpp"
+#include "realtime.hpp"
+#include "pow2.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+// --------------------------------------------------
+// Producer
+// --------------------------------------------------
+
+FrameRing::FrameRing(size_t capacity)
+    : published(metrics().counter(
+          "soupy_fanout_published_total", "Frames published to the fan-out ring")),
+      truncated(metrics().counter(
+          "soupy_fanout_truncated_total",
+          "Frames with more fingers than a ring slot holds"))
+{
+    size_t cap = round_pow2(capacity < 2 ? 2 : capacity);
+    slots.reset(new Slot[cap]);
+    mask = cap - 1;
+}
+
+FrameRing::Consumer& FrameRing::add_consumer(const std::string& name)
+{
+    consumers.emplace_back(new Consumer(*this, name));
+    return *consumers.back();
+}
+
+void FrameRing::prefault()
+{
+    rt_prefault(slots.get(), capacity() * sizeof(Slot));
+}
+
+void FrameRing::publish(uint16_t seq, uint64_t timestamp,
+                        const FingerArrayView& fingers)
+{
+    uint64_t s = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots[s & mask];
+
+    if (fingers.size() > RingFrame::MAX_FINGERS)
+        truncated.inc();
+
+    // readers that see 0 (or a newer stamp) know the frame is gone
+    slot.stamp.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.frame.timestamp = timestamp;
+    slot.frame.seq = seq;
+    slot.frame.count = (uint8_t)fingers.copy_to(slot.frame.fingers,
+                                                RingFrame::MAX_FINGERS);
+
+    slot.stamp.store(s + 1, std::memory_order_release);
+    head_.store(s + 1, std::memory_order_release);
+
+    published.inc();
+}
+
+void FrameRing::print_stats() const
+{
+    for (auto& c : consumers)
+        std::printf("[FANOUT] consumer=%s frames=%llu overruns=%llu lag=%llu "
+                    "(ring %zu, published %llu)\n",
+            c->name().c_str(),
+            (unsigned long long)c->frames(),
+            (unsigned long long)c->overruns(),
+            (unsigned long long)c->lag(),
+            capacity(),
+            (unsigned long long)head());
+}
+
+// --------------------------------------------------
+// Consumers
+// --------------------------------------------------
+
+FrameRing::Consumer::Consumer(FrameRing& r, const std::string& n)
+    : ring(r),
+      name_(n),
+      cursor(r.head()),
+      frames_(metrics().counter(
+          "soupy_fanout_consumed_total", "Frames read by a fan-out consumer",
+          ("consumer=\"" + n + "\"").c_str())),
+      overruns_(metrics().counter(
+          "soupy_fanout_overruns_total",
+          "Frames a fan-out consumer missed because the ring lapped it",
+          ("consumer=\"" + n + "\"").c_str()))
+{
+    lag_metric = metrics().gauge_fn("soupy_fanout_lag_frames",
+        "Frames published but not yet read by a fan-out consumer",
+        ("consumer=\"" + n + "\"").c_str(),
+        [this]{ return (double)lag(); });
+}
+
+uint64_t FrameRing::Consumer::lag() const
+{
+    uint64_t h = ring.head();
+    uint64_t c = cursor.load(std::memory_order_relaxed);
+    return h > c ? h - c : 0;
+}
+
+bool FrameRing::Consumer::next(RingFrame& out)
+{
+    uint64_t c = cursor.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        uint64_t h = ring.head();
+        if (c >= h)
+            return false;
+
+        Slot& slot = ring.slots[c & ring.mask];
+        uint64_t s1 = slot.stamp.load(std::memory_order_acquire);
+
+        if (s1 == c + 1)
+        {
+            out.timestamp = slot.frame.timestamp;
+            out.seq = slot.frame.seq;
+            out.count = slot.frame.count;
+            if (out.count > RingFrame::MAX_FINGERS)
+                out.count = RingFrame::MAX_FINGERS;
+            std::memcpy(out.fingers, slot.frame.fingers,
+                        out.count * sizeof(FingerData));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot.stamp.load(std::memory_order_relaxed) == s1)
+            {
+                cursor.store(c + 1, std::memory_order_relaxed);
+                frames_.inc();
+                return true;
+            }
+        }
+
+        // lapped: skip to the oldest frame the writer is not about to
+        // overwrite, one slot of margin
+        h = ring.head();
+        uint64_t oldest = h > ring.mask ? h - ring.mask : 0;
+        if (oldest <= c)
+            oldest = c + 1;
+
+        overruns_.inc(oldest - c);
+        c = oldest;
+        cursor.store(c, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "protocol.hpp"
+#include "metrics.hpp"
+
+// --------------------------------------------------
+// Multicast frame ring
+// --------------------------------------------------
+//
+// Decoded finger frames, published once by the parser and read by any
+// number of consumers (logger, filter, publishers), each at its own pace
+// through its own cursor. Slots are preallocated; publish() never
+// allocates, never takes a lock and never waits for a consumer.
+//
+// A consumer that falls more than 'capacity' frames behind has been
+// lapped: the frames it missed are counted as overruns and it resumes at
+// the oldest frame still in the ring. Every slot carries the sequence
+// number it holds (seqlock style), so a reader racing the writer notices
+// that its copy was overwritten and retries further ahead.
+//
+// One producer. Consumers must be added before publishing starts, and
+// each Consumer is used by one thread.
+
+struct RingFrame
+{
+    static constexpr size_t MAX_FINGERS = 16;
+
+    uint64_t   timestamp;
+    uint16_t   seq;
+    uint8_t    count;
+    FingerData fingers[MAX_FINGERS];
+};
+
+class FrameRing
+{
+public:
+    class Consumer
+    {
+    public:
+        // copy the next frame into 'out'; false if caught up
+        bool next(RingFrame& out);
+
+        const std::string& name() const { return name_; }
+
+        uint64_t lag() const;
+        uint64_t frames() const { return frames_.value(); }
+        uint64_t overruns() const { return overruns_.value(); }
+
+    private:
+        friend class FrameRing;
+        Consumer(FrameRing& ring, const std::string& name);
+
+        FrameRing& ring;
+        std::string name_;
+        std::atomic<uint64_t> cursor{0};
+
+        Counter& frames_;
+        Counter& overruns_;
+
+        MetricFn lag_metric;
+    };
+
+    // capacity is rounded up to a power of two
+    explicit FrameRing(size_t capacity);
+
+    // before the first publish(); the consumer starts at the current head
+    Consumer& add_consumer(const std::string& name);
+
+    // frames with more than MAX_FINGERS fingers are truncated
+    void publish(uint16_t seq, uint64_t timestamp,
+                 const FingerArrayView& fingers);
+
+    // touch the slot storage (--mlock)
+    void prefault();
+
+    size_t capacity() const { return mask + 1; }
+    uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+    void print_stats() const;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> stamp{0};     // seq + 1 once written, 0 while writing
+        RingFrame frame;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask = 0;
+    std::atomic<uint64_t> head_{0};
+
+    std::deque<std::unique_ptr<Consumer>> consumers;
+
+    Counter& published;
+    Counter& truncated;
+};
@@ -0,0 +1,521 @@
+#include "fw_cmd_bench.hpp"
+#include "stats.hpp"
+
+#include "cmd.h"
+#include "cmd_usb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// --------------------------------------------------
+// Host model of the OUT pipe
+// --------------------------------------------------
+//
+// The host writes commands in bulk transfers that go out as 64-byte
+// packets (the last one short), or, for the split tests, as packets of
+// random length. tinyusb moves a packet into the vendor RX FIFO only
+// once a whole packet fits, which with a 64-byte FIFO means once the
+// firmware has read everything. The model clock advances by one packet
+// time per packet, except in the budget test, which needs real time.
+
+static const uint32_t USB_PACKET = 64;
+static const uint32_t FIFO_SIZE = 64;       // CFG_TUD_VENDOR_RX_BUFSIZE
+static const uint64_t PKT_US = 53;
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+// what a handler saw, or what it should see
+struct Rec
+{
+    uint8_t type;
+    uint16_t seq;
+    uint64_t key;       // heartbeat host time, forces hash, frame CRC
+
+    bool operator==(const Rec& o) const
+    {
+        return type == o.type && seq == o.seq && key == o.key;
+    }
+};
+
+struct CmdStream
+{
+    std::vector<uint8_t> bytes;
+    std::vector<uint32_t> packet_end;   // USB packet boundaries
+    std::vector<Rec> expect;
+
+    uint64_t junk = 0;
+    uint64_t mutated = 0;
+};
+
+struct OutFifo
+{
+    const CmdStream* s = nullptr;
+    size_t next_packet = 0;
+    uint32_t pos = 0;
+
+    uint8_t buf[FIFO_SIZE];
+    uint32_t rd = 0;
+    uint32_t len = 0;
+
+    bool real_clock = false;
+    uint64_t now_us = 0;
+
+    bool done() const
+    {
+        return next_packet == s->packet_end.size() && !len;
+    }
+
+    void fill()
+    {
+        if (next_packet == s->packet_end.size() || FIFO_SIZE - len < USB_PACKET)
+            return;
+
+        std::memmove(buf, buf + rd, len);
+        rd = 0;
+
+        uint32_t end = s->packet_end[next_packet++];
+        std::memcpy(buf + len, s->bytes.data() + pos, end - pos);
+        len += end - pos;
+        pos = end;
+
+        now_us += PKT_US;
+    }
+};
+
+OutFifo* g_fifo = nullptr;
+
+uint64_t force_key(const pkt_force_t* f, uint8_t n)
+{
+    // FNV-1a over the count and the values
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&](uint32_t v) { h = (h ^ v) * 1099511628211ull; };
+
+    mix(n);
+    for (uint8_t i = 0; i < n; ++i)
+    {
+        mix((uint16_t)f[i].fx);
+        mix((uint16_t)f[i].fy);
+        mix((uint16_t)f[i].fz);
+    }
+    return h;
+}
+
+struct Recorder
+{
+    std::vector<Rec> got;
+    uint32_t work_us = 0;       // per heartbeat, real time
+
+    static Recorder& of(void* ctx) { return *static_cast<Recorder*>(ctx); }
+
+    static void heartbeat(void* ctx, uint16_t seq, uint64_t host_tx, uint64_t)
+    {
+        Recorder& r = of(ctx);
+        r.got.push_back({PKT_TYPE_HEARTBEAT, seq, host_tx});
+
+        if (r.work_us)
+        {
+            auto until = bench_clock::now() + std::chrono::microseconds(r.work_us);
+            while (bench_clock::now() < until) {}
+        }
+    }
+
+    static void forces(void* ctx, uint16_t seq, const pkt_force_t* f,
+                       uint8_t count, uint64_t)
+    {
+        of(ctx).got.push_back({PKT_TYPE_FORCES, seq, force_key(f, count)});
+    }
+
+    static void other(void* ctx, const pkt_view_t* v, const uint8_t* frame,
+                      uint64_t)
+    {
+        of(ctx).got.push_back({v->type, v->seq,
+                               pkt_crc32(frame, v->frame_len)});
+    }
+};
+
+} // namespace
+
+extern "C" uint32_t cmd_usb_available(void)
+{
+    return g_fifo->len;
+}
+
+extern "C" uint32_t cmd_usb_read(void* buf, uint32_t n)
+{
+    OutFifo& f = *g_fifo;
+    if (n > f.len)
+        n = f.len;
+
+    std::memcpy(buf, f.buf + f.rd, n);
+    f.rd += n;
+    f.len -= n;
+    return n;
+}
+
+extern "C" uint64_t cmd_usb_time_us(void)
+{
+    if (!g_fifo->real_clock)
+        return g_fifo->now_us;
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        bench_clock::now().time_since_epoch()).count();
+}
+
+// --------------------------------------------------
+// Command streams
+// --------------------------------------------------
+
+enum class Damage { none, junk, fuzz };
+
+static size_t make_frame(std::mt19937& rng, uint16_t seq, uint8_t* out,
+                         Rec& r)
+{
+    unsigned kind = rng() % 5;
+
+    if (kind < 2)
+    {
+        uint64_t host = ((uint64_t)rng() << 32) | rng();
+        r = {PKT_TYPE_HEARTBEAT, seq, host};
+        return pkt_encode_heartbeat(out, CMD_FRAME_MAX, seq, host);
+    }
+
+    if (kind < 4)
+    {
+        pkt_force_t f[PKT_FORCES_MAX];
+        uint8_t n = (uint8_t)(rng() % (PKT_FORCES_MAX + 1));
+        for (uint8_t i = 0; i < n; ++i)
+        {
+            f[i].fx = (int16_t)rng();
+            f[i].fy = (int16_t)rng();
+            f[i].fz = (int16_t)rng();
+        }
+        r = {PKT_TYPE_FORCES, seq, force_key(f, n)};
+        return pkt_encode_forces(out, CMD_FRAME_MAX, seq, f, n);
+    }
+
+    uint16_t pad = (uint16_t)(rng() % (PKT_PROBE_MAX_PAD + 1));
+    size_t len = pkt_encode_probe(out, CMD_FRAME_MAX, seq, rng(), pad);
+    r = {PKT_TYPE_PROBE, seq, pkt_crc32(out, len)};
+    return len;
+}
+
+static void add_junk(std::mt19937& rng, CmdStream& s, bool magic_free)
+{
+    size_t n = 1 + rng() % 40;
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint8_t b = (uint8_t)rng();
+        if (magic_free && b == (PKT_MAGIC & 0xFF))
+            b ^= 1;
+        s.bytes.push_back(b);
+    }
+    s.junk += n;
+}
+
+// a magic and a random size, up to past CMD_FRAME_MAX, then junk
+static void add_false_header(std::mt19937& rng, CmdStream& s)
+{
+    uint8_t h[PKT_HEADER_SIZE];
+    pkt_put_u16(h, PKT_MAGIC);
+    pkt_put_u16(h + 2, (uint16_t)(rng() % 80));
+    pkt_put_u16(h + 4, (uint16_t)rng());
+    h[6] = (uint8_t)(1 + rng() % 5);
+
+    s.bytes.insert(s.bytes.end(), h, h + sizeof(h));
+    s.junk += sizeof(h);
+    add_junk(rng, s, false);
+}
+
+static void packetize(std::mt19937& rng, CmdStream& s, uint32_t from,
+                      bool random_split)
+{
+    uint32_t end = (uint32_t)s.bytes.size();
+    while (from < end)
+    {
+        uint32_t n = random_split ? 1 + rng() % USB_PACKET : USB_PACKET;
+        from = std::min(end, from + n);
+        s.packet_end.push_back(from);
+    }
+}
+
+static CmdStream make_stream(unsigned frames, uint32_t seed, Damage damage,
+                             bool random_split)
+{
+    std::mt19937 rng(seed);
+    CmdStream s;
+    s.bytes.reserve((size_t)frames * 40);
+    s.expect.reserve(frames);
+
+    uint8_t frame[CMD_FRAME_MAX];
+    unsigned i = 0;
+
+    while (i < frames)
+    {
+        // one host write of up to 8 commands
+        uint32_t write_start = (uint32_t)s.bytes.size();
+        unsigned batch = 1 + rng() % 8;
+
+        for (unsigned k = 0; k < batch && i < frames; ++k, ++i)
+        {
+            Rec r;
+            size_t len = make_frame(rng, (uint16_t)i, frame, r);
+            bool intact = true;
+
+            if (damage == Damage::junk && rng() % 4 == 0)
+                add_junk(rng, s, true);
+
+            if (damage == Damage::fuzz && rng() % 8 == 0)
+            {
+                s.mutated++;
+
+                switch (rng() % 4)
+                {
+                case 0:     // bit flip anywhere in the frame
+                {
+                    size_t bit = rng() % (len * 8);
+                    frame[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+                    intact = false;
+                    break;
+                }
+                case 1:     // frame cut short
+                    len = 1 + rng() % (len - 1);
+                    intact = false;
+                    break;
+                case 2:
+                    add_junk(rng, s, false);
+                    break;
+                default:
+                    add_false_header(rng, s);
+                    break;
+                }
+            }
+
+            s.bytes.insert(s.bytes.end(), frame, frame + len);
+            if (intact)
+                s.expect.push_back(r);
+        }
+
+        packetize(rng, s, write_start, random_split);
+    }
+
+    return s;
+}
+
+// What the parser should make of any byte stream: at each offset, a
+// valid frame of up to CMD_FRAME_MAX bytes is taken whole, anything else
+// skips one byte. A fuzzed stream can hold look-alikes (a frame cut
+// just short of the next frame's magic can read as whole), so the fuzz
+// runs check against this rather than against the intact frames.
+static std::vector<Rec> reference_parse(const std::vector<uint8_t>& bytes)
+{
+    std::vector<Rec> out;
+    size_t p = 0;
+
+    while (p < bytes.size())
+    {
+        pkt_view_t v;
+        size_t left = std::min(bytes.size() - p, (size_t)CMD_FRAME_MAX);
+
+        if (pkt_decode(bytes.data() + p, left, &v) != PKT_OK)
+        {
+            p++;
+            continue;
+        }
+
+        uint64_t host;
+        pkt_force_t f[PKT_FORCES_MAX];
+        uint8_t n;
+
+        if (pkt_decode_heartbeat(&v, &host))
+            out.push_back({v.type, v.seq, host});
+        else if (v.type == PKT_TYPE_FORCES)
+        {
+            if (pkt_decode_forces(&v, f, PKT_FORCES_MAX, &n))
+                out.push_back({v.type, v.seq, force_key(f, n)});
+        }
+        else
+            out.push_back({v.type, v.seq,
+                           pkt_crc32(bytes.data() + p, v.frame_len)});
+
+        p += v.frame_len;
+    }
+
+    return out;
+}
+
+// --------------------------------------------------
+// Runs
+// --------------------------------------------------
+
+struct RunResult
+{
+    cmd_stats_t stats;
+    uint64_t calls = 0;
+    LatencyHistogram call_us;       // real clock runs only
+    double ns = 0.0;
+    bool ok = false;
+};
+
+static void run_stream(const CmdStream& s, const std::vector<Rec>& expect,
+                       uint32_t budget_us, uint32_t work_us, bool real_clock,
+                       RunResult& res)
+{
+    static cmd_t c;
+
+    Recorder rec;
+    rec.got.reserve(expect.size() + 16);
+    rec.work_us = work_us;
+
+    OutFifo fifo;
+    fifo.s = &s;
+    fifo.real_clock = real_clock;
+    g_fifo = &fifo;
+
+    cmd_handlers_t h{};
+    h.heartbeat = Recorder::heartbeat;
+    h.forces = Recorder::forces;
+    h.other = Recorder::other;
+    h.ctx = &rec;
+    cmd_init(&c, &h, budget_us);
+
+    auto t0 = bench_clock::now();
+    while (!fifo.done())
+    {
+        fifo.fill();
+
+        if (real_clock)
+        {
+            uint64_t c0 = cmd_usb_time_us();
+            cmd_task(&c);
+            res.call_us.record(cmd_usb_time_us() - c0);
+        }
+        else
+            cmd_task(&c);
+
+        res.calls++;
+    }
+    auto t1 = bench_clock::now();
+
+    res.ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        t1 - t0).count();
+    res.stats = c.stats;
+
+    res.ok = rec.got == expect;
+    if (!res.ok)
+    {
+        size_t n = std::min(rec.got.size(), expect.size());
+        size_t i = 0;
+        while (i < n && rec.got[i] == expect[i])
+            i++;
+        std::printf("[FWCMD] MISMATCH: %zu frames out, %zu expected, first "
+                    "difference at %zu\n", rec.got.size(), expect.size(), i);
+    }
+
+    g_fifo = nullptr;
+}
+
+static bool clean_case(unsigned frames, bool random_split)
+{
+    CmdStream s = make_stream(frames, 1, Damage::none, random_split);
+    RunResult r;
+    run_stream(s, s.expect, 1000, 0, false, r);
+
+    std::printf("[FWCMD] clean, %s packets: frames=%llu %.1f B/frame "
+                "pkts=%zu: %.1f ns/frame, %.0f MB/s %s\n",
+        random_split ? "random-length" : "64-byte",
+        (unsigned long long)r.stats.frames,
+        (double)s.bytes.size() / frames, s.packet_end.size(),
+        r.ns / frames, s.bytes.size() * 1e3 / r.ns,
+        r.ok ? "ok" : "FAIL");
+
+    return r.ok;
+}
+
+static bool junk_case(unsigned frames)
+{
+    CmdStream s = make_stream(frames, 2, Damage::junk, true);
+    RunResult r;
+    run_stream(s, s.expect, 1000, 0, false, r);
+
+    bool ok = r.ok && r.stats.resync_bytes == s.junk;
+
+    std::printf("[FWCMD] junk between frames: frames=%llu junk=%llu B "
+                "resync=%llu B bad_crc=%llu oversize=%llu: %.1f ns/frame %s\n",
+        (unsigned long long)r.stats.frames,
+        (unsigned long long)s.junk,
+        (unsigned long long)r.stats.resync_bytes,
+        (unsigned long long)r.stats.bad_crc,
+        (unsigned long long)r.stats.oversize,
+        r.ns / frames, ok ? "ok" : "FAIL");
+
+    return ok;
+}
+
+static bool fuzz_case(unsigned frames, uint32_t seed)
+{
+    CmdStream s = make_stream(frames, seed, Damage::fuzz, true);
+    std::vector<Rec> expect = reference_parse(s.bytes);
+    RunResult r;
+    run_stream(s, expect, 1000, 0, false, r);
+
+    std::printf("[FWCMD] fuzz seed %u: frames=%u mutated=%llu intact=%zu "
+                "reference=%zu out=%llu bad_crc=%llu oversize=%llu "
+                "malformed=%llu resync=%llu B %s\n",
+        seed, frames,
+        (unsigned long long)s.mutated, s.expect.size(), expect.size(),
+        (unsigned long long)r.stats.frames,
+        (unsigned long long)r.stats.bad_crc,
+        (unsigned long long)r.stats.oversize,
+        (unsigned long long)r.stats.malformed,
+        (unsigned long long)r.stats.resync_bytes,
+        r.ok ? "ok" : "FAIL");
+
+    return r.ok;
+}
+
+// heartbeat handlers that take work_us each against a budget_us per call
+static bool budget_case(unsigned frames, uint32_t budget_us, uint32_t work_us)
+{
+    CmdStream s = make_stream(frames, 3, Damage::none, false);
+    RunResult r;
+    run_stream(s, s.expect, budget_us, work_us, true, r);
+
+    // real time on a shared host, so call times are reported, not checked:
+    // preemption inside a handler shows up in the tail
+    std::printf("[FWCMD] budget %u us, %u us per heartbeat: calls=%llu "
+                "budget stops=%llu (bound: budget + one handler = %u us) %s\n",
+        budget_us, work_us,
+        (unsigned long long)r.calls,
+        (unsigned long long)r.stats.budget_stops,
+        budget_us + work_us,
+        r.ok ? "ok" : "FAIL");
+    r.call_us.print("FWCMD cmd_task", "us");
+
+    return r.ok;
+}
+
+int run_fw_cmd_bench(unsigned frames)
+{
+    if (frames < 100)
+        frames = 100;
+
+    bool ok = true;
+
+    ok &= clean_case(frames, false);
+    ok &= clean_case(frames, true);
+    ok &= junk_case(frames);
+
+    for (uint32_t seed = 10; seed < 18; ++seed)
+        ok &= fuzz_case(frames / 8, seed);
+
+    ok &= budget_case(std::min(frames, 20000u), 50, 20);
+
+    std::printf("[FWCMD] %s\n", ok ? "all frames accounted for" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// --------------------------------------------------
+// Firmware command parser bench
+// --------------------------------------------------
+//
+// Runs firmware/cmd.c on the host against a model of the vendor OUT
+// FIFO, feeding it host command streams split across USB packets:
+// clean, with junk between frames, and fuzzed (bit flips, truncated
+// frames, junk and false headers). Checks that exactly the intact frames
+// come out, in order, and reports parse cost per frame (host time) and
+// how a slow handler is held to the per-call budget. Returns nonzero on
+// a mismatch.
+
+int run_fw_cmd_bench(unsigned frames);
@@ -0,0 +1,241 @@
+#include "fw_stream_bench.hpp"
+#include "protocol.hpp"
+#include "stats.hpp"
+
+#include "stream.h"
+#include "stream_usb.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// --------------------------------------------------
+// Host model of the USB pipe
+// --------------------------------------------------
+//
+// The vendor TX FIFO holds one 64-byte packet; a flush puts it on the
+// bus for PKT_US (full speed, ~19 bulk packets per 1 ms frame) and the
+// FIFO stays busy until then. On the host side, packets accumulate in an
+// IN transfer that completes on a short packet or when full (no ZLP),
+// like the libusb pool in usb_transport.cpp. Completed transfers go
+// straight to the parser.
+
+static const uint64_t PKT_US = 53;
+
+namespace {
+
+struct BenchHandler : PacketHandler
+{
+    uint64_t now_us = 0;        // set by the model before parsing
+    LatencyHistogram latency;
+
+    uint64_t frames = 0;
+    uint64_t lost = 0;
+    uint64_t bad = 0;
+    uint16_t next_seq = 0;
+
+    void on_finger_packet(uint16_t seq, uint64_t ts,
+                          const FingerArrayView&) override
+    {
+        if (frames && seq != next_seq)
+            lost += (uint16_t)(seq - next_seq);
+        next_seq = seq + 1;
+        frames++;
+
+        latency.record(now_us - ts);
+    }
+
+    void on_unknown(uint8_t, uint16_t, const uint8_t*, uint16_t) override
+    {
+        bad++;
+    }
+
+    void on_bad_crc(uint8_t, uint16_t) override
+    {
+        bad++;
+    }
+};
+
+struct UsbModel
+{
+    uint64_t now_us = 0;
+
+    uint8_t fifo[STREAM_USB_PACKET];
+    uint32_t fifo_len = 0;
+    bool on_bus = false;
+    uint64_t bus_done = 0;
+
+    std::vector<uint8_t> xfer;
+    size_t xfer_size = 1024;
+    uint64_t transfers = 0;
+
+    ByteRing ring{64 * 1024};
+    BenchHandler handler;
+
+    void complete()
+    {
+        ring.push(xfer.data(), xfer.size());
+        xfer.clear();
+        transfers++;
+
+        handler.now_us = now_us;
+        parse_from_ring(ring, handler);
+    }
+
+    // deliver the packet on the bus once its time is up
+    void advance(uint64_t t)
+    {
+        now_us = t;
+        if (!on_bus || t < bus_done)
+            return;
+
+        xfer.insert(xfer.end(), fifo, fifo + fifo_len);
+
+        bool short_pkt = fifo_len < STREAM_USB_PACKET;
+        fifo_len = 0;
+        on_bus = false;
+
+        if (short_pkt || xfer.size() >= xfer_size)
+            complete();
+    }
+};
+
+UsbModel* g_model = nullptr;
+
+} // namespace
+
+extern "C" uint32_t stream_usb_write_available(void)
+{
+    g_model->advance(g_model->now_us);
+    return g_model->on_bus ? 0 : STREAM_USB_PACKET - g_model->fifo_len;
+}
+
+extern "C" uint32_t stream_usb_write(const void* data, uint32_t n)
+{
+    uint32_t room = stream_usb_write_available();
+    if (n > room) n = room;
+
+    std::memcpy(g_model->fifo + g_model->fifo_len, data, n);
+    g_model->fifo_len += n;
+    return n;
+}
+
+extern "C" void stream_usb_flush(void)
+{
+    UsbModel& m = *g_model;
+    if (!m.fifo_len || m.on_bus)
+        return;
+
+    m.on_bus = true;
+    m.bus_done = m.now_us + PKT_US;
+}
+
+// --------------------------------------------------
+// Bench
+// --------------------------------------------------
+
+static void run_case(unsigned rate_hz, uint16_t bank, uint32_t flush_us)
+{
+    static stream_t s;      // ~4 KB of sample banks, keep it off the stack
+
+    UsbModel model;
+    g_model = &model;
+
+    stream_config_t cfg{};
+    cfg.period_us = 1000000 / rate_hz;
+    cfg.bank_samples = bank;
+    cfg.flush_us = flush_us;
+    stream_init(&s, &cfg);
+
+    // 10 s of simulated time, main loop spinning every 20 us
+    const uint64_t duration_us = 10000000;
+    const uint64_t tick_us = 20;
+
+    stream_sample_t smp{};
+    smp.count = STREAM_MAX_FINGERS;
+
+    uint64_t next_sample = 0;
+    for (uint64_t t = 0; t < duration_us; t += tick_us)
+    {
+        model.advance(t);
+
+        if (t >= next_sample)
+        {
+            smp.timestamp_us = t;
+            smp.fingers[0].x = (double)t;
+            stream_push_sample(&s, &smp);
+            next_sample += cfg.period_us;
+        }
+
+        stream_task(&s, t);
+    }
+
+    const stream_stats_t& st = s.stats;
+    const BenchHandler& h = model.handler;
+    uint64_t pkts = st.packets_full + st.packets_short;
+    double per = h.frames ? (double)pkts / h.frames : 0.0;
+
+    std::printf("[FWSTREAM] %u Hz bank=%u flush=%u us: frames=%llu "
+                "pkts/frame=%.2f (short %.2f) fill=%.0f%% xfers=%llu "
+                "lost=%llu bad=%llu overruns=%llu\n",
+        rate_hz, (unsigned)bank, (unsigned)flush_us,
+        (unsigned long long)h.frames,
+        per,
+        h.frames ? (double)st.packets_short / h.frames : 0.0,
+        pkts ? 100.0 * st.bytes / (pkts * STREAM_USB_PACKET) : 0.0,
+        (unsigned long long)model.transfers,
+        (unsigned long long)h.lost,
+        (unsigned long long)h.bad,
+        (unsigned long long)st.sample_overruns);
+
+    h.latency.print("FWSTREAM-LAT", "us (sim)");
+
+    g_model = nullptr;
+}
+
+int run_fw_stream_bench(unsigned rate_hz)
+{
+    if (!rate_hz || rate_hz > 1000000)
+    {
+        std::printf("bad rate: %u\n", rate_hz);
+        return 1;
+    }
+
+    uint32_t period = 1000000 / rate_hz;
+
+    // tail flushed with every bank vs held back to fill packets
+    run_case(rate_hz, 1, 0);
+    run_case(rate_hz, 1, period);
+    run_case(rate_hz, 4, 0);
+    run_case(rate_hz, 4, 2 * period);
+
+    // framing cost on this host
+    stream_t* s = new stream_t;
+    stream_config_t cfg{};
+    cfg.bank_samples = 1;
+    stream_init(s, &cfg);
+
+    stream_sample_t smp{};
+    smp.count = STREAM_MAX_FINGERS;
+    uint8_t frame[STREAM_FRAME_MAX];
+
+    const int iters = 1000000;
+    volatile uint32_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i)
+    {
+        smp.timestamp_us = (uint64_t)i;
+        sink = sink + stream_frame_sample(frame, (uint16_t)i, &smp);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::printf("[FWSTREAM] frame+crc %u B: %.1f ns/frame\n",
+        (unsigned)stream_frame_sample(frame, 0, &smp),
+        (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            t1 - t0).count() / iters);
+
+    delete s;
+    return 0;
+}
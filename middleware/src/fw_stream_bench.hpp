@@ -0,0 +1,13 @@
+#pragma once
+
+// --------------------------------------------------
+// Firmware stream bench
+// --------------------------------------------------
+//
+// Runs firmware/stream.c on the host against a model of the vendor IN
+// FIFO and the host's IN transfers, parses the result with
+// parse_from_ring and reports USB packets per frame, latency to the
+// parser (in simulated time) and framing cost (in host time).
+// rate_hz is the sampling rate.
+
+int run_fw_stream_bench(unsigned rate_hz);
@@ -0,0 +1,593 @@
+#include "haptics.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+static const double DEG = 3.14159265358979323846 / 180.0;
+
+// primitives per BVH leaf
+static const uint32_t LEAF_SIZE = 4;
+
+// --------------------------------------------------
+// Scene
+// --------------------------------------------------
+
+uint32_t HapticScene::add_sphere(const Vec3& c, double r)
+{
+    Prim p;
+    p.kind = SPHERE;
+    p.object = n_objects;
+    p.index = (uint32_t)spheres.size();
+    p.box = Aabb::around(c, r);
+    p.centroid = c;
+
+    spheres.push_back({c, r});
+    prims.push_back(p);
+    return n_objects++;
+}
+
+uint32_t HapticScene::add_box(const Vec3& c, const Vec3& half,
+                              const Vec3& rot_deg)
+{
+    double cx = std::cos(rot_deg.x * DEG), sx = std::sin(rot_deg.x * DEG);
+    double cy = std::cos(rot_deg.y * DEG), sy = std::sin(rot_deg.y * DEG);
+    double cz = std::cos(rot_deg.z * DEG), sz = std::sin(rot_deg.z * DEG);
+
+    // columns of Rz * Ry * Rx
+    Box b;
+    b.c = c;
+    b.half = half;
+    b.axis[0] = {cz * cy, sz * cy, -sy};
+    b.axis[1] = {cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx};
+    b.axis[2] = {cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx};
+
+    // extent along each world axis
+    Vec3 e;
+    for (int i = 0; i < 3; ++i)
+    {
+        e.x += std::fabs(b.axis[i].x) * half[i];
+        e.y += std::fabs(b.axis[i].y) * half[i];
+        e.z += std::fabs(b.axis[i].z) * half[i];
+    }
+
+    Prim p;
+    p.kind = BOX;
+    p.object = n_objects;
+    p.index = (uint32_t)boxes.size();
+    p.box.lo = c - e;
+    p.box.hi = c + e;
+    p.centroid = c;
+
+    boxes.push_back(b);
+    prims.push_back(p);
+    return n_objects++;
+}
+
+uint32_t HapticScene::add_plane(const Vec3& n, double d)
+{
+    double len = n.length();
+    if (len <= 0.0)
+        return n_objects;
+
+    plane_list.push_back({n * (1.0 / len), d / len, n_objects});
+    return n_objects++;
+}
+
+uint32_t HapticScene::add_mesh(const std::vector<Vec3>& verts,
+                               const std::vector<uint32_t>& idx)
+{
+    for (size_t i = 0; i + 2 < idx.size(); i += 3)
+    {
+        if (idx[i] >= verts.size() || idx[i + 1] >= verts.size() ||
+            idx[i + 2] >= verts.size())
+            continue;
+
+        Tri t{verts[idx[i]], verts[idx[i + 1]], verts[idx[i + 2]]};
+
+        Prim p;
+        p.kind = TRIANGLE;
+        p.object = n_objects;
+        p.index = (uint32_t)tris.size();
+        p.box.grow(t.a);
+        p.box.grow(t.b);
+        p.box.grow(t.c);
+        p.centroid = (t.a + t.b + t.c) * (1.0 / 3.0);
+
+        tris.push_back(t);
+        prims.push_back(p);
+    }
+    return n_objects++;
+}
+
+bool HapticScene::load_obj(const std::string& path, const Vec3& at,
+                           double scale)
+{
+    FILE* f = std::fopen(path.c_str(), "r");
+    if (!f)
+    {
+        std::printf("[HAPTIC] cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<Vec3> verts;
+    std::vector<uint32_t> idx;
+    char line[512];
+
+    while (std::fgets(line, sizeof(line), f))
+    {
+        if (line[0] == 'v' && line[1] == ' ')
+        {
+            Vec3 v;
+            if (std::sscanf(line + 2, "%lf %lf %lf", &v.x, &v.y, &v.z) == 3)
+                verts.push_back(at + v * scale);
+        }
+        else if (line[0] == 'f' && line[1] == ' ')
+        {
+            // polygon as a fan; "i", "i/t", "i/t/n", "i//n", negative = relative
+            uint32_t poly[32];
+            int n = 0;
+
+            for (char* tok = std::strtok(line + 2, " \t\r\n"); tok && n < 32;
+                 tok = std::strtok(nullptr, " \t\r\n"))
+            {
+                long v = std::strtol(tok, nullptr, 10);
+                if (v < 0) v += (long)verts.size() + 1;
+                if (v <= 0) continue;
+                poly[n++] = (uint32_t)(v - 1);
+            }
+
+            for (int i = 1; i + 1 < n; ++i)
+            {
+                idx.push_back(poly[0]);
+                idx.push_back(poly[i]);
+                idx.push_back(poly[i + 1]);
+            }
+        }
+    }
+    std::fclose(f);
+
+    add_mesh(verts, idx);
+    return true;
+}
+
+bool HapticScene::load(const std::string& path)
+{
+    FILE* f = std::fopen(path.c_str(), "r");
+    if (!f)
+    {
+        std::printf("[HAPTIC] cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    char line[512];
+    int lineno = 0;
+    bool ok = true;
+
+    while (ok && std::fgets(line, sizeof(line), f))
+    {
+        lineno++;
+
+        char kind[16];
+        int used = 0;
+        if (std::sscanf(line, " %15s %n", kind, &used) != 1 || kind[0] == '#')
+            continue;
+
+        const char* rest = line + used;
+        double v[9];
+        int n = std::sscanf(rest, "%lf %lf %lf %lf %lf %lf %lf %lf %lf",
+                            &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+                            &v[6], &v[7], &v[8]);
+
+        if (!std::strcmp(kind, "sphere") && n >= 4)
+            add_sphere({v[0], v[1], v[2]}, v[3]);
+        else if (!std::strcmp(kind, "box") && (n == 6 || n == 9))
+            add_box({v[0], v[1], v[2]}, {v[3], v[4], v[5]},
+                    n == 9 ? Vec3{v[6], v[7], v[8]} : Vec3{});
+        else if (!std::strcmp(kind, "plane") && n >= 4)
+            add_plane({v[0], v[1], v[2]}, v[3]);
+        else if (!std::strcmp(kind, "mesh"))
+        {
+            char file[256];
+            double at[4] = {0.0, 0.0, 0.0, 1.0};
+            int m = std::sscanf(rest, "%255s %lf %lf %lf %lf",
+                                file, &at[0], &at[1], &at[2], &at[3]);
+
+            // relative to the scene file
+            std::string obj = file;
+            size_t slash = path.rfind('/');
+            if (m >= 1 && obj[0] != '/' && slash != std::string::npos)
+                obj = path.substr(0, slash + 1) + obj;
+
+            ok = m >= 1 && load_obj(obj, {at[0], at[1], at[2]}, at[3]);
+        }
+        else
+        {
+            std::printf("[HAPTIC] %s:%d: bad line\n", path.c_str(), lineno);
+            ok = false;
+        }
+    }
+    std::fclose(f);
+
+    return ok;
+}
+
+void HapticScene::add_random(size_t n, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> pos(-1.0, 1.0);
+    std::uniform_real_distribution<double> size(0.01, 0.05);
+    std::uniform_real_distribution<double> angle(0.0, 180.0);
+    std::uniform_int_distribution<int> kind(0, 9);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        Vec3 c{pos(rng), pos(rng), pos(rng)};
+        int k = kind(rng);
+
+        if (k < 4)
+            add_sphere(c, size(rng));
+        else if (k < 8)
+            add_box(c, {size(rng), size(rng), size(rng)},
+                    {angle(rng), angle(rng), angle(rng)});
+        else
+        {
+            // octahedron
+            double r = size(rng);
+            std::vector<Vec3> v = {
+                c + Vec3{r, 0, 0}, c + Vec3{-r, 0, 0},
+                c + Vec3{0, r, 0}, c + Vec3{0, -r, 0},
+                c + Vec3{0, 0, r}, c + Vec3{0, 0, -r},
+            };
+            std::vector<uint32_t> t = {
+                0, 2, 4,  2, 1, 4,  1, 3, 4,  3, 0, 4,
+                2, 0, 5,  1, 2, 5,  3, 1, 5,  0, 3, 5,
+            };
+            add_mesh(v, t);
+        }
+    }
+
+    add_plane({0.0, 1.0, 0.0}, -1.0);
+}
+
+void HapticScene::build()
+{
+    tree.clear();
+    tree.reserve(2 * prims.size());
+
+    if (!prims.empty())
+        build_node(0, (uint32_t)prims.size());
+}
+
+// depth-first: a node's left child follows it, the right one is at 'first'
+uint32_t HapticScene::build_node(uint32_t first, uint32_t count)
+{
+    uint32_t self = (uint32_t)tree.size();
+    tree.emplace_back();
+
+    Aabb box, centroids;
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        box.grow(prims[i].box);
+        centroids.grow(prims[i].centroid);
+    }
+    tree[self].box = box;
+
+    Vec3 ext = centroids.hi - centroids.lo;
+    int axis = ext.x >= ext.y && ext.x >= ext.z ? 0 : (ext.y >= ext.z ? 1 : 2);
+
+    if (count <= LEAF_SIZE || ext[axis] <= 0.0)
+    {
+        tree[self].first = first;
+        tree[self].count = count;
+        return self;
+    }
+
+    // median split on the longest centroid axis
+    uint32_t half = count / 2;
+    std::nth_element(prims.begin() + first, prims.begin() + first + half,
+                     prims.begin() + first + count,
+                     [axis](const Prim& a, const Prim& b) {
+                         return a.centroid[axis] < b.centroid[axis];
+                     });
+
+    build_node(first, half);
+    uint32_t right = build_node(first + half, count - half);
+
+    tree[self].first = right;
+    tree[self].count = 0;
+    return self;
+}
+
+// --------------------------------------------------
+// Narrow phase
+// --------------------------------------------------
+
+// Ericson, Real-Time Collision Detection, 5.1.5
+static Vec3 closest_on_triangle(const Vec3& p, const Vec3& a,
+                                const Vec3& b, const Vec3& c)
+{
+    Vec3 ab = b - a, ac = c - a, ap = p - a;
+    double d1 = ab.dot(ap), d2 = ac.dot(ap);
+    if (d1 <= 0.0 && d2 <= 0.0) return a;
+
+    Vec3 bp = p - b;
+    double d3 = ab.dot(bp), d4 = ac.dot(bp);
+    if (d3 >= 0.0 && d4 <= d3) return b;
+
+    double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+        return a + ab * (d1 / (d1 - d3));
+
+    Vec3 cp = p - c;
+    double d5 = ab.dot(cp), d6 = ac.dot(cp);
+    if (d6 >= 0.0 && d5 <= d6) return c;
+
+    double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+        return a + ac * (d2 / (d2 - d6));
+
+    double va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    double denom = 1.0 / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// finger sphere (c, r) against a primitive: depth > 0 and the normal
+// pointing from the object towards the finger
+bool HapticEngine::collide(const HapticScene::Prim& prim, const Vec3& c,
+                           Contact& out) const
+{
+    const double r = p.finger_radius;
+    out.object = prim.object;
+
+    switch (prim.kind)
+    {
+    case HapticScene::SPHERE:
+    {
+        const auto& s = scene.spheres[prim.index];
+        Vec3 d = c - s.c;
+        double dist = d.length();
+        out.depth = r + s.r - dist;
+        if (out.depth <= 0.0) return false;
+        out.n = dist > 0.0 ? d * (1.0 / dist) : Vec3{0.0, 1.0, 0.0};
+        return true;
+    }
+
+    case HapticScene::BOX:
+    {
+        const auto& b = scene.boxes[prim.index];
+        Vec3 d = c - b.c;
+        double local[3], clamped[3];
+        bool inside = true;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            local[i] = d.dot(b.axis[i]);
+            double h = b.half[i];
+            clamped[i] = local[i] < -h ? -h : (local[i] > h ? h : local[i]);
+            if (clamped[i] != local[i]) inside = false;
+        }
+
+        if (inside)
+        {
+            // push out through the nearest face
+            int axis = 0;
+            double best = HUGE_VAL;
+            for (int i = 0; i < 3; ++i)
+            {
+                double gap = b.half[i] - std::fabs(local[i]);
+                if (gap < best) { best = gap; axis = i; }
+            }
+            out.depth = r + best;
+            out.n = b.axis[axis] * (local[axis] < 0.0 ? -1.0 : 1.0);
+            return true;
+        }
+
+        Vec3 off = b.axis[0] * (local[0] - clamped[0]) +
+                   b.axis[1] * (local[1] - clamped[1]) +
+                   b.axis[2] * (local[2] - clamped[2]);
+        double dist = off.length();
+        out.depth = r - dist;
+        if (out.depth <= 0.0) return false;
+        out.n = off * (1.0 / dist);
+        return true;
+    }
+
+    case HapticScene::TRIANGLE:
+    {
+        const auto& t = scene.tris[prim.index];
+        Vec3 q = closest_on_triangle(c, t.a, t.b, t.c);
+        Vec3 d = c - q;
+        double dist = d.length();
+        out.depth = r - dist;
+        if (out.depth <= 0.0) return false;
+
+        if (dist > 0.0)
+            out.n = d * (1.0 / dist);
+        else
+        {
+            Vec3 n = (t.b - t.a).cross(t.c - t.a);
+            double len = n.length();
+            out.n = len > 0.0 ? n * (1.0 / len) : Vec3{0.0, 1.0, 0.0};
+        }
+        return true;
+    }
+    }
+
+    return false;
+}
+
+void HapticEngine::add_contact(const Contact& c)
+{
+    for (Contact& f : found)
+    {
+        if (f.object == c.object)
+        {
+            if (c.depth > f.depth) f = c;
+            return;
+        }
+    }
+    found.push_back(c);
+}
+
+// --------------------------------------------------
+// Engine
+// --------------------------------------------------
+
+HapticEngine::HapticEngine(const HapticScene& scene, const HapticParams& p)
+    : scene(scene), p(p)
+{
+    stack.reserve(64);
+    found.reserve(16);
+    for (FingerState& s : state)
+        s.cand.reserve(64);
+}
+
+void HapticEngine::reset()
+{
+    for (FingerState& s : state)
+    {
+        s.has_prev = false;
+        s.cached = false;
+        s.cand.clear();
+    }
+}
+
+void HapticEngine::query(const Aabb& box, std::vector<uint32_t>& out)
+{
+    queries++;
+
+    if (scene.tree.empty())
+        return;
+
+    stack.clear();
+    stack.push_back(0);
+
+    while (!stack.empty())
+    {
+        uint32_t i = stack.back();
+        stack.pop_back();
+
+        const HapticScene::Node& n = scene.tree[i];
+        if (!n.box.overlaps(box))
+            continue;
+
+        if (n.count)
+        {
+            for (uint32_t k = n.first; k < n.first + n.count; ++k)
+                if (scene.prims[k].box.overlaps(box))
+                    out.push_back(k);
+        }
+        else
+        {
+            stack.push_back(n.first);
+            stack.push_back(i + 1);
+        }
+    }
+}
+
+void HapticEngine::step(const FingerData* fingers, uint8_t count, double dt,
+                        FingerForce* out)
+{
+    ticks++;
+
+    if (count > MAX_FINGERS)
+        count = MAX_FINGERS;
+
+    const double r = p.finger_radius;
+
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        FingerState& s = state[i];
+        Vec3 c{fingers[i].x, fingers[i].y, fingers[i].z};
+
+        Vec3 v;
+        if (s.has_prev && dt > 0.0)
+            v = (c - s.prev) * (1.0 / dt);
+        s.prev = c;
+        s.has_prev = true;
+
+        Aabb tight = Aabb::around(c, r);
+        found.clear();
+        Contact hit;
+
+        if (broad == BroadPhase::brute)
+        {
+            for (const HapticScene::Prim& prim : scene.prims)
+            {
+                prims_tested++;
+                if (collide(prim, c, hit))
+                    add_contact(hit);
+            }
+        }
+        else
+        {
+            if (broad == BroadPhase::tree)
+            {
+                s.cand.clear();
+                query(tight, s.cand);
+            }
+            else if (!s.cached || !s.fat.contains(tight))
+            {
+                s.fat = Aabb::around(c, r + p.margin);
+                s.cand.clear();
+                query(s.fat, s.cand);
+                s.cached = true;
+            }
+            else
+                reuses++;
+
+            for (uint32_t k : s.cand)
+            {
+                prims_tested++;
+                if (collide(scene.prims[k], c, hit))
+                    add_contact(hit);
+            }
+        }
+
+        for (const HapticScene::Plane& pl : scene.plane_list)
+        {
+            double depth = r - (pl.n.dot(c) - pl.d);
+            if (depth > 0.0)
+                add_contact({pl.object, depth, pl.n});
+        }
+
+        FingerForce& f = out[i];
+        f.f = {};
+        f.contacts = (uint32_t)found.size();
+
+        for (const Contact& k : found)
+        {
+            double mag = p.stiffness * k.depth - p.damping * v.dot(k.n);
+            if (mag > 0.0)
+                f.f += k.n * mag;
+        }
+
+        double len = f.f.length();
+        if (len > p.max_force)
+            f.f = f.f * (p.max_force / len);
+
+        contacts += found.size();
+    }
+}
+
+void HapticEngine::to_wire(const FingerForce* f, uint8_t count,
+                           pkt_force_t* out)
+{
+    auto mn = [](double n) {
+        double v = std::round(n * 1000.0);
+        return (int16_t)(v > 32767.0 ? 32767 : (v < -32768.0 ? -32768 : v));
+    };
+
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        out[i].fx = mn(f[i].f.x);
+        out[i].fy = mn(f[i].f.y);
+        out[i].fz = mn(f[i].f.z);
+    }
+}
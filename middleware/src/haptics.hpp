@@ -0,0 +1,238 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "protocol.hpp"
+#include "packet_codec.h"
+
+// --------------------------------------------------
+// Haptic contact rendering
+// --------------------------------------------------
+//
+// A static scene of spheres, oriented boxes, planes and triangle meshes.
+// Every bounded primitive (sphere, box, mesh triangle) sits in one BVH;
+// planes are unbounded and tested directly. Each finger is a sphere of
+// 'finger_radius'. A finger penetrating an object by 'depth' along the
+// contact normal n gets a spring-damper force
+//
+//   F = max(0, k * depth - b * (v . n)) * n
+//
+// from the deepest contact per object (meshes touch through several
+// triangles), summed over objects and clamped to 'max_force'.
+//
+// Broad phase is incremental: each finger keeps the primitives that
+// overlap a box 'margin' larger than itself from its last tree query and
+// reuses them while it stays inside that box, so a finger resting on or
+// moving near a surface does not walk the tree every tick.
+//
+// Units are the device's (metres assumed for k in N/m and b in N s/m).
+// The scene is built once; step() runs on one thread and never
+// allocates after the first few ticks.
+
+struct Vec3
+{
+    double x = 0.0, y = 0.0, z = 0.0;
+
+    Vec3() = default;
+    Vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+
+    Vec3 operator+(const Vec3& o) const { return {x + o.x, y + o.y, z + o.z}; }
+    Vec3 operator-(const Vec3& o) const { return {x - o.x, y - o.y, z - o.z}; }
+    Vec3 operator*(double s) const { return {x * s, y * s, z * s}; }
+    Vec3& operator+=(const Vec3& o) { x += o.x; y += o.y; z += o.z; return *this; }
+
+    double dot(const Vec3& o) const { return x * o.x + y * o.y + z * o.z; }
+    Vec3 cross(const Vec3& o) const
+    {
+        return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x};
+    }
+    double length() const { return std::sqrt(dot(*this)); }
+
+    double operator[](int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+};
+
+struct Aabb
+{
+    Vec3 lo{ HUGE_VAL,  HUGE_VAL,  HUGE_VAL};
+    Vec3 hi{-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+
+    void grow(const Vec3& p)
+    {
+        lo = {std::fmin(lo.x, p.x), std::fmin(lo.y, p.y), std::fmin(lo.z, p.z)};
+        hi = {std::fmax(hi.x, p.x), std::fmax(hi.y, p.y), std::fmax(hi.z, p.z)};
+    }
+    void grow(const Aabb& b) { grow(b.lo); grow(b.hi); }
+
+    bool overlaps(const Aabb& b) const
+    {
+        return lo.x <= b.hi.x && hi.x >= b.lo.x &&
+               lo.y <= b.hi.y && hi.y >= b.lo.y &&
+               lo.z <= b.hi.z && hi.z >= b.lo.z;
+    }
+    bool contains(const Aabb& b) const
+    {
+        return lo.x <= b.lo.x && lo.y <= b.lo.y && lo.z <= b.lo.z &&
+               hi.x >= b.hi.x && hi.y >= b.hi.y && hi.z >= b.hi.z;
+    }
+
+    static Aabb around(const Vec3& c, double r)
+    {
+        Aabb b;
+        b.lo = {c.x - r, c.y - r, c.z - r};
+        b.hi = {c.x + r, c.y + r, c.z + r};
+        return b;
+    }
+};
+
+// --------------------------------------------------
+// Scene
+// --------------------------------------------------
+
+class HapticScene
+{
+public:
+    // each returns the object id
+    uint32_t add_sphere(const Vec3& c, double r);
+    // half extents, then rotation in degrees about x, y, z (applied x first)
+    uint32_t add_box(const Vec3& c, const Vec3& half, const Vec3& rot_deg = {});
+    // solid below n . p = d, n pointing out of the solid
+    uint32_t add_plane(const Vec3& n, double d);
+    // triangles are index triples into 'verts'
+    uint32_t add_mesh(const std::vector<Vec3>& verts,
+                      const std::vector<uint32_t>& tris);
+
+    // Text scene, one object per line, '#' comments:
+    //   sphere x y z r
+    //   box    x y z hx hy hz [rx ry rz]
+    //   plane  nx ny nz d
+    //   mesh   file.obj [x y z [scale]]
+    bool load(const std::string& path);
+
+    // 'n' objects in [-1, 1]^3 (spheres, boxes, small meshes) and a floor
+    void add_random(size_t n, uint32_t seed);
+
+    // BVH over everything added so far
+    void build();
+
+    size_t objects() const { return n_objects; }
+    size_t primitives() const { return prims.size(); }
+    size_t planes() const { return plane_list.size(); }
+    size_t nodes() const { return tree.size(); }
+
+private:
+    friend class HapticEngine;
+
+    enum Kind : uint8_t { SPHERE, BOX, TRIANGLE };
+
+    struct Prim
+    {
+        Kind kind;
+        uint32_t object;
+        uint32_t index;     // into spheres / boxes / tris
+        Aabb box;
+        Vec3 centroid;
+    };
+
+    struct Sphere { Vec3 c; double r; };
+    struct Box { Vec3 c; Vec3 half; Vec3 axis[3]; };
+    struct Tri { Vec3 a, b, c; };
+    struct Plane { Vec3 n; double d; uint32_t object; };
+
+    // leaf if count > 0: prims [first, first + count); else an inner
+    // node with its left child right after it and the right one at first
+    struct Node
+    {
+        Aabb box;
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    uint32_t build_node(uint32_t first, uint32_t count);
+    bool load_obj(const std::string& path, const Vec3& at, double scale);
+
+    std::vector<Sphere> spheres;
+    std::vector<Box> boxes;
+    std::vector<Tri> tris;
+    std::vector<Plane> plane_list;
+    std::vector<Prim> prims;
+    std::vector<Node> tree;
+    uint32_t n_objects = 0;
+};
+
+// --------------------------------------------------
+// Engine
+// --------------------------------------------------
+
+struct HapticParams
+{
+    double finger_radius = 0.01;
+    double stiffness = 1000.0;      // N/m
+    double damping = 2.0;           // N s/m
+    double max_force = 20.0;        // N
+    double margin = 0.02;           // broad-phase cache slack
+};
+
+struct FingerForce
+{
+    Vec3 f;
+    uint32_t contacts = 0;
+};
+
+class HapticEngine
+{
+public:
+    static constexpr size_t MAX_FINGERS = 16;
+
+    enum class BroadPhase
+    {
+        brute,      // every primitive, every tick (reference)
+        tree,       // BVH query every tick
+        cached,     // BVH query only when a finger leaves its cached box
+    };
+
+    HapticEngine(const HapticScene& scene, const HapticParams& p = {});
+
+    BroadPhase broad = BroadPhase::cached;
+
+    // one tick, 'dt' seconds after the previous one; out[count]
+    void step(const FingerData* fingers, uint8_t count, double dt,
+              FingerForce* out);
+
+    // forget velocities and broad-phase caches
+    void reset();
+
+    // forces in mN for pkt_encode_forces(), saturated to i16
+    static void to_wire(const FingerForce* f, uint8_t count, pkt_force_t* out);
+
+    uint64_t ticks = 0;
+    uint64_t queries = 0;           // BVH walks
+    uint64_t reuses = 0;            // finger-ticks served from the cache
+    uint64_t prims_tested = 0;
+    uint64_t contacts = 0;
+
+private:
+    struct Contact { uint32_t object; double depth; Vec3 n; };
+
+    struct FingerState
+    {
+        Vec3 prev;
+        bool has_prev = false;
+        Aabb fat;
+        bool cached = false;
+        std::vector<uint32_t> cand;
+    };
+
+    void query(const Aabb& box, std::vector<uint32_t>& out);
+    bool collide(const HapticScene::Prim& p, const Vec3& c, Contact& out) const;
+    void add_contact(const Contact& c);
+
+    const HapticScene& scene;
+    HapticParams p;
+
+    FingerState state[MAX_FINGERS];
+    std::vector<uint32_t> stack;
+    std::vector<Contact> found;     // deepest per object, current finger
+};
@@ -0,0 +1,145 @@
+#include "haptics_bench.hpp"
+#include "haptics.hpp"
+#include "stats.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static const unsigned FINGERS = 5;
+static const unsigned TICKS = 20000;
+static const double DT = 0.001;     // 1 kHz haptic loop
+
+// fingers wandering through [-1, 1]^3 at ~0.5 m/s, bouncing off the walls
+static std::vector<FingerData> make_trajectory(unsigned ticks)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> pos(-1.0, 1.0);
+    std::normal_distribution<double> jitter(0.0, 0.05);
+
+    std::vector<FingerData> out((size_t)ticks * FINGERS);
+
+    for (unsigned f = 0; f < FINGERS; ++f)
+    {
+        double p[3] = {pos(rng), pos(rng), pos(rng)};
+        double v[3] = {jitter(rng), jitter(rng), jitter(rng)};
+
+        for (unsigned t = 0; t < ticks; ++t)
+        {
+            double speed = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+            for (int k = 0; k < 3; ++k)
+            {
+                v[k] = v[k] * 0.5 / (speed > 0.0 ? speed : 1.0) + jitter(rng);
+                p[k] += v[k] * DT;
+                if (p[k] < -1.0 || p[k] > 1.0)
+                {
+                    v[k] = -v[k];
+                    p[k] = p[k] < -1.0 ? -1.0 : 1.0;
+                }
+            }
+
+            FingerData& d = out[(size_t)t * FINGERS + f];
+            d.x = p[0];
+            d.y = p[1];
+            d.z = p[2];
+            d.state_array = f;
+            d.temp = 30.0f;
+        }
+    }
+    return out;
+}
+
+struct RunResult
+{
+    std::vector<FingerForce> forces;
+    double mean_ns = 0.0;
+};
+
+static RunResult run(const HapticScene& scene, HapticEngine::BroadPhase bp,
+                     const char* name, const std::vector<FingerData>& traj,
+                     unsigned ticks)
+{
+    HapticEngine engine(scene);
+    engine.broad = bp;
+
+    RunResult r;
+    r.forces.resize((size_t)ticks * FINGERS);
+
+    LatencyHistogram ns;
+
+    for (unsigned t = 0; t < ticks; ++t)
+    {
+        auto t0 = bench_clock::now();
+        engine.step(&traj[(size_t)t * FINGERS], FINGERS, DT,
+                    &r.forces[(size_t)t * FINGERS]);
+        auto t1 = bench_clock::now();
+
+        ns.record((uint64_t)std::chrono::duration_cast<
+            std::chrono::nanoseconds>(t1 - t0).count());
+    }
+
+    r.mean_ns = ns.mean();
+
+    std::printf("[HAPTIC-BENCH] %-7s ticks=%u tick ns: mean=%.0f p50=%llu "
+                "p99=%llu max=%llu | per tick: prims=%.1f queries=%.2f "
+                "contacts=%.3f\n",
+        name, ticks, ns.mean(),
+        (unsigned long long)ns.percentile(50),
+        (unsigned long long)ns.percentile(99),
+        (unsigned long long)ns.max(),
+        (double)engine.prims_tested / ticks,
+        (double)engine.queries / ticks,
+        (double)engine.contacts / ticks);
+
+    return r;
+}
+
+static double max_diff(const RunResult& a, const RunResult& b, size_t n)
+{
+    double m = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        Vec3 d = a.forces[i].f - b.forces[i].f;
+        m = std::fmax(m, d.length());
+    }
+    return m;
+}
+
+int run_haptics_bench(unsigned objects)
+{
+    HapticScene scene;
+    scene.add_random(objects, 1);
+
+    auto t0 = bench_clock::now();
+    scene.build();
+    auto t1 = bench_clock::now();
+
+    std::printf("[HAPTIC-BENCH] objects=%zu prims=%zu planes=%zu nodes=%zu "
+                "build=%lld us\n",
+        scene.objects(), scene.primitives(), scene.planes(), scene.nodes(),
+        (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+            t1 - t0).count());
+
+    std::vector<FingerData> traj = make_trajectory(TICKS);
+
+    // brute force is the reference; keep it short on big scenes
+    unsigned brute_ticks = objects > 2000 ? 2000 : TICKS;
+
+    RunResult brute  = run(scene, HapticEngine::BroadPhase::brute,  "brute",  traj, brute_ticks);
+    RunResult tree   = run(scene, HapticEngine::BroadPhase::tree,   "bvh",    traj, TICKS);
+    RunResult cached = run(scene, HapticEngine::BroadPhase::cached, "cached", traj, TICKS);
+
+    size_t n = (size_t)brute_ticks * FINGERS;
+    double d_tree = max_diff(brute, tree, n);
+    double d_cached = max_diff(brute, cached, n);
+
+    std::printf("[HAPTIC-BENCH] max force difference vs brute: bvh=%g cached=%g N "
+                "(%s)\n",
+        d_tree, d_cached, d_tree < 1e-9 && d_cached < 1e-9 ? "match" : "MISMATCH");
+
+    return d_tree < 1e-9 && d_cached < 1e-9 ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// --------------------------------------------------
+// Haptics bench
+// --------------------------------------------------
+//
+// Per-tick cost of HapticEngine::step() for five fingers moving through
+// a random scene of 'objects' objects, with brute-force, BVH and cached
+// BVH broad phases.
+
+int run_haptics_bench(unsigned objects);
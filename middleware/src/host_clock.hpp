@@ -0,0 +1,16 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// --------------------------------------------------
+// Host monotonic clock
+// --------------------------------------------------
+//
+// Microseconds on steady_clock: the time base heartbeats carry as t0 and
+// that ClockSync, RttProbe and the sim device all compare against.
+
+inline uint64_t host_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
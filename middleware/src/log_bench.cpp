@@ -0,0 +1,84 @@
+#include "log_bench.hpp"
+#include "binlog.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using bench_clock = std::chrono::steady_clock;
+
+// well under the ring size, so the timed calls never see a full ring
+static const unsigned BATCH = 512;
+
+static double ns_per(bench_clock::time_point t0, bench_clock::time_point t1,
+                     unsigned iters)
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        t1 - t0).count() / iters;
+}
+
+static void report(const char* what, double ns)
+{
+    std::printf("[LOG-BENCH] %-28s %7.1f ns/call\n", what, ns);
+}
+
+int run_log_bench(unsigned iters)
+{
+    if (iters < BATCH)
+        iters = BATCH;
+
+    FILE* null = std::fopen("/dev/null", "w");
+    if (!null)
+    {
+        std::printf("[LOG-BENCH] cannot open /dev/null\n");
+        return 1;
+    }
+
+    // printf the same [FINGERS] line, to a file nobody reads
+    auto t0 = bench_clock::now();
+    for (unsigned i = 0; i < iters; ++i)
+        std::fprintf(null, "[FINGERS] seq=%u ts=%llu count=%u\n",
+            i & 0xFFFF, (unsigned long long)i * 1000, 5u);
+    auto t1 = bench_clock::now();
+    report("fprintf (formatted)", ns_per(t0, t1, iters));
+
+    t0 = bench_clock::now();
+    for (unsigned i = 0; i < iters; ++i)
+        (void)log_now_ns();
+    t1 = bench_clock::now();
+    report("timestamp alone", ns_per(t0, t1, iters));
+
+    if (!log_start(LogMode::raw, "/dev/null"))
+        return 1;
+
+    // timed in batches; between them the log thread empties the ring
+    uint64_t ns = 0;
+    unsigned done = 0;
+
+    while (done < iters)
+    {
+        t0 = bench_clock::now();
+        for (unsigned i = 0; i < BATCH; ++i, ++done)
+            SOUPY_LOG("[FINGERS] seq=%u ts=%llu count=%u\n",
+                done & 0xFFFF, (unsigned long long)done * 1000, 5u);
+        t1 = bench_clock::now();
+        ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+
+        while (!log_ring().empty())
+            std::this_thread::yield();
+    }
+    report("SOUPY_LOG (deferred)", (double)ns / done);
+
+    t0 = bench_clock::now();
+    for (unsigned i = 0; i < iters; ++i)
+        SOUPY_LOG_RATE(10, "[USB] transfer error: status=%d\n", -(int)(i & 7));
+    t1 = bench_clock::now();
+    report("SOUPY_LOG_RATE (suppressed)", ns_per(t0, t1, iters));
+
+    log_stop();
+    std::fclose(null);
+
+    std::printf("[LOG-BENCH] calls=%u dropped=%llu\n",
+        iters, (unsigned long long)g_log_dropped->value());
+    return 0;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// --------------------------------------------------
+// Log bench
+// --------------------------------------------------
+//
+// Caller-side cost of a SOUPY_LOG call (deferred, and over its rate
+// limit) next to printf-ing the same line.
+
+int run_log_bench(unsigned iters);
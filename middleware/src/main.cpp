@@ -1,9 +1,26 @@
 #include "main.hpp"
 #include "ring_buffer.hpp"
+#include "ik_lut.h"
+#include "fw_cmd_bench.hpp"
+#include "fw_stream_bench.hpp"
+#include "codec_bench.hpp"
+#include "reactor.hpp"
+#include "rtt_probe.hpp"
+#include "binlog.hpp"
+#include "log_bench.hpp"
+#include "haptics_bench.hpp"
+#include "calib_bench.hpp"
+#include "stream_bench.hpp"
+#include "alloc_track.hpp"
+#include "trace.hpp"
+#include "host_clock.hpp"
 
 #include <thread>
 #include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 
 // --------------------------------------------------
 // Packet handler implementation
@@ -12,21 +29,47 @@
 void AppPacketHandler::on_finger_packet(
     uint16_t seq,
     uint64_t timestamp,
-    const FingerData* fingers,
-    uint8_t count)
+    const FingerArrayView& fingers)
 {
-    std::printf("[FINGERS] seq=%u ts=%llu count=%u\n",
+    finger_packets.inc();
+
+    if (host_timestamps || clock.valid())
+    {
+        uint64_t now = host_now_us();
+        uint64_t ts = host_timestamps ? timestamp : clock.to_host(timestamp);
+
+        latency_us.record(now > ts ? now - ts : 0);
+
+        if (resampler)
+            resampler->push(ts, fingers);
+    }
+
+    edges.feed(seq, timestamp, fingers);
+
+    if (fanout)
+    {
+        TraceScope trace("fanout publish", seq);
+        fanout->publish(seq, timestamp, fingers);
+    }
+
+    if (delay_us)
+        std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+
+    if (quiet || edges_only)
+        return;
+
+    SOUPY_LOG("[FINGERS] seq=%u ts=%llu count=%u\n",
         seq,
         (unsigned long long)timestamp,
-        (unsigned)count);
+        (unsigned)fingers.size());
 
     // Uncomment for per-finger debug
     /*
-    for (uint8_t i = 0; i < count; ++i)
+    for (uint8_t i = 0; i < fingers.size(); ++i)
     {
-        const auto& f = fingers[i];
+        FingerView f = fingers[i];
         printf("  i=%u pos=(%.3f %.3f %.3f) state=0x%08X temp=%.2f\n",
-            i, f.x, f.y, f.z, f.state_array, f.temp);
+            i, f.x(), f.y(), f.z(), f.state_array(), f.temp());
     }
     */
 }
@@ -37,17 +80,58 @@ void AppPacketHandler::on_unknown(
     const uint8_t*,
     uint16_t len)
 {
-    std::printf("[UNKNOWN] type=%u seq=%u len=%u\n",
+    unknown_packets.inc();
+
+    if (quiet)
+        return;
+
+    SOUPY_LOG("[UNKNOWN] type=%u seq=%u len=%u\n",
         type, seq, len);
 }
 
+void AppPacketHandler::on_time_reply(
+    uint16_t,
+    uint64_t host_tx_us,
+    uint64_t dev_rx_us,
+    uint64_t dev_tx_us)
+{
+    clock.add(host_tx_us, dev_rx_us, dev_tx_us, host_now_us());
+}
+
+void AppPacketHandler::on_bad_crc(uint8_t, uint16_t)
+{
+    crc_errors.inc();
+}
+
+void AppPacketHandler::on_state_edges(const StateEdge* e, size_t count)
+{
+    state_edges.inc(count);
+
+    if (quiet || !edges_only)
+        return;
+
+    for (size_t i = 0; i < count; ++i)
+        SOUPY_LOG("[EDGE] seq=%u ts=%llu finger=%u bit=%u %s\n",
+            e[i].seq,
+            (unsigned long long)e[i].timestamp,
+            (unsigned)e[i].finger,
+            (unsigned)e[i].bit,
+            e[i].set ? "set" : "clear");
+}
+
 // --------------------------------------------------
 // RX thread
 // --------------------------------------------------
 
 void rx_thread_fn(Runtime& rt)
 {
+    rt_setup_current_thread("soupy-rx", rt.opt.rx_rt);
+
+    Counter& rx_bytes = metrics().counter(
+        "soupy_rx_bytes_total", "Bytes read from the transport");
+
     uint8_t buf[1024];
+    FrameSplitter splitter;
 
     while (rt.running.load())
     {
@@ -58,15 +142,23 @@ void rx_thread_fn(Runtime& rt)
             continue;
         }
 
-        Chunk c;
-        c.bytes.assign(buf, buf + n);
+        rx_bytes.inc((uint64_t)n);
 
+        // queue whole frames only, so overload drops never split a packet
+        Chunk c;
         {
-            std::lock_guard<std::mutex> lk(rt.m);
-            rt.queue.push_back(std::move(c));
+            TraceScope trace("rx split", -1, (uint32_t)n);
+
+            c.reserve((size_t)n);
+            splitter.feed(buf, (size_t)n, [&](const uint8_t* f, size_t len) {
+                if (c.empty())
+                    c.seq = wire::Header::seq::load(f);
+                c.append(f, len);
+            });
+            trace.seq = c.seq;
         }
 
-        rt.cv.notify_one();
+        rt.queue.push(std::move(c), &rt.running);
     }
 }
 
@@ -76,27 +168,22 @@ void rx_thread_fn(Runtime& rt)
 
 void parser_thread_fn(Runtime& rt)
 {
+    rt_setup_current_thread("soupy-parser", rt.opt.parser_rt);
+
     ByteRing ring(8192);
 
     while (rt.running.load())
     {
         Chunk c;
 
-        {
-            std::unique_lock<std::mutex> lk(rt.m);
-            rt.cv.wait(lk, [&]{
-                return !rt.queue.empty() || !rt.running.load();
-            });
-
-            if (!rt.running.load())
-                break;
+        if (!rt.queue.pop_wait(c, rt.running))
+            break;
 
-            c = std::move(rt.queue.front());
-            rt.queue.pop_front();
+        {
+            TraceScope trace("ring push", c.seq, (uint32_t)c.size());
+            ring.push(c.data(), c.size());
         }
-
-        ring.push(c.bytes.data(), c.bytes.size());
-        parse_from_ring(ring, rt.handler);
+        parse_from_ring(ring, rt.sink());
     }
 }
 
@@ -104,61 +191,1154 @@ void parser_thread_fn(Runtime& rt)
 // TX thread (heartbeat)
 // --------------------------------------------------
 
+static void send_heartbeat(Runtime& rt, uint16_t seq)
+{
+    static Counter& sent = metrics().counter(
+        "soupy_heartbeats_sent_total", "Heartbeats written to the transport");
+    static Counter& failed = metrics().counter(
+        "soupy_heartbeat_send_failures_total", "Heartbeat writes that came up short");
+
+    uint8_t pkt[PKT_HEARTBEAT_FRAME];
+    size_t len = pkt_encode_heartbeat(pkt, sizeof(pkt), seq, host_now_us());
+    int n = rt.transport->write(pkt, (int)len);
+
+    if (n == (int)len)
+        sent.inc();
+    else
+        failed.inc();
+}
+
 void tx_thread_fn(Runtime& rt)
 {
+    rt_setup_current_thread("soupy-tx", rt.opt.tx_rt);
+
     uint16_t seq = 0;
 
+    // a late heartbeat replaces the missed ones instead of bursting
+    rt.heartbeat.start();
+
+    while (rt.running.load())
+    {
+        rt.heartbeat.wait();
+        send_heartbeat(rt, seq++);
+    }
+}
+
+// --------------------------------------------------
+// Haptic loop (resampler output)
+// --------------------------------------------------
+
+static constexpr unsigned HAPTIC_RATE_HZ = 1000;
+
+static LatencyHistogram& haptic_step_ns()
+{
+    static LatencyHistogram& h = metrics().histogram(
+        "soupy_haptic_step_ns", "Contact force computation per tick");
+    return h;
+}
+
+static void haptic_tick(Runtime& rt, const ResampledFrame& f)
+{
+    static Counter& sent = metrics().counter(
+        "soupy_forces_sent_total", "Force packets written to the transport");
+    static Counter& failed = metrics().counter(
+        "soupy_force_send_failures_total", "Force writes that came up short");
+
+    static uint16_t seq = 0;
+    static uint64_t last_tick = 0;
+
+    uint8_t n = f.count < PKT_FORCES_MAX ? f.count : (uint8_t)PKT_FORCES_MAX;
+    double dt = (double)(f.tick > last_tick ? f.tick - last_tick : 1) /
+                HAPTIC_RATE_HZ;
+    last_tick = f.tick;
+
+    FingerForce forces[HapticEngine::MAX_FINGERS];
+    pkt_force_t wire[HapticEngine::MAX_FINGERS];
+
+    auto t0 = std::chrono::steady_clock::now();
+    rt.haptics->step(f.fingers, n, dt, forces);
+    auto t1 = std::chrono::steady_clock::now();
+
+    haptic_step_ns().record((uint64_t)std::chrono::duration_cast<
+        std::chrono::nanoseconds>(t1 - t0).count());
+
+    HapticEngine::to_wire(forces, n, wire);
+
+    uint8_t pkt[PKT_FORCES_FRAME(PKT_FORCES_MAX)];
+    size_t len = pkt_encode_forces(pkt, sizeof(pkt), seq++, wire, n);
+
+    if (rt.transport->write(pkt, (int)len) == (int)len)
+        sent.inc();
+    else
+        failed.inc();
+}
+
+// --------------------------------------------------
+// Run-to-completion thread (rx + parse + heartbeat)
+// --------------------------------------------------
+
+void rtc_thread_fn(Runtime& rt)
+{
+    rt_setup_current_thread("soupy-rtc", rt.opt.rx_rt);
+
+    Counter& rx_bytes = metrics().counter(
+        "soupy_rx_bytes_total", "Bytes read from the transport");
+
+    ByteRing ring(8192);
+    uint8_t buf[1024];
+
+    // with busy polling poll() never blocks; otherwise it may wait up to
+    // 1 ms for the transport (libusb events or the next sim packet)
+    const int poll_us = rt.opt.busy_poll ? 0 : 1000;
+
+    uint16_t hb_seq = 0;
+    rt.heartbeat.start();
+
+    while (rt.running.load())
+    {
+        rt.transport->poll(poll_us);
+
+        int n;
+        while ((n = rt.transport->read(buf, sizeof(buf))) > 0)
+        {
+            rx_bytes.inc((uint64_t)n);
+            ring.push(buf, (size_t)n);
+            parse_from_ring(ring, rt.sink());
+        }
+
+        uint64_t due;
+        if (rt.heartbeat.expire(PeriodicTimer::now_ns(), due))
+            send_heartbeat(rt, hb_seq++);
+    }
+}
+
+// --------------------------------------------------
+// Fan-out consumers
+// --------------------------------------------------
+//
+// Each runs on its own thread and reads the frame ring at its own pace;
+// none of them can hold up the parser.
+
+static bool fanout_spec_valid(const std::string& spec)
+{
+    return spec == "filter" ||
+           spec.compare(0, 7, "logger:") == 0 ||
+           spec.compare(0, 5, "slow:") == 0;
+}
+
+void fanout_thread_fn(Runtime& rt, FrameRing::Consumer& c,
+                      const std::string& spec)
+{
+    char name[16];
+    std::snprintf(name, sizeof(name), "soupy-%s", c.name().c_str());
+    rt_setup_current_thread(name, ThreadRtConfig{});
+
+    FILE* log = nullptr;
+    unsigned slow_us = 0;
+
+    if (spec.compare(0, 7, "logger:") == 0)
+    {
+        log = std::fopen(spec.c_str() + 7, "w");
+        if (!log)
+        {
+            std::printf("[FANOUT] %s: cannot open %s\n",
+                c.name().c_str(), spec.c_str() + 7);
+            return;
+        }
+        std::fprintf(log, "seq,timestamp,finger,x,y,z,state,temp\n");
+    }
+    else if (spec.compare(0, 5, "slow:") == 0)
+    {
+        slow_us = (unsigned)std::strtoul(spec.c_str() + 5, nullptr, 10);
+    }
+
+    // filter: exponential moving average of each finger position
+    constexpr double ALPHA = 0.1;
+    double smooth[RingFrame::MAX_FINGERS][3] = {};
+
+    RingFrame f;
+
     while (rt.running.load())
     {
-        auto pkt = build_heartbeat(seq++);
-        rt.transport->write(pkt.data(), pkt.size());
+        if (!c.next(f))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        if (log)
+        {
+            for (uint8_t i = 0; i < f.count; ++i)
+            {
+                const FingerData& d = f.fingers[i];
+                std::fprintf(log, "%u,%llu,%u,%.6f,%.6f,%.6f,%u,%.2f\n",
+                    f.seq, (unsigned long long)f.timestamp, (unsigned)i,
+                    d.x, d.y, d.z, d.state_array, d.temp);
+            }
+        }
+        else if (slow_us)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(slow_us));
+        }
+        else
+        {
+            for (uint8_t i = 0; i < f.count; ++i)
+            {
+                smooth[i][0] += ALPHA * (f.fingers[i].x - smooth[i][0]);
+                smooth[i][1] += ALPHA * (f.fingers[i].y - smooth[i][1]);
+                smooth[i][2] += ALPHA * (f.fingers[i].z - smooth[i][2]);
+            }
+        }
+    }
+
+    if (log)
+        std::fclose(log);
+}
+
+// --------------------------------------------------
+// Allocation check
+// --------------------------------------------------
+
+static int report_alloc_check(unsigned warmup_secs, unsigned run_secs)
+{
+    AllocThreadStats st[64];
+    size_t n = alloc_track_report(st, 64);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        std::printf("[ALLOC] thread=%s allocs=%llu bytes=%llu\n",
+            st[i].name,
+            (unsigned long long)st[i].allocs,
+            (unsigned long long)st[i].bytes);
+        total += st[i].allocs;
+    }
+
+    unsigned secs = run_secs > warmup_secs ? run_secs - warmup_secs : 0;
+    std::printf("[ALLOC] %llu heap allocations in %u s after %u s warm-up: %s\n",
+        (unsigned long long)total, secs, warmup_secs, total ? "FAIL" : "ok");
+
+    return total ? 1 : 0;
+}
+
+// --------------------------------------------------
+// Reactor mode
+// --------------------------------------------------
+
+static int run_reactor(Runtime& rt, const TransportConfig& base)
+{
+#ifndef USE_SIM
+    (void)rt;
+    (void)base;
+    std::printf("reactor mode needs the sim build\n");
+    return 1;
+#else
+    ReactorConfig rc;
+    rc.workers = rt.opt.workers;
+
+    TransportConfig tcfg = base;
+    tcfg.print_stats = false;
+    if (!tcfg.sim_rate_hz)
+        tcfg.sim_rate_hz = 1000;
+
+    Reactor reactor(rc);
+
+    for (unsigned i = 0; i < rt.opt.streams; ++i)
+    {
+        auto t = std::make_unique<SimTransport>(tcfg);
+        t->set_polled(true);
+        if (!t->open())
+        {
+            std::printf("stream %u: open failed\n", i);
+            return 1;
+        }
+
+        auto h = std::make_unique<AppPacketHandler>();
+        h->quiet = true;
+        h->host_timestamps = tcfg.sim_clock.ideal();
+
+        if (!reactor.add_stream(std::move(t), std::move(h)))
+            return 1;
+    }
+
+    std::printf("Running %u sim streams on %u reactor workers at %u Hz\n",
+        rt.opt.streams, rc.workers, tcfg.sim_rate_hz);
+
+    if (!rt.opt.metrics_file.empty() || !rt.opt.metrics_sock.empty())
+        rt.exporter.start(rt.opt.metrics_file, rt.opt.metrics_sock,
+                          rt.opt.metrics_period_ms);
+
+    Counter& fingers = rt.handler.finger_packets;
+    uint64_t pk0 = fingers.value();
+
+    auto wall0 = std::chrono::steady_clock::now();
+    std::clock_t cpu0 = std::clock();
+
+    if (!reactor.start())
+        return 1;
+
+    unsigned run_secs = rt.opt.run_secs;
+    if (rt.opt.alloc_check && !run_secs)
+        run_secs = rt.opt.alloc_check_warmup + 5;
+
+    for (unsigned t = 0; run_secs == 0 || t < run_secs; ++t)
+    {
+        if (rt.opt.alloc_check && t == rt.opt.alloc_check_warmup)
+            alloc_track_arm();
+
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    if (rt.opt.alloc_check)
+        alloc_track_disarm();
+
+    reactor.stop();
+
+    double cpu_s  = (double)(std::clock() - cpu0) / CLOCKS_PER_SEC;
+    double wall_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall0).count();
+    uint64_t packets = fingers.value() - pk0;
+
+    reactor.print_stats();
+    std::printf("[REACTOR] streams=%u workers=%u packets=%llu (%.0f/s, "
+                "expected %u/s) bytes=%llu\n",
+        rt.opt.streams, rc.workers,
+        (unsigned long long)packets, packets / wall_s,
+        rt.opt.streams * tcfg.sim_rate_hz,
+        (unsigned long long)reactor.bytes());
+    std::printf("[CPU] mode=reactor cpu=%.2fs wall=%.2fs (%.0f%% of one core)\n",
+        cpu_s, wall_s, 100.0 * cpu_s / wall_s);
+
+    reactor.close_all();
+
+    if (rt.handler.latency_us.count())
+        rt.handler.latency_us.print("LATENCY", "us");
+
+    if (rt.opt.alloc_check)
+        return report_alloc_check(rt.opt.alloc_check_warmup, run_secs);
+
+    return 0;
+#endif
+}
+
+// --------------------------------------------------
+// IK table check
+// --------------------------------------------------
+
+// float literal that reads back to the same float
+static std::string c_float(float v)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", v);
+
+    std::string s = buf;
+    if (s.find_first_of(".e") == std::string::npos)
+        s += ".0";
+    return s + "f";
+}
+
+// firmware/ik_lut_table.h: the table as a const initializer, so the glove
+// keeps it in flash instead of solving it at boot
+static bool write_ik_table(const ik_lut_t& lut, const std::string& path,
+                           float step, float bound)
+{
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f)
+    {
+        std::printf("IK table: can't write %s\n", path.c_str());
+        return false;
+    }
+
+    std::fprintf(f,
+        "//\n"
+        "// Generated by the middleware: --ik-check %g,%g --ik-gen (make ik-table).\n"
+        "// Do not edit. max_err %.4f deg over %u checked samples, %u reachable\n"
+        "// entries of %u.\n"
+        "//\n\n"
+        "#ifndef IK_LUT_TABLE_H\n"
+        "#define IK_LUT_TABLE_H\n\n"
+        "#include \"ik_lut.h\"\n\n"
+        "#if IK_LUT_MAX_ENTRIES < %u\n"
+        "#error \"IK_LUT_MAX_ENTRIES too small for ik_lut_table.h\"\n"
+        "#endif\n\n"
+        "static const ik_lut_t IK_LUT_TABLE = {\n"
+        "    .min_deg         = %s,\n"
+        "    .step_deg        = %s,\n"
+        "    .inv_step        = %s,\n"
+        "    .count           = %u,\n"
+        "    .reachable_count = %u,\n"
+        "    .max_err_deg     = %s,\n"
+        "    .edge_cells      = %u,\n"
+        "    .uncovered       = %u,\n"
+        "    .spurious        = %u,\n"
+        "    .joints = {\n",
+        step, bound, lut.max_err_deg,
+        (unsigned)(lut.count - 1) * IK_LUT_CHECK_SAMPLES,
+        (unsigned)lut.reachable_count, (unsigned)lut.count,
+        (unsigned)lut.count,
+        c_float(lut.min_deg).c_str(), c_float(lut.step_deg).c_str(),
+        c_float(lut.inv_step).c_str(), (unsigned)lut.count,
+        (unsigned)lut.reachable_count, c_float(lut.max_err_deg).c_str(),
+        (unsigned)lut.edge_cells, (unsigned)lut.uncovered,
+        (unsigned)lut.spurious);
+
+    for (unsigned i = 0; i < lut.count; ++i)
+    {
+        std::fprintf(f, "        {");
+        for (int k = 0; k < IK_NUM_JOINTS; ++k)
+            std::fprintf(f, "%s%s", k ? ", " : " ",
+                         c_float(lut.joints[i][k]).c_str());
+        std::fprintf(f, " },\n");
+    }
+
+    std::fprintf(f, "    },\n    .reachable = {");
+    for (unsigned i = 0; i < lut.count; ++i)
+        std::fprintf(f, "%s%u,", i % 32 ? " " : "\n        ",
+                     (unsigned)lut.reachable[i]);
+    std::fprintf(f, "\n    },\n};\n\n#endif\n");
+
+    bool ok = std::fclose(f) == 0;
+    if (ok)
+        std::printf("[IK] wrote %s\n", path.c_str());
+    return ok;
+}
+
+static int run_ik_check(float step, float bound, const std::string& gen)
+{
+    static ik_lut_t lut;
+
+    auto t0 = std::chrono::steady_clock::now();
+    ik_lut_status_t st = ik_lut_build(&lut, step, bound);
+    if (st == IK_LUT_TOO_FINE)
+    {
+        std::printf("IK table: step %.3f needs more than %d entries\n",
+            step, IK_LUT_MAX_ENTRIES);
+        return 1;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    const int iters = 1000000;
+    float out[IK_NUM_JOINTS] = {};
+    volatile float sink = 0.0f;
+
+    auto t2 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i)
+    {
+        float a = IK_DISTAL_MIN_DEG +
+            (IK_DISTAL_MAX_DEG - IK_DISTAL_MIN_DEG) * (i % 3607) / 3607.0f;
+        if (ik_lut_lookup(&lut, a, out))
+            sink = sink + out[1];
+    }
+    auto t3 = std::chrono::steady_clock::now();
+
+    using us = std::chrono::microseconds;
+    using ns = std::chrono::nanoseconds;
+
+    std::printf("[IK] step=%.3f deg entries=%u reachable=%u bytes=%zu "
+                "build=%lld us\n",
+        step,
+        (unsigned)lut.count,
+        (unsigned)lut.reachable_count,
+        (size_t)lut.count * (sizeof(lut.joints[0]) + sizeof(lut.reachable[0])),
+        (long long)std::chrono::duration_cast<us>(t1 - t0).count());
+    std::printf("[IK] max_err=%.4f deg over %u samples/cell, edge_cells=%u "
+                "uncovered=%u spurious=%u lookup=%.1f ns\n",
+        lut.max_err_deg,
+        (unsigned)IK_LUT_CHECK_SAMPLES,
+        (unsigned)lut.edge_cells,
+        (unsigned)lut.uncovered,
+        (unsigned)lut.spurious,
+        (double)std::chrono::duration_cast<ns>(t3 - t2).count() / iters);
+
+    if (st == IK_LUT_OVER_BOUND)
+    {
+        std::printf("[IK] FAIL: max_err %.4f deg over the %.4f deg bound\n",
+            lut.max_err_deg, bound);
+        return 1;
+    }
+
+    if (!gen.empty() && !write_ik_table(lut, gen, step, bound))
+        return 1;
+
+    return 0;
+}
+
+// --------------------------------------------------
+// Options
+// --------------------------------------------------
+
+bool parse_options(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* a = argv[i];
+        bool has_val = (i + 1 < argc);
+
+        if (!std::strcmp(a, "--ik-check") && has_val)
+        {
+            char* end = nullptr;
+            opt.ik_check_step = std::strtof(argv[++i], &end);
+            if (*end == ',')
+                opt.ik_check_bound = std::strtof(end + 1, &end);
+
+            if (*end || !(opt.ik_check_step > 0.0f) ||
+                opt.ik_check_bound < 0.0f)
+            {
+                std::printf("bad --ik-check: %s\n", argv[i]);
+                return false;
+            }
+        }
+        else if (!std::strcmp(a, "--ik-gen") && has_val)
+            opt.ik_gen = argv[++i];
+        else if (!std::strcmp(a, "--codec-bench") && has_val)
+            opt.codec_bench_iters = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--haptics-bench") && has_val)
+            opt.haptics_bench_objects = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--haptics") && has_val)
+            opt.haptics = argv[++i];
+        else if (!std::strcmp(a, "--log-bench") && has_val)
+            opt.log_bench_iters = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--calib-bench") && has_val)
+            opt.calib_bench_frames = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--calib") && has_val)
+        {
+            std::string v = argv[++i];
+            size_t comma = v.find(',');
+            opt.calib = v.substr(0, comma);
+            if (comma != std::string::npos)
+                opt.calib_device = v.substr(comma + 1);
+        }
+        else if (!std::strcmp(a, "--log-raw") && has_val)
+            opt.log_raw = argv[++i];
+        else if (!std::strcmp(a, "--log-decode") && has_val)
+            opt.log_decode = argv[++i];
+        else if (!std::strcmp(a, "--trace") && has_val)
+            opt.trace = argv[++i];
+        else if (!std::strcmp(a, "--fw-stream-bench") && has_val)
+            opt.fw_stream_bench_hz = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--fw-cmd-bench") && has_val)
+            opt.fw_cmd_bench_frames = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--alloc-check") && has_val)
+        {
+            opt.alloc_check = true;
+            opt.alloc_check_warmup = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!std::strcmp(a, "--spin-us") && has_val)
+            opt.spin_us = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--run-secs") && has_val)
+            opt.run_secs = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--quiet"))
+            opt.quiet = true;
+        else if (!std::strcmp(a, "--edges"))
+            opt.edges_only = true;
+        else if (!std::strcmp(a, "--sim-hz") && has_val)
+            opt.sim_hz = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--probe") && has_val)
+        {
+            char* end = nullptr;
+            opt.probe_hz = (unsigned)std::strtoul(argv[++i], &end, 10);
+            if (*end == ',')
+                opt.probe_pad = (unsigned)std::strtoul(end + 1, &end, 10);
+
+            if (*end || !opt.probe_hz)
+            {
+                std::printf("bad --probe: %s\n", argv[i]);
+                return false;
+            }
+        }
+        else if (!std::strcmp(a, "--probe-timeout-ms") && has_val)
+            opt.probe_timeout_ms = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--sim-clock") && has_val)
+        {
+            SimClockConfig& c = opt.sim_clock;
+            char* end = nullptr;
+
+            c.offset_us = std::strtoll(argv[++i], &end, 10);
+            if (*end == ',')
+                c.skew_ppm = std::strtod(end + 1, &end);
+            if (*end == ',')
+                c.drift_ppm_per_s = std::strtod(end + 1, &end);
+
+            if (*end)
+            {
+                std::printf("bad --sim-clock: %s\n", argv[i]);
+                return false;
+            }
+        }
+        else if (!std::strcmp(a, "--cpu-rx") && has_val)
+            opt.rx_rt.cpu = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--cpu-parser") && has_val)
+            opt.parser_rt.cpu = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--cpu-tx") && has_val)
+            opt.tx_rt.cpu = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--rt-policy") && has_val)
+        {
+            RtPolicy pol;
+            if (!rt_parse_policy(argv[++i], pol))
+            {
+                std::printf("bad --rt-policy: %s\n", argv[i]);
+                return false;
+            }
+            opt.rx_rt.policy = opt.parser_rt.policy = opt.tx_rt.policy = pol;
+        }
+        else if (!std::strcmp(a, "--rt-prio") && has_val)
+        {
+            // parser and rx sit on the data path, heartbeat one level below
+            int prio = std::atoi(argv[++i]);
+            opt.rx_rt.priority = prio;
+            opt.parser_rt.priority = prio;
+            opt.tx_rt.priority = prio > 1 ? prio - 1 : prio;
+        }
+        else if (!std::strcmp(a, "--mlock"))
+            opt.mlock = true;
+        else if (!std::strcmp(a, "--mode") && has_val)
+        {
+            const char* m = argv[++i];
+            opt.run_to_completion = false;
+            opt.reactor = false;
+
+            if (!std::strcmp(m, "rtc"))
+                opt.run_to_completion = true;
+            else if (!std::strcmp(m, "reactor"))
+                opt.reactor = true;
+            else if (!std::strcmp(m, "threaded"))
+                opt.run_to_completion = false;
+            else
+            {
+                std::printf("bad --mode: %s\n", m);
+                return false;
+            }
+        }
+        else if (!std::strcmp(a, "--busy-poll"))
+            opt.busy_poll = true;
+        else if (!std::strcmp(a, "--streams") && has_val)
+            opt.streams = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--workers") && has_val)
+            opt.workers = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if ((!std::strcmp(a, "--queue") ||
+                  !std::strcmp(a, "--transport-queue")) && has_val)
+        {
+            QueueConfig& q = !std::strcmp(a, "--queue")
+                ? opt.pipe_queue : opt.transport_queue;
+
+            char* end = nullptr;
+            q.capacity = std::strtoul(argv[++i], &end, 10);
+
+            if (*end == ',' && !parse_overload_policy(end + 1, q.policy))
+            {
+                std::printf("bad queue policy: %s\n", end + 1);
+                return false;
+            }
+        }
+        else if (!std::strcmp(a, "--fanout") && has_val)
+        {
+            std::string list = argv[++i];
+            size_t pos = 0;
+
+            while (pos <= list.size())
+            {
+                size_t comma = list.find(',', pos);
+                if (comma == std::string::npos) comma = list.size();
+
+                std::string spec = list.substr(pos, comma - pos);
+                if (!fanout_spec_valid(spec))
+                {
+                    std::printf("bad --fanout consumer: %s\n", spec.c_str());
+                    return false;
+                }
+
+                opt.fanout.push_back(spec);
+                pos = comma + 1;
+            }
+        }
+        else if (!std::strcmp(a, "--stream") && has_val)
+        {
+            char* end = nullptr;
+            opt.stream.port = (uint16_t)std::strtoul(argv[++i], &end, 10);
+            if (*end == ',')
+                opt.stream.bind_addr = end + 1;
+            opt.stream.tcp = true;
+        }
+        else if (!std::strcmp(a, "--stream-mcast") && has_val)
+        {
+            std::string v = argv[++i];
+            size_t colon = v.rfind(':');
+            if (colon == std::string::npos)
+            {
+                std::printf("bad --stream-mcast, want <group>:<port>: %s\n",
+                    v.c_str());
+                return false;
+            }
+            opt.stream.mcast_group = v.substr(0, colon);
+            opt.stream.mcast_port =
+                (uint16_t)std::strtoul(v.c_str() + colon + 1, nullptr, 10);
+        }
+        else if (!std::strcmp(a, "--stream-queue") && has_val)
+        {
+            char* end = nullptr;
+            opt.stream.queue_frames = std::strtoul(argv[++i], &end, 10);
+
+            if (*end == ',')
+            {
+                if (!std::strcmp(end + 1, "drop"))
+                    opt.stream.slow = StreamServerConfig::Slow::drop;
+                else if (!std::strcmp(end + 1, "downsample"))
+                    opt.stream.slow = StreamServerConfig::Slow::downsample;
+                else
+                {
+                    std::printf("bad slow client policy: %s\n", end + 1);
+                    return false;
+                }
+            }
+        }
+        else if (!std::strcmp(a, "--stream-bench") && has_val)
+            opt.stream_bench_clients = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--fanout-ring") && has_val)
+            opt.fanout_ring = std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--resample") && has_val)
+        {
+            char* p = argv[++i];
 
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(10)); // 100 Hz
+            for (;;)
+            {
+                char* end = nullptr;
+                unsigned long hz = std::strtoul(p, &end, 10);
+                if (end == p || !hz)
+                {
+                    std::printf("bad --resample rate: %s\n", p);
+                    return false;
+                }
+
+                opt.resample_hz.push_back((unsigned)hz);
+
+                if (*end != ',')
+                    break;
+                p = end + 1;
+            }
+        }
+        else if (!std::strcmp(a, "--resample-delay-us") && has_val)
+            opt.resample_delay_us = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--mem-budget") && has_val)
+            opt.mem_budget = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--handler-delay-us") && has_val)
+            opt.handler_delay_us = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--usb-xfers") && has_val)
+            opt.usb_transfers = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--usb-xfer-size") && has_val)
+            opt.usb_xfer_size = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--usb-timeout-ms") && has_val)
+            opt.usb_timeout_ms = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--usb-adaptive"))
+            opt.usb_adaptive = true;
+        else if (!std::strcmp(a, "--metrics-file") && has_val)
+            opt.metrics_file = argv[++i];
+        else if (!std::strcmp(a, "--metrics-sock") && has_val)
+            opt.metrics_sock = argv[++i];
+        else if (!std::strcmp(a, "--metrics-period-ms") && has_val)
+            opt.metrics_period_ms = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::printf("unknown option: %s\n", a);
+            return false;
+        }
     }
+    return true;
 }
 
 // --------------------------------------------------
 // MAIN
 // --------------------------------------------------
 
-int main()
+int main(int argc, char** argv)
 {
     Runtime rt;
 
+    if (!parse_options(argc, argv, rt.opt))
+        return 1;
+
+    if (!rt.opt.ik_gen.empty() && !(rt.opt.ik_check_step > 0.0f))
+    {
+        std::printf("--ik-gen needs --ik-check <step>[,<max_err>]\n");
+        return 1;
+    }
+
+    // rtc, reactor and probe runs poll the transport from the thread that
+    // drains its queue, so that producer can never wait for room
+    if (rt.opt.transport_queue.policy == OverloadPolicy::Block &&
+        (rt.opt.run_to_completion || rt.opt.reactor || rt.opt.probe_hz))
+    {
+        std::printf("--transport-queue block needs --mode threaded\n");
+        return 1;
+    }
+
+    if (rt.opt.ik_check_step > 0.0f)
+        return run_ik_check(rt.opt.ik_check_step, rt.opt.ik_check_bound,
+                            rt.opt.ik_gen);
+
+    if (rt.opt.codec_bench_iters)
+        return run_codec_bench(rt.opt.codec_bench_iters);
+
+    if (rt.opt.haptics_bench_objects)
+        return run_haptics_bench(rt.opt.haptics_bench_objects);
+
+    if (rt.opt.log_bench_iters)
+        return run_log_bench(rt.opt.log_bench_iters);
+
+    if (rt.opt.calib_bench_frames)
+        return run_calib_bench(rt.opt.calib_bench_frames);
+
+    if (rt.opt.stream_bench_clients)
+        return run_stream_bench(rt.opt.stream_bench_clients, rt.opt.sim_hz,
+                                rt.opt.run_secs, rt.opt.stream);
+
+    if (!rt.opt.log_decode.empty())
+        return log_decode(rt.opt.log_decode.c_str());
+
+    if (rt.opt.fw_stream_bench_hz)
+        return run_fw_stream_bench(rt.opt.fw_stream_bench_hz);
+
+    if (rt.opt.fw_cmd_bench_frames)
+        return run_fw_cmd_bench(rt.opt.fw_cmd_bench_frames);
+
+    rt.handler.quiet = rt.opt.quiet;
+    rt.handler.edges_only = rt.opt.edges_only;
+    rt.handler.delay_us = rt.opt.handler_delay_us;
+    rt.heartbeat.spin_ns = rt.opt.spin_us * 1000;
+
+    rt.budget.limit = rt.opt.mem_budget;
+    rt.queue.configure(rt.opt.pipe_queue, &rt.budget);
+
+    // blocks for full queues up front, so an overload does not go back to
+    // the heap: transport reads are large chunks, sim frames small ones
+    chunk_pools().large.reserve(rt.opt.pipe_queue.capacity +
+                                rt.opt.transport_queue.capacity + 16);
+    chunk_pools().small.reserve(rt.opt.transport_queue.capacity + 16);
+
+    rt.metric_fns.push_back(metrics().gauge_fn("soupy_clock_offset_us",
+        "Estimated device minus host clock", "",
+        [&rt]{ return rt.handler.clock.offset_us(); }));
+    rt.metric_fns.push_back(metrics().gauge_fn("soupy_clock_skew_ppm",
+        "Estimated device clock rate error", "",
+        [&rt]{ return rt.handler.clock.skew_ppm(); }));
+    rt.metric_fns.push_back(metrics().gauge_fn("soupy_clock_min_rtt_us",
+        "Fastest heartbeat round trip in the sync window", "",
+        [&rt]{ return rt.handler.clock.min_delay_us(); }));
+
+    rt.metric_fns.push_back(metrics().gauge_fn("soupy_queue_memory_bytes",
+        "Bytes held by all pipeline queues", "",
+        [&rt]{ return (double)rt.budget.used(); }));
+
+    if (!rt.opt.haptics.empty())
+    {
+        rt.scene = std::make_unique<HapticScene>();
+
+        if (!rt.opt.haptics.compare(0, 7, "random:"))
+            rt.scene->add_random(std::strtoul(rt.opt.haptics.c_str() + 7,
+                                              nullptr, 10), 1);
+        else if (!rt.scene->load(rt.opt.haptics))
+            return 1;
+
+        rt.scene->build();
+        rt.haptics = std::make_unique<HapticEngine>(*rt.scene);
+
+        std::printf("[HAPTIC] scene: objects=%zu primitives=%zu planes=%zu "
+                    "nodes=%zu\n",
+            rt.scene->objects(), rt.scene->primitives(),
+            rt.scene->planes(), rt.scene->nodes());
+    }
+
+    if (!rt.opt.calib.empty())
+    {
+        CalibrationFile file;
+        if (!file.load(rt.opt.calib))
+            return 1;
+
+        const DeviceCalib* dev = file.find(rt.opt.calib_device);
+        if (!dev)
+        {
+            std::printf("[CALIB] no device '%s' in %s\n",
+                rt.opt.calib_device.c_str(), rt.opt.calib.c_str());
+            return 1;
+        }
+
+        rt.calib = std::make_unique<Calibration>(*dev);
+        rt.calib_stage = std::make_unique<CalibratingHandler>(
+            *rt.calib, rt.handler);
+
+        std::printf("[CALIB] device=%s kernel=%s\n",
+            rt.calib->device().c_str(),
+            Calibration::kernel_name(rt.calib->kernel));
+    }
+
+    TransportConfig tcfg;
+    tcfg.rx_queue    = rt.opt.transport_queue;
+    tcfg.budget      = &rt.budget;
+    tcfg.sim_rate_hz = rt.opt.sim_hz;
+    tcfg.sim_clock   = rt.opt.sim_clock;
+    tcfg.spin_us     = rt.opt.spin_us;
+
+    tcfg.usb_transfers  = rt.opt.usb_transfers;
+    tcfg.usb_xfer_size  = rt.opt.usb_xfer_size;
+    tcfg.usb_timeout_ms = rt.opt.usb_timeout_ms;
+    tcfg.usb_adaptive   = rt.opt.usb_adaptive;
+
+    // mlockall faults in what is mapped now, but if it fails (no
+    // CAP_IPC_LOCK) the queue and pool storage is still touched here
+    // rather than on the first burst
+    if (rt.opt.mlock)
+    {
+        rt_lock_memory();
+        tcfg.prefault = true;
+        rt.queue.prefault();
+        chunk_pools().small.prefault();
+        chunk_pools().large.prefault();
+    }
+
+    if (rt.opt.reactor)
+        return run_reactor(rt, tcfg);
+
+    // an unpaced sim would bury the echoes under finger packets
+    if (rt.opt.probe_hz && !tcfg.sim_rate_hz)
+        tcfg.sim_rate_hz = 1000;
+
 #ifdef USE_SIM
     std::printf("Running SIM transport\n");
-    rt.transport = std::make_unique<SimTransport>();
+    rt.transport = std::make_unique<SimTransport>(tcfg);
+    rt.handler.host_timestamps = rt.opt.sim_clock.ideal();
 #elif defined(USE_USB)
     std::printf("Running USB transport\n");
-    rt.transport = std::make_unique<USBTransport>();
+    rt.transport = std::make_unique<USBTransport>(tcfg);
+#ifdef USE_FAKE_USB
+    // the fake device stamps packets with host steady_clock time
+    rt.handler.host_timestamps = true;
+#endif
 #else
     std::printf("No transport defined\n");
     return 1;
 #endif
 
+    rt.transport->set_polled(rt.opt.run_to_completion || rt.opt.probe_hz);
+
     if (!rt.transport->open())
     {
         std::printf("Transport open failed\n");
         return 1;
     }
 
-    std::thread rx(rx_thread_fn, std::ref(rt));
-    std::thread parser(parser_thread_fn, std::ref(rt));
-    std::thread tx(tx_thread_fn, std::ref(rt));
+    if (rt.opt.probe_hz)
+    {
+        RttProbeConfig pc;
+        pc.rate_hz    = rt.opt.probe_hz;
+        pc.pad        = rt.opt.probe_pad;
+        pc.secs       = rt.opt.run_secs ? rt.opt.run_secs : 5;
+        pc.timeout_ms = rt.opt.probe_timeout_ms;
+
+        int rc = run_rtt_probe(*rt.transport, pc);
+        rt.transport->close();
+        return rc;
+    }
+
+    if (rt.opt.log_raw.empty())
+        log_start(LogMode::text);
+    else if (!log_start(LogMode::raw, rt.opt.log_raw.c_str()))
+        return 1;
+
+    if (!rt.opt.metrics_file.empty() || !rt.opt.metrics_sock.empty())
+        rt.exporter.start(rt.opt.metrics_file, rt.opt.metrics_sock,
+                          rt.opt.metrics_period_ms);
+
+    std::vector<FrameRing::Consumer*> consumers;
+
+    bool streaming = rt.opt.stream.tcp || !rt.opt.stream.mcast_group.empty();
+
+    if (!rt.opt.fanout.empty() || streaming)
+    {
+        rt.fanout = std::make_unique<FrameRing>(rt.opt.fanout_ring);
+
+        for (const std::string& spec : rt.opt.fanout)
+        {
+            // logger:/tmp/x.csv -> "logger"; repeats get a numeric suffix
+            std::string name = spec.substr(0, spec.find(':'));
+            for (FrameRing::Consumer* c : consumers)
+                if (c->name() == name)
+                    name += std::to_string(consumers.size());
+
+            consumers.push_back(&rt.fanout->add_consumer(name));
+        }
+
+        if (streaming)
+        {
+            rt.stream = std::make_unique<StreamServer>(
+                rt.fanout->add_consumer("stream"), rt.opt.stream);
+            if (!rt.stream->start())
+                return 1;
+
+            if (rt.opt.stream.tcp)
+                std::printf("[STREAM] listening on %s:%u\n",
+                    rt.opt.stream.bind_addr.c_str(), (unsigned)rt.stream->port());
+            if (!rt.opt.stream.mcast_group.empty())
+                std::printf("[STREAM] multicast to %s:%u\n",
+                    rt.opt.stream.mcast_group.c_str(),
+                    (unsigned)rt.opt.stream.mcast_port);
+        }
+
+        if (rt.opt.mlock)
+            rt.fanout->prefault();
+        rt.handler.fanout = rt.fanout.get();
+    }
+
+    if (!rt.opt.resample_hz.empty() || rt.haptics)
+    {
+        rt.resampler = std::make_unique<Resampler>(rt.opt.resample_delay_us);
+        rt.resampler->spin_us = rt.opt.spin_us;
+
+        for (unsigned hz : rt.opt.resample_hz)
+        {
+            bool print = !rt.opt.quiet;
+
+            rt.resampler->add_output(hz, [hz, print](const ResampledFrame& f) {
+                if (!print)
+                    return;
+
+                SOUPY_LOG("[RESAMPLED] hz=%u tick=%llu sample_us=%llu "
+                          "count=%u%s\n",
+                    hz,
+                    (unsigned long long)f.tick,
+                    (unsigned long long)f.sample_us,
+                    (unsigned)f.count,
+                    f.held ? " held" : "");
+            });
+        }
+
+        if (rt.haptics)
+            rt.resampler->add_output(HAPTIC_RATE_HZ,
+                [&rt](const ResampledFrame& f) { haptic_tick(rt, f); });
+
+        rt.handler.resampler = rt.resampler.get();
+        rt.resampler->start();
+    }
+
+    if (!rt.opt.trace.empty())
+    {
+        trace_install_dump_signal();
+        trace_start();
+    }
+
+    auto wall0 = std::chrono::steady_clock::now();
+    std::clock_t cpu0 = std::clock();
+
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < consumers.size(); ++i)
+        threads.emplace_back(fanout_thread_fn, std::ref(rt),
+                             std::ref(*consumers[i]),
+                             std::cref(rt.opt.fanout[i]));
+
+    if (rt.opt.run_to_completion)
+    {
+        threads.emplace_back(rtc_thread_fn, std::ref(rt));
+    }
+    else
+    {
+        threads.emplace_back(rx_thread_fn, std::ref(rt));
+        threads.emplace_back(parser_thread_fn, std::ref(rt));
+        threads.emplace_back(tx_thread_fn, std::ref(rt));
+    }
+
+    unsigned run_secs = rt.opt.run_secs;
+    if (rt.opt.alloc_check && !run_secs)
+        run_secs = rt.opt.alloc_check_warmup + 5;
 
     // demo loop
-    for (;;)
+    for (unsigned t = 0; run_secs == 0 || t < run_secs; ++t)
+    {
+        if (rt.opt.alloc_check && t == rt.opt.alloc_check_warmup)
+            alloc_track_arm();
+
         std::this_thread::sleep_for(std::chrono::seconds(1));
 
+        if (!rt.opt.trace.empty() && trace_dump_requested())
+            trace_write(rt.opt.trace.c_str());
+    }
+
+    if (rt.opt.alloc_check)
+        alloc_track_disarm();
+
     // cleanup
     rt.running.store(false);
-    rt.cv.notify_all();
+    rt.queue.wake_all();
 
-    rx.join();
-    parser.join();
-    tx.join();
+    for (auto& t : threads)
+        t.join();
+
+    if (rt.resampler)
+        rt.resampler->stop();
+
+    if (rt.stream)
+        rt.stream->stop();
+
+    if (!rt.opt.trace.empty())
+    {
+        trace_stop();
+        trace_write(rt.opt.trace.c_str());
+    }
+
+    log_stop();
+
+    rt.exporter.stop();
+
+    double cpu_s  = (double)(std::clock() - cpu0) / CLOCKS_PER_SEC;
+    double wall_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall0).count();
 
     rt.transport->close();
+
+    if (!rt.opt.run_to_completion)
+        rt.queue.print_stats();
+
+    if (rt.heartbeat.ticks())
+        rt.heartbeat.print();
+
+    if (rt.fanout)
+        rt.fanout->print_stats();
+
+    if (rt.stream)
+        rt.stream->print_stats();
+
+    if (rt.resampler)
+        rt.resampler->print_stats();
+
+    if (rt.haptics)
+    {
+        std::printf("[HAPTIC] ticks=%llu tree queries=%llu cache reuses=%llu "
+                    "contacts=%llu\n",
+            (unsigned long long)rt.haptics->ticks,
+            (unsigned long long)rt.haptics->queries,
+            (unsigned long long)rt.haptics->reuses,
+            (unsigned long long)rt.haptics->contacts);
+        haptic_step_ns().print("HAPTIC step", "ns");
+    }
+
+    std::printf("[MEM] budget=%zu peak=%zu bytes\n",
+        rt.budget.limit, rt.budget.peak());
+
+    std::printf("[CPU] mode=%s cpu=%.2fs wall=%.2fs (%.0f%% of one core)\n",
+        rt.opt.run_to_completion
+            ? (rt.opt.busy_poll ? "rtc+busy" : "rtc")
+            : "threaded",
+        cpu_s, wall_s, 100.0 * cpu_s / wall_s);
+
+    if (rt.handler.clock.samples())
+        rt.handler.clock.print();
+
+    if (rt.handler.edges.frames())
+        rt.handler.edges.print();
+
+    if (rt.handler.latency_us.count())
+        rt.handler.latency_us.print("LATENCY", "us");
+
+    if (rt.opt.alloc_check)
+        return report_alloc_check(rt.opt.alloc_check_warmup, run_secs);
+
     return 0;
 }
\ No newline at end of file
@@ -1,61 +1,307 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
-#include <deque>
-#include <mutex>
-#include <condition_variable>
 #include <atomic>
 
 #include "transport.hpp"
 #include "protocol.hpp"
-
-// --------------------------------------------------
-// RX → parser chunk
-// --------------------------------------------------
-
-struct Chunk
-{
-    std::vector<uint8_t> bytes;
-};
+#include "frame_queue.hpp"
+#include "realtime.hpp"
+#include "stats.hpp"
+#include "metrics.hpp"
+#include "clock_sync.hpp"
+#include "state_edges.hpp"
+#include "frame_ring.hpp"
+#include "resampler.hpp"
+#include "haptics.hpp"
+#include "calibration.hpp"
+#include "stream_server.hpp"
+#include "periodic.hpp"
 
 // --------------------------------------------------
 // Application packet handler
 // --------------------------------------------------
 
-class AppPacketHandler : public PacketHandler
+class AppPacketHandler : public PacketHandler, public StateEdgeListener
 {
 public:
+    AppPacketHandler() { edges.subscribe(this); }
+
+    // suppress per-packet printing
+    bool quiet = false;
+
+    // print state edge events instead of whole frames
+    bool edges_only = false;
+
+    // finger timestamps are host steady_clock microseconds (sim/fake with
+    // an ideal device clock); otherwise they go through 'clock'
+    bool host_timestamps = false;
+
+    // device -> host time, fed by heartbeat time replies
+    ClockSync clock;
+
+    // touch / release events from state_array changes
+    StateEdgeTracker edges;
+
+    LatencyHistogram& latency_us = metrics().histogram(
+        "soupy_pipeline_latency_us",
+        "Device timestamp (in host time) to handler dispatch latency");
+
+    Counter& finger_packets = metrics().counter(
+        "soupy_packets_total", "Packets dispatched", "type=\"finger\"");
+    Counter& unknown_packets = metrics().counter(
+        "soupy_packets_total", "Packets dispatched", "type=\"unknown\"");
+    Counter& state_edges = metrics().counter(
+        "soupy_state_edges_total", "Finger state bits that changed");
+    Counter& crc_errors = metrics().counter(
+        "soupy_crc_errors_total", "Framed packets dropped on CRC mismatch");
+
+    // artificial per-packet work, to exercise the overload policies
+    unsigned delay_us = 0;
+
+    // decoded frames for the fan-out consumers, if any
+    FrameRing* fanout = nullptr;
+
+    // fixed-rate outputs, if any; fed frames in host time
+    Resampler* resampler = nullptr;
+
     void on_finger_packet(
         uint16_t seq,
         uint64_t timestamp,
-        const FingerData* fingers,
-        uint8_t count) override;
+        const FingerArrayView& fingers) override;
 
     void on_unknown(
         uint8_t type,
         uint16_t seq,
         const uint8_t* payload,
         uint16_t len) override;
+
+    void on_time_reply(
+        uint16_t seq,
+        uint64_t host_tx_us,
+        uint64_t dev_rx_us,
+        uint64_t dev_tx_us) override;
+
+    void on_bad_crc(uint8_t type, uint16_t seq) override;
+
+    void on_state_edges(const StateEdge* e, size_t count) override;
+};
+
+// --------------------------------------------------
+// Command line options
+// --------------------------------------------------
+
+struct Options
+{
+    // --ik-check <step>[,<max_err>]: build the IK table, report error and
+    // exit (nonzero if the error is over max_err degrees)
+    float ik_check_step = 0.0f;
+    float ik_check_bound = 0.0f;
+
+    // --ik-gen <file>: with --ik-check, write the table as a C header
+    std::string ik_gen;
+
+    // --fw-stream-bench <hz>: run firmware/stream.c against a USB model
+    unsigned fw_stream_bench_hz = 0;
+
+    // --fw-cmd-bench <frames>: run firmware/cmd.c on split, junk-laden and
+    // fuzzed command streams
+    unsigned fw_cmd_bench_frames = 0;
+
+    // --codec-bench <frames>: packet codec throughput
+    unsigned codec_bench_iters = 0;
+
+    // --haptics-bench <objects>: contact engine cost per tick
+    unsigned haptics_bench_objects = 0;
+
+    // --log-bench <calls>: SOUPY_LOG call cost
+    unsigned log_bench_iters = 0;
+
+    // --calib-bench <frames>: calibration kernels and stage throughput
+    unsigned calib_bench_frames = 0;
+
+    // --log-raw <path>: hot-path log records go to a raw file instead of
+    // being formatted; --log-decode <path>: print one as text and exit
+    std::string log_raw;
+    std::string log_decode;
+
+    // --trace <path>: record pipeline events (see trace.hpp) and write
+    // them as Chrome trace JSON at exit and on SIGUSR1
+    std::string trace;
+
+    // --probe <hz>[,<pad>]: measure link RTT with echoed probes for
+    // --run-secs (default 5) and exit; --probe-timeout-ms <n>
+    unsigned probe_hz = 0;
+    unsigned probe_pad = 0;
+    unsigned probe_timeout_ms = 100;
+
+    // --spin-us <n>: busy-wait the last n us before each periodic
+    // deadline (heartbeat, sim source, resampler), for less jitter
+    unsigned spin_us = 0;
+
+    // --run-secs <n>: stop after n seconds (0 = forever)
+    unsigned run_secs = 0;
+
+    // --alloc-check <warmup secs>: count heap allocations per thread once
+    // warmed up and fail if the pipeline made any (--run-secs, default 5)
+    unsigned alloc_check_warmup = 0;
+    bool alloc_check = false;
+
+    // --quiet: no per-packet output
+    bool quiet = false;
+
+    // --edges: print finger state changes instead of every frame
+    bool edges_only = false;
+
+    // --sim-hz <n>: sim packet rate (0 = unpaced)
+    unsigned sim_hz = 0;
+
+    // --sim-clock <offset_us>,<skew_ppm>[,<drift_ppm_per_s>]: sim device
+    // clock error, exercises clock sync
+    SimClockConfig sim_clock;
+
+    // --cpu-{rx,parser,tx} <n>, --rt-policy fifo|rr, --rt-prio <n>
+    ThreadRtConfig rx_rt;
+    ThreadRtConfig parser_rt;
+    ThreadRtConfig tx_rt;
+
+    // --mlock: prefault and lock all memory
+    bool mlock = false;
+
+    // --mode rtc: one thread polls the transport, parses and sends
+    // heartbeats (uses the rx thread settings); default is threaded
+    bool run_to_completion = false;
+
+    // --busy-poll: rtc loop never sleeps
+    bool busy_poll = false;
+
+    // --mode reactor: --streams sim transports served by a pool of
+    // --workers threads (see reactor.hpp)
+    bool reactor = false;
+    unsigned streams = 64;
+    unsigned workers = 2;
+
+    // --queue <cap>,<policy>: rx → parser queue
+    // --transport-queue <cap>,<policy>: transport internal RX queue
+    // policy: block | drop-newest | drop-oldest | coalesce
+    QueueConfig pipe_queue;
+    QueueConfig transport_queue;
+
+    // --mem-budget <bytes>: cap on bytes held by all queues (0 = none)
+    size_t mem_budget = 0;
+
+    // --handler-delay-us <n>: simulate a slow consumer
+    unsigned handler_delay_us = 0;
+
+    // --fanout <c>[,<c>...]: consumer threads reading decoded frames from
+    // a multicast ring; c = logger:<csv path> | filter | slow:<us>
+    // --fanout-ring <n>: ring slots
+    std::vector<std::string> fanout;
+    size_t fanout_ring = 1024;
+
+    // --stream <port>[,<bind addr>]: serve decoded frames to TCP clients
+    // in the wire format (see stream_server.hpp)
+    // --stream-mcast <group>:<port>: and to a UDP multicast group
+    // --stream-queue <frames>[,drop|downsample]: per-client backlog bound
+    // and what happens to a client that passes it
+    // --stream-bench <clients>: loopback clients at --sim-hz (default
+    // 1000) for --run-secs (default 5), report latency and server CPU
+    StreamServerConfig stream;
+    unsigned stream_bench_clients = 0;
+
+    // --resample <hz>[,<hz>...]: one interpolated frame per tick at each
+    // rate (see resampler.hpp); --resample-delay-us <n>: jitter buffer
+    // delay, the most latency it adds
+    std::vector<unsigned> resample_hz;
+    unsigned resample_delay_us = 2000;
+
+    // --haptics <scene file>|random:<n>: contact forces against the scene
+    // (see haptics.hpp) on a 1 kHz resampled output, sent to the device
+    std::string haptics;
+
+    // --calib <file>[,<device>]: calibrate finger frames before the
+    // handler (see calibration.hpp); device defaults to "default".
+    // Threaded and rtc modes; the reactor streams are not calibrated
+    std::string calib;
+    std::string calib_device = "default";
+
+    // --usb-xfers <n>, --usb-xfer-size <bytes>, --usb-timeout-ms <n>,
+    // --usb-adaptive: bulk IN transfer pool
+    int      usb_transfers = 8;
+    int      usb_xfer_size = 1024;
+    unsigned usb_timeout_ms = 0;
+    bool     usb_adaptive = false;
+
+    // --metrics-file <path>: rewrite Prometheus text every period
+    // --metrics-sock <path>: serve it on a Unix socket
+    // --metrics-period-ms <n>
+    std::string metrics_file;
+    std::string metrics_sock;
+    unsigned metrics_period_ms = 1000;
 };
 
+bool parse_options(int argc, char** argv, Options& opt);
+
 // --------------------------------------------------
 // Runtime container
 // --------------------------------------------------
 
+static constexpr unsigned HEARTBEAT_HZ = 100;
+
 struct Runtime
 {
+    Options opt;
+
     std::unique_ptr<ITransport> transport;
 
     std::atomic<bool> running{true};
 
+    // heartbeat deadlines, for the tx thread or the rtc loop
+    PeriodicTimer heartbeat{"heartbeat", HEARTBEAT_HZ, Overrun::skip};
+
+    // shared by every pipeline queue; declared before them so it
+    // outlives their destructors
+    MemoryBudget budget;
+
     // RX → parser queue
-    std::mutex m;
-    std::condition_variable cv;
-    std::deque<Chunk> queue;
+    FrameQueue queue{"rx->parser"};
+
+    // parser → fan-out consumers (--fanout)
+    std::unique_ptr<FrameRing> fanout;
+
+    // network clients (--stream, --stream-mcast), a fan-out consumer
+    std::unique_ptr<StreamServer> stream;
+
+    // contact forces (--haptics), driven by the resampler
+    std::unique_ptr<HapticScene> scene;
+    std::unique_ptr<HapticEngine> haptics;
+
+    // parser → fixed-rate outputs (--resample, --haptics); declared
+    // before the handler that feeds it
+    std::unique_ptr<Resampler> resampler;
 
     // handler
     AppPacketHandler handler;
+
+    // parser → calibration → handler (--calib); declared after the
+    // handler it forwards to
+    std::unique_ptr<Calibration> calib;
+    std::unique_ptr<CalibratingHandler> calib_stage;
+
+    // where the parser dispatches
+    PacketHandler& sink()
+    {
+        if (calib_stage)
+            return *calib_stage;
+        return handler;
+    }
+
+    MetricsExporter exporter;
+
+    // sampled metrics reading the members above; unregistered first
+    std::vector<MetricFn> metric_fns;
 };
 
 // --------------------------------------------------
@@ -64,4 +310,7 @@ struct Runtime
 
 void rx_thread_fn(Runtime& rt);
 void parser_thread_fn(Runtime& rt);
-void tx_thread_fn(Runtime& rt);
\ No newline at end of file
+void tx_thread_fn(Runtime& rt);
+void rtc_thread_fn(Runtime& rt);
+void fanout_thread_fn(Runtime& rt, FrameRing::Consumer& c,
+                      const std::string& spec);
\ No newline at end of file
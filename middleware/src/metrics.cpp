@@ -0,0 +1,439 @@
+#include "metrics.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdarg>
+#include <cerrno>
+#include <chrono>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// --------------------------------------------------
+// Registry
+// --------------------------------------------------
+
+MetricsRegistry& metrics()
+{
+    static MetricsRegistry r;
+    return r;
+}
+
+MetricsRegistry::Entry& MetricsRegistry::find_or_add(
+    const char* name, const char* help, const char* labels, Kind kind)
+{
+    std::lock_guard<std::mutex> lk(m);
+
+    for (auto& e : entries)
+        if (e->name == name && e->labels == labels)
+            return *e;
+
+    auto e = std::make_shared<Entry>();
+    e->name   = name;
+    e->help   = help;
+    e->labels = labels;
+    e->kind   = kind;
+
+    if (kind == Kind::Histogram)
+        e->hist = std::make_unique<LatencyHistogram>();
+
+    entries.push_back(std::move(e));
+    return *entries.back();
+}
+
+MetricFn MetricsRegistry::add_fn(
+    const char* name, const char* help, const char* labels, Kind kind,
+    std::function<double()> fn)
+{
+    auto e = std::make_shared<Entry>();
+    e->name = name;
+    e->help = help;
+    e->kind = kind;
+    e->fn   = std::move(fn);
+
+    std::lock_guard<std::mutex> lk(m);
+
+    // one series per registration: a repeated name + labels (the same
+    // queue name in many transports, say) gets an instance label
+    std::string base = labels;
+    e->labels = base;
+
+    for (unsigned n = 1; ; ++n)
+    {
+        bool taken = false;
+        for (auto& o : entries)
+            if (o->name == e->name && o->labels == e->labels)
+                taken = true;
+        if (!taken)
+            break;
+
+        e->labels = base + (base.empty() ? "" : ",") +
+                    "instance=\"" + std::to_string(n) + "\"";
+    }
+
+    e->fn_id = next_fn_id++;
+    entries.push_back(e);
+    return MetricFn(e->fn_id);
+}
+
+void MetricsRegistry::remove_fn(uint64_t id)
+{
+    std::shared_ptr<Entry> e;
+    {
+        std::lock_guard<std::mutex> lk(m);
+
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if ((*it)->fn_id == id)
+            {
+                e = *it;
+                entries.erase(it);
+                break;
+            }
+    }
+    if (!e)
+        return;
+
+    // a render() may have taken the entry before it was erased
+    std::lock_guard<std::mutex> lk(e->fn_m);
+    e->fn = nullptr;
+}
+
+MetricFn& MetricFn::operator=(MetricFn&& o) noexcept
+{
+    if (this != &o)
+    {
+        reset();
+        id = o.id;
+        o.id = 0;
+    }
+    return *this;
+}
+
+void MetricFn::reset()
+{
+    if (id)
+        metrics().remove_fn(id);
+    id = 0;
+}
+
+Counter& MetricsRegistry::counter(
+    const char* name, const char* help, const char* labels)
+{
+    return find_or_add(name, help, labels, Kind::Counter).counter;
+}
+
+Gauge& MetricsRegistry::gauge(
+    const char* name, const char* help, const char* labels)
+{
+    return find_or_add(name, help, labels, Kind::Gauge).gauge;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(
+    const char* name, const char* help, const char* labels)
+{
+    return *find_or_add(name, help, labels, Kind::Histogram).hist;
+}
+
+MetricFn MetricsRegistry::gauge_fn(
+    const char* name, const char* help, const char* labels,
+    std::function<double()> fn)
+{
+    return add_fn(name, help, labels, Kind::GaugeFn, std::move(fn));
+}
+
+MetricFn MetricsRegistry::counter_fn(
+    const char* name, const char* help, const char* labels,
+    std::function<double()> fn)
+{
+    return add_fn(name, help, labels, Kind::CounterFn, std::move(fn));
+}
+
+// --------------------------------------------------
+// Prometheus rendering
+// --------------------------------------------------
+
+static void append(std::string& out, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void append(std::string& out, const char* fmt, ...)
+{
+    char line[512];
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = std::vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+
+    if (n > 0)
+        out.append(line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+}
+
+// name{labels} or name{labels,extra}
+static std::string series(const std::string& name, const std::string& labels,
+                          const char* suffix = "", const char* extra = "")
+{
+    std::string s = name + suffix;
+
+    if (labels.empty() && !*extra)
+        return s;
+
+    s += '{';
+    s += labels;
+    if (!labels.empty() && *extra) s += ',';
+    s += extra;
+    s += '}';
+    return s;
+}
+
+static void render_histogram(std::string& out, const std::string& name,
+                             const std::string& labels,
+                             const LatencyHistogram& h)
+{
+    // collapse the log-linear buckets into powers of two for 'le'
+    uint64_t cum = 0;
+    uint64_t count = h.count();
+    uint64_t max = h.max();
+    char le[48];
+
+    for (int b = 0; b < LatencyHistogram::BUCKETS; ++b)
+    {
+        cum += h.bucket_count(b);
+
+        uint64_t hi = LatencyHistogram::bucket_upper(b);
+        bool edge = ((hi + 1) & hi) == 0;   // hi = 2^k - 1
+
+        if (edge)
+        {
+            std::snprintf(le, sizeof(le), "le=\"%llu\"", (unsigned long long)hi);
+            append(out, "%s %llu\n",
+                series(name, labels, "_bucket", le).c_str(),
+                (unsigned long long)cum);
+
+            if (hi >= max)
+                break;
+        }
+    }
+
+    append(out, "%s %llu\n",
+        series(name, labels, "_bucket", "le=\"+Inf\"").c_str(),
+        (unsigned long long)count);
+    append(out, "%s %llu\n",
+        series(name, labels, "_sum").c_str(),
+        (unsigned long long)h.total());
+    append(out, "%s %llu\n",
+        series(name, labels, "_count").c_str(),
+        (unsigned long long)count);
+}
+
+std::string MetricsRegistry::render() const
+{
+    std::string out;
+    out.reserve(4096);
+
+    // sampled functions read objects whose owners may be unregistering
+    // them, so they run outside the registry lock (see remove_fn)
+    std::deque<std::shared_ptr<Entry>> snap;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        snap = entries;
+    }
+
+    // families in registration order, all series of a family together
+    for (size_t i = 0; i < snap.size(); ++i)
+    {
+        const Entry& head = *snap[i];
+
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; ++j)
+            seen = (snap[j]->name == head.name);
+        if (seen)
+            continue;
+
+        const char* type =
+            head.kind == Kind::Histogram ? "histogram" :
+            (head.kind == Kind::Counter || head.kind == Kind::CounterFn)
+                ? "counter" : "gauge";
+
+        append(out, "# HELP %s %s\n", head.name.c_str(), head.help.c_str());
+        append(out, "# TYPE %s %s\n", head.name.c_str(), type);
+
+        for (size_t j = i; j < snap.size(); ++j)
+        {
+            const Entry& e = *snap[j];
+            if (e.name != head.name)
+                continue;
+
+            std::string s = series(e.name, e.labels);
+
+            switch (e.kind)
+            {
+            case Kind::Counter:
+                append(out, "%s %llu\n", s.c_str(),
+                    (unsigned long long)e.counter.value());
+                break;
+            case Kind::Gauge:
+                append(out, "%s %lld\n", s.c_str(),
+                    (long long)e.gauge.value());
+                break;
+            case Kind::GaugeFn:
+            case Kind::CounterFn:
+            {
+                std::lock_guard<std::mutex> lk(e.fn_m);
+                if (e.fn)   // unregistered since the copy
+                    append(out, "%s %.17g\n", s.c_str(), e.fn());
+                break;
+            }
+            case Kind::Histogram:
+                render_histogram(out, e.name, e.labels, *e.hist);
+                break;
+            }
+        }
+    }
+
+    return out;
+}
+
+// --------------------------------------------------
+// Exporter
+// --------------------------------------------------
+
+bool MetricsExporter::start(const std::string& file,
+                            const std::string& sock,
+                            unsigned period)
+{
+    file_path = file;
+    sock_path = sock;
+    period_ms = period ? period : 1000;
+
+#ifdef __linux__
+    if (!sock_path.empty())
+    {
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0)
+        {
+            std::printf("[METRICS] socket failed: %s\n", std::strerror(errno));
+            return false;
+        }
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, sock_path.c_str(), sizeof(addr.sun_path) - 1);
+
+        ::unlink(sock_path.c_str());
+        if (::bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+            ::listen(listen_fd, 8) != 0)
+        {
+            std::printf("[METRICS] bind %s failed: %s\n",
+                sock_path.c_str(), std::strerror(errno));
+            ::close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+    }
+#else
+    if (!sock_path.empty())
+    {
+        std::printf("[METRICS] unix socket not supported on this platform\n");
+        sock_path.clear();
+    }
+#endif
+
+    running.store(true);
+    worker = std::thread([this]{ loop(); });
+    return true;
+}
+
+void MetricsExporter::stop()
+{
+    if (!running.exchange(false))
+        return;
+
+    if (worker.joinable())
+        worker.join();
+
+#ifdef __linux__
+    if (listen_fd >= 0)
+    {
+        ::close(listen_fd);
+        ::unlink(sock_path.c_str());
+        listen_fd = -1;
+    }
+#endif
+}
+
+void MetricsExporter::loop()
+{
+    using clock = std::chrono::steady_clock;
+    auto next = clock::now();
+
+    while (running.load())
+    {
+        std::string text = metrics().render();
+
+        if (!file_path.empty())
+            write_file(text);
+
+        next += std::chrono::milliseconds(period_ms);
+
+        // answer scrapes until the next file rewrite
+        while (running.load())
+        {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                next - clock::now()).count();
+            if (left <= 0)
+                break;
+
+            int wait = left > 100 ? 100 : (int)left;
+
+            if (listen_fd >= 0)
+                serve_socket(wait);
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+        }
+    }
+}
+
+void MetricsExporter::write_file(const std::string& text)
+{
+    std::string tmp = file_path + ".tmp";
+
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+        return;
+
+    std::fwrite(text.data(), 1, text.size(), f);
+    std::fclose(f);
+    std::rename(tmp.c_str(), file_path.c_str());
+}
+
+void MetricsExporter::serve_socket(int wait_ms)
+{
+#ifdef __linux__
+    pollfd pfd{ listen_fd, POLLIN, 0 };
+    if (::poll(&pfd, 1, wait_ms) <= 0)
+        return;
+
+    int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    std::string text = metrics().render();
+
+    size_t off = 0;
+    while (off < text.size())
+    {
+        ssize_t n = ::send(fd, text.data() + off, text.size() - off,
+                           MSG_NOSIGNAL);
+        if (n <= 0) break;
+        off += (size_t)n;
+    }
+
+    ::close(fd);
+#else
+    (void)wait_ms;
+#endif
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <functional>
+#include <cstdint>
+
+#include "stats.hpp"
+
+// --------------------------------------------------
+// Metric types
+// --------------------------------------------------
+//
+// Updates are single relaxed atomics, safe from any thread (transport
+// callbacks, parser, TX). Nothing on the update path takes a lock.
+
+class Counter
+{
+public:
+    void inc(uint64_t n = 1) { v.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return v.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> v{0};
+};
+
+class Gauge
+{
+public:
+    void set(int64_t x) { v.store(x, std::memory_order_relaxed); }
+    void add(int64_t x) { v.fetch_add(x, std::memory_order_relaxed); }
+    int64_t value() const { return v.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> v{0};
+};
+
+// --------------------------------------------------
+// Registry
+// --------------------------------------------------
+//
+// Register metrics at startup and keep the returned reference; lookups
+// take the registry lock and do not belong on the hot path. Names are
+// Prometheus metric names, 'labels' the body of the {...} label set
+// (e.g. "queue=\"rx\""). Registering the same name + labels twice
+// returns the same metric.
+//
+// Sampled metrics (gauge_fn / counter_fn) usually read an object that
+// does not live as long as the registry, so they stay registered only as
+// long as the returned MetricFn handle: keep it as a member of the object
+// the function reads, declared after what it reads. Each registration is
+// its own series; a name + labels already in use gets an instance="<n>"
+// label added rather than replacing the earlier one.
+
+class MetricsRegistry;
+
+class MetricFn
+{
+public:
+    MetricFn() = default;
+    MetricFn(MetricFn&& o) noexcept : id(o.id) { o.id = 0; }
+    MetricFn& operator=(MetricFn&& o) noexcept;
+    ~MetricFn() { reset(); }
+
+    MetricFn(const MetricFn&) = delete;
+    MetricFn& operator=(const MetricFn&) = delete;
+
+    // unregister; once this returns the function is not running and
+    // will not be called again
+    void reset();
+
+private:
+    friend class MetricsRegistry;
+    explicit MetricFn(uint64_t id) : id(id) {}
+
+    uint64_t id = 0;
+};
+
+class MetricsRegistry
+{
+public:
+    Counter& counter(const char* name, const char* help,
+                     const char* labels = "");
+
+    Gauge& gauge(const char* name, const char* help,
+                 const char* labels = "");
+
+    LatencyHistogram& histogram(const char* name, const char* help,
+                                const char* labels = "");
+
+    // Sampled at scrape time, outside the registry lock; fn must only
+    // read atomics.
+    [[nodiscard]] MetricFn gauge_fn(const char* name, const char* help,
+                                    const char* labels,
+                                    std::function<double()> fn);
+
+    [[nodiscard]] MetricFn counter_fn(const char* name, const char* help,
+                                      const char* labels,
+                                      std::function<double()> fn);
+
+    // Prometheus text exposition format.
+    std::string render() const;
+
+private:
+    friend class MetricFn;
+
+    enum class Kind { Counter, Gauge, Histogram, GaugeFn, CounterFn };
+
+    struct Entry
+    {
+        std::string name;
+        std::string help;
+        std::string labels;
+        Kind kind;
+
+        Counter counter;
+        Gauge gauge;
+        std::unique_ptr<LatencyHistogram> hist;
+
+        // sampled metrics: 'fn' runs under 'fn_m', which remove_fn()
+        // takes to wait out a call in progress
+        uint64_t fn_id = 0;
+        mutable std::mutex fn_m;
+        std::function<double()> fn;
+    };
+
+    Entry& find_or_add(const char* name, const char* help,
+                       const char* labels, Kind kind);
+
+    MetricFn add_fn(const char* name, const char* help, const char* labels,
+                    Kind kind, std::function<double()> fn);
+    void remove_fn(uint64_t id);
+
+    mutable std::mutex m;
+    std::deque<std::shared_ptr<Entry>> entries;
+    uint64_t next_fn_id = 1;
+};
+
+MetricsRegistry& metrics();
+
+// --------------------------------------------------
+// Exporter
+// --------------------------------------------------
+//
+// Background thread that renders the registry every period and either
+// rewrites 'file_path' atomically (write + rename) or answers
+// connections on the Unix socket 'sock_path' with the current text.
+// Either path may be empty.
+
+class MetricsExporter
+{
+public:
+    bool start(const std::string& file_path,
+               const std::string& sock_path,
+               unsigned period_ms);
+    void stop();
+
+    ~MetricsExporter() { stop(); }
+
+private:
+    void loop();
+    void write_file(const std::string& text);
+    void serve_socket(int wait_ms);
+
+    std::string file_path;
+    std::string sock_path;
+    unsigned period_ms = 1000;
+
+    int listen_fd = -1;
+    std::atomic<bool> running{false};
+    std::thread worker;
+};
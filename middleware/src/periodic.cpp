@@ -0,0 +1,149 @@
+#include "periodic.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <time.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() ((void)0)
+#endif
+
+static std::string task_label(const std::string& task)
+{
+    return "task=\"" + task + "\"";
+}
+
+PeriodicTimer::PeriodicTimer(const std::string& t, unsigned rate, Overrun p)
+    : task(t), hz(rate), policy(p),
+      lateness_ns(metrics().histogram(
+          "soupy_periodic_lateness_ns", "Periodic task wakeup after its deadline",
+          task_label(t).c_str())),
+      ticks_run(metrics().counter(
+          "soupy_periodic_ticks_total", "Periodic task ticks run",
+          task_label(t).c_str())),
+      overruns(metrics().counter(
+          "soupy_periodic_overruns_total",
+          "Wakeups a whole period or more late", task_label(t).c_str())),
+      skipped(metrics().counter(
+          "soupy_periodic_skipped_total",
+          "Ticks not run because of an overrun", task_label(t).c_str()))
+{}
+
+// steady_clock is CLOCK_MONOTONIC on Linux, which clock_nanosleep uses
+uint64_t PeriodicTimer::now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PeriodicTimer::start(uint64_t now)
+{
+    start_ns = now;
+    tick = 0;
+    catching_up = false;
+}
+
+void PeriodicTimer::start()
+{
+    start(now_ns());
+}
+
+void PeriodicTimer::sleep_until_ns(uint64_t t, uint32_t spin)
+{
+    uint64_t wake = t > spin ? t - spin : 0;
+
+#ifdef __linux__
+    timespec ts;
+    ts.tv_sec  = (time_t)(wake / 1000000000ull);
+    ts.tv_nsec = (long)(wake % 1000000000ull);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#else
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+        std::chrono::nanoseconds(wake)));
+#endif
+
+    if (spin)
+        while (now_ns() < t)
+            CPU_RELAX();
+}
+
+bool PeriodicTimer::expire(uint64_t now, uint64_t& due)
+{
+    if (!hz)
+    {
+        due = now;
+        tick++;
+        ticks_run.inc();
+        return true;
+    }
+
+    uint64_t d = deadline_of(tick);
+    if (now < d)
+        return false;
+
+    lateness_ns.record(now - d);
+
+    // newest tick due by now (split so days of nanoseconds x hz fit)
+    uint64_t el = now - start_ns;
+    uint64_t newest = el / 1000000000ull * hz +
+                      el % 1000000000ull * hz / 1000000000ull;
+    if (newest < tick)
+        newest = tick;      // rounding at the deadline itself
+    uint64_t behind = newest - tick;
+
+    // a catch-up backlog counts as one overrun, on the wakeup that found it
+    if (behind && !catching_up)
+        overruns.inc();
+    catching_up = behind && policy == Overrun::catch_up;
+
+    if (behind)
+    {
+        uint64_t keep = policy == Overrun::catch_up ? max_burst : 0;
+        if (behind > keep)
+        {
+            skipped.inc(behind - keep);
+            tick += behind - keep;
+        }
+    }
+
+    due = deadline_of(tick);
+    tick++;
+    ticks_run.inc();
+    return true;
+}
+
+uint64_t PeriodicTimer::wait()
+{
+    uint64_t due;
+
+    for (;;)
+    {
+        uint64_t now = now_ns();
+        if (expire(now, due))
+            return tick - 1;
+
+        sleep_until_ns(deadline(), spin_ns);
+    }
+}
+
+void PeriodicTimer::print() const
+{
+    std::printf("[SCHED] task=%s rate=%u Hz ticks=%llu overruns=%llu "
+                "skipped=%llu\n",
+        task.c_str(), hz,
+        (unsigned long long)ticks_run.value(),
+        (unsigned long long)overruns.value(),
+        (unsigned long long)skipped.value());
+
+    std::string name = "SCHED " + task + " lateness";
+    lateness_ns.print(name.c_str(), "ns");
+}
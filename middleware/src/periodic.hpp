@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "metrics.hpp"
+
+// --------------------------------------------------
+// Periodic deadlines
+// --------------------------------------------------
+//
+// Absolute deadlines for a fixed-rate task: tick n is due at
+//
+//   start + n * 1 s / hz
+//
+// (exact for rates that don't divide 1 s), so the rate doesn't drift by
+// the loop body's run time the way sleep_for(period) does. Every expiry
+// records how late it ran in soupy_periodic_lateness_ns{task="..."}.
+//
+// A wakeup a whole period or more late is an overrun, handled per task:
+//   skip      run only the newest due tick, count the older ones as
+//             skipped (heartbeats, resampled outputs: a stale tick is
+//             worthless)
+//   catch_up  run every missed tick back to back, up to max_burst of
+//             them, skipping the rest (a frame source keeps its rate)
+//
+// wait() sleeps with clock_nanosleep(TIMER_ABSTIME) on Linux. With
+// spin_ns it wakes that much early and busy-waits to the deadline,
+// trading CPU for wakeup jitter. Polled loops call expire(now) instead.
+// One thread drives a timer.
+
+enum class Overrun { skip, catch_up };
+
+class PeriodicTimer
+{
+public:
+    static constexpr unsigned DEFAULT_BURST = 64;
+
+    // hz = 0: unpaced, every expire() / wait() returns a tick at once
+    PeriodicTimer(const std::string& task, unsigned hz,
+                  Overrun policy = Overrun::skip);
+
+    // tick 0 is due at 'now_ns'
+    void start(uint64_t now_ns);
+    void start();
+
+    // the next tick to run, and its deadline
+    uint64_t next_tick() const { return tick; }
+    uint64_t deadline() const { return deadline_of(tick); }
+
+    // true if a tick is due at 'now_ns'; 'due' gets its deadline.
+    // Records lateness and applies the overrun policy.
+    bool expire(uint64_t now_ns, uint64_t& due);
+
+    // sleep to the next deadline and run it; returns its tick number
+    uint64_t wait();
+
+    // clock_nanosleep(TIMER_ABSTIME) to t on the steady clock, the last
+    // spin_ns of it busy
+    static void sleep_until_ns(uint64_t t, uint32_t spin_ns = 0);
+    static uint64_t now_ns();
+
+    unsigned rate_hz() const { return hz; }
+    uint64_t ticks() const { return ticks_run.value(); }
+
+    void print() const;
+
+    unsigned max_burst = DEFAULT_BURST;     // catch_up only
+    uint32_t spin_ns = 0;                   // busy part of wait()
+
+private:
+    // split like expire(): n * 1e9 alone wraps after ~1.8e10 ticks
+    // (about two days at 100 kHz); (n % hz) * 1e9 stays under 4.3e18
+    uint64_t deadline_of(uint64_t n) const
+    {
+        if (!hz)
+            return start_ns;
+        return start_ns + n / hz * 1000000000ull +
+               n % hz * 1000000000ull / hz;
+    }
+
+    std::string task;
+    unsigned hz;
+    Overrun policy;
+
+    uint64_t start_ns = 0;
+    uint64_t tick = 0;
+    bool catching_up = false;
+
+    LatencyHistogram& lateness_ns;
+    Counter& ticks_run;
+    Counter& overruns;
+    Counter& skipped;
+};
@@ -0,0 +1,178 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include "metrics.hpp"
+#include "realtime.hpp"
+
+// --------------------------------------------------
+// Fixed-size block pool
+// --------------------------------------------------
+//
+// Blocks are carved from slabs of 'slab_blocks' and handed out from a
+// free list. Slabs are never given back, so once the pipeline has had its
+// peak number of blocks in flight get() and put() no longer touch the
+// heap. The pool lives for the whole process (blocks may still be held by
+// static objects at exit), so there is no destructor.
+
+class BlockPool
+{
+public:
+    BlockPool(const char* name, size_t block_size, size_t slab_blocks = 64)
+        : block_size_((block_size + 15) & ~(size_t)15),
+          slab_blocks(slab_blocks)
+    {
+        std::string label = std::string("pool=\"") + name + "\"";
+        auto& reg = metrics();
+
+        in_use_metric = reg.gauge_fn("soupy_pool_blocks_in_use", "Pool blocks handed out",
+            label.c_str(), [this]{ return (double)in_use(); });
+        blocks_metric = reg.gauge_fn("soupy_pool_blocks", "Pool blocks carved from slabs",
+            label.c_str(), [this]{ return (double)blocks(); });
+    }
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    size_t block_size() const { return block_size_; }
+
+    void* get()
+    {
+        std::lock_guard<std::mutex> lk(m);
+
+        if (!free_list)
+            grow(slab_blocks);
+
+        FreeBlock* b = free_list;
+        free_list = b->next;
+        in_use_.fetch_add(1, std::memory_order_relaxed);
+        return b;
+    }
+
+    void put(void* p)
+    {
+        std::lock_guard<std::mutex> lk(m);
+
+        FreeBlock* b = static_cast<FreeBlock*>(p);
+        b->next = free_list;
+        free_list = b;
+        in_use_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // carve at least 'n' blocks up front
+    void reserve(size_t n)
+    {
+        std::lock_guard<std::mutex> lk(m);
+
+        size_t have = blocks();
+        if (n > have)
+            grow(n - have);
+    }
+
+    // touch every free block (--mlock), so the first use of a reserved
+    // block does not page fault
+    void prefault()
+    {
+        std::lock_guard<std::mutex> lk(m);
+
+        for (FreeBlock* b = free_list; b; b = b->next)
+            rt_prefault(b, block_size_);
+    }
+
+    size_t in_use() const { return in_use_.load(std::memory_order_relaxed); }
+    size_t blocks() const { return blocks_.load(std::memory_order_relaxed); }
+
+private:
+    struct FreeBlock { FreeBlock* next; };
+
+    void grow(size_t n)
+    {
+        uint8_t* slab = static_cast<uint8_t*>(std::malloc(n * block_size_));
+        if (!slab)
+            throw std::bad_alloc();
+
+        for (size_t i = n; i-- > 0; )
+        {
+            FreeBlock* b = reinterpret_cast<FreeBlock*>(slab + i * block_size_);
+            b->next = free_list;
+            free_list = b;
+        }
+        blocks_.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    const size_t block_size_;
+    const size_t slab_blocks;
+
+    std::mutex m;
+    FreeBlock* free_list = nullptr;
+    std::atomic<size_t> in_use_{0};
+    std::atomic<size_t> blocks_{0};
+
+    MetricFn in_use_metric;
+    MetricFn blocks_metric;
+};
+
+// --------------------------------------------------
+// Chunk buffers
+// --------------------------------------------------
+//
+// Two size classes: single frames (sim, echoes) fit a small block, a
+// transport read's worth of frames a large one. Anything bigger falls
+// back to the heap and is counted, since it means a block size is too
+// small for the traffic.
+
+class ChunkPools
+{
+public:
+    static constexpr size_t SMALL = 256;
+    static constexpr size_t LARGE = 4096;
+
+    BlockPool small{"chunk-small", SMALL};
+    BlockPool large{"chunk-large", LARGE, 16};
+
+    Counter& heap_fallbacks = metrics().counter(
+        "soupy_pool_heap_fallbacks_total",
+        "Chunk buffers too big for any pool block");
+
+    // a buffer of at least 'n' bytes; its capacity goes to 'cap'
+    uint8_t* get(size_t n, size_t& cap)
+    {
+        if (n <= SMALL)
+        {
+            cap = SMALL;
+            return static_cast<uint8_t*>(small.get());
+        }
+        if (n <= LARGE)
+        {
+            cap = LARGE;
+            return static_cast<uint8_t*>(large.get());
+        }
+
+        heap_fallbacks.inc();
+        cap = n;
+        return static_cast<uint8_t*>(::operator new(n));
+    }
+
+    void put(uint8_t* p, size_t cap)
+    {
+        if (cap == SMALL)
+            small.put(p);
+        else if (cap == LARGE)
+            large.put(p);
+        else
+            ::operator delete(p);
+    }
+};
+
+inline ChunkPools& chunk_pools()
+{
+    // never destroyed, see BlockPool
+    static ChunkPools* p = new ChunkPools;
+    return *p;
+}
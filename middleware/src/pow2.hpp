@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+
+// --------------------------------------------------
+// Power-of-two sizing
+// --------------------------------------------------
+//
+// Rings indexed with 'seq & mask' need a power-of-two slot count; this
+// rounds a requested size up to one.
+
+inline size_t round_pow2(size_t n)
+{
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
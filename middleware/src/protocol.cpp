@@ -1,125 +1,102 @@
 #include "protocol.hpp"
+#include "trace.hpp"
 #include <cstring>
 
 // ---------------- CRC ----------------
 
 uint32_t crc32(const uint8_t* data, size_t len)
 {
-    uint32_t crc = 0xFFFFFFFF;
-
-    for (size_t i = 0; i < len; ++i) {
-        crc ^= data[i];
-        for (int j = 0; j < 8; ++j)
-            crc = (crc >> 1) ^ (0xEDB88320u & (uint32_t)-(int)(crc & 1u));
-    }
-
-    return ~crc;
+    return pkt_crc32(data, len);
 }
 
 // ---------------- parser ----------------
 
 void parse_from_ring(ByteRing& ring, PacketHandler& handler)
 {
-    uint8_t header_buf[sizeof(PacketHeader)];
+    using namespace wire;
+
+    uint8_t header_buf[Header::SIZE];
 
     while (true)
     {
-        if (ring.size() < sizeof(PacketHeader) + 4)
-            return;
-
-        if (!ring.peek(header_buf, sizeof(PacketHeader)))
-            return;
+        if (ring.size() < Header::SIZE + Crc::end)
+            break;
 
-        PacketHeader* hdr =
-            reinterpret_cast<PacketHeader*>(header_buf);
+        if (!ring.peek(header_buf, Header::SIZE))
+            break;
 
-        if (hdr->magic != MAGIC)
+        if (Header::magic::load(header_buf) != MAGIC)
         {
             ring.consume(1);
             continue;
         }
 
-        size_t total =
-            sizeof(PacketHeader) + hdr->size + 4;
+        const uint16_t size = Header::size::load(header_buf);
+        const uint16_t seq  = Header::seq::load(header_buf);
+        const uint8_t  type = Header::type::load(header_buf);
+
+        size_t total = Header::SIZE + size + Crc::end;
 
         if (ring.size() < total)
-            return;
+            break;
 
-        std::vector<uint8_t> pkt(total);
-        ring.read(pkt.data(), total);
+        TraceScope trace("parse", seq, type);
 
-        uint32_t crc_expected =
-            *reinterpret_cast<uint32_t*>(
-                pkt.data() + total - 4);
+        // reused across calls; only grows when a bigger frame shows up
+        thread_local std::vector<uint8_t> pkt;
+        if (pkt.size() < total)
+            pkt.resize(total);
+        ring.read(pkt.data(), total);
 
-        uint32_t crc_actual =
-            crc32(pkt.data(), total - 4);
+        uint32_t crc_expected = Crc::load(pkt.data() + total - Crc::end);
+        uint32_t crc_actual;
+        {
+            TraceScope crc_trace("crc", seq, (uint32_t)total);
+            crc_actual = crc32(pkt.data(), total - Crc::end);
+        }
 
         if (crc_expected != crc_actual)
-            continue;
-
-        const uint8_t* payload =
-            pkt.data() + sizeof(PacketHeader);
-
-        if (hdr->type == 1)
         {
-            if (hdr->size < 9) continue;
-
-            uint64_t ts =
-                *reinterpret_cast<const uint64_t*>(payload);
+            handler.on_bad_crc(type, seq);
+            continue;
+        }
 
-            uint8_t count = payload[8];
+        const uint8_t* payload = pkt.data() + Header::SIZE;
 
-            size_t need = 9 + count * sizeof(FingerData);
-            if (hdr->size < need) continue;
+        TraceScope dispatch_trace("dispatch", seq, type);
 
-            const FingerData* fingers =
-                reinterpret_cast<const FingerData*>(payload + 9);
+        if (type == PKT_TYPE_FINGERS)
+        {
+            FingersPacket f;
+            if (!decode_fingers(payload, size, f))
+                continue;
 
-            handler.on_finger_packet(
-                hdr->seq,
-                ts,
-                fingers,
-                count);
+            handler.on_finger_packet(seq, f.timestamp, f.fingers);
+        }
+        else if (type == PKT_TYPE_TIME_REPLY && fits<TimeReply>(size))
+        {
+            handler.on_time_reply(
+                seq,
+                TimeReply::host_tx::load(payload),
+                TimeReply::dev_rx::load(payload),
+                TimeReply::dev_tx::load(payload));
+        }
+        else if (type == PKT_TYPE_PROBE && fits<Probe>(size))
+        {
+            handler.on_probe_echo(
+                seq,
+                Probe::host_tx::load(payload),
+                size);
         }
         else
         {
             handler.on_unknown(
-                hdr->type,
-                hdr->seq,
+                type,
+                seq,
                 payload,
-                hdr->size);
+                size);
         }
     }
-}
-
-// ---------------- builder ----------------
-
-std::vector<uint8_t> build_heartbeat(uint16_t seq)
-{
-    const uint8_t payload[1] = {1};
 
-    PacketHeader hdr{};
-    hdr.magic = MAGIC;
-    hdr.size  = sizeof(payload);
-    hdr.seq   = seq;
-    hdr.type  = 2;
-
-    size_t total =
-        sizeof(hdr) + sizeof(payload) + 4;
-
-    std::vector<uint8_t> buf(total);
-
-    size_t off = 0;
-
-    memcpy(buf.data()+off, &hdr, sizeof(hdr));
-    off += sizeof(hdr);
-
-    memcpy(buf.data()+off, payload, sizeof(payload));
-    off += sizeof(payload);
-
-    uint32_t crc = crc32(buf.data(), off);
-    memcpy(buf.data()+off, &crc, 4);
-
-    return buf;
-}
\ No newline at end of file
+    handler.on_parse_end();
+}
@@ -2,36 +2,30 @@
 #include <cstdint>
 #include <vector>
 #include "ring_buffer.hpp"
+#include "packet_codec.h"
+#include "schema.hpp"
 
 // ---------------- constants ----------------
 
-constexpr uint16_t MAGIC = 0xA55A;
+// Wire format and codec live in shared/packet_codec.h
+constexpr uint16_t MAGIC = PKT_MAGIC;
 
-#pragma pack(push,1)
-struct PacketHeader {
-    uint16_t magic;
-    uint16_t size;
-    uint16_t seq;
-    uint8_t  type;
-};
+using PacketHeader = pkt_header_t;
+using FingerData   = pkt_finger_t;
 
-struct FingerData {
-    double x;
-    double y;
-    double z;
-    uint32_t state_array;
-    float temp;
-};
-#pragma pack(pop)
+// fingers of a received frame, read in place (see schema.hpp)
+using FingerView      = wire::FingerView;
+using FingerArrayView = wire::FingerArrayView;
 
 // ---------------- callbacks ----------------
 
 struct PacketHandler {
+    // 'fingers' points into the parser's frame buffer: valid for the
+    // duration of the call
     virtual void on_finger_packet(
         uint16_t seq,
         uint64_t timestamp,
-        const FingerData* fingers,
-        uint8_t count) = 0;
+        const FingerArrayView& fingers) = 0;
 
     virtual void on_unknown(
         uint8_t type,
@@ -39,6 +33,41 @@ struct PacketHandler {
         const uint8_t* payload,
         uint16_t len) = 0;
 
+    // device answer to a timed heartbeat (see clock_sync.hpp)
+    virtual void on_time_reply(
+        uint16_t seq,
+        uint64_t host_tx_us,
+        uint64_t dev_rx_us,
+        uint64_t dev_tx_us)
+    {
+        (void)seq;
+        (void)host_tx_us;
+        (void)dev_rx_us;
+        (void)dev_tx_us;
+    }
+
+    // a link probe came back (see rtt_probe.hpp)
+    virtual void on_probe_echo(
+        uint16_t seq,
+        uint64_t host_tx_us,
+        uint16_t len)
+    {
+        (void)seq;
+        (void)host_tx_us;
+        (void)len;
+    }
+
+    // framed packet whose CRC did not match; dropped by the parser
+    virtual void on_bad_crc(uint8_t type, uint16_t seq)
+    {
+        (void)type;
+        (void)seq;
+    }
+
+    // parse_from_ring() has dispatched every whole frame it had; stages
+    // that batch frames (calibration.hpp) hand them on here
+    virtual void on_parse_end() {}
+
     virtual ~PacketHandler() = default;
 };
 
@@ -48,6 +77,4 @@ uint32_t crc32(const uint8_t* data, size_t len);
 
 void parse_from_ring(
     ByteRing& ring,
-    PacketHandler& handler);
-
-std::vector<uint8_t> build_heartbeat(uint16_t seq);
\ No newline at end of file
+    PacketHandler& handler);
\ No newline at end of file
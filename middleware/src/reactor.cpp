@@ -0,0 +1,511 @@
+#include "reactor.hpp"
+#include "realtime.hpp"
+#include "host_clock.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+// --------------------------------------------------
+// Timer wheel
+// --------------------------------------------------
+//
+// Hashed wheel of periodic timers, one slot per tick; timers further out
+// than SLOTS ticks carry a round count. Owned and advanced by a single
+// worker, so no locking.
+
+namespace {
+
+enum TimerKind : uint8_t { TIMER_POLL, TIMER_HEARTBEAT };
+
+template <class Owner>
+class TimerWheel
+{
+public:
+    static constexpr uint32_t SLOTS = 256;
+
+    void add(Owner* owner, TimerKind kind, uint32_t period, uint32_t first)
+    {
+        insert(Timer{owner, kind, period ? period : 1, 0}, first);
+    }
+
+    // fire(Owner*, TimerKind) for every timer due in the next 'ticks'
+    template <class F>
+    void advance(uint64_t ticks, F&& fire)
+    {
+        while (ticks--)
+        {
+            now++;
+            due.swap(slots[now % SLOTS]);
+
+            for (Timer& t : due)
+            {
+                if (t.rounds)
+                {
+                    t.rounds--;
+                    slots[now % SLOTS].push_back(t);
+                    continue;
+                }
+
+                fire(t.owner, t.kind);
+                insert(t, t.period);
+            }
+            due.clear();
+        }
+    }
+
+private:
+    struct Timer
+    {
+        Owner*    owner;
+        TimerKind kind;
+        uint32_t  period;
+        uint32_t  rounds;
+    };
+
+    void insert(Timer t, uint32_t delay)
+    {
+        if (!delay) delay = 1;
+        t.rounds = (delay - 1) / SLOTS;
+        slots[(now + delay) % SLOTS].push_back(t);
+    }
+
+    // a slot's timers while they fire; swapping trades buffers with the
+    // slot, so once every slot has its working size advance() does not
+    // allocate
+    std::vector<Timer> due;
+
+    std::vector<Timer> slots[SLOTS];
+    uint64_t now = 0;
+};
+
+// Run queue: a ring sized for every stream at start(). A stream is on at
+// most one queue at a time (Stream::scheduled), so it never fills, and
+// unlike a deque it does not allocate as it cycles.
+template <class T>
+class RunQueue
+{
+public:
+    void reserve(size_t n) { slots.assign(n ? n : 1, nullptr); }
+
+    bool empty() const { return !count; }
+
+    void push_back(T* p)
+    {
+        slots[(head + count) % slots.size()] = p;
+        count++;
+    }
+
+    T* pop_front()
+    {
+        T* p = slots[head];
+        head = (head + 1) % slots.size();
+        count--;
+        return p;
+    }
+
+    T* pop_back()
+    {
+        count--;
+        return slots[(head + count) % slots.size()];
+    }
+
+private:
+    std::vector<T*> slots;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+} // namespace
+
+// --------------------------------------------------
+// Streams and workers
+// --------------------------------------------------
+
+struct Reactor::Stream
+{
+    unsigned id = 0;
+    unsigned home = 0;
+
+    std::unique_ptr<ITransport> transport;
+    std::unique_ptr<PacketHandler> handler;
+    int fd = -1;
+
+    // parse state, only touched by the worker running the stream
+    ByteRing ring{16384};
+    uint16_t hb_seq = 0;
+    uint64_t bytes = 0;
+
+    std::atomic<bool> scheduled{false};
+    std::atomic<bool> poll_due{false};
+    std::atomic<bool> hb_due{false};
+
+    // event_fd() is registered one-shot on the home worker's epoll: once
+    // it has fired it stays disarmed until a run has drained it, so a
+    // stream stolen by another worker does not keep the home one spinning
+    std::atomic<bool> fd_fired{false};
+};
+
+struct Reactor::Worker
+{
+    unsigned id = 0;
+    int epfd = -1;
+    int tfd = -1;
+    int wakefd = -1;
+    std::thread th;
+
+    std::mutex qm;
+    RunQueue<Stream> runq;
+
+    TimerWheel<Stream> wheel;
+
+    // written by the worker, read after join
+    uint64_t runs = 0;
+    uint64_t steals = 0;
+    uint64_t ticks = 0;
+    uint64_t late_ticks = 0;
+};
+
+Reactor::Reactor(const ReactorConfig& c) : cfg(c)
+{
+    if (!cfg.workers) cfg.workers = 1;
+    if (!cfg.tick_us) cfg.tick_us = 1000;
+}
+
+Reactor::~Reactor()
+{
+    close_all();
+}
+
+bool Reactor::add_stream(std::unique_ptr<ITransport> transport,
+                         std::unique_ptr<PacketHandler> handler)
+{
+    if (running.load() || !transport || !handler)
+        return false;
+
+    auto s = std::make_unique<Stream>();
+    s->id = (unsigned)streams.size();
+    s->home = s->id % cfg.workers;
+    s->fd = transport->event_fd();
+    s->transport = std::move(transport);
+    s->handler = std::move(handler);
+
+    if (s->fd < 0)
+    {
+        std::printf("[REACTOR] stream %u: transport has no event fd\n", s->id);
+        return false;
+    }
+
+    streams.push_back(std::move(s));
+    return true;
+}
+
+uint64_t Reactor::bytes() const
+{
+    uint64_t n = 0;
+    for (auto& s : streams)
+        n += s->bytes;
+    return n;
+}
+
+void Reactor::print_stats() const
+{
+    for (auto& w : workers)
+        std::printf("[REACTOR] worker %u: runs=%llu steals=%llu ticks=%llu "
+                    "late_ticks=%llu\n",
+            w->id,
+            (unsigned long long)w->runs,
+            (unsigned long long)w->steals,
+            (unsigned long long)w->ticks,
+            (unsigned long long)w->late_ticks);
+}
+
+void Reactor::close_all()
+{
+    stop();
+
+    for (auto& s : streams)
+        if (s->transport)
+            s->transport->close();
+
+    streams.clear();
+}
+
+#ifdef __linux__
+
+// --------------------------------------------------
+// Scheduling
+// --------------------------------------------------
+
+void Reactor::schedule(Stream& s)
+{
+    if (s.scheduled.exchange(true))
+        return;
+
+    Worker& h = *workers[s.home];
+    std::lock_guard<std::mutex> lk(h.qm);
+    h.runq.push_back(&s);
+}
+
+Reactor::Stream* Reactor::next_task(Worker& w)
+{
+    {
+        std::lock_guard<std::mutex> lk(w.qm);
+        if (!w.runq.empty())
+        {
+            return w.runq.pop_front();
+        }
+    }
+
+    // steal from the back of someone else's queue; owners pop the front
+    for (unsigned k = 1; k < workers.size(); ++k)
+    {
+        Worker& v = *workers[(w.id + k) % workers.size()];
+
+        std::unique_lock<std::mutex> lk(v.qm, std::try_to_lock);
+        if (!lk.owns_lock() || v.runq.empty())
+            continue;
+
+        Stream* s = v.runq.pop_back();
+        w.steals++;
+        return s;
+    }
+
+    return nullptr;
+}
+
+void Reactor::run(Worker& w, Stream& s)
+{
+    w.runs++;
+
+    // device side first (sim), then host TX, so their output is drained
+    // below in the same run
+    if (s.poll_due.exchange(false))
+        s.transport->poll(0);
+
+    if (s.hb_due.exchange(false))
+    {
+        uint8_t pkt[PKT_HEARTBEAT_FRAME];
+        size_t len = pkt_encode_heartbeat(pkt, sizeof(pkt), s.hb_seq++,
+                                          host_now_us());
+        s.transport->write(pkt, (int)len);
+    }
+
+    uint64_t v;
+    ssize_t r = ::read(s.fd, &v, sizeof(v));
+    (void)r;
+
+    // re-arm after the read: anything queued from here on fires again
+    if (s.fd_fired.exchange(false))
+    {
+        epoll_event e{};
+        e.events = EPOLLIN | EPOLLONESHOT;
+        e.data.ptr = &s;
+        epoll_ctl(workers[s.home]->epfd, EPOLL_CTL_MOD, s.fd, &e);
+    }
+
+    uint8_t buf[1024];
+
+    for (;;)
+    {
+        size_t room = s.ring.free_space();
+        if (room > sizeof(buf)) room = sizeof(buf);
+        if (!room)
+            break;
+
+        int n = s.transport->read(buf, (int)room);
+        if (n <= 0)
+            break;
+
+        s.ring.push(buf, (size_t)n);
+        s.bytes += (uint64_t)n;
+
+        parse_from_ring(s.ring, *s.handler);
+    }
+
+    s.scheduled.store(false);
+
+    // timers and fd events that fired while we ran could not queue us
+    if (s.fd_fired.load() || s.poll_due.load() || s.hb_due.load())
+        schedule(s);
+}
+
+void Reactor::on_tick(Worker& w, uint64_t expirations)
+{
+    w.ticks += expirations;
+    if (expirations > 1)
+        w.late_ticks += expirations - 1;
+
+    w.wheel.advance(expirations, [this](Stream* s, TimerKind kind) {
+        if (kind == TIMER_POLL)
+            s->poll_due.store(true);
+        else
+            s->hb_due.store(true);
+        schedule(*s);
+    });
+}
+
+void Reactor::worker_loop(Worker& w)
+{
+    char name[16];
+    std::snprintf(name, sizeof(name), "soupy-rw%u", w.id);
+    rt_setup_current_thread(name, ThreadRtConfig{});
+
+    epoll_event ev[64];
+
+    while (running.load())
+    {
+        // the tick wakes us at least once per tick to look for stealable work
+        int n = epoll_wait(w.epfd, ev, 64, 100);
+
+        for (int i = 0; i < n; ++i)
+        {
+            void* p = ev[i].data.ptr;
+
+            if (p == &w.tfd)
+            {
+                uint64_t exp = 0;
+                if (::read(w.tfd, &exp, sizeof(exp)) == sizeof(exp) && exp)
+                    on_tick(w, exp);
+            }
+            else if (p == &w.wakefd)
+            {
+                uint64_t v;
+                ssize_t r = ::read(w.wakefd, &v, sizeof(v));
+                (void)r;
+            }
+            else
+            {
+                Stream* s = static_cast<Stream*>(p);
+                s->fd_fired.store(true);
+                schedule(*s);
+            }
+        }
+
+        while (Stream* s = next_task(w))
+            run(w, *s);
+    }
+}
+
+// --------------------------------------------------
+// Start / stop
+// --------------------------------------------------
+
+bool Reactor::start()
+{
+    if (running.load())
+        return false;
+
+    for (unsigned i = 0; i < cfg.workers; ++i)
+    {
+        auto w = std::make_unique<Worker>();
+        w->id = i;
+        w->epfd = epoll_create1(EPOLL_CLOEXEC);
+        w->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        w->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        w->runq.reserve(streams.size());
+
+        if (w->epfd < 0 || w->tfd < 0 || w->wakefd < 0)
+        {
+            std::printf("[REACTOR] worker %u setup failed: %s\n",
+                i, std::strerror(errno));
+            return false;
+        }
+
+        itimerspec its{};
+        its.it_interval.tv_sec  = cfg.tick_us / 1000000;
+        its.it_interval.tv_nsec = (long)(cfg.tick_us % 1000000) * 1000;
+        its.it_value = its.it_interval;
+        timerfd_settime(w->tfd, 0, &its, nullptr);
+
+        epoll_event e{};
+        e.events = EPOLLIN;
+        e.data.ptr = &w->tfd;
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->tfd, &e);
+        e.data.ptr = &w->wakefd;
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->wakefd, &e);
+
+        workers.push_back(std::move(w));
+    }
+
+    uint32_t hb_ticks = (uint32_t)((cfg.heartbeat_ms * 1000ull + cfg.tick_us - 1)
+                                   / cfg.tick_us);
+
+    for (auto& s : streams)
+    {
+        Worker& w = *workers[s->home];
+
+        epoll_event e{};
+        e.events = EPOLLIN | EPOLLONESHOT;
+        e.data.ptr = s.get();
+        epoll_ctl(w.epfd, EPOLL_CTL_ADD, s->fd, &e);
+
+        if (cfg.poll_ticks)
+            w.wheel.add(s.get(), TIMER_POLL, cfg.poll_ticks, 1);
+
+        // spread heartbeats over the period instead of bursting
+        if (cfg.heartbeat_ms)
+            w.wheel.add(s.get(), TIMER_HEARTBEAT, hb_ticks,
+                         1 + s->id % (hb_ticks ? hb_ticks : 1));
+    }
+
+    running.store(true);
+
+    for (auto& w : workers)
+    {
+        Worker* wp = w.get();
+        w->th = std::thread([this, wp]{ worker_loop(*wp); });
+    }
+
+    return true;
+}
+
+void Reactor::stop()
+{
+    if (!running.exchange(false))
+        return;
+
+    for (auto& w : workers)
+    {
+        uint64_t one = 1;
+        ssize_t r = ::write(w->wakefd, &one, sizeof(one));
+        (void)r;
+    }
+
+    for (auto& w : workers)
+    {
+        if (w->th.joinable())
+            w->th.join();
+
+        ::close(w->epfd);
+        ::close(w->tfd);
+        ::close(w->wakefd);
+        w->epfd = w->tfd = w->wakefd = -1;
+    }
+}
+
+#else
+
+void Reactor::schedule(Stream&) {}
+Reactor::Stream* Reactor::next_task(Worker&) { return nullptr; }
+void Reactor::run(Worker&, Stream&) {}
+void Reactor::on_tick(Worker&, uint64_t) {}
+void Reactor::worker_loop(Worker&) {}
+
+bool Reactor::start()
+{
+    std::printf("[REACTOR] needs epoll/timerfd (Linux only)\n");
+    return false;
+}
+
+void Reactor::stop() {}
+
+#endif
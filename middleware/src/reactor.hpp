@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "transport.hpp"
+#include "protocol.hpp"
+#include "ring_buffer.hpp"
+
+// --------------------------------------------------
+// Reactor
+// --------------------------------------------------
+//
+// Serves many transports from a small fixed pool of workers instead of
+// three threads per transport (Linux: epoll, eventfd, timerfd).
+//
+// Every stream has a home worker. The home worker's epoll watches the
+// transport's event_fd(), and its timer wheel (one timerfd tick) fires
+// the stream's device poll and heartbeat. Either one puts the stream on
+// the home worker's run queue. A worker with an empty run queue steals
+// from the back of the others, so a busy worker's streams run wherever
+// there is an idle core. Parse state (ring + handler) lives in the
+// stream, and a stream is only ever run by one worker at a time.
+//
+// Transports must be opened in polled mode and expose event_fd().
+
+struct ReactorConfig
+{
+    unsigned workers      = 2;
+    unsigned tick_us      = 1000;   // timer wheel resolution
+    unsigned heartbeat_ms = 10;
+    unsigned poll_ticks   = 1;      // device poll period, 0 = never
+};
+
+class Reactor
+{
+public:
+    explicit Reactor(const ReactorConfig& cfg);
+    ~Reactor();
+
+    // Before start(). Takes ownership of both; the transport must
+    // already be open.
+    bool add_stream(std::unique_ptr<ITransport> transport,
+                    std::unique_ptr<PacketHandler> handler);
+
+    bool start();
+    void stop();
+
+    // stops first if needed; closes every transport
+    void close_all();
+
+    void print_stats() const;
+
+    uint64_t bytes() const;
+
+private:
+    struct Stream;
+    struct Worker;
+
+    void worker_loop(Worker& w);
+    void schedule(Stream& s);
+    Stream* next_task(Worker& w);
+    void run(Worker& w, Stream& s);
+    void on_tick(Worker& w, uint64_t expirations);
+
+    ReactorConfig cfg;
+    std::vector<std::unique_ptr<Stream>> streams;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> running{false};
+};
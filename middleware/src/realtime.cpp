@@ -0,0 +1,157 @@
+#include "realtime.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// --------------------------------------------------
+// Helpers
+// --------------------------------------------------
+
+static size_t page_size()
+{
+#ifdef __linux__
+    long ps = sysconf(_SC_PAGESIZE);
+    if (ps > 0) return (size_t)ps;
+#endif
+    return 4096;
+}
+
+bool rt_parse_policy(const char* s, RtPolicy& out)
+{
+    if (!std::strcmp(s, "fifo"))    { out = RtPolicy::Fifo;       return true; }
+    if (!std::strcmp(s, "rr"))      { out = RtPolicy::RoundRobin; return true; }
+    if (!std::strcmp(s, "default")) { out = RtPolicy::Default;    return true; }
+    return false;
+}
+
+// --------------------------------------------------
+// Prefaulting
+// --------------------------------------------------
+
+void rt_prefault(void* p, size_t len)
+{
+    if (!p || !len) return;
+
+    volatile uint8_t* b = static_cast<volatile uint8_t*>(p);
+    size_t ps = page_size();
+
+    // read-then-write keeps existing contents intact
+    for (size_t off = 0; off < len; off += ps)
+        b[off] = b[off];
+
+    b[len - 1] = b[len - 1];
+}
+
+// One fixed chunk per call, recursing until 'bytes' are covered, so the
+// stack use is what was asked for (plus a frame per chunk) and a small
+// thread stack is not overrun. The stack grows down, so each chunk is
+// touched from its top (nearest the caller) towards the bottom.
+static constexpr size_t STACK_CHUNK = 16 * 1024;
+
+__attribute__((noinline))
+static void prefault_stack_chunk(size_t bytes, size_t ps)
+{
+    volatile uint8_t chunk[STACK_CHUNK];
+
+    size_t n = bytes < STACK_CHUNK ? bytes : STACK_CHUNK;
+    for (size_t off = 0; off < n; off += ps)
+        chunk[STACK_CHUNK - 1 - off] = 0;
+
+    if (bytes > STACK_CHUNK)
+        prefault_stack_chunk(bytes - STACK_CHUNK, ps);
+
+    // a use after the call keeps it from becoming a tail call
+    (void)chunk[STACK_CHUNK - 1];
+}
+
+void rt_prefault_stack(size_t bytes)
+{
+    if (bytes)
+        prefault_stack_chunk(bytes, page_size());
+}
+
+// --------------------------------------------------
+// Memory locking
+// --------------------------------------------------
+
+bool rt_lock_memory()
+{
+#ifdef __linux__
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        std::printf("[RT] mlockall failed: %s (continuing unlocked)\n",
+            std::strerror(errno));
+        return false;
+    }
+    return true;
+#else
+    std::printf("[RT] mlockall not supported on this platform\n");
+    return false;
+#endif
+}
+
+// --------------------------------------------------
+// Per-thread setup
+// --------------------------------------------------
+
+// the scheduling fallback is the same for every thread (usually no
+// CAP_SYS_NICE), so it is reported by the first one only
+static std::atomic<bool> sched_warned{false};
+
+void rt_setup_current_thread(const char* name, const ThreadRtConfig& cfg)
+{
+#ifdef __linux__
+    pthread_t self = pthread_self();
+
+    if (cfg.cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cfg.cpu, &set);
+
+        int r = pthread_setaffinity_np(self, sizeof(set), &set);
+        if (r != 0)
+            std::printf("[RT] %s: pin to cpu %d failed: %s\n",
+                name, cfg.cpu, std::strerror(r));
+    }
+
+    if (cfg.policy != RtPolicy::Default)
+    {
+        int pol = (cfg.policy == RtPolicy::Fifo) ? SCHED_FIFO : SCHED_RR;
+
+        int lo = sched_get_priority_min(pol);
+        int hi = sched_get_priority_max(pol);
+        int prio = cfg.priority < lo ? lo : cfg.priority > hi ? hi : cfg.priority;
+
+        sched_param sp{};
+        sp.sched_priority = prio;
+
+        int r = pthread_setschedparam(self, pol, &sp);
+        if (r != 0 && !sched_warned.exchange(true))
+            std::printf("[RT] %s: %s prio %d failed: %s (keeping default)\n",
+                name,
+                pol == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR",
+                prio,
+                std::strerror(r));
+    }
+
+    pthread_setname_np(self, name);
+#else
+    if ((cfg.cpu >= 0 || cfg.policy != RtPolicy::Default) &&
+        !sched_warned.exchange(true))
+        std::printf("[RT] %s: thread tuning not supported on this platform\n",
+            name);
+#endif
+
+    rt_prefault_stack(64 * 1024);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+
+// --------------------------------------------------
+// Real-time thread configuration
+// --------------------------------------------------
+//
+// Everything here is best-effort: when the platform or our privileges do
+// not allow a setting we print a warning and keep running with the
+// default scheduler. The scheduling policy fallback is printed once per
+// process; a failed CPU pin is printed by each thread, since each names
+// its own CPU.
+
+enum class RtPolicy
+{
+    Default,
+    Fifo,
+    RoundRobin,
+};
+
+struct ThreadRtConfig
+{
+    int      cpu = -1;          // -1 = no pinning
+    RtPolicy policy = RtPolicy::Default;
+    int      priority = 0;      // 1..99 for Fifo / RoundRobin
+};
+
+// Apply pinning + scheduling to the calling thread and prefault its stack.
+void rt_setup_current_thread(const char* name, const ThreadRtConfig& cfg);
+
+// Touch 'bytes' of the current stack so later growth does not page fault.
+void rt_prefault_stack(size_t bytes);
+
+// Touch every page of [p, p+len).
+void rt_prefault(void* p, size_t len);
+
+// mlockall(MCL_CURRENT | MCL_FUTURE).
+bool rt_lock_memory();
+
+bool rt_parse_policy(const char* s, RtPolicy& out);
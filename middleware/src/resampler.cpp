@@ -0,0 +1,217 @@
+#include "resampler.hpp"
+#include "realtime.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// --------------------------------------------------
+// Jitter buffer
+// --------------------------------------------------
+
+Resampler::Resampler(uint32_t delay_us)
+    : delay_us(delay_us),
+      dropped(metrics().counter(
+          "soupy_resample_dropped_total",
+          "Frames not resampled: timestamp not after the previous frame"))
+{}
+
+Resampler::~Resampler()
+{
+    stop();
+}
+
+void Resampler::push(uint64_t host_us, const FingerArrayView& fingers)
+{
+    std::lock_guard<std::mutex> lk(m);
+
+    if (pushed && host_us <= ring[(pushed - 1) % DEPTH].t)
+    {
+        dropped.inc();
+        return;
+    }
+
+    Frame& f = ring[pushed % DEPTH];
+    f.t = host_us;
+    f.count = (uint8_t)fingers.copy_to(f.fingers, RingFrame::MAX_FINGERS);
+    pushed++;
+}
+
+static double lerp(double a, double b, double w)
+{
+    return a + (b - a) * w;
+}
+
+bool Resampler::sample(uint64_t t, ResampledFrame& out)
+{
+    std::lock_guard<std::mutex> lk(m);
+
+    if (!pushed)
+        return false;
+
+    uint64_t oldest = pushed > DEPTH ? pushed - DEPTH : 0;
+
+    // newest frame at or before t; the oldest one if t predates them all
+    uint64_t i = pushed - 1;
+    while (i > oldest && ring[i % DEPTH].t > t)
+        --i;
+
+    const Frame& a = ring[i % DEPTH];
+
+    out.newest_us = ring[(pushed - 1) % DEPTH].t;
+    out.held = (i == pushed - 1);
+    out.count = a.count;
+
+    if (out.held || a.t > t)
+    {
+        for (uint8_t k = 0; k < a.count; ++k)
+            out.fingers[k] = a.fingers[k];
+        return true;
+    }
+
+    const Frame& b = ring[(i + 1) % DEPTH];
+    double w = (double)(t - a.t) / (double)(b.t - a.t);
+
+    for (uint8_t k = 0; k < a.count; ++k)
+    {
+        out.fingers[k] = a.fingers[k];
+
+        // a finger that appears in only one of the frames is held
+        if (k >= b.count)
+            continue;
+
+        out.fingers[k].x    = lerp(a.fingers[k].x, b.fingers[k].x, w);
+        out.fingers[k].y    = lerp(a.fingers[k].y, b.fingers[k].y, w);
+        out.fingers[k].z    = lerp(a.fingers[k].z, b.fingers[k].z, w);
+        out.fingers[k].temp = (float)lerp(a.fingers[k].temp,
+                                          b.fingers[k].temp, w);
+    }
+
+    return true;
+}
+
+// --------------------------------------------------
+// Outputs
+// --------------------------------------------------
+
+void Resampler::add_output(unsigned rate_hz, Callback fn)
+{
+    if (!rate_hz)
+        return;
+
+    auto o = std::make_unique<Output>();
+    o->rate_hz = rate_hz;
+    o->fn = std::move(fn);
+
+    o->timer = std::make_unique<PeriodicTimer>(
+        "resample-" + std::to_string(rate_hz), rate_hz, Overrun::skip);
+    o->timer->spin_ns = spin_us * 1000;
+
+    std::string label = "rate=\"" + std::to_string(rate_hz) + "\"";
+
+    o->ticks = &metrics().counter(
+        "soupy_resample_ticks_total", "Resampled frames delivered",
+        label.c_str());
+    o->held = &metrics().counter(
+        "soupy_resample_held_total",
+        "Ticks with no frame after the sample time (newest frame repeated)",
+        label.c_str());
+    o->age_us = &metrics().histogram(
+        "soupy_resample_age_us",
+        "Tick time minus the newest input frame it used",
+        label.c_str());
+
+    outputs.push_back(std::move(o));
+}
+
+bool Resampler::start()
+{
+    if (outputs.empty() || running.exchange(true))
+        return false;
+
+    worker = std::thread(&Resampler::loop, this);
+    return true;
+}
+
+void Resampler::stop()
+{
+    if (!running.exchange(false))
+        return;
+
+    if (worker.joinable())
+        worker.join();
+}
+
+void Resampler::loop()
+{
+    rt_setup_current_thread("soupy-resample", ThreadRtConfig{});
+
+    const uint64_t start_ns = PeriodicTimer::now_ns();
+    for (const auto& o : outputs)
+        o->timer->start(start_ns);
+
+    ResampledFrame frame;
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        uint64_t next = UINT64_MAX;
+        uint32_t spin = 0;
+        for (const auto& o : outputs)
+        {
+            uint64_t d = o->timer->deadline();
+            if (d < next)
+            {
+                next = d;
+                spin = o->timer->spin_ns;
+            }
+        }
+
+        PeriodicTimer::sleep_until_ns(next, spin);
+
+        uint64_t now = PeriodicTimer::now_ns();
+
+        for (const auto& o : outputs)
+        {
+            uint64_t due;
+            if (!o->timer->expire(now, due))
+                continue;
+
+            frame.tick = o->timer->next_tick() - 1;
+            frame.tick_us = due / 1000;
+            frame.sample_us = frame.tick_us > delay_us
+                ? frame.tick_us - delay_us : 0;
+
+            if (!sample(frame.sample_us, frame))
+                continue;
+
+            o->age_us->record(frame.tick_us > frame.newest_us
+                              ? frame.tick_us - frame.newest_us : 0);
+
+            o->ticks->inc();
+            if (frame.held)
+                o->held->inc();
+
+            if (o->fn)
+                o->fn(frame);
+        }
+    }
+}
+
+void Resampler::print_stats() const
+{
+    for (const auto& o : outputs)
+    {
+        std::printf("[RESAMPLE] %u Hz delay=%u us: ticks=%llu held=%llu "
+                    "(%.2f%%)\n",
+            o->rate_hz, delay_us,
+            (unsigned long long)o->ticks->value(),
+            (unsigned long long)o->held->value(),
+            o->ticks->value()
+                ? 100.0 * o->held->value() / o->ticks->value() : 0.0);
+
+        o->timer->print();
+    }
+
+    std::printf("[RESAMPLE] dropped=%llu (out of order)\n",
+        (unsigned long long)dropped.value());
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "protocol.hpp"
+#include "frame_ring.hpp"
+#include "metrics.hpp"
+#include "periodic.hpp"
+
+// --------------------------------------------------
+// Fixed-rate resampler
+// --------------------------------------------------
+//
+// Frames arrive whenever USB transfers complete: irregular, often in
+// bursts. A Resampler keeps a small jitter buffer of one device's recent
+// frames (timestamps already in host time) and serves any number of
+// outputs at fixed rates (90 Hz render, 1 kHz haptics, ...). Each output
+// gets exactly one frame per tick, interpolated at
+//
+//   sample time = tick time - delay
+//
+// so bursts up to 'delay' late are hidden and the added latency is never
+// more than 'delay'. Positions and temperature are interpolated linearly
+// between the frames around the sample time; state_array is taken from
+// the earlier one. If no frame after the sample time has arrived yet,
+// the newest frame is held and the tick is flagged.
+//
+// One ticker thread runs all outputs, each on its own PeriodicTimer
+// ("resample-<hz>"); a tick that is more than one period late skips
+// ahead (counted as skipped) instead of bursting. Output callbacks run
+// on the ticker thread.
+
+struct ResampledFrame
+{
+    uint64_t tick;          // tick number of this output
+    uint64_t tick_us;       // host time of the tick
+    uint64_t sample_us;     // host time sampled: tick_us - delay
+    uint64_t newest_us;     // host time of the newest frame buffered
+    bool     held;          // nothing newer than sample_us yet
+    uint8_t  count;
+    FingerData fingers[RingFrame::MAX_FINGERS];
+};
+
+class Resampler
+{
+public:
+    using Callback = std::function<void(const ResampledFrame&)>;
+
+    static constexpr size_t DEPTH = 64;     // frames in the jitter buffer
+
+    explicit Resampler(uint32_t delay_us);
+    ~Resampler();
+
+    // before start()
+    void add_output(unsigned rate_hz, Callback fn);
+
+    // busy-wait the last spin_us before each tick; before add_output()
+    unsigned spin_us = 0;
+
+    // parser side; frames must come in timestamp order
+    void push(uint64_t host_us, const FingerArrayView& fingers);
+
+    bool start();
+    void stop();
+
+    void print_stats() const;
+
+private:
+    struct Frame
+    {
+        uint64_t t = 0;
+        uint8_t  count = 0;
+        FingerData fingers[RingFrame::MAX_FINGERS];
+    };
+
+    struct Output
+    {
+        unsigned rate_hz = 0;
+        Callback fn;
+        std::unique_ptr<PeriodicTimer> timer;
+
+        Counter* ticks = nullptr;
+        Counter* held = nullptr;
+        LatencyHistogram* age_us = nullptr;     // tick time - newest frame used
+    };
+
+    // false if no frame has arrived yet
+    bool sample(uint64_t t, ResampledFrame& out);
+
+    void loop();
+
+    uint32_t delay_us;
+
+    std::mutex m;
+    Frame ring[DEPTH];
+    uint64_t pushed = 0;
+
+    std::vector<std::unique_ptr<Output>> outputs;
+
+    Counter& dropped;       // frames out of timestamp order
+
+    std::atomic<bool> running{false};
+    std::thread worker;
+};
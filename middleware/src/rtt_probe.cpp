@@ -0,0 +1,282 @@
+#include "rtt_probe.hpp"
+#include "protocol.hpp"
+#include "ring_buffer.hpp"
+#include "stats.hpp"
+#include "host_clock.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+using probe_clock = std::chrono::steady_clock;
+
+// --------------------------------------------------
+// Echo matching
+// --------------------------------------------------
+
+class ProbeHandler : public PacketHandler
+{
+public:
+    // one slot per sequence number; a probe is resolved (echoed or
+    // timed out) long before its seq comes round again
+    struct Slot
+    {
+        uint64_t tx_us = 0;
+        bool     pending = false;
+        bool     timed_out = false;     // counted lost, echo not seen yet
+    };
+
+    std::vector<Slot> slots = std::vector<Slot>(65536);
+    std::deque<uint16_t> outstanding;   // send order
+
+    uint16_t frame_payload = 0;
+    uint64_t timeout_us = 0;
+
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t lost = 0;
+    uint64_t late = 0;          // echoes of probes already counted lost
+    uint64_t duplicates = 0;
+    uint64_t reordered = 0;
+    uint64_t bad_len = 0;
+    uint64_t bad_crc = 0;
+    uint64_t fingers = 0;
+
+    bool     have_last = false;
+    uint16_t last_seq = 0;
+
+    LatencyHistogram rtt;       // whole run
+    LatencyHistogram window;    // since the last progress line
+
+    void on_send(uint16_t seq, uint64_t tx_us)
+    {
+        Slot& s = slots[seq];
+
+        // still waiting after 65536 probes: count it lost now
+        if (s.pending)
+            lost++;
+
+        s.tx_us = tx_us;
+        s.pending = true;
+        s.timed_out = false;
+        outstanding.push_back(seq);
+        sent++;
+    }
+
+    void on_probe_echo(uint16_t seq, uint64_t host_tx_us,
+                       uint16_t len) override
+    {
+        uint64_t now = host_now_us();
+        Slot& s = slots[seq];
+
+        // the first echo after the timeout is late (the probe stays
+        // lost); anything else not pending is a duplicate or not ours
+        if (s.timed_out && s.tx_us == host_tx_us)
+        {
+            s.timed_out = false;
+            late++;
+            return;
+        }
+        if (!s.pending || s.tx_us != host_tx_us)
+        {
+            duplicates++;
+            return;
+        }
+
+        s.pending = false;
+        received++;
+
+        if (len != frame_payload)
+            bad_len++;
+
+        if (have_last && (int16_t)(seq - last_seq) < 0)
+            reordered++;
+        else
+            last_seq = seq;
+        have_last = true;
+
+        uint64_t d = now > host_tx_us ? now - host_tx_us : 0;
+        rtt.record(d);
+        window.record(d);
+    }
+
+    void on_finger_packet(uint16_t, uint64_t,
+                          const FingerArrayView&) override
+    {
+        fingers++;
+    }
+
+    void on_unknown(uint8_t, uint16_t, const uint8_t*, uint16_t) override {}
+
+    void on_bad_crc(uint8_t, uint16_t) override
+    {
+        bad_crc++;
+    }
+
+    // drop answered probes from the front, time out the old ones
+    void expire(uint64_t now)
+    {
+        while (!outstanding.empty())
+        {
+            Slot& s = slots[outstanding.front()];
+
+            if (s.pending)
+            {
+                if (now - s.tx_us < timeout_us)
+                    break;
+
+                s.pending = false;
+                s.timed_out = true;
+                lost++;
+            }
+
+            outstanding.pop_front();
+        }
+    }
+};
+
+// --------------------------------------------------
+// Probe loop
+// --------------------------------------------------
+
+int run_rtt_probe(ITransport& transport, const RttProbeConfig& c)
+{
+    RttProbeConfig cfg = c;
+    if (!cfg.rate_hz) cfg.rate_hz = 1000;
+    if (!cfg.timeout_ms) cfg.timeout_ms = 100;
+
+    if (cfg.pad > PKT_PROBE_MAX_PAD)
+    {
+        std::printf("[PROBE] pad %u > %u (one 64-byte packet), clamped\n",
+            cfg.pad, (unsigned)PKT_PROBE_MAX_PAD);
+        cfg.pad = PKT_PROBE_MAX_PAD;
+    }
+
+    const unsigned frame_len = PKT_PROBE_FRAME(cfg.pad);
+
+    ProbeHandler h;
+    h.frame_payload = (uint16_t)(PKT_PROBE_FIXED + cfg.pad);
+    h.timeout_us = cfg.timeout_ms * 1000ull;
+
+    std::printf("[PROBE] %u Hz, %u-byte frames, %u s, timeout %u ms\n",
+        cfg.rate_hz, frame_len, cfg.secs, cfg.timeout_ms);
+
+    ByteRing ring(16384);
+    uint8_t buf[1024];
+    uint8_t pkt[64];
+
+    const auto period = std::chrono::nanoseconds(1000000000ull / cfg.rate_hz);
+    const auto start = probe_clock::now();
+    const auto stop_tx = start + std::chrono::seconds(cfg.secs);
+    const auto stop_rx = stop_tx + std::chrono::milliseconds(cfg.timeout_ms);
+
+    auto next = start;
+    auto next_report = start + std::chrono::seconds(1);
+    unsigned report_s = 0;
+
+    uint16_t seq = 0;
+    uint64_t send_fail = 0;
+    uint64_t late_sends = 0;
+
+    auto drain = [&] {
+        int n;
+        while ((n = transport.read(buf, sizeof(buf))) > 0)
+        {
+            ring.push(buf, (size_t)n);
+            parse_from_ring(ring, h);
+        }
+    };
+
+    for (;;)
+    {
+        auto now = probe_clock::now();
+        bool sending = now < stop_tx;
+
+        if (!sending && (now >= stop_rx || h.outstanding.empty()))
+            break;
+
+        if (sending && now >= next)
+        {
+            uint64_t tx = host_now_us();
+            size_t len = pkt_encode_probe(pkt, sizeof(pkt), seq, tx,
+                                          (uint16_t)cfg.pad);
+
+            if (transport.write(pkt, (int)len) == (int)len)
+                h.on_send(seq, tx);
+            else
+                send_fail++;
+
+            seq++;
+            next += period;
+
+            // fell more than 10 periods behind: skip ahead instead of bursting
+            if (now - next > 10 * period)
+            {
+                late_sends++;
+                next = now + period;
+            }
+        }
+
+        // the echo may already be there (sim), so look before sleeping
+        drain();
+
+        int wait_us = 0;
+        if (sending && next > now)
+        {
+            auto w = std::chrono::duration_cast<std::chrono::microseconds>(
+                next - now).count();
+            wait_us = (int)(w < 1000 ? w : 1000);
+        }
+        else if (!sending)
+        {
+            wait_us = 1000;
+        }
+
+        transport.poll(wait_us);
+        drain();
+
+        h.expire(host_now_us());
+
+        if (probe_clock::now() >= next_report && sending)
+        {
+            report_s++;
+            next_report += std::chrono::seconds(1);
+
+            std::printf("[PROBE] t=%us sent=%llu recv=%llu lost=%llu "
+                        "p50=%llu p99=%llu max=%llu us\n",
+                report_s,
+                (unsigned long long)h.sent,
+                (unsigned long long)h.received,
+                (unsigned long long)h.lost,
+                (unsigned long long)h.window.percentile(50.0),
+                (unsigned long long)h.window.percentile(99.0),
+                (unsigned long long)h.window.max());
+            h.window.reset();
+        }
+    }
+
+    // whatever is still outstanding never came back
+    h.expire(UINT64_MAX);
+
+    std::printf("[PROBE] sent=%llu recv=%llu lost=%llu (%.3f%%) late=%llu "
+                "dup=%llu reordered=%llu bad_len=%llu bad_crc=%llu send_fail=%llu "
+                "late_sends=%llu fingers=%llu\n",
+        (unsigned long long)h.sent,
+        (unsigned long long)h.received,
+        (unsigned long long)h.lost,
+        h.sent ? 100.0 * h.lost / h.sent : 0.0,
+        (unsigned long long)h.late,
+        (unsigned long long)h.duplicates,
+        (unsigned long long)h.reordered,
+        (unsigned long long)h.bad_len,
+        (unsigned long long)h.bad_crc,
+        (unsigned long long)send_fail,
+        (unsigned long long)late_sends,
+        (unsigned long long)h.fingers);
+
+    if (h.rtt.count())
+        h.rtt.print("RTT", "us");
+
+    return h.received ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+
+#include "transport.hpp"
+
+// --------------------------------------------------
+// Link RTT probe
+// --------------------------------------------------
+//
+// Sends type 4 probe frames (host send time + filler) at a fixed rate,
+// matches the echoes coming back through the normal RX stream and
+// reports round-trip percentiles, loss, late echoes (after the timeout,
+// still counted lost), duplicates and reordering. The
+// firmware, the fake libusb device and the sim all echo probes, so the
+// same run qualifies a host/hub/cable or just the host side.
+//
+// The transport must be open in polled mode; finger packets arriving in
+// between are parsed and ignored.
+
+struct RttProbeConfig
+{
+    unsigned rate_hz    = 1000;
+    unsigned pad        = 0;     // filler bytes, up to PKT_PROBE_MAX_PAD
+    unsigned secs       = 5;
+    unsigned timeout_ms = 100;   // no echo by then: lost
+};
+
+int run_rtt_probe(ITransport& transport, const RttProbeConfig& cfg);
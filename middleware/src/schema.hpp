@@ -0,0 +1,285 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "packet_codec.h"
+
+// --------------------------------------------------
+// Wire schema
+// --------------------------------------------------
+//
+// Compile-time description of every packet layout: a field is a
+// (type, offset) pair, a record a list of fields and a size. Fields are
+// read with memcpy-based little-endian loads, valid at any alignment
+// (a single load on x86 and ARM) and independent of #pragma pack, so
+// nothing reinterprets packet bytes as host structs. The static_asserts
+// at the bottom pin the schema to shared/packet_codec.h.
+
+namespace wire {
+
+template <class T>
+inline T load_le(const uint8_t* p)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+
+    T v;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint8_t b[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i)
+        b[i] = p[sizeof(T) - 1 - i];
+    std::memcpy(&v, b, sizeof(T));
+#else
+    std::memcpy(&v, p, sizeof(T));
+#endif
+    return v;
+}
+
+template <class T, size_t Offset>
+struct Field
+{
+    using type = T;
+    static constexpr size_t offset = Offset;
+    static constexpr size_t end = Offset + sizeof(T);
+
+    static T load(const uint8_t* record) { return load_le<T>(record + Offset); }
+};
+
+// fields start at 0, follow each other without gaps and end at 'size'
+template <class... F>
+constexpr bool packed_layout(size_t size)
+{
+    size_t at = 0;
+    bool ok = true;
+    ((ok = ok && F::offset == at, at = F::end), ...);
+    return ok && at == size;
+}
+
+// ---------------- records ----------------
+
+struct Header
+{
+    using magic = Field<uint16_t, 0>;
+    using size  = Field<uint16_t, 2>;
+    using seq   = Field<uint16_t, 4>;
+    using type  = Field<uint8_t,  6>;
+
+    static constexpr size_t SIZE = 7;
+};
+
+// type 1 element
+struct Finger
+{
+    using x           = Field<double,   0>;
+    using y           = Field<double,   8>;
+    using z           = Field<double,   16>;
+    using state_array = Field<uint32_t, 24>;
+    using temp        = Field<float,    28>;
+
+    static constexpr size_t SIZE = 32;
+};
+
+// type 1: fixed part, then 'count' Finger records
+struct Fingers
+{
+    using timestamp = Field<uint64_t, 0>;
+    using count     = Field<uint8_t,  8>;
+
+    static constexpr size_t SIZE = 9;
+    using element = Finger;
+};
+
+// type 2 (host -> device)
+struct Heartbeat
+{
+    using flags   = Field<uint8_t,  0>;
+    using host_us = Field<uint64_t, 1>;
+
+    static constexpr size_t SIZE = 9;
+};
+
+// type 3
+struct TimeReply
+{
+    using host_tx = Field<uint64_t, 0>;
+    using dev_rx  = Field<uint64_t, 8>;
+    using dev_tx  = Field<uint64_t, 16>;
+
+    static constexpr size_t SIZE = 24;
+};
+
+// type 4: fixed part, then filler
+struct Probe
+{
+    using host_tx = Field<uint64_t, 0>;
+
+    static constexpr size_t SIZE = 8;
+};
+
+// type 5 element, mN
+struct Force
+{
+    using fx = Field<int16_t, 0>;
+    using fy = Field<int16_t, 2>;
+    using fz = Field<int16_t, 4>;
+
+    static constexpr size_t SIZE = 6;
+};
+
+// type 5 (host -> device): fixed part, then 'count' Force records
+struct Forces
+{
+    using count = Field<uint8_t, 0>;
+
+    static constexpr size_t SIZE = 1;
+    using element = Force;
+};
+
+// CRC32 after header + payload
+using Crc = Field<uint32_t, 0>;
+
+// payload of 'len' bytes holds the record's fixed part
+template <class Record>
+constexpr bool fits(size_t len) { return len >= Record::SIZE; }
+
+// ---------------- views ----------------
+
+// Typed read-only access to one record in a frame. Reads only the
+// fields asked for; never copies the record.
+template <class Record>
+class RecordView
+{
+public:
+    explicit RecordView(const uint8_t* p) : p(p) {}
+
+    template <class F>
+    typename F::type get() const { return F::load(p); }
+
+    const uint8_t* data() const { return p; }
+
+protected:
+    const uint8_t* p;
+};
+
+class FingerView : public RecordView<Finger>
+{
+public:
+    using RecordView::RecordView;
+
+    double   x() const           { return get<Finger::x>(); }
+    double   y() const           { return get<Finger::y>(); }
+    double   z() const           { return get<Finger::z>(); }
+    uint32_t state_array() const { return get<Finger::state_array>(); }
+    float    temp() const        { return get<Finger::temp>(); }
+};
+
+// The fingers of one type 1 frame, in place.
+class FingerArrayView
+{
+public:
+    FingerArrayView() = default;
+    FingerArrayView(const uint8_t* p, uint8_t n) : p(p), n(n) {}
+
+    uint8_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+    FingerView operator[](size_t i) const { return FingerView(p + i * Finger::SIZE); }
+
+    // copy up to 'max' fingers into host structs; returns how many
+    size_t copy_to(pkt_finger_t* out, size_t max) const
+    {
+        size_t k = n < max ? n : max;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        for (size_t i = 0; i < k; ++i)
+        {
+            FingerView f = (*this)[i];
+            out[i].x = f.x();
+            out[i].y = f.y();
+            out[i].z = f.z();
+            out[i].state_array = f.state_array();
+            out[i].temp = f.temp();
+        }
+#else
+        // wire and host layouts are the same (asserted below)
+        std::memcpy(out, p, k * Finger::SIZE);
+#endif
+        return k;
+    }
+
+    const uint8_t* data() const { return p; }
+
+private:
+    const uint8_t* p = nullptr;
+    uint8_t n = 0;
+};
+
+// ---------------- decoders ----------------
+
+struct FingersPacket
+{
+    uint64_t timestamp;
+    FingerArrayView fingers;
+};
+
+inline bool decode_fingers(const uint8_t* payload, size_t len,
+                           FingersPacket& out)
+{
+    if (!fits<Fingers>(len))
+        return false;
+
+    uint8_t n = Fingers::count::load(payload);
+    if (len < Fingers::SIZE + (size_t)n * Finger::SIZE)
+        return false;
+
+    out.timestamp = Fingers::timestamp::load(payload);
+    out.fingers = FingerArrayView(payload + Fingers::SIZE, n);
+    return true;
+}
+
+// ---------------- checks ----------------
+
+static_assert(std::numeric_limits<double>::is_iec559 &&
+              std::numeric_limits<float>::is_iec559,
+              "wire floats are IEEE 754");
+
+static_assert(packed_layout<Header::magic, Header::size, Header::seq,
+                            Header::type>(Header::SIZE), "header layout");
+static_assert(packed_layout<Finger::x, Finger::y, Finger::z,
+                            Finger::state_array, Finger::temp>(Finger::SIZE),
+              "finger layout");
+static_assert(packed_layout<Fingers::timestamp, Fingers::count>(Fingers::SIZE),
+              "fingers layout");
+static_assert(packed_layout<Heartbeat::flags, Heartbeat::host_us>(Heartbeat::SIZE),
+              "heartbeat layout");
+static_assert(packed_layout<TimeReply::host_tx, TimeReply::dev_rx,
+                            TimeReply::dev_tx>(TimeReply::SIZE),
+              "time reply layout");
+static_assert(packed_layout<Probe::host_tx>(Probe::SIZE), "probe layout");
+static_assert(packed_layout<Forces::count>(Forces::SIZE), "forces layout");
+static_assert(packed_layout<Force::fx, Force::fy, Force::fz>(Force::SIZE),
+              "force layout");
+
+// the C codec agrees
+static_assert(Header::SIZE == PKT_HEADER_SIZE, "codec header size");
+static_assert(Crc::end == PKT_CRC_SIZE, "codec CRC size");
+static_assert(Fingers::SIZE == PKT_FINGERS_FIXED, "codec fingers size");
+static_assert(PKT_HEARTBEAT_FRAME == PKT_OVERHEAD + Heartbeat::SIZE,
+              "codec heartbeat size");
+static_assert(PKT_TIME_REPLY_FRAME == PKT_OVERHEAD + TimeReply::SIZE,
+              "codec time reply size");
+static_assert(PKT_PROBE_FIXED == Probe::SIZE, "codec probe size");
+static_assert(PKT_FORCES_FIXED == Forces::SIZE &&
+              sizeof(pkt_force_t) == Force::SIZE, "codec forces size");
+
+// and so does the host struct copy_to() fills
+static_assert(sizeof(pkt_finger_t) == Finger::SIZE &&
+              offsetof(pkt_finger_t, x) == Finger::x::offset &&
+              offsetof(pkt_finger_t, y) == Finger::y::offset &&
+              offsetof(pkt_finger_t, z) == Finger::z::offset &&
+              offsetof(pkt_finger_t, state_array) == Finger::state_array::offset &&
+              offsetof(pkt_finger_t, temp) == Finger::temp::offset,
+              "pkt_finger_t matches the wire");
+
+} // namespace wire
@@ -1,131 +1,297 @@
 #include "transport.hpp"
 #include "protocol.hpp"
+#include "periodic.hpp"
+#include "host_clock.hpp"
 
 #include <cstring>
 #include <thread>
 #include <atomic>
 #include <vector>
-#include <mutex>
 #include <chrono>
 #include <random>
+#include <cstdio>
+#include <memory>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
 class SimTransportImpl {
     public:
         std::thread worker;
         std::atomic<bool> running{false};
 
-        std::mutex m;
-        std::vector<uint8_t> buffer;
+        // generated packets, one frame per chunk
+        FrameQueue buffer{"sim"};
+        ChunkReader reader;
 
         uint16_t seq = 0;
+        unsigned rate_hz = 0;
+
+        std::mt19937 rng{std::random_device{}()};
+        std::uniform_real_distribution<double> dist{-1.0, 1.0};
+        std::uniform_real_distribution<float>  temp{20.f, 40.f};
+
+        // touch bit (state_array bit 8) flips now and then, per finger
+        static constexpr uint32_t TOUCH_BIT = 1u << 8;
+        std::bernoulli_distribution touch_flip{1.0 / 250.0};
+        uint32_t touch[5] = {};
+
+        // device clock model, see SimClockConfig
+        SimClockConfig clock;
+        uint64_t clock_start_us = 0;
+
+        // frame deadlines when paced; catches up after a late wakeup so
+        // the device rate holds, like the firmware's timer would
+        std::unique_ptr<PeriodicTimer> timer;
+
+        // polled mode: the caller's loop generates packets via poll()
+        bool polled = false;
+
+        // polled mode: eventfd signalled whenever a chunk is queued
+        int efd = -1;
+
+        // catch-up limit for one poll() after a late call
+        static constexpr int MAX_BURST = 64;
+
+        void queue_chunk(Chunk&& c)
+        {
+            buffer.push(std::move(c), &running);
+
+#ifdef __linux__
+            if (efd >= 0)
+            {
+                uint64_t one = 1;
+                ssize_t r = ::write(efd, &one, sizeof(one));
+                (void)r;
+            }
+#endif
+        }
 
         void generate_loop()
         {
-            std::mt19937 rng{std::random_device{}()};
-            std::uniform_real_distribution<double> dist(-1.0, 1.0);
-            std::uniform_real_distribution<float>  temp(20.f, 40.f);
+#ifdef __linux__
+            pthread_setname_np(pthread_self(), "soupy-sim");
+#endif
+            if (timer)
+                timer->start();
 
             while (running.load())
             {
-                // Build fake finger packet
-                uint64_t ts =
-                    std::chrono::duration_cast<std::chrono::microseconds>(
-                        std::chrono::steady_clock::now().time_since_epoch())
-                        .count();
+                if (timer)
+                    timer->wait();
 
-                uint8_t count = 5;
+                generate_one();
+            }
+        }
 
-                std::vector<FingerData> fingers(count);
+        void poll(int timeout_us)
+        {
+            if (!timer)
+            {
+                generate_one();
+                return;
+            }
 
-                for (uint8_t i = 0; i < count; ++i)
-                {
-                    fingers[i].x = dist(rng);
-                    fingers[i].y = dist(rng);
-                    fingers[i].z = dist(rng);
-                    fingers[i].state_array = i;
-                    fingers[i].temp = temp(rng);
-                }
+            uint64_t now = PeriodicTimer::now_ns();
+            uint64_t next = timer->deadline();
 
-                // Build payload
-                std::vector<uint8_t> payload;
+            if (now < next && timeout_us > 0)
+            {
+                uint64_t limit = now + (uint64_t)timeout_us * 1000;
+                PeriodicTimer::sleep_until_ns(next < limit ? next : limit,
+                                              timer->spin_ns);
+                now = PeriodicTimer::now_ns();
+            }
 
-                payload.resize(9 + count*sizeof(FingerData));
+            uint64_t due;
+            for (int i = 0; i < MAX_BURST && timer->expire(now, due); ++i)
+                generate_one();
+        }
 
-                std::memcpy(payload.data(), &ts, 8);
-                payload[8] = count;
+        // device clock error at host time h, in microseconds
+        double clock_error_us(uint64_t h) const
+        {
+            double t = (double)(h - clock_start_us);
+            return (double)clock.offset_us +
+                   clock.skew_ppm * 1e-6 * t +
+                   0.5 * clock.drift_ppm_per_s * 1e-6 * t * (t * 1e-6);
+        }
 
-                std::memcpy(
-                    payload.data() + 9,
-                    fingers.data(),
-                    count*sizeof(FingerData));
+        uint64_t device_now_us() const
+        {
+            uint64_t h = host_now_us();
+            return h + (int64_t)clock_error_us(h);
+        }
 
-                PacketHeader hdr{};
-                hdr.magic = MAGIC;
-                hdr.size  = payload.size();
-                hdr.seq   = seq++;
-                hdr.type  = 1;
+        // answer timed heartbeats like the firmware does
+        void on_host_write(const uint8_t* data, int len)
+        {
+            pkt_view_t v;
+            size_t left = (size_t)len;
 
-                size_t total =
-                    sizeof(hdr) + payload.size() + 4;
+            while (left && pkt_decode(data, left, &v) == PKT_OK)
+            {
+                uint64_t host_tx;
+                if (pkt_decode_heartbeat(&v, &host_tx))
+                {
+                    uint64_t rx = device_now_us();
 
-                std::vector<uint8_t> pkt(total);
+                    Chunk c;
+                    c.seq = v.seq;
+                    pkt_encode_time_reply(c.resize(PKT_TIME_REPLY_FRAME),
+                                          PKT_TIME_REPLY_FRAME,
+                                          v.seq, host_tx, rx,
+                                          device_now_us());
 
-                size_t off = 0;
+                    queue_chunk(std::move(c));
+                }
+                else if (v.type == PKT_TYPE_FORCES)
+                {
+                    // rendered by the device, nothing comes back
+                }
+                else
+                {
+                    // anything else comes back verbatim, like the firmware
+                    Chunk c;
+                    c.seq = v.seq;
+                    c.append(data, v.frame_len);
+                    queue_chunk(std::move(c));
+                }
 
-                std::memcpy(pkt.data()+off, &hdr, sizeof(hdr));
-                off += sizeof(hdr);
+                data += v.frame_len;
+                left -= v.frame_len;
+            }
+        }
 
-                std::memcpy(pkt.data()+off, payload.data(), payload.size());
-                off += payload.size();
+        void generate_one()
+        {
+            // Build fake finger packet
+            uint64_t ts = device_now_us();
 
-                uint32_t crc = crc32(pkt.data(), off);
-                std::memcpy(pkt.data()+off, &crc, 4);
+            const uint8_t count = 5;
+            FingerData fingers[count];
 
-                {
-                    std::lock_guard<std::mutex> lk(m);
-                    buffer.insert(buffer.end(), pkt.begin(), pkt.end());
-                }
+            for (uint8_t i = 0; i < count; ++i)
+            {
+                fingers[i].x = dist(rng);
+                fingers[i].y = dist(rng);
+                fingers[i].z = dist(rng);
+                if (touch_flip(rng))
+                    touch[i] ^= TOUCH_BIT;
+
+                fingers[i].state_array = i | touch[i];
+                fingers[i].temp = temp(rng);
             }
+
+            TraceScope trace("sim frame", seq);
+
+            // encode straight into the chunk handed to the queue
+            Chunk c;
+            c.seq = seq;
+            pkt_encode_fingers(c.resize(PKT_FINGERS_FRAME(count)),
+                               PKT_FINGERS_FRAME(count),
+                               seq++, ts, fingers, count);
+
+            queue_chunk(std::move(c));
         }
 };
 
-static SimTransportImpl g_sim;
+SimTransport::SimTransport(const TransportConfig& cfg)
+    : cfg(cfg), impl(new SimTransportImpl) {}
+
+SimTransport::~SimTransport() = default;
 
 bool SimTransport::open()
 {
-    g_sim.running.store(true);
-    g_sim.worker = std::thread(&SimTransportImpl::generate_loop, &g_sim);
+    impl->rate_hz = cfg.sim_rate_hz;
+    if (impl->rate_hz)
+    {
+        impl->timer = std::make_unique<PeriodicTimer>(
+            "sim", impl->rate_hz, Overrun::catch_up);
+        impl->timer->max_burst = SimTransportImpl::MAX_BURST;
+        impl->timer->spin_ns = cfg.spin_us * 1000;
+    }
+    impl->clock = cfg.sim_clock;
+    impl->clock_start_us = host_now_us();
+    impl->buffer.configure(transport_rx_queue(cfg, impl->polled), cfg.budget);
+    if (cfg.prefault)
+        impl->buffer.prefault();
+    impl->running.store(true);
+
+    if (impl->polled)
+    {
+        if (impl->timer)
+            impl->timer->start();
+#ifdef __linux__
+        impl->efd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+    }
+    else
+        impl->worker = std::thread(&SimTransportImpl::generate_loop, impl.get());
+
     return true;
 }
 
-int SimTransport::read(uint8_t* out, int maxlen)
+void SimTransport::set_polled(bool polled)
 {
-    std::lock_guard<std::mutex> lk(g_sim.m);
-
-    if (g_sim.buffer.empty())
-        return 0;
-
-    int n = std::min<int>(maxlen, g_sim.buffer.size());
+    impl->polled = polled;
+}
 
-    std::memcpy(out, g_sim.buffer.data(), n);
+void SimTransport::poll(int timeout_us)
+{
+    impl->poll(timeout_us);
+}
 
-    g_sim.buffer.erase(
-        g_sim.buffer.begin(),
-        g_sim.buffer.begin() + n);
+int SimTransport::event_fd() const
+{
+    return impl->efd;
+}
 
-    return n;
+int SimTransport::read(uint8_t* out, int maxlen)
+{
+    return impl->reader.read(impl->buffer, out, maxlen);
 }
 
-int SimTransport::write(const uint8_t*, int len)
+int SimTransport::write(const uint8_t* data, int len)
 {
-    // ignore writes in sim
+    impl->on_host_write(data, len);
     return len;
 }
 
 void SimTransport::close()
 {
-    g_sim.running.store(false);
-
-    if (g_sim.worker.joinable())
-        g_sim.worker.join();
+    impl->running.store(false);
+    impl->buffer.wake_all();
+
+    if (impl->worker.joinable())
+        impl->worker.join();
+
+    if (cfg.print_stats)
+    {
+        impl->buffer.print_stats();
+        if (impl->timer)
+            impl->timer->print();
+    }
+    impl->buffer.clear();
+
+#ifdef __linux__
+    if (impl->efd >= 0)
+    {
+        ::close(impl->efd);
+        impl->efd = -1;
+    }
+#endif
+
+    if (!impl->clock.ideal())
+    {
+        uint64_t h = host_now_us();
+        double t = (double)(h - impl->clock_start_us) * 1e-6;
+
+        std::printf("[SIM] device clock: offset=%.1f us skew=%.3f ppm\n",
+            impl->clock_error_us(h),
+            impl->clock.skew_ppm + impl->clock.drift_ppm_per_s * t);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include "protocol.hpp"
+
+// --------------------------------------------------
+// Finger state edge events
+// --------------------------------------------------
+//
+// FingerData::state_array is resent in every frame but rarely changes.
+// StateEdgeTracker keeps the last state per finger and turns each frame
+// into one event per bit that flipped, so consumers that only care about
+// touches and releases subscribe here instead of diffing full frames.
+//
+// A finger's state starts out as 0, so the first frame reports its set
+// bits as edges; reset() restarts from 0 (e.g. after a reconnect).
+//
+// Single writer (whoever parses packets); listeners run on that thread.
+
+struct StateEdge
+{
+    uint64_t timestamp;     // device timestamp of the frame
+    uint16_t seq;           // frame sequence number
+    uint8_t  finger;
+    uint8_t  bit;           // 0..31 in state_array
+    bool     set;           // true: 0 -> 1, false: 1 -> 0
+};
+
+// bytes one edge takes on the wire: ts, seq, finger, bit | set << 7
+constexpr size_t STATE_EDGE_WIRE_SIZE = 12;
+
+struct StateEdgeListener
+{
+    // every edge of one frame, in finger then bit order
+    virtual void on_state_edges(const StateEdge* edges, size_t count) = 0;
+
+    virtual ~StateEdgeListener() = default;
+};
+
+class StateEdgeTracker
+{
+public:
+    static constexpr size_t MAX_FINGERS = 256;
+
+    void subscribe(StateEdgeListener* l) { listeners.push_back(l); }
+
+    void reset()
+    {
+        for (uint32_t& s : last) s = 0;
+    }
+
+    // returns the number of edges emitted for this frame
+    size_t feed(uint16_t seq, uint64_t timestamp,
+                const FingerArrayView& fingers)
+    {
+        n_frames++;
+        n_state_bytes += (uint64_t)fingers.size() * sizeof(uint32_t);
+
+        size_t n = 0;
+
+        for (uint8_t f = 0; f < fingers.size(); ++f)
+        {
+            uint32_t cur = fingers[f].state_array();
+            uint32_t diff = cur ^ last[f];
+            if (!diff)
+                continue;
+
+            last[f] = cur;
+
+            while (diff)
+            {
+                int bit = __builtin_ctz(diff);
+                diff &= diff - 1;
+
+                if (n == batch.size())
+                    batch.resize(n ? n * 2 : 16);
+
+                batch[n++] = StateEdge{timestamp, seq, f, (uint8_t)bit,
+                                       ((cur >> bit) & 1u) != 0};
+            }
+        }
+
+        if (!n)
+            return 0;
+
+        n_edges += n;
+
+        for (StateEdgeListener* l : listeners)
+            l->on_state_edges(batch.data(), n);
+
+        return n;
+    }
+
+    uint32_t state(uint8_t finger) const { return last[finger]; }
+
+    uint64_t frames() const { return n_frames; }
+    uint64_t edges() const { return n_edges; }
+
+    void print() const
+    {
+        std::printf("[EDGES] frames=%llu edges=%llu state bytes: "
+                    "full=%llu events=%llu\n",
+            (unsigned long long)n_frames,
+            (unsigned long long)n_edges,
+            (unsigned long long)n_state_bytes,
+            (unsigned long long)(n_edges * STATE_EDGE_WIRE_SIZE));
+    }
+
+private:
+    uint32_t last[MAX_FINGERS] = {};
+
+    // reused per frame so steady state never allocates
+    std::vector<StateEdge> batch;
+    std::vector<StateEdgeListener*> listeners;
+
+    uint64_t n_frames = 0;
+    uint64_t n_edges = 0;
+    uint64_t n_state_bytes = 0;
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+// --------------------------------------------------
+// Log-linear latency histogram
+// --------------------------------------------------
+//
+// Values below 2^SUB_BITS land in exact buckets, larger values in
+// 2^SUB_BITS sub-buckets per power of two (~6% resolution). Lock-free:
+// any number of writers, readers see a slightly torn but never blocking
+// snapshot.
+
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB      = 1 << SUB_BITS;
+    static constexpr int BUCKETS  = SUB + (64 - SUB_BITS) * SUB;
+
+    void record(uint64_t v)
+    {
+        counts[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+        n.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(v, std::memory_order_relaxed);
+
+        uint64_t m = max_v.load(std::memory_order_relaxed);
+        while (v > m && !max_v.compare_exchange_weak(
+                   m, v, std::memory_order_relaxed)) {}
+    }
+
+    void reset()
+    {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+        n.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        max_v.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return n.load(std::memory_order_relaxed); }
+    uint64_t total() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_v.load(std::memory_order_relaxed); }
+    double   mean() const { return count() ? (double)total() / count() : 0.0; }
+
+    uint64_t bucket_count(int b) const
+    {
+        return counts[b].load(std::memory_order_relaxed);
+    }
+
+    // upper edge of the bucket holding the p-th percentile (0..100)
+    uint64_t percentile(double p) const
+    {
+        uint64_t cnt = count();
+        uint64_t mx  = max();
+        if (!cnt) return 0;
+
+        uint64_t target = (uint64_t)(p / 100.0 * cnt);
+        if (target >= cnt) target = cnt - 1;
+
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; ++b)
+        {
+            seen += bucket_count(b);
+            if (seen > target)
+            {
+                uint64_t hi = bucket_upper(b);
+                return hi < mx ? hi : mx;
+            }
+        }
+        return mx;
+    }
+
+    void print(const char* name, const char* unit) const
+    {
+        std::printf(
+            "[%s] n=%llu mean=%.1f p50=%llu p99=%llu p99.9=%llu max=%llu %s\n",
+            name,
+            (unsigned long long)count(),
+            mean(),
+            (unsigned long long)percentile(50.0),
+            (unsigned long long)percentile(99.0),
+            (unsigned long long)percentile(99.9),
+            (unsigned long long)max(),
+            unit);
+    }
+
+    static int bucket_of(uint64_t v)
+    {
+        if (v < (uint64_t)SUB) return (int)v;
+
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - SUB_BITS;
+        int sub = (int)((v >> shift) & (SUB - 1));
+        return SUB + (shift * SUB) + sub;
+    }
+
+    static uint64_t bucket_upper(int b)
+    {
+        if (b < SUB) return (uint64_t)b;
+
+        int shift = (b - SUB) / SUB;
+        int sub   = (b - SUB) % SUB;
+        uint64_t base = (uint64_t)(SUB + sub) << shift;
+        return base + ((uint64_t)1 << shift) - 1;
+    }
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS]{};
+    std::atomic<uint64_t> n{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max_v{0};
+};
@@ -0,0 +1,290 @@
+#include "stream_bench.hpp"
+#include "protocol.hpp"
+#include "stats.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using bench_clock = std::chrono::steady_clock;
+
+static const unsigned FINGERS = 5;
+
+static uint64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        bench_clock::now().time_since_epoch()).count();
+}
+
+#ifdef __linux__
+
+// one loopback client: its bytes, its parser state, its latencies
+struct BenchClient : PacketHandler
+{
+    int fd = -1;
+    ByteRing ring{65536};
+    LatencyHistogram latency_us;
+    uint64_t frames = 0;
+
+    void on_finger_packet(uint16_t, uint64_t timestamp,
+                          const FingerArrayView&) override
+    {
+        uint64_t now = now_us();
+        latency_us.record(now > timestamp ? now - timestamp : 0);
+        frames++;
+    }
+
+    void on_unknown(uint8_t, uint16_t, const uint8_t*, uint16_t) override {}
+};
+
+static int connect_loopback(uint16_t port, int rcvbuf)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    // before connect, so the window is negotiated that small
+    if (rcvbuf)
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void reader_loop(std::vector<std::unique_ptr<BenchClient>>& clients,
+                        std::atomic<bool>& running)
+{
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+
+    for (auto& c : clients)
+    {
+        epoll_event e{};
+        e.events = EPOLLIN;
+        e.data.ptr = c.get();
+        epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &e);
+    }
+
+    epoll_event ev[128];
+    uint8_t buf[16384];
+
+    while (running.load())
+    {
+        int n = epoll_wait(epfd, ev, 128, 100);
+
+        for (int i = 0; i < n; ++i)
+        {
+            BenchClient& c = *static_cast<BenchClient*>(ev[i].data.ptr);
+
+            size_t room = std::min(sizeof(buf), c.ring.free_space());
+            ssize_t r = ::recv(c.fd, buf, room, MSG_DONTWAIT);
+            if (r <= 0)
+            {
+                if (r == 0)
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, c.fd, nullptr);
+                continue;
+            }
+
+            c.ring.push(buf, (size_t)r);
+            parse_from_ring(c.ring, c);
+        }
+    }
+
+    ::close(epfd);
+}
+
+static uint64_t median(std::vector<uint64_t> v)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+int run_stream_bench(unsigned n_clients, unsigned hz, unsigned secs,
+                     const StreamServerConfig& base)
+{
+    if (!n_clients)
+        n_clients = 1;
+    if (!hz)
+        hz = 1000;
+    if (!secs)
+        secs = 5;
+
+    unsigned n_slow = n_clients / 10;
+
+    FrameRing frames(4096);
+    FrameRing::Consumer& consumer = frames.add_consumer("stream");
+
+    StreamServerConfig cfg = base;
+    cfg.tcp = true;
+    cfg.port = 0;
+    cfg.bind_addr = "127.0.0.1";
+    cfg.log_clients = false;
+
+    StreamServer server(consumer, cfg);
+    if (!server.start())
+        return 1;
+
+    std::vector<std::unique_ptr<BenchClient>> clients;
+    std::vector<int> slow;
+
+    for (unsigned i = 0; i < n_clients; ++i)
+    {
+        auto c = std::make_unique<BenchClient>();
+        c->fd = connect_loopback(server.port(), 0);
+        if (c->fd < 0)
+        {
+            std::printf("[STREAM-BENCH] connect failed: %s\n", std::strerror(errno));
+            return 1;
+        }
+        clients.push_back(std::move(c));
+    }
+
+    for (unsigned i = 0; i < n_slow; ++i)
+    {
+        int fd = connect_loopback(server.port(), 4096);
+        if (fd < 0)
+        {
+            std::printf("[STREAM-BENCH] connect failed: %s\n", std::strerror(errno));
+            return 1;
+        }
+        slow.push_back(fd);
+    }
+
+    // let the server accept everyone before the clock starts
+    while (server.clients() < n_clients + n_slow)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    std::printf("[STREAM-BENCH] %u clients + %u that never read, %u Hz x %u "
+                "fingers for %u s, queue %zu frames, slow clients %s\n",
+        n_clients, n_slow, hz, FINGERS, secs, cfg.queue_frames,
+        cfg.slow == StreamServerConfig::Slow::drop ? "dropped" : "downsampled");
+
+    std::atomic<bool> reading{true};
+    std::thread reader(reader_loop, std::ref(clients), std::ref(reading));
+
+    // the producer stands in for the parser: publish() must stay cheap
+    // whatever the clients do
+    LatencyHistogram publish_ns;
+    FingerData f[FINGERS] = {};
+
+    auto period = std::chrono::nanoseconds(1000000000ull / hz);
+    auto t0 = bench_clock::now();
+    auto next = t0;
+    std::clock_t cpu0 = std::clock();
+    uint64_t total = (uint64_t)hz * secs;
+
+    for (uint64_t i = 0; i < total; ++i)
+    {
+        std::this_thread::sleep_until(next);
+        next += period;
+
+        for (unsigned k = 0; k < FINGERS; ++k)
+        {
+            f[k].x = (double)i;
+            f[k].state_array = k;
+        }
+
+        auto p0 = bench_clock::now();
+        frames.publish((uint16_t)i, now_us(),
+            FingerArrayView(reinterpret_cast<const uint8_t*>(f), FINGERS));
+        publish_ns.record((uint64_t)std::chrono::duration_cast<
+            std::chrono::nanoseconds>(bench_clock::now() - p0).count());
+    }
+
+    // drain, then stop
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    double wall_s = std::chrono::duration<double>(bench_clock::now() - t0).count();
+    double cpu_s = (double)(std::clock() - cpu0) / CLOCKS_PER_SEC;
+
+    server.stop();
+    reading.store(false);
+    reader.join();
+
+    // ---- report ----
+
+    std::vector<uint64_t> p50, p99, got;
+    LatencyHistogram all;
+
+    for (auto& c : clients)
+    {
+        p50.push_back(c->latency_us.percentile(50.0));
+        p99.push_back(c->latency_us.percentile(99.0));
+        got.push_back(c->frames);
+
+        for (int b = 0; b < LatencyHistogram::BUCKETS; ++b)
+            for (uint64_t k = c->latency_us.bucket_count(b); k; --k)
+                all.record(LatencyHistogram::bucket_upper(b));
+
+        ::close(c->fd);
+    }
+
+    for (int fd : slow)
+        ::close(fd);
+
+    std::printf("[STREAM-BENCH] frames per client: min=%llu median=%llu "
+                "max=%llu of %llu published\n",
+        (unsigned long long)*std::min_element(got.begin(), got.end()),
+        (unsigned long long)median(got),
+        (unsigned long long)*std::max_element(got.begin(), got.end()),
+        (unsigned long long)total);
+
+    std::printf("[STREAM-BENCH] per-client p50 latency: min=%llu median=%llu "
+                "max=%llu us\n",
+        (unsigned long long)*std::min_element(p50.begin(), p50.end()),
+        (unsigned long long)median(p50),
+        (unsigned long long)*std::max_element(p50.begin(), p50.end()));
+
+    std::printf("[STREAM-BENCH] per-client p99 latency: min=%llu median=%llu "
+                "max=%llu us\n",
+        (unsigned long long)*std::min_element(p99.begin(), p99.end()),
+        (unsigned long long)median(p99),
+        (unsigned long long)*std::max_element(p99.begin(), p99.end()));
+
+    all.print("STREAM-BENCH all clients", "us (bucket upper edges)");
+    publish_ns.print("STREAM-BENCH publish", "ns");
+
+    std::printf("[STREAM-BENCH] server thread CPU %.3f s over %.2f s = %.1f%% "
+                "of one core\n",
+        server.cpu_ns() / 1e9, wall_s, 100.0 * server.cpu_ns() / 1e9 / wall_s);
+    std::printf("[STREAM-BENCH] whole process (server, producer, client "
+                "readers) %.1f%% of one core\n", 100.0 * cpu_s / wall_s);
+
+    server.print_stats();
+    frames.print_stats();
+    return 0;
+}
+
+#else
+
+int run_stream_bench(unsigned, unsigned, unsigned, const StreamServerConfig&)
+{
+    std::printf("[STREAM-BENCH] needs epoll (Linux only)\n");
+    return 1;
+}
+
+#endif
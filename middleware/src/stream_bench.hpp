@@ -0,0 +1,14 @@
+#pragma once
+#include "stream_server.hpp"
+
+// --------------------------------------------------
+// Stream server bench
+// --------------------------------------------------
+//
+// 'clients' loopback TCP clients against a StreamServer fed at 'hz'
+// frames/s for 'secs' seconds, plus one slow client per ten that never
+// reads. Reports each client's frame latency (publish to parsed), the
+// server thread's CPU and what the slow clients cost the producer.
+
+int run_stream_bench(unsigned clients, unsigned hz, unsigned secs,
+                     const StreamServerConfig& base);
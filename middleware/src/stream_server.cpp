@@ -0,0 +1,522 @@
+#include "stream_server.hpp"
+#include "realtime.hpp"
+#include "pow2.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+struct StreamServer::Client
+{
+    int fd = -1;
+    char peer[32] = {};
+
+    uint64_t cursor = 0;        // next packet to send
+    unsigned step = 1;          // send every step-th packet
+    uint64_t step_since = 0;    // head when step last changed
+    bool blocked = false;       // socket full, waiting for EPOLLOUT
+
+    // rest of a partially written packet
+    uint8_t  tail[MAX_PACKET];
+    uint16_t tail_off = 0;
+    uint16_t tail_len = 0;
+
+    uint64_t frames = 0;
+};
+
+StreamServer::StreamServer(FrameRing::Consumer& src,
+                           const StreamServerConfig& c)
+    : source(src), cfg(c)
+{
+    if (!cfg.queue_frames)
+        cfg.queue_frames = 1;
+    if (!cfg.max_step)
+        cfg.max_step = 1;
+
+    log_size = round_pow2(2 * cfg.queue_frames);
+    log.reset(new Packet[log_size]);
+
+    clients_metric = metrics().gauge_fn("soupy_stream_clients", "Connected TCP clients", "",
+        [this]{ return (double)clients(); });
+}
+
+StreamServer::~StreamServer()
+{
+    stop();
+}
+
+void StreamServer::print_stats() const
+{
+    uint64_t w = writes.value();
+
+    std::printf("[STREAM] clients=%zu accepted=%llu dropped=%llu "
+                "frames=%llu sent=%llu skipped=%llu writes=%llu "
+                "(%.1f frames/write) bytes=%llu mcast=%llu\n",
+        clients(),
+        (unsigned long long)accepted.value(),
+        (unsigned long long)dropped.value(),
+        (unsigned long long)frames.value(),
+        (unsigned long long)sent.value(),
+        (unsigned long long)skipped.value(),
+        (unsigned long long)w,
+        w ? (double)sent.value() / w : 0.0,
+        (unsigned long long)bytes.value(),
+        (unsigned long long)mcast_sent.value());
+}
+
+#ifdef __linux__
+
+// --------------------------------------------------
+// Start / stop
+// --------------------------------------------------
+
+bool StreamServer::start()
+{
+    if (running.load())
+        return false;
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (epfd < 0 || tfd < 0)
+    {
+        std::printf("[STREAM] setup failed: %s\n", std::strerror(errno));
+        stop();
+        return false;
+    }
+
+    unsigned tick = cfg.tick_us ? cfg.tick_us : 1000;
+    itimerspec its{};
+    its.it_interval.tv_sec  = tick / 1000000;
+    its.it_interval.tv_nsec = (long)(tick % 1000000) * 1000;
+    its.it_value = its.it_interval;
+    timerfd_settime(tfd, 0, &its, nullptr);
+
+    epoll_event e{};
+    e.events = EPOLLIN;
+    e.data.ptr = &tfd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &e);
+
+    if (cfg.tcp)
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(cfg.port);
+
+        listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+
+        if (listen_fd < 0 ||
+            inet_pton(AF_INET, cfg.bind_addr.c_str(), &addr.sin_addr) != 1 ||
+            ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+            ::bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+            ::listen(listen_fd, 128) != 0)
+        {
+            std::printf("[STREAM] listen on %s:%u failed: %s\n",
+                cfg.bind_addr.c_str(), (unsigned)cfg.port, std::strerror(errno));
+            stop();
+            return false;
+        }
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(listen_fd, (sockaddr*)&addr, &len);
+        bound_port = ntohs(addr.sin_port);
+
+        e.data.ptr = &listen_fd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &e);
+    }
+
+    if (!cfg.mcast_group.empty())
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(cfg.mcast_port);
+
+        mcast_fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        unsigned char ttl = (unsigned char)cfg.mcast_ttl;
+
+        // connected, so batches go out with sendmmsg and no addresses
+        if (mcast_fd < 0 ||
+            inet_pton(AF_INET, cfg.mcast_group.c_str(), &addr.sin_addr) != 1 ||
+            ::setsockopt(mcast_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0 ||
+            ::connect(mcast_fd, (sockaddr*)&addr, sizeof(addr)) != 0)
+        {
+            std::printf("[STREAM] multicast %s:%u failed: %s\n",
+                cfg.mcast_group.c_str(), (unsigned)cfg.mcast_port,
+                std::strerror(errno));
+            stop();
+            return false;
+        }
+    }
+
+    running.store(true);
+    worker = std::thread([this]{ loop(); });
+    return true;
+}
+
+void StreamServer::stop()
+{
+    if (running.exchange(false) && worker.joinable())
+        worker.join();
+
+    for (auto& c : client_list)
+        if (c->fd >= 0)
+            ::close(c->fd);
+    client_list.clear();
+    n_clients.store(0);
+
+    for (int* fd : {&listen_fd, &mcast_fd, &tfd, &epfd})
+    {
+        if (*fd >= 0)
+            ::close(*fd);
+        *fd = -1;
+    }
+}
+
+// --------------------------------------------------
+// Server loop
+// --------------------------------------------------
+
+void StreamServer::loop()
+{
+    rt_setup_current_thread("soupy-stream", ThreadRtConfig{});
+
+    epoll_event ev[64];
+
+    while (running.load())
+    {
+        int n = epoll_wait(epfd, ev, 64, 100);
+
+        for (int i = 0; i < n; ++i)
+        {
+            void* p = ev[i].data.ptr;
+
+            if (p == &tfd)
+            {
+                uint64_t exp;
+                ssize_t r = ::read(tfd, &exp, sizeof(exp));
+                (void)r;
+            }
+            else if (p == &listen_fd)
+            {
+                accept_clients();
+            }
+            else
+            {
+                Client& c = *static_cast<Client*>(p);
+                if (c.fd < 0)
+                    continue;
+
+                if (ev[i].events & (EPOLLERR | EPOLLHUP))
+                {
+                    close_client(c, "hung up");
+                    continue;
+                }
+
+                // clients have nothing to say; EOF means they left
+                if (ev[i].events & EPOLLIN)
+                {
+                    uint8_t junk[256];
+                    ssize_t r;
+                    while ((r = ::recv(c.fd, junk, sizeof(junk), 0)) > 0) {}
+                    if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                    {
+                        close_client(c, "disconnected");
+                        continue;
+                    }
+                }
+
+                if (ev[i].events & EPOLLOUT)
+                    c.blocked = false;
+            }
+        }
+
+        pull_frames();
+
+        for (auto& c : client_list)
+            service(*c);
+
+        // forget closed clients; epoll already dropped their fds
+        size_t k = 0;
+        for (size_t i = 0; i < client_list.size(); ++i)
+            if (client_list[i]->fd >= 0)
+                client_list[k++] = std::move(client_list[i]);
+        client_list.resize(k);
+        n_clients.store(k, std::memory_order_relaxed);
+    }
+
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    thread_cpu_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// at most queue_frames per pass: with the backlog check after every
+// pass, no client's cursor can fall out of the log
+void StreamServer::pull_frames()
+{
+    RingFrame f;
+    uint64_t first = head;
+
+    while (head - first < cfg.queue_frames && source.next(f))
+    {
+        Packet& p = log[head & (log_size - 1)];
+        p.len = (uint16_t)pkt_encode_fingers(p.bytes, sizeof(p.bytes),
+            f.seq, f.timestamp, f.fingers, f.count);
+        head++;
+    }
+
+    if (head == first)
+        return;
+
+    frames.inc(head - first);
+
+    if (mcast_fd >= 0)
+        send_multicast(first);
+}
+
+void StreamServer::send_multicast(uint64_t from)
+{
+    mmsghdr msg[IOV_BATCH];
+    iovec iov[IOV_BATCH];
+
+    while (from < head)
+    {
+        unsigned n = 0;
+        for (; n < (unsigned)IOV_BATCH && from + n < head; ++n)
+        {
+            Packet& p = log[(from + n) & (log_size - 1)];
+            iov[n] = {p.bytes, p.len};
+            msg[n] = {};
+            msg[n].msg_hdr.msg_iov = &iov[n];
+            msg[n].msg_hdr.msg_iovlen = 1;
+        }
+
+        // a full socket buffer loses datagrams, as UDP would anyway
+        int r = ::sendmmsg(mcast_fd, msg, n, MSG_DONTWAIT);
+        if (r > 0)
+            mcast_sent.inc((uint64_t)r);
+
+        from += n;
+    }
+}
+
+// --------------------------------------------------
+// Clients
+// --------------------------------------------------
+
+void StreamServer::accept_clients()
+{
+    for (;;)
+    {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+
+        int fd = ::accept4(listen_fd, (sockaddr*)&addr, &len,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        if (client_list.size() >= cfg.max_clients)
+        {
+            ::close(fd);
+            continue;
+        }
+
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        // a fixed buffer also stops autotuning from growing it to
+        // megabytes of backlog the queue bound never sees
+        if (cfg.sndbuf)
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &cfg.sndbuf, sizeof(cfg.sndbuf));
+
+        auto c = std::make_unique<Client>();
+        c->fd = fd;
+        c->cursor = head;
+        c->step_since = head;
+
+        char ip[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        std::snprintf(c->peer, sizeof(c->peer), "%s:%u",
+                      ip, (unsigned)ntohs(addr.sin_port));
+
+        // edge-triggered: EPOLLOUT once each time a full socket drains
+        epoll_event e{};
+        e.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        e.data.ptr = c.get();
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &e);
+
+        accepted.inc();
+        if (cfg.log_clients)
+            std::printf("[STREAM] %s connected\n", c->peer);
+
+        client_list.push_back(std::move(c));
+    }
+}
+
+void StreamServer::close_client(Client& c, const char* why)
+{
+    if (cfg.log_clients)
+        std::printf("[STREAM] %s %s after %llu frames\n",
+            c.peer, why, (unsigned long long)c.frames);
+
+    ::close(c.fd);
+    c.fd = -1;
+}
+
+void StreamServer::service(Client& c)
+{
+    if (c.fd < 0)
+        return;
+
+    uint64_t backlog = head > c.cursor ? head - c.cursor : 0;
+
+    if (backlog > cfg.queue_frames)
+    {
+        if (cfg.slow == StreamServerConfig::Slow::drop)
+        {
+            dropped.inc();
+            close_client(c, "too slow, dropped");
+            return;
+        }
+
+        // keep only the newest frame and thin out from here
+        skipped.inc(backlog - 1);
+        c.cursor = head - 1;
+        if (c.step < cfg.max_step)
+            c.step *= 2;
+        c.step_since = head;
+    }
+
+    if (!c.blocked && !flush(c))
+        return;
+
+    // caught up for a whole queue's worth of frames: send more of them
+    if (c.step > 1 && !c.blocked && c.cursor >= head &&
+        head - c.step_since >= cfg.queue_frames)
+    {
+        c.step /= 2;
+        c.step_since = head;
+    }
+}
+
+// false if the client was closed
+bool StreamServer::flush(Client& c)
+{
+    iovec iov[IOV_BATCH];
+
+    for (;;)
+    {
+        int n = 0;
+        size_t total = 0;
+
+        if (c.tail_off < c.tail_len)
+        {
+            iov[n++] = {c.tail + c.tail_off, (size_t)(c.tail_len - c.tail_off)};
+            total += c.tail_len - c.tail_off;
+        }
+
+        uint64_t cur = c.cursor;
+        for (; n < IOV_BATCH && cur < head; cur += c.step)
+        {
+            Packet& p = log[cur & (log_size - 1)];
+            iov[n++] = {p.bytes, p.len};
+            total += p.len;
+        }
+
+        if (!n)
+            return true;
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)n;
+
+        ssize_t w = ::sendmsg(c.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (w < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                c.blocked = true;
+                return true;
+            }
+            close_client(c, "write failed");
+            return false;
+        }
+
+        writes.inc();
+        bytes.inc((uint64_t)w);
+
+        // retire what went out; a packet cut short keeps its rest
+        size_t left = (size_t)w;
+        int i = 0;
+
+        if (c.tail_off < c.tail_len)
+        {
+            size_t k = std::min(left, iov[0].iov_len);
+            c.tail_off += (uint16_t)k;
+            left -= k;
+            i = 1;
+        }
+
+        uint64_t done = 0;
+        for (; i < n && left; ++i)
+        {
+            size_t len = iov[i].iov_len;
+
+            if (left < len)
+            {
+                std::memcpy(c.tail, (uint8_t*)iov[i].iov_base + left, len - left);
+                c.tail_off = 0;
+                c.tail_len = (uint16_t)(len - left);
+                left = 0;
+            }
+            else
+                left -= len;
+
+            c.cursor += c.step;
+            done++;
+        }
+
+        c.frames += done;
+        sent.inc(done);
+        if (c.step > 1)
+            skipped.inc(done * (c.step - 1));
+
+        if ((size_t)w < total)
+        {
+            c.blocked = true;
+            return true;
+        }
+    }
+}
+
+#else
+
+bool StreamServer::start()
+{
+    std::printf("[STREAM] needs epoll/timerfd (Linux only)\n");
+    return false;
+}
+
+void StreamServer::stop() {}
+void StreamServer::loop() {}
+void StreamServer::pull_frames() {}
+void StreamServer::send_multicast(uint64_t) {}
+void StreamServer::accept_clients() {}
+void StreamServer::service(Client&) {}
+bool StreamServer::flush(Client&) { return true; }
+void StreamServer::close_client(Client&, const char*) {}
+
+#endif
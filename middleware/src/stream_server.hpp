@@ -0,0 +1,134 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_ring.hpp"
+#include "metrics.hpp"
+
+// --------------------------------------------------
+// Network frame server
+// --------------------------------------------------
+//
+// Streams decoded finger frames to TCP clients (and optionally a UDP
+// multicast group) in the device wire format, so a client only needs
+// parse_from_ring. One thread (Linux: epoll + timerfd) reads a FrameRing
+// consumer, so nothing here can hold up the parser; at most the server's
+// own consumer gets lapped.
+//
+// Each frame is encoded once into a log of 2 x queue_frames packets. A
+// client's send queue is its cursor into that log, bounded by
+// queue_frames: every tick the server gathers whatever each client has
+// not had yet into one write (sendmsg, i.e. writev without SIGPIPE; up
+// to IOV_BATCH packets per call). A client whose backlog passes its bound
+// is slow and, per policy, either disconnected or downsampled: its
+// cursor jumps to the newest frame and it gets only every 2nd, 4th ...
+// frame from then on, stepping back towards every frame once it has
+// kept up for a queue's worth of frames. The unsent end of a partially
+// written packet stays with the client, so skipping never cuts a packet.
+
+struct StreamServerConfig
+{
+    enum class Slow { drop, downsample };
+
+    bool        tcp = false;            // listen for TCP clients
+    uint16_t    port = 0;               // 0 = pick one (see port())
+    std::string bind_addr = "0.0.0.0";
+
+    std::string mcast_group;            // empty = no multicast
+    uint16_t    mcast_port = 0;
+    unsigned    mcast_ttl = 1;
+
+    size_t   queue_frames = 256;        // per-client backlog bound
+    int      sndbuf = 65536;            // kernel send buffer, 0 = default
+    Slow     slow = Slow::downsample;
+    unsigned max_step = 64;             // coarsest downsampling
+    unsigned tick_us = 250;             // ring poll period
+    unsigned max_clients = 1024;
+    bool     log_clients = true;        // print connects / disconnects
+};
+
+class StreamServer
+{
+public:
+    static constexpr size_t MAX_PACKET = PKT_FINGERS_FRAME(RingFrame::MAX_FINGERS);
+    static constexpr int IOV_BATCH = 64;
+
+    StreamServer(FrameRing::Consumer& source, const StreamServerConfig& cfg);
+    ~StreamServer();
+
+    // binds and starts the server thread; false (and a message) if a
+    // socket can't be set up
+    bool start();
+    void stop();
+
+    // bound TCP port, after start()
+    uint16_t port() const { return bound_port; }
+
+    size_t clients() const { return n_clients.load(std::memory_order_relaxed); }
+
+    // server thread CPU time, after stop()
+    uint64_t cpu_ns() const { return thread_cpu_ns; }
+
+    void print_stats() const;
+
+private:
+    struct Client;
+
+    void loop();
+    void pull_frames();
+    void send_multicast(uint64_t from);
+    void accept_clients();
+    void service(Client& c);
+    bool flush(Client& c);
+    void close_client(Client& c, const char* why);
+
+    FrameRing::Consumer& source;
+    StreamServerConfig cfg;
+
+    // encoded packets, packet i in slot i & (log_size - 1)
+    struct Packet
+    {
+        uint16_t len;
+        uint8_t bytes[MAX_PACKET];
+    };
+    size_t log_size = 0;
+    std::unique_ptr<Packet[]> log;
+    uint64_t head = 0;                  // packets encoded so far
+
+    std::vector<std::unique_ptr<Client>> client_list;
+    std::atomic<size_t> n_clients{0};
+
+    int listen_fd = -1;
+    int mcast_fd = -1;
+    int epfd = -1;
+    int tfd = -1;
+    uint16_t bound_port = 0;
+
+    std::atomic<bool> running{false};
+    std::thread worker;
+    uint64_t thread_cpu_ns = 0;
+
+    Counter& frames = metrics().counter(
+        "soupy_stream_frames_total", "Frames encoded for network clients");
+    Counter& sent = metrics().counter(
+        "soupy_stream_sent_total", "Frames written to TCP clients");
+    Counter& skipped = metrics().counter(
+        "soupy_stream_skipped_total", "Frames left out for downsampled clients");
+    Counter& bytes = metrics().counter(
+        "soupy_stream_bytes_total", "Bytes written to TCP clients");
+    Counter& writes = metrics().counter(
+        "soupy_stream_writes_total", "writev calls to TCP clients");
+    Counter& accepted = metrics().counter(
+        "soupy_stream_clients_total", "TCP clients accepted");
+    Counter& dropped = metrics().counter(
+        "soupy_stream_dropped_clients_total", "Slow TCP clients disconnected");
+    Counter& mcast_sent = metrics().counter(
+        "soupy_stream_mcast_total", "Frames sent to the multicast group");
+
+    MetricFn clients_metric;
+};
@@ -0,0 +1,199 @@
+#include "trace.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::atomic<bool> g_trace_on{false};
+
+// --------------------------------------------------
+// Registry
+// --------------------------------------------------
+//
+// Rings stay registered after their thread exits, so the trace still
+// shows what short-lived threads did. Past MAX_RINGS threads nothing more
+// is recorded (the attach is retried, under the lock, on every event).
+
+static constexpr uint32_t MAX_RINGS = 128;
+
+static std::mutex g_reg_mutex;
+static TraceRing* g_rings[MAX_RINGS];
+static std::atomic<uint32_t> g_ring_count{0};
+
+TraceRing* trace_attach_thread()
+{
+    std::lock_guard<std::mutex> lk(g_reg_mutex);
+
+    uint32_t n = g_ring_count.load(std::memory_order_relaxed);
+    if (n == MAX_RINGS)
+        return nullptr;
+
+    TraceRing* r = new TraceRing();
+
+#ifdef __linux__
+    pthread_getname_np(pthread_self(), r->name, sizeof(r->name));
+    r->tid = (int)syscall(SYS_gettid);
+#else
+    std::snprintf(r->name, sizeof(r->name), "thread-%u", n);
+    r->tid = (int)n + 1;
+#endif
+
+    g_rings[n] = r;
+    g_ring_count.store(n + 1, std::memory_order_release);
+    return r;
+}
+
+void TraceRing::snapshot(std::vector<TraceEvent>& out) const
+{
+    uint64_t h = head.load(std::memory_order_acquire);
+    uint64_t lo = h > CAPACITY ? h - CAPACITY : 0;
+
+    size_t base = out.size();
+    for (uint64_t i = lo; i < h; ++i)
+        out.push_back(ev[i & (CAPACITY - 1)]);
+
+    // the owner may have lapped the oldest slots while we copied
+    uint64_t h2 = head.load(std::memory_order_acquire);
+    uint64_t valid = h2 >= CAPACITY ? h2 - CAPACITY + 1 : 0;
+
+    if (valid > lo)
+    {
+        size_t torn = (size_t)(valid - lo);
+        if (torn > out.size() - base)
+            torn = out.size() - base;
+        out.erase(out.begin() + base, out.begin() + base + torn);
+    }
+}
+
+// --------------------------------------------------
+// Control
+// --------------------------------------------------
+
+void trace_start()
+{
+    g_trace_on.store(true);
+}
+
+void trace_stop()
+{
+    g_trace_on.store(false);
+}
+
+static volatile std::sig_atomic_t g_dump_requested = 0;
+
+static void on_dump_signal(int)
+{
+    g_dump_requested = 1;
+}
+
+void trace_install_dump_signal()
+{
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, on_dump_signal);
+#endif
+}
+
+bool trace_dump_requested()
+{
+    if (!g_dump_requested)
+        return false;
+
+    g_dump_requested = 0;
+    return true;
+}
+
+// --------------------------------------------------
+// Chrome trace JSON
+// --------------------------------------------------
+//
+// {"traceEvents": [...]} with one "X" (complete) or "i" (instant) event
+// per record, timestamps in microseconds, plus thread_name metadata.
+
+static void write_json_string(FILE* f, const char* s)
+{
+    std::fputc('"', f);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            std::fputc('\\', f);
+        if ((unsigned char)*s >= 0x20)
+            std::fputc(*s, f);
+    }
+    std::fputc('"', f);
+}
+
+bool trace_write(const char* path)
+{
+    FILE* f = std::fopen(path, "w");
+    if (!f)
+    {
+        std::printf("[TRACE] cannot write %s\n", path);
+        return false;
+    }
+
+#ifdef __linux__
+    int pid = (int)getpid();
+#else
+    int pid = 1;
+#endif
+
+    std::fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    uint32_t n = g_ring_count.load(std::memory_order_acquire);
+    std::vector<TraceEvent> ev;
+    size_t total = 0;
+    bool first = true;
+
+    for (uint32_t r = 0; r < n; ++r)
+    {
+        const TraceRing& ring = *g_rings[r];
+
+        std::fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\","
+                        "\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+            first ? "" : ",\n", pid, ring.tid);
+        write_json_string(f, ring.name);
+        std::fprintf(f, "}}");
+        first = false;
+
+        ev.clear();
+        ring.snapshot(ev);
+        total += ev.size();
+
+        for (const TraceEvent& e : ev)
+        {
+            std::fprintf(f, ",\n{\"name\":");
+            write_json_string(f, e.name);
+            if (e.cat)
+            {
+                std::fprintf(f, ",\"cat\":");
+                write_json_string(f, e.cat);
+            }
+
+            if (e.dur_ns == TraceEvent::INSTANT)
+                std::fprintf(f, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f",
+                    e.ts_ns / 1000.0);
+            else
+                std::fprintf(f, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f",
+                    e.ts_ns / 1000.0, e.dur_ns / 1000.0);
+
+            std::fprintf(f, ",\"pid\":%d,\"tid\":%d,\"args\":{", pid, ring.tid);
+            if (e.seq >= 0)
+                std::fprintf(f, "\"seq\":%d,", (int)e.seq);
+            std::fprintf(f, "\"arg\":%u}}", (unsigned)e.arg);
+        }
+    }
+
+    std::fprintf(f, "\n]}\n");
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+
+    std::printf("[TRACE] %zu events from %u threads -> %s\n", total, n, path);
+    return ok;
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------
+// Pipeline event tracing
+// --------------------------------------------------
+//
+//   TraceScope t("parse", seq);                    // begin .. end of block
+//   trace_instant("queue pop", "rx->parser", seq, waited_us);
+//
+// With --trace <path> every thread records the scopes it runs into its
+// own preallocated ring, which keeps the most recent TraceRing::CAPACITY
+// events. trace_write() turns all rings into Chrome trace JSON (open it
+// in ui.perfetto.dev or chrome://tracing), at exit or on SIGUSR1.
+//
+// Events carry the seq of the packet they worked on (the first frame of
+// a chunk), so a slow frame can be followed from the USB completion or
+// sim through the queues to the handler. Until trace_start() a scope
+// costs one relaxed load.
+
+struct TraceEvent
+{
+    static constexpr uint64_t INSTANT = ~0ull;
+
+    const char* name;
+    const char* cat;        // e.g. the queue; nullptr for none
+    uint64_t ts_ns;
+    uint64_t dur_ns;        // INSTANT for a point event
+    int32_t seq;            // -1: not tied to a packet
+    uint32_t arg;           // bytes, type, wait... depends on the event
+};
+
+// --------------------------------------------------
+// Per-thread ring
+// --------------------------------------------------
+//
+// Single producer; overwrites the oldest event when full. snapshot() may
+// run while the owner keeps recording and drops whatever the owner could
+// have overwritten during the copy.
+
+class TraceRing
+{
+public:
+    static constexpr size_t CAPACITY = 32768;
+
+    void add(const TraceEvent& e)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        ev[h & (CAPACITY - 1)] = e;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // events still held, oldest first, appended to 'out'
+    void snapshot(std::vector<TraceEvent>& out) const;
+
+    char name[16] = {};     // thread name when it first traced
+    int tid = 0;
+
+private:
+    std::atomic<uint64_t> head{0};
+    TraceEvent ev[CAPACITY];
+};
+
+// --------------------------------------------------
+// Front end
+// --------------------------------------------------
+
+extern std::atomic<bool> g_trace_on;
+
+TraceRing* trace_attach_thread();
+
+inline bool trace_on()
+{
+    return g_trace_on.load(std::memory_order_relaxed);
+}
+
+inline uint64_t trace_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void trace_record(const TraceEvent& e)
+{
+    thread_local TraceRing* ring = nullptr;
+
+    if (!ring && !(ring = trace_attach_thread()))
+        return;
+    ring->add(e);
+}
+
+inline void trace_instant(const char* name, const char* cat,
+                          int32_t seq = -1, uint32_t arg = 0)
+{
+    if (trace_on())
+        trace_record({name, cat, trace_now_ns(), TraceEvent::INSTANT,
+                      seq, arg});
+}
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name, int32_t seq = -1, uint32_t arg = 0,
+                        const char* cat = nullptr)
+        : seq(seq), arg(arg), name(name), cat(cat),
+          t0(trace_on() ? trace_now_ns() : 0) {}
+
+    ~TraceScope()
+    {
+        if (t0)
+            trace_record({name, cat, t0, trace_now_ns() - t0, seq, arg});
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // may be filled in once known, before the scope ends
+    int32_t seq;
+    uint32_t arg;
+
+private:
+    const char* name;
+    const char* cat;
+    uint64_t t0;
+};
+
+// --------------------------------------------------
+// Control / output
+// --------------------------------------------------
+
+void trace_start();
+void trace_stop();
+
+// all rings as Chrome trace JSON; false if 'path' can't be written
+bool trace_write(const char* path);
+
+// SIGUSR1 asks for a write; the main loop polls this
+bool trace_dump_requested();
+void trace_install_dump_signal();
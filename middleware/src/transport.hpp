@@ -1,5 +1,53 @@
 #pragma once
 #include <cstdint>
+#include <memory>
+#include "frame_queue.hpp"
+
+// Sim device clock: dev = host + offset + skew * t + drift * t^2 / 2,
+// t = time since open. All zero means the device runs on host time.
+struct SimClockConfig {
+    int64_t offset_us       = 0;
+    double  skew_ppm        = 0.0;
+    double  drift_ppm_per_s = 0.0;
+
+    bool ideal() const
+    {
+        return offset_us == 0 && skew_ppm == 0.0 && drift_ppm_per_s == 0.0;
+    }
+};
+
+// Settings shared by all transports. The transport's internal RX queue
+// holds whole frames and charges 'budget' (may be null).
+struct TransportConfig {
+    QueueConfig   rx_queue;
+    MemoryBudget* budget = nullptr;
+    unsigned      sim_rate_hz = 0;   // sim only, 0 = unpaced
+    SimClockConfig sim_clock;        // sim only
+    unsigned      spin_us = 0;       // sim only: busy end of each frame wait
+
+    // USB only: bulk IN transfer pool
+    int      usb_transfers  = 8;
+    int      usb_xfer_size  = 1024;  // bytes, multiple of 64
+    unsigned usb_timeout_ms = 0;     // 0 = no timeout
+    bool     usb_adaptive   = false; // resize pool from observed traffic
+
+    // touch the RX queue's slot storage on open() (--mlock)
+    bool prefault = false;
+
+    // print queue stats on close()
+    bool print_stats = true;
+};
+
+// The RX queue settings a transport actually uses. A polled transport
+// fills its queue from the same thread that drains it, so a producer that
+// waited for room would wait forever: Block becomes DropNewest there.
+inline QueueConfig transport_rx_queue(const TransportConfig& cfg, bool polled)
+{
+    QueueConfig q = cfg.rx_queue;
+    if (polled && q.policy == OverloadPolicy::Block)
+        q.policy = OverloadPolicy::DropNewest;
+    return q;
+}
 
 class ITransport {
 public:
@@ -7,25 +55,56 @@ public:
     virtual int  read(uint8_t* buf, int len) = 0;
     virtual int  write(const uint8_t* buf, int len) = 0;
     virtual void close() = 0;
+
+    // Run-to-completion support: when polled (set before open()), the
+    // transport starts no background threads and the caller drives its
+    // I/O with poll(). timeout_us = 0 returns immediately.
+    virtual void set_polled(bool) {}
+    virtual void poll(int timeout_us) { (void)timeout_us; }
+
+    // Reactor support: an fd that polls readable while read() has data
+    // (Linux eventfd, valid after open() in polled mode), or -1.
+    virtual int event_fd() const { return -1; }
+
     virtual ~ITransport() {}
 };
 
 #ifdef USE_USB
 class USBTransport : public ITransport {
 public:
+    explicit USBTransport(const TransportConfig& cfg = {}) : cfg(cfg) {}
+
     bool open() override;
     int  read(uint8_t*, int) override;
     int  write(const uint8_t*, int) override;
     void close() override;
+    void set_polled(bool) override;
+    void poll(int) override;
+
+private:
+    TransportConfig cfg;
 };
 #endif
 
 #ifdef USE_SIM
+class SimTransportImpl;
+
+// Each instance is an independent simulated glove.
 class SimTransport : public ITransport {
 public:
+    explicit SimTransport(const TransportConfig& cfg = {});
+    ~SimTransport() override;
+
     bool open() override;
     int  read(uint8_t*, int) override;
     int  write(const uint8_t*, int) override;
     void close() override;
+    void set_polled(bool) override;
+    void poll(int) override;
+    int  event_fd() const override;
+
+private:
+    TransportConfig cfg;
+    std::unique_ptr<SimTransportImpl> impl;
 };
 #endif
\ No newline at end of file
@@ -1,15 +1,20 @@
 #include "transport.hpp"
+#include "binlog.hpp"
 
 #include <libusb.h>
 #include <cstdio>
+#include <cstdlib>
 #include <vector>
-#include <deque>
-#include <mutex>
+#include <memory>
 #include <thread>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
 #include <cstring>
 
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
 static const uint16_t VID = 0x1d50;
 static const uint16_t PID = 0xdead;
 
@@ -18,13 +23,46 @@ static const uint8_t EP_OUT = 0x01;
 
 static const int IFACE = 0;
 
-// tune these
-static const int NUM_IN_TRANSFERS = 8;
-static const int IN_XFER_SIZE     = 1024;
+// bounds for the IN transfer pool (runtime-configured via TransportConfig)
+static const int MAX_PACKET       = 64;
+static const int MIN_IN_TRANSFERS = 2;
+static const int MAX_IN_TRANSFERS = 64;
+static const int MIN_IN_XFER_SIZE = MAX_PACKET;
+static const int MAX_IN_XFER_SIZE = 16384;
+
+// adaptive mode re-evaluates the pool this often, and sizes buffers so
+// that a backlogged device fills one in about ADAPT_FILL_TIME
+static const auto ADAPT_WINDOW    = std::chrono::milliseconds(250);
+static const auto ADAPT_FILL_TIME = std::chrono::microseconds(1000);
+static const int  ADAPT_MIN_SIZE  = 512;
+
+// mean submit-to-completion time above which IN transfers are mostly
+// sitting queued waiting for the device: the pool is bigger than the
+// traffic needs
+static const auto ADAPT_IDLE_LATENCY = ADAPT_FILL_TIME * 4;
+
+using Clock = std::chrono::steady_clock;
+
+class USBTransportImpl;
 
 struct InXferCtx {
+    USBTransportImpl* owner = nullptr;
     libusb_transfer* xfer = nullptr;
     uint8_t* buf = nullptr;
+    int size = 0;
+    bool in_flight = false;
+    Clock::time_point submitted;
+};
+
+// Observations over one adapt window (event thread only).
+struct AdaptWindow {
+    Clock::time_point start;
+    uint64_t completions = 0;
+    uint64_t full = 0;          // actual_length == length
+    uint64_t starved = 0;       // no other IN transfer was queued
+    uint64_t bytes = 0;
+    uint64_t latency_us = 0;    // sum of submit-to-completion times
+    uint64_t quiet_windows = 0; // consecutive windows without starvation
 };
 
 class USBTransportImpl {
@@ -35,92 +73,307 @@ public:
     std::thread event_thread;
     std::atomic<bool> running{false};
 
-    std::mutex rx_m;
-    std::deque<std::vector<uint8_t>> rx_q;
+    // polled mode: no event thread, the caller pumps events via poll()
+    bool polled = false;
+
+    // transfer data is cut into whole frames before it is queued, so the
+    // queue's overload policy never drops part of a packet
+    FrameSplitter splitter;
+    FrameQueue rx_q{"usb-rx"};
+    ChunkReader reader;
+
+    Counter& xfer_done = metrics().counter(
+        "soupy_usb_in_transfers_total", "Completed bulk IN transfers");
+    Counter& xfer_errors = metrics().counter(
+        "soupy_usb_in_transfer_errors_total", "Bulk IN transfers that did not complete");
+    Counter& in_bytes = metrics().counter(
+        "soupy_usb_in_bytes_total", "Bytes received on bulk IN");
+    Counter& resubmit_failures = metrics().counter(
+        "soupy_usb_resubmit_failures_total", "Failed bulk IN resubmissions");
+    Counter& out_failures = metrics().counter(
+        "soupy_usb_out_failures_total", "Failed bulk OUT transfers");
+
+    Gauge& pool_gauge = metrics().gauge(
+        "soupy_usb_in_transfers", "Bulk IN transfers kept in flight");
+    Gauge& size_gauge = metrics().gauge(
+        "soupy_usb_in_xfer_size_bytes", "Bulk IN transfer buffer size");
+    LatencyHistogram& xfer_latency = metrics().histogram(
+        "soupy_usb_in_latency_us", "Bulk IN submit to completion time");
+
+    TransportConfig cfg;
+
+    // pool; contexts are only added or resized on the event thread once
+    // streaming has started
+    std::vector<std::unique_ptr<InXferCtx>> in_ctx;
+    int target_count = 0;
+    int target_size = 0;
+    std::atomic<int> in_flight{0};
+    AdaptWindow win;
+
+    static int round_size(int n)
+    {
+        n = (n + MAX_PACKET - 1) / MAX_PACKET * MAX_PACKET;
+        if (n < MIN_IN_XFER_SIZE) n = MIN_IN_XFER_SIZE;
+        if (n > MAX_IN_XFER_SIZE) n = MAX_IN_XFER_SIZE;
+        return n;
+    }
+
+    static int clamp_count(int n)
+    {
+        return n < MIN_IN_TRANSFERS ? MIN_IN_TRANSFERS
+             : n > MAX_IN_TRANSFERS ? MAX_IN_TRANSFERS : n;
+    }
 
-    InXferCtx in_ctx[NUM_IN_TRANSFERS]{};
+    bool submit(InXferCtx& c)
+    {
+        if (c.size != target_size) {
+            uint8_t* nb = (uint8_t*)std::realloc(c.buf, (size_t)target_size);
+            if (!nb) return false;
+            c.buf = nb;
+            c.size = target_size;
+        }
+
+        libusb_fill_bulk_transfer(
+            c.xfer,
+            handle,
+            EP_IN,
+            c.buf,
+            c.size,
+            &USBTransportImpl::on_in_transfer,
+            &c,
+            cfg.usb_timeout_ms // 0 = unlimited (fine for async; events thread handles it)
+        );
+
+        c.submitted = Clock::now();
+        c.in_flight = true;
+        in_flight.fetch_add(1);
+
+        if (libusb_submit_transfer(c.xfer) != 0) {
+            c.in_flight = false;
+            in_flight.fetch_sub(1);
+            return false;
+        }
+        return true;
+    }
+
+    // Bring the number of in-flight transfers up to target_count, reusing
+    // idle contexts before allocating new ones.
+    bool fill_pool()
+    {
+        int active = 0;
+        for (auto& c : in_ctx)
+            if (c->in_flight) active++;
+
+        for (auto& c : in_ctx) {
+            if (active >= target_count) return true;
+            if (c->in_flight) continue;
+            if (!submit(*c)) return false;
+            active++;
+        }
+
+        while (active < target_count) {
+            auto c = std::make_unique<InXferCtx>();
+            c->owner = this;
+            c->xfer = libusb_alloc_transfer(0);
+            if (!c->xfer) return false;
+
+            in_ctx.push_back(std::move(c));
+            if (!submit(*in_ctx.back())) return false;
+            active++;
+        }
+        return true;
+    }
+
+    void adapt(Clock::time_point now)
+    {
+        if (now - win.start < ADAPT_WINDOW)
+            return;
+
+        int count = target_count;
+        int size  = target_size;
+
+        if (win.completions) {
+            double secs = std::chrono::duration<double>(now - win.start).count();
+            double rate = (double)win.bytes / secs;
+
+            // Size: big enough for ADAPT_FILL_TIME of traffic, so a
+            // backlogged device completes a transfer about once per frame
+            // instead of waiting to fill a huge buffer.
+            double fill_s = std::chrono::duration<double>(ADAPT_FILL_TIME).count();
+            int want = (int)(rate * fill_s);
+            want = round_size(want < ADAPT_MIN_SIZE ? ADAPT_MIN_SIZE : want);
+
+            // hysteresis: don't reallocate the pool over small rate wobble
+            if (want * 4 > size * 5 || want * 5 < size * 4)
+                size = want;
+
+            // Count: transfers that fill up mean the device has a backlog,
+            // and a completion with nothing else queued means it had to
+            // NAK; both ask for more in flight. Unless backlogged, a long
+            // mean completion time means transfers sit queued behind each
+            // other waiting for data: then a starved completion is the
+            // device pausing, not the pool running dry, and the pool
+            // shrinks straight away. Otherwise shrink after a quiet spell.
+            bool backlog = win.full * 2 > win.completions;
+            bool starved = win.starved * 100 > win.completions;
+            bool idle = !backlog &&
+                win.latency_us / win.completions > (uint64_t)
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        ADAPT_IDLE_LATENCY).count();
+
+            if (backlog || (starved && !idle)) {
+                count = clamp_count(count + 2);
+                win.quiet_windows = 0;
+            } else if (idle || ++win.quiet_windows >= 8) {
+                count = clamp_count(count - 1);
+                win.quiet_windows = 0;
+            }
+        }
+
+        if (count != target_count || size != target_size) {
+            SOUPY_LOG("[USB] adapt: transfers %d -> %d, size %d -> %d "
+                      "(%.0f B/s, %llu completions, mean %llu us)\n",
+                target_count, count, target_size, size,
+                (double)win.bytes * 1000.0 /
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        now - win.start).count(),
+                (unsigned long long)win.completions,
+                (unsigned long long)(win.completions
+                    ? win.latency_us / win.completions : 0));
+
+            target_count = count;
+            target_size  = size;
+            pool_gauge.set(count);
+            size_gauge.set(size);
+        }
+
+        uint64_t quiet = win.quiet_windows;
+        win = AdaptWindow{};
+        win.start = now;
+        win.quiet_windows = quiet;
+    }
 
     static void LIBUSB_CALL on_in_transfer(libusb_transfer* t)
     {
-        auto* self = reinterpret_cast<USBTransportImpl*>(t->user_data);
-        if (!self || !self->running.load()) return;
+        auto* c = reinterpret_cast<InXferCtx*>(t->user_data);
+        auto* self = c->owner;
+
+        c->in_flight = false;
+        int others = self->in_flight.fetch_sub(1) - 1;
+
+        if (!self->running.load()) return;
+
+        auto now = Clock::now();
+
+        if (t->status == LIBUSB_TRANSFER_COMPLETED) {
+            uint64_t lat_us = (uint64_t)
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    now - c->submitted).count();
+
+            self->xfer_done.inc();
+            self->xfer_latency.record(lat_us);
+
+            self->win.completions++;
+            self->win.latency_us += lat_us;
+            self->win.bytes += (uint64_t)t->actual_length;
+            if (t->actual_length == t->length) self->win.full++;
+            if (others == 0) self->win.starved++;
+        }
+        else {
+            self->xfer_errors.inc();
+            SOUPY_LOG_RATE(10, "[USB] IN transfer failed: status=%d\n",
+                (int)t->status);
+        }
 
         if (t->status == LIBUSB_TRANSFER_COMPLETED && t->actual_length > 0) {
-            std::vector<uint8_t> chunk((size_t)t->actual_length);
-            std::memcpy(chunk.data(), t->buffer, (size_t)t->actual_length);
-
-            {
-                std::lock_guard<std::mutex> lk(self->rx_m);
-                self->rx_q.push_back(std::move(chunk));
-                // optional: cap queue size to avoid runaway memory
-                if (self->rx_q.size() > 256) self->rx_q.pop_front();
-            }
+            self->in_bytes.inc((uint64_t)t->actual_length);
+
+            TraceScope trace("usb complete", -1, (uint32_t)t->actual_length);
+
+            Chunk chunk;
+            chunk.reserve((size_t)t->actual_length);
+            self->splitter.feed(t->buffer, (size_t)t->actual_length,
+                [&](const uint8_t* f, size_t n) {
+                    if (chunk.empty())
+                        chunk.seq = wire::Header::seq::load(f);
+                    chunk.append(f, n);
+                });
+            trace.seq = chunk.seq;
+
+            // with the block policy this stalls the event loop, which in
+            // turn stops resubmission and lets the device NAK
+            self->rx_q.push(std::move(chunk), &self->running);
         }
 
-        // resubmit to keep streaming (unless shutting down)
-        if (self->running.load()) {
-            int r = libusb_submit_transfer(t);
-            if (r != 0) {
-                // If resubmission fails, stop running
-                self->running.store(false);
-            }
+        if (!self->running.load()) return;
+
+        if (self->cfg.usb_adaptive)
+            self->adapt(now);
+
+        // resubmit to keep streaming, unless the pool is shrinking
+        int active = others + 1;
+        bool ok = true;
+
+        if (active <= self->target_count)
+            ok = self->submit(*c);
+
+        if (ok && active < self->target_count)
+            ok = self->fill_pool();
+
+        if (!ok) {
+            // If resubmission fails, stop running
+            self->resubmit_failures.inc();
+            SOUPY_LOG("[USB] IN resubmit failed, stopping\n");
+            self->running.store(false);
         }
     }
 
     bool start_async_in()
     {
-        for (int i = 0; i < NUM_IN_TRANSFERS; ++i) {
-            in_ctx[i].buf = (uint8_t*)std::malloc(IN_XFER_SIZE);
-            if (!in_ctx[i].buf) return false;
-
-            in_ctx[i].xfer = libusb_alloc_transfer(0);
-            if (!in_ctx[i].xfer) return false;
-
-            libusb_fill_bulk_transfer(
-                in_ctx[i].xfer,
-                handle,
-                EP_IN,
-                in_ctx[i].buf,
-                IN_XFER_SIZE,
-                &USBTransportImpl::on_in_transfer,
-                this,
-                0 // timeout: 0 = unlimited (fine for async; events thread handles it)
-            );
-
-            int r = libusb_submit_transfer(in_ctx[i].xfer);
-            if (r != 0) return false;
-        }
-        return true;
+        target_count = clamp_count(cfg.usb_transfers);
+        target_size  = round_size(cfg.usb_xfer_size);
+
+        pool_gauge.set(target_count);
+        size_gauge.set(target_size);
+
+        win = AdaptWindow{};
+        win.start = Clock::now();
+
+        return fill_pool();
     }
 
     void stop_async_in()
     {
-        for (int i = 0; i < NUM_IN_TRANSFERS; ++i) {
-            if (in_ctx[i].xfer) {
-                libusb_cancel_transfer(in_ctx[i].xfer);
+        for (auto& c : in_ctx) {
+            if (c->xfer && c->in_flight) {
+                libusb_cancel_transfer(c->xfer);
             }
         }
 
         // pump events a bit so cancellations complete
-        for (int i = 0; i < 50; ++i) {
+        for (int i = 0; i < 50 && in_flight.load() > 0; ++i) {
             timeval tv{0, 10'000}; // 10ms
             libusb_handle_events_timeout(ctx, &tv);
         }
 
-        for (int i = 0; i < NUM_IN_TRANSFERS; ++i) {
-            if (in_ctx[i].xfer) {
-                libusb_free_transfer(in_ctx[i].xfer);
-                in_ctx[i].xfer = nullptr;
+        for (auto& c : in_ctx) {
+            if (c->xfer) {
+                libusb_free_transfer(c->xfer);
+                c->xfer = nullptr;
             }
-            if (in_ctx[i].buf) {
-                std::free(in_ctx[i].buf);
-                in_ctx[i].buf = nullptr;
+            if (c->buf) {
+                std::free(c->buf);
+                c->buf = nullptr;
             }
         }
+        in_ctx.clear();
     }
 
     void event_loop()
     {
+#ifdef __linux__
+        pthread_setname_np(pthread_self(), "soupy-usb");
+#endif
         while (running.load()) {
             timeval tv{0, 50'000}; // 50ms
             libusb_handle_events_timeout(ctx, &tv);
@@ -163,7 +416,8 @@ public:
             return false;
         }
 
-        event_thread = std::thread([this](){ event_loop(); });
+        if (!polled)
+            event_thread = std::thread([this](){ event_loop(); });
 
         std::printf("USB async RX started\n");
         return true;
@@ -172,6 +426,7 @@ public:
     void close()
     {
         running.store(false);
+        rx_q.wake_all();
 
         stop_async_in();
 
@@ -187,27 +442,21 @@ public:
             libusb_exit(ctx);
             ctx = nullptr;
         }
+
+        if (cfg.print_stats)
+            rx_q.print_stats();
+        rx_q.clear();
     }
 
-    int read(uint8_t* out, int maxlen)
+    void poll(int timeout_us)
     {
-        std::lock_guard<std::mutex> lk(rx_m);
-        if (rx_q.empty()) return 0;
-
-        auto& front = rx_q.front();
-        int n = (int)front.size();
-        if (n > maxlen) n = maxlen;
-
-        std::memcpy(out, front.data(), (size_t)n);
-
-        // if chunk larger than maxlen, keep remainder
-        if ((size_t)n < front.size()) {
-            front.erase(front.begin(), front.begin() + n);
-        } else {
-            rx_q.pop_front();
-        }
+        timeval tv{0, timeout_us};
+        libusb_handle_events_timeout_completed(ctx, &tv, nullptr);
+    }
 
-        return n;
+    int read(uint8_t* out, int maxlen)
+    {
+        return reader.read(rx_q, out, maxlen);
     }
 
     int write(const uint8_t* data, int len)
@@ -218,7 +467,10 @@ public:
                                      (unsigned char*)data, len,
                                      &transferred,
                                      10 /*ms timeout*/);
-        if (r != 0) return 0;
+        if (r != 0) {
+            out_failures.inc();
+            return 0;
+        }
         return transferred;
     }
 };
@@ -226,7 +478,17 @@ public:
 // one instance owned by USBTransport wrapper
 static USBTransportImpl g_usb;
 
-bool USBTransport::open() { return g_usb.open(); }
+bool USBTransport::open()
+{
+    g_usb.cfg = cfg;
+    g_usb.rx_q.configure(transport_rx_queue(cfg, g_usb.polled), cfg.budget);
+    if (cfg.prefault)
+        g_usb.rx_q.prefault();
+    return g_usb.open();
+}
+
 int  USBTransport::read(uint8_t* b, int n) { return g_usb.read(b, n); }
 int  USBTransport::write(const uint8_t* b, int n) { return g_usb.write(b, n); }
 void USBTransport::close() { g_usb.close(); }
+void USBTransport::set_polled(bool p) { g_usb.polled = p; }
+void USBTransport::poll(int timeout_us) { g_usb.poll(timeout_us); }
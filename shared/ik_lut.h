@@ -0,0 +1,373 @@
+//
+// Finger IK lookup table.
+//
+// C port of solve_to_distal() from firmware/py/test.py plus a table that
+// precomputes its joint solutions over the distal angle range. The exact
+// solver only depends on the fixed link lengths and joint limits, so the
+// table is built once, offline (middleware --ik-check / --ik-gen, which
+// writes firmware/ik_lut_table.h), and lookups are a single linear
+// interpolation.
+//
+// Header-only so it can be shared by the firmware (C) and middleware (C++).
+//
+
+#ifndef IK_LUT_H
+#define IK_LUT_H
+
+#include <math.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------- config ----------------
+
+// Distal angle range covered by the table (matches the slider in test.py)
+#define IK_DISTAL_MIN_DEG  (-180.0f)
+#define IK_DISTAL_MAX_DEG  ( 180.0f)
+
+// Upper bound on table size; 0.5 deg steps over 360 deg take ~12 KB.
+// The firmware lowers this to 361 (1 deg steps, ~6 KB).
+#ifndef IK_LUT_MAX_ENTRIES
+#define IK_LUT_MAX_ENTRIES 721
+#endif
+
+#define IK_NUM_JOINTS 4
+
+#define IK_WRIST_TOL     0.15    // reachable: wrist within this of target
+#define IK_CCD_TOL       1e-4    // CCD runs to this, or until it stalls
+#define IK_CCD_ITERS     200
+#define IK_DIST_STEPS    160
+#define IK_REFINE_STEPS  16      // bisections of the first reachable step
+
+// error check: exact solves per table cell, spread across the cell
+#ifndef IK_LUT_CHECK_SAMPLES
+#define IK_LUT_CHECK_SAMPLES 16
+#endif
+
+static const double IK_L[IK_NUM_JOINTS] = { 6.0, 5.0, 3.0, 2.5 };
+
+// min, max, rest (degrees)
+static const double IK_LIMITS[IK_NUM_JOINTS][3] = {
+    {   0,   0,   0 },  // joint 1 fixed
+    { -30,  90, -10 },  // joint 2
+    {   0, 110,  10 },  // joint 3
+    { -10,  90,  10 },  // joint 4
+};
+
+// ---------------- exact solver ----------------
+
+typedef struct {
+    double j[IK_NUM_JOINTS];   // last solution, used as the CCD seed
+} ik_state_t;
+
+static inline void ik_state_init(ik_state_t* s)
+{
+    for (int i = 0; i < IK_NUM_JOINTS; ++i)
+        s->j[i] = IK_LIMITS[i][2];
+}
+
+static inline double ik_clamp(double v, double mn, double mx)
+{
+    return v < mn ? mn : v > mx ? mx : v;
+}
+
+static inline double ik_wrap180(double d)
+{
+    d = fmod(d + 180.0, 360.0);
+    if (d < 0) d += 360.0;
+    return d - 180.0;
+}
+
+#define IK_PI 3.14159265358979323846
+
+static inline double ik_rad(double d) { return d * (IK_PI / 180.0); }
+static inline double ik_deg(double r) { return r * (180.0 / IK_PI); }
+
+// p1, p2 and wrist of the chain [0, j2, j3, 0]
+static inline void ik_wrist_points(double j2, double j3, double pts[3][2])
+{
+    double t2 = ik_rad(j2);
+    double t3 = t2 + ik_rad(j3);
+
+    pts[0][0] = IK_L[0];
+    pts[0][1] = 0.0;
+    pts[1][0] = pts[0][0] + IK_L[1] * cos(t2);
+    pts[1][1] = pts[0][1] + IK_L[1] * sin(t2);
+    pts[2][0] = pts[1][0] + IK_L[2] * cos(t3);
+    pts[2][1] = pts[1][1] + IK_L[2] * sin(t3);
+}
+
+static inline double ik_dist(const double a[2], const double b[2])
+{
+    return hypot(a[0] - b[0], a[1] - b[1]);
+}
+
+// rotate joint around pivot so that 'end' swings towards 'target'
+static inline double ik_ccd_step(
+    double j, double mn, double mx,
+    const double pivot[2], const double end[2], const double target[2])
+{
+    double v1x = end[0] - pivot[0],    v1y = end[1] - pivot[1];
+    double v2x = target[0] - pivot[0], v2y = target[1] - pivot[1];
+
+    if (hypot(v1x, v1y) > 1e-6 && hypot(v2x, v2y) > 1e-6)
+    {
+        double a1 = atan2(v1y, v1x);
+        double a2 = atan2(v2y, v2x);
+        j += ik_wrap180(ik_deg(a2 - a1));
+        j = ik_clamp(j, mn, mx);
+    }
+    return j;
+}
+
+static inline double ik_solve_wrist(
+    const double target[2], double* j2, double* j3)
+{
+    double pts[3][2];
+    double prev = HUGE_VAL;
+
+    *j2 = ik_clamp(*j2, IK_LIMITS[1][0], IK_LIMITS[1][1]);
+    *j3 = ik_clamp(*j3, IK_LIMITS[2][0], IK_LIMITS[2][1]);
+
+    for (int it = 0; it < IK_CCD_ITERS; ++it)
+    {
+        // converged, or stuck against a limit / out of reach
+        ik_wrist_points(*j2, *j3, pts);
+        double d = ik_dist(pts[2], target);
+        if (d < IK_CCD_TOL || prev - d < 1e-9) break;
+        prev = d;
+
+        *j3 = ik_ccd_step(*j3, IK_LIMITS[2][0], IK_LIMITS[2][1],
+                          pts[1], pts[2], target);
+
+        ik_wrist_points(*j2, *j3, pts);
+        if (ik_dist(pts[2], target) < IK_CCD_TOL) break;
+
+        *j2 = ik_ccd_step(*j2, IK_LIMITS[1][0], IK_LIMITS[1][1],
+                          pts[0], pts[2], target);
+    }
+
+    ik_wrist_points(*j2, *j3, pts);
+    return ik_dist(pts[2], target);
+}
+
+// One candidate of the search: the wrist target 'dist' along the distal
+// ray, solved from the seed. Returns 1 with the pose if it is reachable.
+static inline int ik_try_dist(
+    const ik_state_t* seed, double distal_deg, double dist,
+    double out[IK_NUM_JOINTS])
+{
+    double distal = ik_rad(distal_deg);
+    double ray    = distal - IK_PI / 2;
+    double target[2] = {
+        cos(ray) * dist - cos(distal) * IK_L[3],
+        sin(ray) * dist - sin(distal) * IK_L[3],
+    };
+
+    double j2 = seed->j[1];
+    double j3 = seed->j[2];
+    if (ik_solve_wrist(target, &j2, &j3) > IK_WRIST_TOL)
+        return 0;
+
+    double j4 = distal_deg - (0.0 + j2 + j3);
+    if (j4 < IK_LIMITS[3][0] || j4 > IK_LIMITS[3][1])
+        return 0;
+
+    out[0] = 0.0;
+    out[1] = j2;
+    out[2] = j3;
+    out[3] = j4;
+    return 1;
+}
+
+// Exact solver, the search of solve_to_distal() in test.py: the longest
+// wrist distance along the distal ray that the wrist reaches. Two changes
+// make the answer a continuous function of the distal angle, which the
+// table needs: CCD runs to convergence instead of stopping at the
+// reachability tolerance, and the first reachable distance step is
+// bisected towards the last unreachable one. Seeds from and updates
+// 'state'; returns 0 and keeps the previous solution when no reachable
+// pose is found.
+static inline int ik_solve_to_distal(
+    ik_state_t* state, double distal_deg, double out[IK_NUM_JOINTS])
+{
+    double total = IK_L[0] + IK_L[1] + IK_L[2] + IK_L[3];
+    double step  = total / (IK_DIST_STEPS - 1);
+    double sol[IK_NUM_JOINTS];
+    int found = 0;
+
+    for (int i = 0; i < IK_DIST_STEPS; ++i)
+    {
+        double dist = total - i * step;
+        if (!ik_try_dist(state, distal_deg, dist, sol))
+            continue;
+
+        // reach boundary between this step and the previous one
+        double lo = dist, hi = dist + step;
+        for (int b = 0; i > 0 && b < IK_REFINE_STEPS; ++b)
+        {
+            double mid = 0.5 * (lo + hi);
+            double s[IK_NUM_JOINTS];
+            if (ik_try_dist(state, distal_deg, mid, s))
+            {
+                lo = mid;
+                for (int k = 0; k < IK_NUM_JOINTS; ++k)
+                    sol[k] = s[k];
+            }
+            else
+                hi = mid;
+        }
+
+        for (int k = 0; k < IK_NUM_JOINTS; ++k)
+            state->j[k] = sol[k];
+        found = 1;
+        break;
+    }
+
+    for (int k = 0; k < IK_NUM_JOINTS; ++k)
+        out[k] = state->j[k];
+
+    return found;
+}
+
+// ---------------- lookup table ----------------
+
+typedef struct {
+    float    min_deg;
+    float    step_deg;
+    float    inv_step;
+    uint16_t count;
+    uint16_t reachable_count;
+    float    max_err_deg;   // worst |lut - exact| wherever lookup is valid
+    uint16_t edge_cells;    // cells with one reachable node: lookup invalid
+    uint32_t uncovered;     // check samples the solver reaches, lookup not
+    uint32_t spurious;      // check samples lookup covers, solver doesn't
+    float    joints[IK_LUT_MAX_ENTRIES][IK_NUM_JOINTS];
+    uint8_t  reachable[IK_LUT_MAX_ENTRIES];
+} ik_lut_t;
+
+typedef enum {
+    IK_LUT_OK = 0,
+    IK_LUT_TOO_FINE,        // step needs more than IK_LUT_MAX_ENTRIES
+    IK_LUT_OVER_BOUND,      // built, but max_err_deg > the bound
+} ik_lut_status_t;
+
+static inline int ik_lut_lookup(
+    const ik_lut_t* lut, float distal_deg, float out[IK_NUM_JOINTS]);
+
+// Build the table at 'step_deg' resolution. Every node is solved from the
+// rest pose, so a node does not depend on its neighbours or the build
+// order. The interpolation error is then measured against the exact
+// solver at IK_LUT_CHECK_SAMPLES points across every cell, edge cells
+// included: where lookup reports a pose the error counts towards
+// max_err_deg, where it reports none but the solver finds one the sample
+// is uncovered. Returns IK_LUT_OVER_BOUND if max_err_deg exceeds
+// bound_deg (bound_deg <= 0: no bound).
+static inline ik_lut_status_t ik_lut_build(
+    ik_lut_t* lut, float step_deg, float bound_deg)
+{
+    float span = IK_DISTAL_MAX_DEG - IK_DISTAL_MIN_DEG;
+    if (step_deg <= 0.0f)
+        return IK_LUT_TOO_FINE;
+
+    int count = (int)ceilf(span / step_deg) + 1;
+    if (count > IK_LUT_MAX_ENTRIES)
+        return IK_LUT_TOO_FINE;
+
+    lut->min_deg  = IK_DISTAL_MIN_DEG;
+    lut->step_deg = step_deg;
+    lut->inv_step = 1.0f / step_deg;
+    lut->count    = (uint16_t)count;
+    lut->reachable_count = 0;
+
+    ik_state_t st;
+    double sol[IK_NUM_JOINTS];
+
+    for (int i = 0; i < count; ++i)
+    {
+        ik_state_init(&st);
+        lut->reachable[i] = (uint8_t)ik_solve_to_distal(
+            &st, lut->min_deg + i * step_deg, sol);
+        lut->reachable_count += lut->reachable[i];
+
+        for (int k = 0; k < IK_NUM_JOINTS; ++k)
+            lut->joints[i][k] = (float)sol[k];
+    }
+
+    float worst = 0.0f;
+    lut->edge_cells = 0;
+    lut->uncovered = 0;
+    lut->spurious = 0;
+
+    for (int i = 0; i + 1 < count; ++i)
+    {
+        if (lut->reachable[i] != lut->reachable[i + 1])
+            lut->edge_cells++;
+
+        for (int n = 1; n <= IK_LUT_CHECK_SAMPLES; ++n)
+        {
+            float a = lut->min_deg +
+                (i + (float)n / (IK_LUT_CHECK_SAMPLES + 1)) * step_deg;
+
+            float got[IK_NUM_JOINTS];
+            int valid = ik_lut_lookup(lut, a, got);
+
+            ik_state_init(&st);
+            int found = ik_solve_to_distal(&st, a, sol);
+
+            if (found && !valid)
+                lut->uncovered++;
+            if (valid && !found)
+                lut->spurious++;
+            if (!found || !valid)
+                continue;
+
+            for (int k = 0; k < IK_NUM_JOINTS; ++k)
+            {
+                float err = fabsf(got[k] - (float)sol[k]);
+                if (err > worst) worst = err;
+            }
+        }
+    }
+    lut->max_err_deg = worst;
+
+    if (bound_deg > 0.0f && worst > bound_deg)
+        return IK_LUT_OVER_BOUND;
+    return IK_LUT_OK;
+}
+
+// O(1) lookup: clamp into range and interpolate between the two nearest
+// table entries. Returns 0 (and leaves 'out' alone) when either entry is
+// unreachable, i.e. there is no pose to interpolate.
+static inline int ik_lut_lookup(
+    const ik_lut_t* lut, float distal_deg, float out[IK_NUM_JOINTS])
+{
+    float pos = (distal_deg - lut->min_deg) * lut->inv_step;
+    int last = lut->count - 1;
+
+    if (pos <= 0.0f) pos = 0.0f;
+    if (pos >= (float)last) pos = (float)last;
+
+    int i = (int)pos;
+    if (i >= last) i = last - 1;
+    float t = pos - (float)i;
+
+    if (!lut->reachable[i] || !lut->reachable[i + 1])
+        return 0;
+
+    for (int k = 0; k < IK_NUM_JOINTS; ++k)
+    {
+        float a = lut->joints[i][k];
+        float b = lut->joints[i + 1][k];
+        out[k] = a + (b - a) * t;
+    }
+    return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IK_LUT_H
@@ -0,0 +1,469 @@
+//
+// Packet codec.
+//
+// Encoder and decoder for the glove <-> host wire format:
+//
+//   PacketHeader  magic 0xA55A (u16), size (u16, payload bytes),
+//                 seq (u16), type (u8)                      7 bytes
+//   payload       'size' bytes
+//   CRC32         over header + payload (IEEE, reflected)   4 bytes
+//
+// All multi-byte fields are little-endian. Encoders write into a caller
+// buffer and decoders return pointers into the caller's bytes; nothing
+// allocates, so the same code runs in the firmware, the sim, the fake
+// libusb device and the middleware TX path.
+//
+// Header-only so it can be shared by the firmware (C) and middleware (C++).
+//
+
+#ifndef PACKET_CODEC_H
+#define PACKET_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------- wire format ----------------
+
+#define PKT_MAGIC           0xA55A
+#define PKT_HEADER_SIZE     7
+#define PKT_CRC_SIZE        4
+#define PKT_OVERHEAD        (PKT_HEADER_SIZE + PKT_CRC_SIZE)
+
+#define PKT_TYPE_FINGERS    1
+#define PKT_TYPE_HEARTBEAT  2
+#define PKT_TYPE_TIME_REPLY 3
+#define PKT_TYPE_PROBE      4
+#define PKT_TYPE_FORCES     5
+
+#pragma pack(push, 1)
+
+typedef struct {
+    uint16_t magic;
+    uint16_t size;
+    uint16_t seq;
+    uint8_t  type;
+} pkt_header_t;
+
+typedef struct {
+    double   x;
+    double   y;
+    double   z;
+    uint32_t state_array;
+    float    temp;
+} pkt_finger_t;
+
+typedef struct {
+    int16_t fx;
+    int16_t fy;
+    int16_t fz;
+} pkt_force_t;
+
+#pragma pack(pop)
+
+#ifdef __cplusplus
+static_assert(sizeof(pkt_header_t) == PKT_HEADER_SIZE, "header layout");
+static_assert(sizeof(pkt_finger_t) == 32, "finger layout");
+static_assert(sizeof(pkt_force_t) == 6, "force layout");
+#else
+_Static_assert(sizeof(pkt_header_t) == PKT_HEADER_SIZE, "header layout");
+_Static_assert(sizeof(pkt_finger_t) == 32, "finger layout");
+_Static_assert(sizeof(pkt_force_t) == 6, "force layout");
+#endif
+
+// type 1: u64 timestamp_us, u8 count, pkt_finger_t[count]
+#define PKT_FINGERS_FIXED   9
+#define PKT_FINGERS_FRAME(count) \
+    (PKT_OVERHEAD + PKT_FINGERS_FIXED + (count) * sizeof(pkt_finger_t))
+
+// type 2 (host -> device): u8 flags (1), u64 host send time in us.
+// Older hosts send the flags byte only.
+#define PKT_HEARTBEAT_FRAME (PKT_OVERHEAD + 9)
+
+// type 3 (device -> host), answer to a timed heartbeat:
+// u64 host send time (echoed), u64 device receive time, u64 device send
+// time, all in us of the respective clock
+#define PKT_TIME_REPLY_FRAME (PKT_OVERHEAD + 24)
+
+// type 4 (host -> device -> host), link probe echoed verbatim:
+// u64 host send time in us, then 'pad' filler bytes. The firmware takes
+// commands of up to one 64-byte packet (CMD_FRAME_MAX), so probes stay
+// within that.
+#define PKT_PROBE_FIXED     8
+#define PKT_PROBE_FRAME(pad) (PKT_OVERHEAD + PKT_PROBE_FIXED + (pad))
+#define PKT_PROBE_MAX_PAD   (64 - PKT_PROBE_FRAME(0))
+
+// type 5 (host -> device): u8 count, pkt_force_t[count], the force to
+// render on each finger in mN (i16 per axis, little-endian). Up to
+// PKT_FORCES_MAX fingers fit one 64-byte packet.
+#define PKT_FORCES_FIXED    1
+#define PKT_FORCES_FRAME(count) \
+    (PKT_OVERHEAD + PKT_FORCES_FIXED + (count) * sizeof(pkt_force_t))
+#define PKT_FORCES_MAX      ((64 - PKT_FORCES_FRAME(0)) / sizeof(pkt_force_t))
+
+// ---------------- CRC32 ----------------
+
+static const uint32_t PKT_CRC_TABLE[256] = {
+    0x00000000u, 0x77073096u, 0xEE0E612Cu, 0x990951BAu, 0x076DC419u, 0x706AF48Fu,
+    0xE963A535u, 0x9E6495A3u, 0x0EDB8832u, 0x79DCB8A4u, 0xE0D5E91Eu, 0x97D2D988u,
+    0x09B64C2Bu, 0x7EB17CBDu, 0xE7B82D07u, 0x90BF1D91u, 0x1DB71064u, 0x6AB020F2u,
+    0xF3B97148u, 0x84BE41DEu, 0x1ADAD47Du, 0x6DDDE4EBu, 0xF4D4B551u, 0x83D385C7u,
+    0x136C9856u, 0x646BA8C0u, 0xFD62F97Au, 0x8A65C9ECu, 0x14015C4Fu, 0x63066CD9u,
+    0xFA0F3D63u, 0x8D080DF5u, 0x3B6E20C8u, 0x4C69105Eu, 0xD56041E4u, 0xA2677172u,
+    0x3C03E4D1u, 0x4B04D447u, 0xD20D85FDu, 0xA50AB56Bu, 0x35B5A8FAu, 0x42B2986Cu,
+    0xDBBBC9D6u, 0xACBCF940u, 0x32D86CE3u, 0x45DF5C75u, 0xDCD60DCFu, 0xABD13D59u,
+    0x26D930ACu, 0x51DE003Au, 0xC8D75180u, 0xBFD06116u, 0x21B4F4B5u, 0x56B3C423u,
+    0xCFBA9599u, 0xB8BDA50Fu, 0x2802B89Eu, 0x5F058808u, 0xC60CD9B2u, 0xB10BE924u,
+    0x2F6F7C87u, 0x58684C11u, 0xC1611DABu, 0xB6662D3Du, 0x76DC4190u, 0x01DB7106u,
+    0x98D220BCu, 0xEFD5102Au, 0x71B18589u, 0x06B6B51Fu, 0x9FBFE4A5u, 0xE8B8D433u,
+    0x7807C9A2u, 0x0F00F934u, 0x9609A88Eu, 0xE10E9818u, 0x7F6A0DBBu, 0x086D3D2Du,
+    0x91646C97u, 0xE6635C01u, 0x6B6B51F4u, 0x1C6C6162u, 0x856530D8u, 0xF262004Eu,
+    0x6C0695EDu, 0x1B01A57Bu, 0x8208F4C1u, 0xF50FC457u, 0x65B0D9C6u, 0x12B7E950u,
+    0x8BBEB8EAu, 0xFCB9887Cu, 0x62DD1DDFu, 0x15DA2D49u, 0x8CD37CF3u, 0xFBD44C65u,
+    0x4DB26158u, 0x3AB551CEu, 0xA3BC0074u, 0xD4BB30E2u, 0x4ADFA541u, 0x3DD895D7u,
+    0xA4D1C46Du, 0xD3D6F4FBu, 0x4369E96Au, 0x346ED9FCu, 0xAD678846u, 0xDA60B8D0u,
+    0x44042D73u, 0x33031DE5u, 0xAA0A4C5Fu, 0xDD0D7CC9u, 0x5005713Cu, 0x270241AAu,
+    0xBE0B1010u, 0xC90C2086u, 0x5768B525u, 0x206F85B3u, 0xB966D409u, 0xCE61E49Fu,
+    0x5EDEF90Eu, 0x29D9C998u, 0xB0D09822u, 0xC7D7A8B4u, 0x59B33D17u, 0x2EB40D81u,
+    0xB7BD5C3Bu, 0xC0BA6CADu, 0xEDB88320u, 0x9ABFB3B6u, 0x03B6E20Cu, 0x74B1D29Au,
+    0xEAD54739u, 0x9DD277AFu, 0x04DB2615u, 0x73DC1683u, 0xE3630B12u, 0x94643B84u,
+    0x0D6D6A3Eu, 0x7A6A5AA8u, 0xE40ECF0Bu, 0x9309FF9Du, 0x0A00AE27u, 0x7D079EB1u,
+    0xF00F9344u, 0x8708A3D2u, 0x1E01F268u, 0x6906C2FEu, 0xF762575Du, 0x806567CBu,
+    0x196C3671u, 0x6E6B06E7u, 0xFED41B76u, 0x89D32BE0u, 0x10DA7A5Au, 0x67DD4ACCu,
+    0xF9B9DF6Fu, 0x8EBEEFF9u, 0x17B7BE43u, 0x60B08ED5u, 0xD6D6A3E8u, 0xA1D1937Eu,
+    0x38D8C2C4u, 0x4FDFF252u, 0xD1BB67F1u, 0xA6BC5767u, 0x3FB506DDu, 0x48B2364Bu,
+    0xD80D2BDAu, 0xAF0A1B4Cu, 0x36034AF6u, 0x41047A60u, 0xDF60EFC3u, 0xA867DF55u,
+    0x316E8EEFu, 0x4669BE79u, 0xCB61B38Cu, 0xBC66831Au, 0x256FD2A0u, 0x5268E236u,
+    0xCC0C7795u, 0xBB0B4703u, 0x220216B9u, 0x5505262Fu, 0xC5BA3BBEu, 0xB2BD0B28u,
+    0x2BB45A92u, 0x5CB36A04u, 0xC2D7FFA7u, 0xB5D0CF31u, 0x2CD99E8Bu, 0x5BDEAE1Du,
+    0x9B64C2B0u, 0xEC63F226u, 0x756AA39Cu, 0x026D930Au, 0x9C0906A9u, 0xEB0E363Fu,
+    0x72076785u, 0x05005713u, 0x95BF4A82u, 0xE2B87A14u, 0x7BB12BAEu, 0x0CB61B38u,
+    0x92D28E9Bu, 0xE5D5BE0Du, 0x7CDCEFB7u, 0x0BDBDF21u, 0x86D3D2D4u, 0xF1D4E242u,
+    0x68DDB3F8u, 0x1FDA836Eu, 0x81BE16CDu, 0xF6B9265Bu, 0x6FB077E1u, 0x18B74777u,
+    0x88085AE6u, 0xFF0F6A70u, 0x66063BCAu, 0x11010B5Cu, 0x8F659EFFu, 0xF862AE69u,
+    0x616BFFD3u, 0x166CCF45u, 0xA00AE278u, 0xD70DD2EEu, 0x4E048354u, 0x3903B3C2u,
+    0xA7672661u, 0xD06016F7u, 0x4969474Du, 0x3E6E77DBu, 0xAED16A4Au, 0xD9D65ADCu,
+    0x40DF0B66u, 0x37D83BF0u, 0xA9BCAE53u, 0xDEBB9EC5u, 0x47B2CF7Fu, 0x30B5FFE9u,
+    0xBDBDF21Cu, 0xCABAC28Au, 0x53B39330u, 0x24B4A3A6u, 0xBAD03605u, 0xCDD70693u,
+    0x54DE5729u, 0x23D967BFu, 0xB3667A2Eu, 0xC4614AB8u, 0x5D681B02u, 0x2A6F2B94u,
+    0xB40BBE37u, 0xC30C8EA1u, 0x5A05DF1Bu, 0x2D02EF8Du
+};
+
+static inline uint32_t pkt_crc32_update(uint32_t crc, const uint8_t* data,
+                                        size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        crc = (crc >> 8) ^ PKT_CRC_TABLE[(crc ^ data[i]) & 0xFF];
+    return crc;
+}
+
+static inline uint32_t pkt_crc32(const uint8_t* data, size_t len)
+{
+    return ~pkt_crc32_update(0xFFFFFFFFu, data, len);
+}
+
+// ---------------- little-endian helpers ----------------
+
+static inline void pkt_put_u16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void pkt_put_u32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t pkt_get_u16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t pkt_get_u32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t pkt_get_u64(const uint8_t* p)
+{
+    return (uint64_t)pkt_get_u32(p) | ((uint64_t)pkt_get_u32(p + 4) << 32);
+}
+
+static inline void pkt_put_u64(uint8_t* p, uint64_t v)
+{
+    pkt_put_u32(p, (uint32_t)v);
+    pkt_put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+// ---------------- encoder ----------------
+
+// Two-step encode for any type: pkt_begin() writes the header and
+// returns where the payload goes, the caller fills it in place, and
+// pkt_finish() patches the size and appends the CRC. Returns the frame
+// length, or 0 if 'cap' is too small.
+
+static inline uint8_t* pkt_begin(uint8_t* out, size_t cap,
+                                 uint8_t type, uint16_t seq)
+{
+    if (cap < PKT_OVERHEAD)
+        return NULL;
+
+    pkt_put_u16(out + 0, PKT_MAGIC);
+    pkt_put_u16(out + 2, 0);
+    pkt_put_u16(out + 4, seq);
+    out[6] = type;
+
+    return out + PKT_HEADER_SIZE;
+}
+
+static inline size_t pkt_finish(uint8_t* out, size_t cap, size_t payload_len)
+{
+    if (payload_len > 0xFFFF || cap < PKT_OVERHEAD + payload_len)
+        return 0;
+
+    pkt_put_u16(out + 2, (uint16_t)payload_len);
+
+    size_t body = PKT_HEADER_SIZE + payload_len;
+    pkt_put_u32(out + body, pkt_crc32(out, body));
+
+    return body + PKT_CRC_SIZE;
+}
+
+static inline size_t pkt_encode(uint8_t* out, size_t cap, uint8_t type,
+                                uint16_t seq, const void* payload,
+                                size_t payload_len)
+{
+    if (cap < PKT_OVERHEAD + payload_len)
+        return 0;
+
+    uint8_t* p = pkt_begin(out, cap, type, seq);
+    if (payload_len)
+        memcpy(p, payload, payload_len);
+
+    return pkt_finish(out, cap, payload_len);
+}
+
+// Fingers are copied as laid out in memory; every supported target
+// (RP2350, x86-64, AArch64) is little-endian.
+static inline size_t pkt_encode_fingers(uint8_t* out, size_t cap,
+                                        uint16_t seq, uint64_t timestamp_us,
+                                        const pkt_finger_t* fingers,
+                                        uint8_t count)
+{
+    size_t payload_len = PKT_FINGERS_FIXED + count * sizeof(pkt_finger_t);
+    if (cap < PKT_OVERHEAD + payload_len)
+        return 0;
+
+    uint8_t* p = pkt_begin(out, cap, PKT_TYPE_FINGERS, seq);
+    pkt_put_u64(p, timestamp_us);
+    p[8] = count;
+    memcpy(p + PKT_FINGERS_FIXED, fingers, count * sizeof(pkt_finger_t));
+
+    return pkt_finish(out, cap, payload_len);
+}
+
+static inline size_t pkt_encode_heartbeat(uint8_t* out, size_t cap,
+                                          uint16_t seq, uint64_t host_us)
+{
+    if (cap < PKT_HEARTBEAT_FRAME)
+        return 0;
+
+    uint8_t* p = pkt_begin(out, cap, PKT_TYPE_HEARTBEAT, seq);
+    p[0] = 1;
+    pkt_put_u64(p + 1, host_us);
+
+    return pkt_finish(out, cap, 9);
+}
+
+static inline size_t pkt_encode_time_reply(uint8_t* out, size_t cap,
+                                           uint16_t seq, uint64_t host_tx_us,
+                                           uint64_t dev_rx_us,
+                                           uint64_t dev_tx_us)
+{
+    if (cap < PKT_TIME_REPLY_FRAME)
+        return 0;
+
+    uint8_t* p = pkt_begin(out, cap, PKT_TYPE_TIME_REPLY, seq);
+    pkt_put_u64(p + 0,  host_tx_us);
+    pkt_put_u64(p + 8,  dev_rx_us);
+    pkt_put_u64(p + 16, dev_tx_us);
+
+    return pkt_finish(out, cap, 24);
+}
+
+static inline size_t pkt_encode_probe(uint8_t* out, size_t cap,
+                                      uint16_t seq, uint64_t host_us,
+                                      uint16_t pad)
+{
+    if (cap < (size_t)PKT_PROBE_FRAME(pad))
+        return 0;
+
+    uint8_t* p = pkt_begin(out, cap, PKT_TYPE_PROBE, seq);
+    pkt_put_u64(p, host_us);
+
+    for (uint16_t i = 0; i < pad; ++i)
+        p[PKT_PROBE_FIXED + i] = (uint8_t)(seq + i);
+
+    return pkt_finish(out, cap, PKT_PROBE_FIXED + pad);
+}
+
+static inline size_t pkt_encode_forces(uint8_t* out, size_t cap,
+                                       uint16_t seq,
+                                       const pkt_force_t* forces,
+                                       uint8_t count)
+{
+    size_t payload_len = PKT_FORCES_FIXED + count * sizeof(pkt_force_t);
+    if (cap < PKT_OVERHEAD + payload_len)
+        return 0;
+
+    uint8_t* p = pkt_begin(out, cap, PKT_TYPE_FORCES, seq);
+    p[0] = count;
+
+    for (uint8_t i = 0; i < count; ++i) {
+        uint8_t* f = p + PKT_FORCES_FIXED + i * sizeof(pkt_force_t);
+        pkt_put_u16(f + 0, (uint16_t)forces[i].fx);
+        pkt_put_u16(f + 2, (uint16_t)forces[i].fy);
+        pkt_put_u16(f + 4, (uint16_t)forces[i].fz);
+    }
+
+    return pkt_finish(out, cap, payload_len);
+}
+
+// ---------------- decoder ----------------
+
+typedef enum {
+    PKT_OK = 0,
+    PKT_NEED_MORE,      // not enough bytes for a whole frame yet
+    PKT_BAD_MAGIC,      // not at a frame start: skip one byte
+    PKT_BAD_CRC,        // whole frame present, checksum wrong: skip it
+} pkt_status_t;
+
+typedef struct {
+    uint8_t        type;
+    uint16_t       seq;
+    const uint8_t* payload;     // points into the decoded buffer
+    uint16_t       payload_len;
+    size_t         frame_len;   // bytes to consume
+} pkt_view_t;
+
+// Decodes the frame at the start of buf. On PKT_OK and PKT_BAD_CRC,
+// v->frame_len is the number of bytes the frame occupies.
+static inline pkt_status_t pkt_decode(const uint8_t* buf, size_t len,
+                                      pkt_view_t* v)
+{
+    if (len < 2)
+        return PKT_NEED_MORE;
+    if (pkt_get_u16(buf) != PKT_MAGIC)
+        return PKT_BAD_MAGIC;
+    if (len < PKT_OVERHEAD)
+        return PKT_NEED_MORE;
+
+    v->payload_len = pkt_get_u16(buf + 2);
+    v->seq         = pkt_get_u16(buf + 4);
+    v->type        = buf[6];
+    v->payload     = buf + PKT_HEADER_SIZE;
+    v->frame_len   = PKT_OVERHEAD + v->payload_len;
+
+    if (len < v->frame_len)
+        return PKT_NEED_MORE;
+
+    size_t body = PKT_HEADER_SIZE + v->payload_len;
+    if (pkt_get_u32(buf + body) != pkt_crc32(buf, body))
+        return PKT_BAD_CRC;
+
+    return PKT_OK;
+}
+
+// Type 1 payload. 'fingers' points into the frame (packed, unaligned).
+static inline int pkt_decode_fingers(const pkt_view_t* v,
+                                     uint64_t* timestamp_us,
+                                     const pkt_finger_t** fingers,
+                                     uint8_t* count)
+{
+    if (v->type != PKT_TYPE_FINGERS || v->payload_len < PKT_FINGERS_FIXED)
+        return 0;
+
+    uint8_t n = v->payload[8];
+    if (v->payload_len < PKT_FINGERS_FIXED + n * sizeof(pkt_finger_t))
+        return 0;
+
+    *timestamp_us = pkt_get_u64(v->payload);
+    *fingers = (const pkt_finger_t*)(v->payload + PKT_FINGERS_FIXED);
+    *count = n;
+    return 1;
+}
+
+// Type 2 payload. Returns 1 if the heartbeat carries a host timestamp.
+static inline int pkt_decode_heartbeat(const pkt_view_t* v, uint64_t* host_us)
+{
+    if (v->type != PKT_TYPE_HEARTBEAT || v->payload_len < 9)
+        return 0;
+
+    *host_us = pkt_get_u64(v->payload + 1);
+    return 1;
+}
+
+// Type 3 payload.
+static inline int pkt_decode_time_reply(const pkt_view_t* v,
+                                        uint64_t* host_tx_us,
+                                        uint64_t* dev_rx_us,
+                                        uint64_t* dev_tx_us)
+{
+    if (v->type != PKT_TYPE_TIME_REPLY || v->payload_len < 24)
+        return 0;
+
+    *host_tx_us = pkt_get_u64(v->payload + 0);
+    *dev_rx_us  = pkt_get_u64(v->payload + 8);
+    *dev_tx_us  = pkt_get_u64(v->payload + 16);
+    return 1;
+}
+
+// Type 4 payload.
+static inline int pkt_decode_probe(const pkt_view_t* v, uint64_t* host_us)
+{
+    if (v->type != PKT_TYPE_PROBE || v->payload_len < PKT_PROBE_FIXED)
+        return 0;
+
+    *host_us = pkt_get_u64(v->payload);
+    return 1;
+}
+
+// Type 5 payload. Copies up to 'max' forces; *count is how many.
+static inline int pkt_decode_forces(const pkt_view_t* v, pkt_force_t* forces,
+                                    uint8_t max, uint8_t* count)
+{
+    if (v->type != PKT_TYPE_FORCES || v->payload_len < PKT_FORCES_FIXED)
+        return 0;
+
+    uint8_t n = v->payload[0];
+    if (v->payload_len < PKT_FORCES_FIXED + n * sizeof(pkt_force_t))
+        return 0;
+
+    if (n > max)
+        n = max;
+
+    for (uint8_t i = 0; i < n; ++i) {
+        const uint8_t* f = v->payload + PKT_FORCES_FIXED + i * sizeof(pkt_force_t);
+        forces[i].fx = (int16_t)pkt_get_u16(f + 0);
+        forces[i].fy = (int16_t)pkt_get_u16(f + 2);
+        forces[i].fz = (int16_t)pkt_get_u16(f + 4);
+    }
+
+    *count = n;
+    return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif